@@ -30,27 +30,40 @@
 #include <click/master.hh>
 #include <click/router.hh>
 #include <click/standard/scheduleinfo.hh>
+#include <click/straccum.hh>
 #include <iostream>
 #include "echoclient.hh"
+#include "../tcp/tcpclock.hh"
 CLICK_DECLS
 
-EchoClient::EchoClient() : _verbose(false)
+EchoClient::EchoClient()
+	: _end_h(NULL), _nthreads(0), _thread(NULL), _wait(true), _verbose(false)
 {
 }
 
 int
 EchoClient::configure(Vector<String> &conf, ErrorHandler *errh)
 {
+	_length = 64;
+	_parallel = 1;
+	_connections = 1;
+	bool stop = false;
+
 	if (Args(conf, this, errh)
 		.read_mp("ADDRESS", _addr)
 		.read_mp("PORT", _port)
 		.read("LENGTH", _length)
 		.read("CONNECTIONS", _connections)
 		.read("PARALLEL", _parallel)
+		.read("STOP", stop)
+		.read("WAIT", _wait)
 		.read("VERBOSE", _verbose)
 		.complete() < 0)
 		return -1;
 
+	if (stop)
+		_end_h = new HandlerCall("stop");
+
 	return 0;
 }
 
@@ -61,6 +74,11 @@ EchoClient::initialize(ErrorHandler *errh)
 	if (r < 0)
 		return r;
 
+	// Stop once every core reaches the connection threshold
+	if (_end_h && _end_h->initialize_write(this, errh) < 0)
+		return -1;
+	_done = 0;
+
 	// Get the number of threads
 	_nthreads = master()->nthreads();   
 	
@@ -69,9 +87,11 @@ EchoClient::initialize(ErrorHandler *errh)
 	click_assert(_thread);        
 	
 	//Useful to synchronize multiple clients 
-	click_chatter("Press Enter to start the experiment:");
-        std::cin.get();
-        click_chatter("Experiment started");
+	if (_wait) {
+		click_chatter("Press Enter to start the experiment:");
+	        std::cin.get();
+	        click_chatter("Experiment started");
+	}
 	
 	// Start per-core tasks
 	for (uint32_t c = 0; c < _nthreads; c++) {
@@ -83,6 +103,13 @@ EchoClient::initialize(ErrorHandler *errh)
 	return 0;
 }
 
+void
+EchoClient::cleanup(CleanupStage)
+{
+	delete [] _thread;
+	delete _end_h;
+}
+
 bool
 EchoClient::run_task(Task *)
 {
@@ -135,6 +162,9 @@ EchoClient::push(int, Packet *p)
 	SET_TCP_SOCKFD_ANNO(p, fd);
 	output(0).push(p);
 
+	// Record the connection latency
+	t->latency.record((TCPClock::fresh() - t->start[fd]).nsecval());
+
 	// Increment closed connection counter
 	t->conn_c++;
 
@@ -146,6 +176,9 @@ EchoClient::push(int, Packet *p)
 		double rate_cps = t->conn_c/time;
 		click_chatter("%s: core %d conn %llu, time %.6f, rate %.0f conn/sec",
 							class_name(), c, t->conn_c, time, rate_cps);
+
+		if (_end_h && _done.fetch_and_add(1) + 1 == _nthreads)
+			(void)_end_h->call_write();
 		return;
 	}
 	
@@ -167,6 +200,12 @@ EchoClient::new_connection()
 	struct linger lin = { .l_onoff = 1, .l_linger = 0 };
 	assert(click_setsockopt(sockfd, SOL_SOCKET, SO_LINGER,(void*) (&lin),sizeof(lin))==0);
 
+	// Remember when the connection started
+	ThreadData *t = &_thread[click_current_cpu_id()];
+	if (sockfd >= t->start.size())
+		t->start.resize(sockfd + 1);
+	t->start[sockfd] = TCPClock::fresh();
+
 	//Send an empty message to open connection (using TCPEpollClient)
 	Packet* q = Packet::make((const void *)NULL, 0);
 	assert(q);
@@ -180,5 +219,36 @@ EchoClient::new_connection()
 	output(0).push(q);
 }
 
+String
+EchoClient::read_handler(Element *e, void *)
+{
+	EchoClient *ec = static_cast<EchoClient *>(e);
+	LatencyHistogram latency;
+	uint64_t conn = 0;
+	double time = 0;
+
+	for (uint32_t c = 0; c < ec->_nthreads; c++) {
+		ThreadData *t = &ec->_thread[c];
+		conn += t->conn_c;
+		latency.merge(t->latency);
+		if (t->end > t->begin)
+			time = MAX(time, (t->end - t->begin).doubleval());
+	}
+
+	StringAccum sa;
+	sa << "connections=" << conn << ' ';
+	sa << "seconds=" << time << ' ';
+	sa << "conn_per_sec=" << (time > 0 ? conn / time : 0) << ' ';
+	sa << latency.unparse("latency_us_", 1000);
+	return sa.take_string();
+}
+
+void
+EchoClient::add_handlers()
+{
+	add_read_handler("stats", read_handler, 0);
+}
+
 CLICK_ENDDECLS
 EXPORT_ELEMENT(EchoClient)
+ELEMENT_REQUIRES(TCPClock)
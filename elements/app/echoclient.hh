@@ -27,7 +27,10 @@
 #define CLICK_ECHOCLIENT_HH
 #include <click/element.hh>
 #include <click/tcpanno.hh>
+#include <click/handlercall.hh>
+#include <click/atomic.hh>
 #include "../tcp/tcpapplication.hh"
+#include "../tcp/latencyhistogram.hh"
 
 CLICK_DECLS
 
@@ -41,6 +44,8 @@ class EchoClient :  public TCPApplication {  public:
 
 	int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
 	int initialize(ErrorHandler *) CLICK_COLD;
+	void cleanup(CleanupStage) CLICK_COLD;
+	void add_handlers() CLICK_COLD;
 
 	void new_connection();
 
@@ -49,6 +54,8 @@ class EchoClient :  public TCPApplication {  public:
 		Timestamp end;
 		uint32_t conn_o;
 		uint32_t conn_c;
+		Vector<Timestamp> start;  // Connection start time per sockfd
+		LatencyHistogram latency; // Connect-to-echo latency in nsec
 
 		ThreadData() : conn_o(0), conn_c(0) { }
 	};
@@ -58,7 +65,10 @@ class EchoClient :  public TCPApplication {  public:
 
   private:
 
+	static String read_handler(Element *, void *) CLICK_COLD;
 
+	HandlerCall *_end_h;
+	atomic_uint32_t _done;
 	IPAddress _addr;
 	int _pid;
 	uint32_t _nthreads;
@@ -67,6 +77,7 @@ class EchoClient :  public TCPApplication {  public:
 	uint32_t _parallel;
 	uint16_t _port;
 	ThreadData *_thread;
+	bool _wait;
 	bool _verbose;
 };
 
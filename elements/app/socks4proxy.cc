@@ -38,7 +38,7 @@ CLICK_DECLS
 
 #define MAX_FDS 8192
 
-Socks4Proxy::Socks4Proxy() : _verbose(false)
+Socks4Proxy::Socks4Proxy() : _splice(true), _verbose(false)
 {
 }
 
@@ -46,6 +46,7 @@ int
 Socks4Proxy::configure(Vector<String> &conf, ErrorHandler *errh)
 {
 	if (Args(conf, this, errh)
+		.read("SPLICE", _splice)
 		.read("VERBOSE", _verbose)
 		.read("PID", _pid)
 		.complete() < 0)
@@ -254,6 +255,17 @@ Socks4Proxy::push(int port, Packet *p)
 				memcpy((void *)q->data(), msg, 8);
 				SET_TCP_SOCKFD_ANNO(q, _socketTable[c][fd].pair);
 				output(SOCKS4PROXY_OUT_SRV_PORT).push(q);
+
+				// Move data between both legs inside the stack
+				if (_splice) {
+					int pair = _socketTable[c][fd].pair;
+					if (click_splice(fd, pair) == 0 && click_splice(pair, fd) == 0) {
+						if (_verbose)
+							click_chatter("%s: spliced fd %d and fd %d", class_name(), fd, pair);
+					}
+					else if (_verbose)
+						click_chatter("%s: splice failed for fd %d and fd %d, forwarding", class_name(), fd, pair);
+				}
 				return;
 			}
 			
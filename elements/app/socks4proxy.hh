@@ -76,6 +76,7 @@ class Socks4Proxy :  public TCPApplication {  public:
 	
 	Vector<SocketTable> _socketTable; 
 	unsigned int _nthreads;
+	bool _splice;
 	bool _verbose;
 };
 
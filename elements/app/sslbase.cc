@@ -34,7 +34,15 @@
 #  include <pthread.h>
 # endif
 #endif
+#include <click/standard/scheduleinfo.hh>
+#include <click/tcpanno.hh>
+#include <clicknet/ether.h>
+#include <clicknet/ip.h>
+#include <clicknet/tcp.h>
+#include <clicknet/tcp.hh>
+#include "elements/tcp/tcpinfo.hh"
 #include "sslbase.hh"
+#include "sslbio.hh"
 CLICK_DECLS
 
 #if HAVE_OPENSSL
@@ -59,6 +67,7 @@ static void locking_callback(int mode, int n, const char *, int)
 # endif
 
 SSLBase::SSLBase()
+	: _thread(NULL), _nthreads(0), _mss(1448), _coalesce(true)
 {
 }
 
@@ -101,7 +110,215 @@ SSLBase::cleanup(CleanupStage)
 		pthread_mutex_destroy(&mutex[i]);
 # endif
 }
+
+int
+SSLBase::initialize_threads(ErrorHandler *errh)
+{
+	_nthreads = master()->nthreads();
+	_thread = new ThreadData[_nthreads];
+
+	for (uint32_t c = 0; c < _nthreads; c++) {
+		ThreadData *t = &_thread[c];
+
+		// Resize socket table
+		t->_socket.resize(TCPInfo::usr_capacity());
+
+		// Record staging buffer
+		t->_record = new unsigned char[SSL_RECORD_MAX];
+
+		// Per-core task writing coalesced records and polling completions
+		t->_task = new Task(this);
+		ScheduleInfo::initialize_task(this, t->_task, false, errh);
+		t->_task->move_thread(c);
+	}
+
+	return 0;
+}
+
+int
+SSLBase::ssl_attach(SSLSocket *s, SSL_CTX *ctx)
+{
+	// Create SSL object
+	s->ssl = SSL_new(ctx);
+	if (!s->ssl)
+		return -1;
+
+	// Create a single packet BIO for both directions
+	s->bio = SSLBIO::make(_mss);
+	if (!s->bio) {
+		SSL_free(s->ssl);
+		s->ssl = NULL;
+		return -1;
+	}
+
+	// Attach BIO to SSL object, which takes our reference
+	SSL_set_bio(s->ssl, s->bio, s->bio);
+
+	// Records are retried from the per-core staging buffer or the packet
+	// itself, with the same length (see ssl_write())
+	SSL_set_mode(s->ssl, SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+
+	return 0;
+}
+
+void
+SSLBase::ssl_enqueue(ThreadData *t, SSLSocket *s, int sockfd, Packet *p)
+{
+	// Insert packet into TX queue
+	s->txq.push_back(p);
+	s->txq_bytes += p->length();
+
+	// Write now if a full record is queued, otherwise wait until all
+	// packets pushed in this round are queued so they share records
+	if (!_coalesce || s->txq_bytes >= SSL_RECORD_MAX) {
+		ssl_process(t, s, sockfd);
+		return;
+	}
+
+	if (!s->pending) {
+		s->pending = true;
+		t->_pending.push_back(sockfd);
+		t->_task->reschedule();
+	}
+}
+
+bool
+SSLBase::run_task(Task *)
+{
+	unsigned c = click_current_cpu_id();
+	ThreadData *t = &_thread[c];
+
+	bool work = ssl_poll(t);
+	if (t->_pending.empty())
+		return work;
+
+	for (int i = 0; i < t->_pending.size(); i++) {
+		int sockfd = t->_pending[i];
+		SSLSocket *s = &(t->_socket[sockfd]);
+
+		// Socket may have been closed in the meantime
+		if (!s->pending || !s->ssl)
+			continue;
+
+		s->pending = false;
+		ssl_process(t, s, sockfd);
+	}
+	t->_pending.clear();
+
+	return true;
+}
+
+int
+SSLBase::ssl_write(ThreadData *t, SSLSocket *s)
+{
+	while (!s->txq.empty()) {
+		Packet *p = s->txq.front();
+		const unsigned char *data;
+
+		// A retried SSL_write() must pass the same length as before. The
+		// head of the queue is only released on success, so gathering the
+		// same number of bytes again yields the same plaintext.
+		int len = s->wlen;
+		if (!len) {
+			if (!p->next())
+				len = MIN(p->length(), SSL_RECORD_MAX);
+			else
+				len = MIN(s->txq_bytes, SSL_RECORD_MAX);
+		}
+
+		// Encrypt from the head packet in place if it holds the whole
+		// record, otherwise gather the queued packets into the record
+		if ((int)p->length() >= len)
+			data = p->data();
+		else {
+			int off = 0;
+			for (Packet *q = p; q && off < len; q = q->next()) {
+				int n = MIN((int)q->length(), len - off);
+				memcpy(t->_record + off, q->data(), n);
+				off += n;
+			}
+			data = t->_record;
+		}
+
+		int n = SSL_write(s->ssl, data, len);
+		if (n <= 0) {
+			s->wlen = len;
+			return SSL_get_error(s->ssl, n);
+		}
+		s->wlen = 0;
+
+		// Release the plaintext that was encrypted
+		s->txq_bytes -= n;
+		while (n > 0) {
+			Packet *q = s->txq.front();
+			if ((int)q->length() <= n) {
+				n -= q->length();
+				s->txq.pop_front();
+				q->kill();
+			}
+			else {
+				q->pull(n);
+				n = 0;
+			}
+		}
+	}
+
+	return SSL_ERROR_NONE;
+}
+
+int
+SSLBase::ssl_read(SSLSocket *s, int sockfd, int port)
+{
+	int err = SSL_ERROR_NONE;
+
+	// Read cleartext into MSS-sized packets and send it to the application
+	while (err == SSL_ERROR_NONE &&
+	       (SSL_pending(s->ssl) || SSLBIO::rx_pending(s->bio))) {
+		WritablePacket *q = Packet::make(TCP_HEADROOM, NULL, 0, _mss);
+		if (!q)
+			break;
+
+		// A packet may span more than one record
+		while (q->length() < _mss) {
+			int n = SSL_read(s->ssl, q->end_data(), _mss - q->length());
+			if (n <= 0) {
+				err = SSL_get_error(s->ssl, n);
+				break;
+			}
+			q = q->put(n);
+		}
+
+		if (!q->length()) {
+			q->kill();
+			continue;
+		}
+
+		SET_TCP_SOCKFD_ANNO(q, sockfd);
+		output(port).push(q);
+	}
+
+	// Waiting for more ciphertext is not an error
+	if (err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE)
+		err = SSL_ERROR_NONE;
+
+	return err;
+}
+
+void
+SSLBase::ssl_flush(SSLSocket *s, int sockfd, int port)
+{
+	// Send encrypted text to the network
+	Packet *p = SSLBIO::take(s->bio);
+	while (p) {
+		Packet *n = p->next();
+		p->set_next(NULL);
+		SET_TCP_SOCKFD_ANNO(p, sockfd);
+		output(port).push(p);
+		p = n;
+	}
+}
 #endif // HAVE_OPENSSL
 
 CLICK_ENDDECLS
+ELEMENT_REQUIRES(SSLBIO)
 ELEMENT_PROVIDES(SSLBase)
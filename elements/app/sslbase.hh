@@ -29,12 +29,16 @@
 #include <click/element.hh>
 #include <click/atomic.hh>
 #include <click/packetqueue.hh>
+#include <click/task.hh>
+#include <click/vector.hh>
 #if HAVE_OPENSSL
 # include <openssl/bio.h>
 # include <openssl/ssl.h>
 #endif
 CLICK_DECLS
 
+#define SSL_RECORD_MAX 16384      // maximum TLS record payload
+
 class SSLBase : public Element { public:
 
 	const char *class_name() const { return "SSLBase"; }
@@ -44,28 +48,65 @@ class SSLBase : public Element { public:
 
 	int initialize(ErrorHandler *) CLICK_COLD;
 	void cleanup(CleanupStage) CLICK_COLD;
+	bool run_task(Task *);
 
 	struct SSLSocket {
 		SSL *ssl;
-		BIO *rbio;
-		BIO *wbio;
+		BIO *bio;
 		bool verified;
 		bool shutdown;
+		bool pending;
+		bool busy;                  // handshake running on a crypto thread
+		uint32_t txq_bytes;
+		int wlen;                   // record length to retry SSL_write() with
 		PacketQueue txq;
-		PacketQueue rxq;
+		PacketQueue held;           // ciphertext received while busy
 
-		SSLSocket() : ssl(0), rbio(0), wbio(0), verified(0), shutdown(0) { }
+		SSLSocket() : ssl(0), bio(0), verified(0), shutdown(0), pending(0),
+		              busy(0), txq_bytes(0), wlen(0) { }
 
 		inline void clear() {
 			ssl  = NULL;
-			rbio = NULL;
-			wbio = NULL;
+			bio  = NULL;
 			verified = false;
 			shutdown = false;
+			pending = false;
+			busy = false;
+			txq_bytes = 0;
+			wlen = 0;
 			txq.clear();
-			rxq.clear();
+			held.clear();
 		}
 	};
+
+	struct ThreadData {
+		Vector<SSLSocket> _socket;
+		Vector<int> _pending;           // sockets with plaintext to coalesce
+		Vector<int> _backlog;           // handshakes waiting for a crypto ring
+		Task *_task;
+		unsigned char *_record;         // staging buffer for one TLS record
+		ThreadData() : _task(NULL), _record(NULL) { }
+	} CLICK_ALIGNED(CLICK_CACHE_LINE_SIZE);
+
+  protected:
+
+	int initialize_threads(ErrorHandler *);
+	int ssl_attach(SSLSocket *, SSL_CTX *);
+	void ssl_enqueue(ThreadData *, SSLSocket *, int, Packet *);
+	int ssl_write(ThreadData *, SSLSocket *);
+	int ssl_read(SSLSocket *, int, int);
+	void ssl_flush(SSLSocket *, int, int);
+
+	// Process a socket after new data is available in either direction
+	virtual void ssl_process(ThreadData *, SSLSocket *, int) = 0;
+
+	// Poll for work done outside the task, e.g., offloaded handshakes
+	virtual bool ssl_poll(ThreadData *) { return false; }
+
+	ThreadData *_thread;
+	uint32_t _nthreads;
+	uint16_t _mss;
+	bool _coalesce;
 # endif
 };
 
@@ -0,0 +1,256 @@
+/*
+ * sslbio.{cc,hh} -- OpenSSL BIO backed by Click packet chains
+ * Rafael Laufer, Massimo Gallo
+ *
+ * Copyright (c) 2019 Nokia Bell Labs
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+ *    in the documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ */
+
+#include <click/config.h>
+#include <click/glue.hh>
+#include <clicknet/ether.h>
+#include <clicknet/ip.h>
+#include <clicknet/tcp.h>
+#include <clicknet/tcp.hh>
+#include "sslbio.hh"
+#if HAVE_OPENSSL
+# include <pthread.h>
+#endif
+CLICK_DECLS
+
+#if HAVE_OPENSSL
+BIO_METHOD *SSLBIO::_method = NULL;
+
+static pthread_once_t once = PTHREAD_ONCE_INIT;
+
+BIO *
+SSLBIO::make(uint16_t mss)
+{
+	struct Init {
+		static void method() {
+			int type = BIO_get_new_index() | BIO_TYPE_SOURCE_SINK;
+			_method = BIO_meth_new(type, "click packet");
+			BIO_meth_set_write(_method, bwrite);
+			BIO_meth_set_read(_method, bread);
+			BIO_meth_set_ctrl(_method, ctrl);
+			BIO_meth_set_create(_method, create);
+			BIO_meth_set_destroy(_method, destroy);
+		}
+	};
+	pthread_once(&once, Init::method);
+
+	BIO *b = BIO_new(_method);
+	if (!b)
+		return NULL;
+
+	Data *d = new Data(mss);
+	BIO_set_data(b, d);
+	return b;
+}
+
+void
+SSLBIO::append(BIO *b, Packet *p)
+{
+	Data *d = (Data *)BIO_get_data(b);
+	d->rx_bytes += p->length();
+	d->rxq.push_back(p);
+}
+
+Packet *
+SSLBIO::take(BIO *b)
+{
+	// Hand over the whole chain of ciphertext packets
+	Data *d = (Data *)BIO_get_data(b);
+	settle(d);
+
+	Packet *p = d->txq.front();
+	while (!d->txq.empty())
+		d->txq.pop_front();
+	d->tx_bytes = d->stage.length();
+	return p;
+}
+
+void
+SSLBIO::begin_offload(BIO *b)
+{
+	Data *d = (Data *)BIO_get_data(b);
+	d->offload = true;
+}
+
+void
+SSLBIO::end_offload(BIO *b)
+{
+	Data *d = (Data *)BIO_get_data(b);
+	d->offload = false;
+	d->drained.clear();
+	settle(d);
+}
+
+size_t
+SSLBIO::rx_pending(BIO *b)
+{
+	return ((Data *)BIO_get_data(b))->rx_bytes;
+}
+
+size_t
+SSLBIO::tx_pending(BIO *b)
+{
+	return ((Data *)BIO_get_data(b))->tx_bytes;
+}
+
+int
+SSLBIO::fill(Data *d, const char *buf, int len)
+{
+	int left = len;
+	while (left > 0) {
+		// Fill the last packet up to the MSS before allocating a new one
+		WritablePacket *q = (WritablePacket *)d->txq.back();
+		if (!q || q->length() >= d->mss) {
+			q = Packet::make(TCP_HEADROOM, NULL, 0, d->mss);
+			if (!q)
+				break;
+			d->txq.push_back(q);
+		}
+
+		int n = d->mss - (int)q->length();
+		if (n > left)
+			n = left;
+		memcpy(q->end_data(), buf, n);
+		q = q->put(n);          // tailroom was reserved, no reallocation
+
+		buf += n;
+		left -= n;
+	}
+
+	return len - left;
+}
+
+void
+SSLBIO::settle(Data *d)
+{
+	// Move staged ciphertext into packets, keeping what does not fit
+	int len = d->stage.length();
+	if (!len || d->offload)
+		return;
+
+	int n = fill(d, d->stage.data(), len);
+	if (n < len)
+		memmove(d->stage.data(), d->stage.data() + n, len - n);
+	d->stage.adjust_length(-n);
+}
+
+int
+SSLBIO::bwrite(BIO *b, const char *buf, int len)
+{
+	Data *d = (Data *)BIO_get_data(b);
+	BIO_clear_retry_flags(b);
+
+	// Keep the byte order if ciphertext is (still) staged
+	if (d->offload || d->stage.length()) {
+		d->stage.append(buf, len);
+		d->tx_bytes += len;
+		settle(d);
+		return len;
+	}
+
+	int n = fill(d, buf, len);
+
+	// Out of packets, ask OpenSSL to retry the remainder later
+	if (n == 0) {
+		BIO_set_retry_write(b);
+		return -1;
+	}
+
+	d->tx_bytes += n;
+	return n;
+}
+
+int
+SSLBIO::bread(BIO *b, char *buf, int len)
+{
+	Data *d = (Data *)BIO_get_data(b);
+	BIO_clear_retry_flags(b);
+
+	if (d->rxq.empty()) {
+		BIO_set_retry_read(b);
+		return -1;
+	}
+
+	int done = 0;
+	while (done < len && !d->rxq.empty()) {
+		Packet *p = d->rxq.front();
+
+		int n = (int)p->length();
+		if (n > len - done)
+			n = len - done;
+		memcpy(buf + done, p->data(), n);
+		p->pull(n);
+		done += n;
+
+		if (!p->length()) {
+			d->rxq.pop_front();
+			if (d->offload)
+				d->drained.push_back(p);
+			else
+				p->kill();
+		}
+	}
+
+	d->rx_bytes -= done;
+	return done;
+}
+
+long
+SSLBIO::ctrl(BIO *b, int cmd, long, void *)
+{
+	Data *d = (Data *)BIO_get_data(b);
+
+	switch (cmd) {
+	case BIO_CTRL_PENDING:
+		return d ? d->rx_bytes : 0;
+	case BIO_CTRL_WPENDING:
+		return d ? d->tx_bytes : 0;
+	case BIO_CTRL_FLUSH:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+int
+SSLBIO::create(BIO *b)
+{
+	BIO_set_init(b, 1);
+	BIO_set_data(b, NULL);
+	return 1;
+}
+
+int
+SSLBIO::destroy(BIO *b)
+{
+	Data *d = (Data *)BIO_get_data(b);
+	delete d;
+	BIO_set_data(b, NULL);
+	return 1;
+}
+#endif // HAVE_OPENSSL
+
+CLICK_ENDDECLS
+ELEMENT_PROVIDES(SSLBIO)
@@ -0,0 +1,85 @@
+/*
+ * sslbio.{cc,hh} -- OpenSSL BIO backed by Click packet chains
+ * Rafael Laufer, Massimo Gallo
+ *
+ * Copyright (c) 2019 Nokia Bell Labs
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+ *    in the documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ */
+
+#ifndef CLICK_SSLBIO_HH
+#define CLICK_SSLBIO_HH
+#include <click/config.h>
+#include <click/packet.hh>
+#include <click/packetqueue.hh>
+#include <click/straccum.hh>
+#if HAVE_OPENSSL
+# include <openssl/bio.h>
+#endif
+CLICK_DECLS
+
+#if HAVE_OPENSSL
+// A BIO that reads ciphertext directly from the packets received from the
+// network and writes ciphertext directly into MSS-sized packets with TCP
+// headroom, so the intermediate copies of a BIO_s_mem pair are avoided.
+class SSLBIO { public:
+
+	static BIO *make(uint16_t mss);
+
+	static void append(BIO *, Packet *);
+	static Packet *take(BIO *);
+	static size_t rx_pending(BIO *);
+	static size_t tx_pending(BIO *);
+
+	// While a handshake runs on a crypto thread, which cannot allocate or
+	// free packets, ciphertext is staged and consumed packets are kept
+	static void begin_offload(BIO *);
+	static void end_offload(BIO *);
+
+  private:
+
+	struct Data {
+		PacketQueue rxq;        // ciphertext from the network
+		PacketQueue txq;        // ciphertext to the network
+		PacketQueue drained;    // packets consumed while offloaded
+		StringAccum stage;      // ciphertext written while offloaded
+		size_t rx_bytes;
+		size_t tx_bytes;
+		uint16_t mss;
+		bool offload;
+
+		Data(uint16_t m) : rx_bytes(0), tx_bytes(0), mss(m), offload(false) { }
+	};
+
+	static int fill(Data *, const char *, int);
+	static void settle(Data *);
+
+	static int bwrite(BIO *, const char *, int);
+	static int bread(BIO *, char *, int);
+	static long ctrl(BIO *, int, long, void *);
+	static int create(BIO *);
+	static int destroy(BIO *);
+
+	static BIO_METHOD *_method;
+
+};
+#endif
+
+CLICK_ENDDECLS
+#endif
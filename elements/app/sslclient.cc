@@ -34,6 +34,7 @@
 #endif
 #include "elements/tcp/tcpinfo.hh"
 #include "sslclient.hh"
+#include "sslbio.hh"
 CLICK_DECLS
 
 #if HAVE_OPENSSL
@@ -49,6 +50,8 @@ SSLClient::configure(Vector<String> &conf, ErrorHandler *errh)
 
 	if (Args(conf, this, errh)
 		.read("SELF_SIGNED", _self_signed)
+		.read("MSS", _mss)
+		.read("COALESCE", _coalesce)
 		.read("VERBOSE", _verbose)
 		.complete() < 0)
 		return -1;
@@ -87,22 +90,21 @@ SSLClient::initialize(ErrorHandler *errh)
 	// Client verifies server, but server does not verify client
 	SSL_CTX_set_verify(_ctx, SSL_VERIFY_NONE, NULL);
 
-	// Resize socket table
-	_socket.resize(TCPInfo::usr_capacity());
-
-	return 0;
+	return initialize_threads(errh);
 }
 
 void
 SSLClient::cleanup(CleanupStage s)
 {
-	for (int i = 0; i < _socket.capacity(); i++) {
-		SSLSocket *s = &_socket[i];
+	for (uint32_t c = 0; c < _nthreads; c++) {
+		for (int i = 0; i < _thread[c]._socket.capacity(); i++) {
+			SSLSocket *s = &(_thread[c]._socket[i]);
 
-		if (s->ssl) {
-			SSL_shutdown(s->ssl);
-			SSL_free(s->ssl);
-			s->clear();
+			if (s->ssl) {
+				SSL_shutdown(s->ssl);
+				SSL_free(s->ssl);
+				s->clear();
+			}
 		}
 	}
 
@@ -113,10 +115,14 @@ void
 SSLClient::push(int port, Packet *p)
 {
 	int sockfd = TCP_SOCKFD_ANNO(p);
-	assert(sockfd < _socket.capacity());
+
+	unsigned c = click_current_cpu_id();
+	ThreadData *t = &_thread[c];
+
+	assert(sockfd < t->_socket.capacity());
 
 	// Get SSL socket information
-	SSLSocket *s = &_socket[sockfd];
+	SSLSocket *s = &(t->_socket[sockfd]);
 
 	// Process network and application packets
 	switch (port) {
@@ -147,60 +153,25 @@ SSLClient::push(int port, Packet *p)
 			return;
 		}
 
-		// Insert packet into RX queue
-		s->rxq.push_back(p);
-
-		while (!s->rxq.empty()) {
-			Packet *q = s->rxq.front();
+		// Hand the ciphertext over to the BIO without copying
+		SSLBIO::append(s->bio, p);
 
-			int numWr = BIO_write(s->wbio, q->data(), q->length());
-			int err = SSL_get_error(s->ssl, numWr);
-
-			// No errors
-			if (err == SSL_ERROR_NONE) {
-				q->pull(numWr);
-				if (!q->length()) {
-					s->rxq.pop_front();
-					q->kill();
-				}
-				continue;
-			}
-
-			// Check if a serious error occurred
-			if (err != SSL_ERROR_WANT_READ && err != SSL_ERROR_WANT_WRITE) {
-				click_chatter("%s: bad BIO_write(), shutting down sockfd %d",
-				   class_name());
-				SSL_shutdown(s->ssl);
-			}
-
-			break;
-		}
-
-		// Flush written data
-		(void)BIO_flush(s->wbio);
 		break;
 
 	case SSL_CLIENT__IN_APP_PORT:
 		// If new connection, create SSL socket
 		if (!s->ssl && TCP_SOCK_ADD_FLAG_ANNO(p)) {
-			// Create SSL object
-			s->ssl = SSL_new(_ctx);
-			assert(s->ssl);
-
-			// Create basic I/O (BIO) pair
-			s->rbio = BIO_new(BIO_s_mem());
-			s->wbio = BIO_new(BIO_s_mem());
-			assert(s->rbio && s->wbio);
-
-			// Attach BIO pair to SSL object
-			SSL_set_bio(s->ssl, s->wbio, s->rbio);
+			// Create SSL object and attach a packet BIO to it
+			int r = ssl_attach(s, _ctx);
+			assert(r == 0);
+			(void)r;
 
 			// Set behavior
 			SSL_set_connect_state(s->ssl);
 
 			// Start SSL handshake
 			SSL_do_handshake(s->ssl);
-			
+
 			if (_verbose)
 				click_chatter("%s: SSL Handshake started sockfd %d", class_name(), sockfd);
 		}
@@ -224,33 +195,29 @@ SSLClient::push(int port, Packet *p)
 			return;
 		}
 
-		// Insert packet into TX queue
-		s->txq.push_back(p);
-
-		break;
+		// Queue plaintext, records are written once coalesced
+		ssl_enqueue(t, s, sockfd, p);
+		return;
 
 	default:
 		assert(0);
 	}
 
+	ssl_process(t, s, sockfd);
+}
+
+void
+SSLClient::ssl_process(ThreadData *t, SSLSocket *s, int sockfd)
+{
 	// Read cleartext and send it to the application
-	while (SSL_pending(s->ssl) || BIO_ctrl_pending(s->wbio) > 0) {
-		Packet *k = Packet::make((const void *)NULL, 0);
-		if (k) {
-			WritablePacket *q = k->uniqueify();
-			assert(q);
-
-			int numRd = SSL_read(s->ssl, q->data(), q->tailroom());
-   			if (numRd > 0) {
-				q = q->put(numRd);
-				SET_TCP_SOCKFD_ANNO(q, sockfd);
-				output(SSL_CLIENT_OUT_APP_PORT).push(q);
-			}
-			else {
-				q->kill();
-				break;
-			}
-		}
+	int err = ssl_read(s, sockfd, SSL_CLIENT_OUT_APP_PORT);
+
+	// The server closed the connection, or a serious error occurred
+	if (err == SSL_ERROR_ZERO_RETURN)
+		s->shutdown = true;
+	else if (err != SSL_ERROR_NONE) {
+		click_chatter("%s: bad SSL_read()", class_name());
+		SSL_shutdown(s->ssl);
 	}
 
 	// If SSL handshake is over, verify the server certificate and trasmit data
@@ -270,34 +237,21 @@ SSLClient::push(int port, Packet *p)
 				click_chatter("%s: sockfd %d could not be verified", 
 				                                          class_name(), sockfd);
 				s->txq.clear();
+				s->txq_bytes = 0;
 				s->shutdown = true;
 			}
 		}
 
 		// After SSL handshake and verification, send packets in TX queue
-		while (!s->txq.empty()) {
-			Packet *q = s->txq.front();
-
-			int numWr = SSL_write(s->ssl, q->data(), q->length());
-			int err = SSL_get_error(s->ssl, numWr);
-
-			// No errors
-			if (err == SSL_ERROR_NONE) {
-				q->pull(numWr);
-				if (!q->length()) {
-					s->txq.pop_front();
-					q->kill();
-				}
-				continue;
-			}
+		if (!s->txq.empty()) {
+			err = ssl_write(t, s);
 
 			// Check if a serious error occurred
-			if (err != SSL_ERROR_WANT_READ && err != SSL_ERROR_WANT_WRITE) {
+			if (err != SSL_ERROR_NONE && err != SSL_ERROR_WANT_READ &&
+			    err != SSL_ERROR_WANT_WRITE) {
 				click_chatter("%s: bad SSL_write()", class_name());
 				SSL_shutdown(s->ssl);
 			}
-
-			break;
 		}
 	}
 
@@ -309,30 +263,12 @@ SSLClient::push(int port, Packet *p)
 	}
 
 	// Read encrypted text and send it to the network
-	while (BIO_ctrl_pending(s->rbio) > 0) {
-		Packet *k = Packet::make((const void *)NULL, 0);
-		if (k) {
-			WritablePacket *q = k->uniqueify();
-			assert(q);
-
-			int numRd = BIO_read(s->rbio, q->data(), q->tailroom());
-			if (numRd > 0) {
-				q = q->put(numRd);
-				SET_TCP_SOCKFD_ANNO(q, sockfd);
-				output(SSL_CLIENT_OUT_NET_PORT).push(q);
-			}
-			else {
-				q->kill();
-				break;
-			}
-		}
-	}
+	ssl_flush(s, sockfd, SSL_CLIENT_OUT_NET_PORT);
 
 	// If the connection shutdown was clean, release resources
 	if (SSL_get_shutdown(s->ssl) & (SSL_SENT_SHUTDOWN|SSL_RECEIVED_SHUTDOWN)) {
 		if (_verbose)
 			click_chatter("%s: Propagating shutdown to lower layers sockfd %d", class_name(), sockfd);
-
 		SSL_free(s->ssl);
 		s->clear();
 
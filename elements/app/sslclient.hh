@@ -61,9 +61,10 @@ class SSLClient : public SSLBase { public:
 
   private:
 
+	void ssl_process(ThreadData *, SSLSocket *, int);
+
 	SSL_CTX *_ctx;
 	bool _self_signed;
-	Vector<SSLSocket> _socket;
 	bool _verbose;
 
 
@@ -0,0 +1,260 @@
+/*
+ * sslcrypto.{cc,hh} -- TLS handshake offload to crypto threads
+ * Rafael Laufer, Massimo Gallo
+ *
+ * Copyright (c) 2019 Nokia Bell Labs
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+ *    in the documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ */
+
+#include <click/config.h>
+#include <click/glue.hh>
+#include <click/machine.hh>
+#include <click/straccum.hh>
+#include "sslcrypto.hh"
+#if HAVE_OPENSSL
+# include <openssl/err.h>
+# include <sched.h>
+# include <unistd.h>
+# include <sys/eventfd.h>
+#endif
+CLICK_DECLS
+
+#if HAVE_OPENSSL
+#define SSL_CRYPTO_SPIN 4096    // empty polls before a worker starts sleeping
+
+__thread SSLCrypto::Job *SSLCrypto::_job;
+
+SSLCrypto::SSLCrypto()
+	: _core(NULL), _worker(NULL), _nthreads(0), _nworkers(0), _size(0),
+	  _stop(false)
+{
+}
+
+SSLCrypto::~SSLCrypto()
+{
+	stop();
+	delete[] _core;
+	delete[] _worker;
+}
+
+int
+SSLCrypto::start(const Vector<int> &cpus, uint32_t nthreads, uint32_t size)
+{
+	_nthreads = nthreads;
+	_nworkers = cpus.size() < (int)nthreads ? cpus.size() : nthreads;
+	_size = size;
+	_stop = false;
+
+	_core = new Core[_nthreads];
+	for (uint32_t c = 0; c < _nthreads; c++)
+		if (_core[c].submitq.initialize(size) < 0 ||
+		    _core[c].completeq.initialize(size) < 0)
+			return -1;
+
+	_worker = new Worker[_nworkers];
+	for (uint32_t i = 0; i < _nworkers; i++) {
+		Worker *w = &_worker[i];
+		w->pool = this;
+		w->id = i;
+		w->cpu = cpus[i];
+
+		if ((w->efd = eventfd(0, EFD_CLOEXEC)) < 0) {
+			stop();
+			return -1;
+		}
+
+		if (pthread_create(&w->tid, NULL, run, w) != 0) {
+			stop();
+			return -1;
+		}
+		w->running = true;
+	}
+
+	return 0;
+}
+
+void
+SSLCrypto::stop()
+{
+	if (!_worker)
+		return;
+
+	__atomic_store_n(&_stop, true, __ATOMIC_RELEASE);
+	for (uint32_t i = 0; i < _nworkers; i++) {
+		Worker *w = &_worker[i];
+		if (w->running) {
+			wake(w);
+			pthread_join(w->tid, NULL);
+			w->running = false;
+		}
+		if (w->efd >= 0) {
+			close(w->efd);
+			w->efd = -1;
+		}
+	}
+}
+
+void
+SSLCrypto::wake(Worker *w)
+{
+	uint64_t one = 1;
+	ssize_t r = write(w->efd, &one, sizeof(one));
+	(void)r;
+}
+
+// Block until a job is submitted, returning false if stopping
+bool
+SSLCrypto::idle(Worker *w)
+{
+	__atomic_store_n(&w->sleeping, true, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	// Look again, a job may have been submitted before the flag was seen
+	bool empty = true;
+	for (uint32_t c = w->id; c < _nthreads && empty; c += _nworkers)
+		empty = _core[c].submitq.empty();
+
+	if (empty && !__atomic_load_n(&_stop, __ATOMIC_ACQUIRE)) {
+		uint64_t n;
+		if (read(w->efd, &n, sizeof(n)) == sizeof(n))
+			w->wakeups++;
+	}
+
+	__atomic_store_n(&w->sleeping, false, __ATOMIC_RELAXED);
+	return !__atomic_load_n(&_stop, __ATOMIC_ACQUIRE);
+}
+
+// Run an action on the owner core, when the job completes if on a worker
+bool
+SSLCrypto::defer(Action fn, void *a, void *b)
+{
+	Job *j = _job;
+	if (!j) {
+		fn(a, b);
+		return true;
+	}
+
+	if (j->nactions == SSL_CRYPTO_ACTIONS)
+		return false;
+
+	j->action[j->nactions].fn = fn;
+	j->action[j->nactions].a = a;
+	j->action[j->nactions].b = b;
+	j->nactions++;
+	return true;
+}
+
+void
+SSLCrypto::increment(void *a, void *)
+{
+	(*(uint64_t *)a)++;
+}
+
+// Increment a per-core counter of core()
+void
+SSLCrypto::count(uint64_t *x)
+{
+	defer(increment, x, NULL);
+}
+
+void *
+SSLCrypto::run(void *arg)
+{
+	Worker *w = (Worker *)arg;
+	SSLCrypto *pool = w->pool;
+
+	// Pin the worker to its core
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(w->cpu, &set);
+	if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+		click_chatter("SSLCrypto: cannot pin worker %u to core %d", w->id, w->cpu);
+
+	uint32_t idle = 0;
+	while (!__atomic_load_n(&pool->_stop, __ATOMIC_ACQUIRE)) {
+		bool work = false;
+
+		for (uint32_t c = w->id; c < pool->_nthreads; c += pool->_nworkers) {
+			Core &m = pool->_core[c];
+			Job j;
+
+			while (m.submitq.pop(j)) {
+				// The callbacks defer their effects into the job
+				_job = &j;
+
+				click_cycles_t cycles = click_get_cycles();
+				int r = SSL_do_handshake(j.ssl);
+				w->cycles += click_get_cycles() - cycles;
+				w->jobs++;
+
+				_job = NULL;
+
+				// The error queue is per thread, hand its head over to the
+				// network core and do not leak it into the next job
+				if (r <= 0) {
+					j.err = SSL_get_error(j.ssl, r);
+					j.error = ERR_peek_error();
+				}
+				ERR_clear_error();
+
+				while (!m.completeq.push(j))
+					click_relax_fence();
+
+				work = true;
+			}
+		}
+
+		// Busy poll for a while, then sleep until a job is submitted
+		if (work)
+			idle = 0;
+		else if (++idle < SSL_CRYPTO_SPIN)
+			click_relax_fence();
+		else if (pool->idle(w))
+			idle = 0;
+	}
+
+	return NULL;
+}
+
+String
+SSLCrypto::unparse() const
+{
+	StringAccum sa;
+
+	for (uint32_t i = 0; i < _nworkers; i++) {
+		const Worker &w = _worker[i];
+		sa << "worker " << i << " cpu " << w.cpu << " jobs " << w.jobs
+		   << " cycles_per_job " << (w.jobs ? w.cycles / w.jobs : 0)
+		   << " wakeups " << w.wakeups << '\n';
+	}
+
+	for (uint32_t c = 0; c < _nthreads; c++) {
+		const Core &m = _core[c];
+		sa << "core " << c << " submitted " << m.submitted
+		   << " completed " << m.completed << " inflight " << m.inflight
+		   << " full " << m.full << '\n';
+	}
+
+	return sa.take_string();
+}
+#endif // HAVE_OPENSSL
+
+CLICK_ENDDECLS
+ELEMENT_PROVIDES(SSLCrypto)
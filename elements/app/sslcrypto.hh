@@ -0,0 +1,194 @@
+/*
+ * sslcrypto.{cc,hh} -- TLS handshake offload to crypto threads
+ * Rafael Laufer, Massimo Gallo
+ *
+ * Copyright (c) 2019 Nokia Bell Labs
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+ *    in the documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ */
+
+#ifndef CLICK_SSLCRYPTO_HH
+#define CLICK_SSLCRYPTO_HH
+#include <click/config.h>
+#include <click/glue.hh>
+#include <click/string.hh>
+#include <click/vector.hh>
+#if HAVE_OPENSSL
+# include <openssl/ssl.h>
+# include <pthread.h>
+#endif
+#include "elements/tcp/spscring.hh"
+CLICK_DECLS
+
+#if HAVE_OPENSSL
+#define SSL_CRYPTO_ACTIONS 4    // deferred actions per handshake
+// A pool of threads, pinned to dedicated cores, running SSL_do_handshake()
+// on behalf of the network cores. Each network core has a submission and a
+// completion ring to the worker serving it (core % workers), so no locks are
+// taken on the packet path.
+//
+// Workers only run the crypto. Whatever the SSL callbacks would do to the
+// per-core state of the submitting core (session cache, counters) is
+// deferred into the job and carried out by that core when it completes.
+class SSLCrypto { public:
+
+	typedef void (*Action)(void *, void *);
+
+	struct Job {
+		SSL *ssl;
+		int sockfd;
+		int core;                   // network core that submitted the job
+		int err;                    // SSL_get_error() of the handshake
+		unsigned long error;        // first error in the worker's queue
+		uint32_t nactions;
+		struct {
+			Action fn;
+			void *a;
+			void *b;
+		} action[SSL_CRYPTO_ACTIONS];
+	};
+
+	SSLCrypto();
+	~SSLCrypto();
+
+	int start(const Vector<int> &cpus, uint32_t nthreads, uint32_t size);
+	void stop();
+
+	inline bool enabled() const {
+		return _nworkers > 0;
+	}
+
+	// Called by network cores only
+	inline bool submit(Job &);
+	inline bool complete(Job &);
+	inline uint32_t inflight() const;
+
+	// Called by the SSL callbacks, on a network core or a worker
+	static bool defer(Action, void *, void *);
+	static void count(uint64_t *);
+	static inline unsigned core();
+
+	String unparse() const;
+
+  private:
+
+	struct Core {
+		SPSCRing<Job> submitq;      // network core -> worker
+		SPSCRing<Job> completeq;    // worker -> network core
+		uint32_t inflight;
+		uint64_t submitted;
+		uint64_t completed;
+		uint64_t full;
+
+		Core() : inflight(0), submitted(0), completed(0), full(0) { }
+	} CLICK_ALIGNED(CLICK_CACHE_LINE_SIZE);
+
+	struct Worker {
+		SSLCrypto *pool;
+		pthread_t tid;
+		int cpu;
+		uint32_t id;
+		bool running;
+		int efd;                    // eventfd to wake the worker up
+		bool sleeping;
+		uint64_t jobs;
+		uint64_t cycles;
+		uint64_t wakeups;
+
+		Worker() : pool(NULL), cpu(-1), id(0), running(false), efd(-1),
+		           sleeping(false), jobs(0), cycles(0), wakeups(0) { }
+	} CLICK_ALIGNED(CLICK_CACHE_LINE_SIZE);
+
+	static void *run(void *);
+	bool idle(Worker *);
+	static void wake(Worker *);
+	static void increment(void *, void *);
+
+	static __thread Job *_job;      // job running on this worker, if any
+
+	Core *_core;
+	Worker *_worker;
+	uint32_t _nthreads;
+	uint32_t _nworkers;
+	uint32_t _size;
+	bool _stop;
+
+};
+
+inline bool
+SSLCrypto::submit(Job &j)
+{
+	unsigned c = click_current_cpu_id();
+	Core &m = _core[c];
+
+	j.core = c;
+	j.err = SSL_ERROR_NONE;
+	j.error = 0;
+	j.nactions = 0;
+
+	// Bounding the jobs in flight guarantees room in the completion ring
+	if (m.inflight >= _size || !m.submitq.push(j)) {
+		m.full++;
+		return false;
+	}
+
+	m.inflight++;
+	m.submitted++;
+
+	// Pairs with the fence in idle(), so that either the worker sees the
+	// job or we see it sleeping
+	Worker *w = &_worker[c % _nworkers];
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&w->sleeping, __ATOMIC_RELAXED))
+		wake(w);
+
+	return true;
+}
+
+inline bool
+SSLCrypto::complete(Job &j)
+{
+	Core &m = _core[click_current_cpu_id()];
+	if (!m.completeq.pop(j))
+		return false;
+
+	// Carry out what the callbacks left for this core
+	for (uint32_t i = 0; i < j.nactions; i++)
+		j.action[i].fn(j.action[i].a, j.action[i].b);
+
+	m.inflight--;
+	m.completed++;
+	return true;
+}
+
+inline uint32_t
+SSLCrypto::inflight() const
+{
+	return _core[click_current_cpu_id()].inflight;
+}
+
+inline unsigned
+SSLCrypto::core()
+{
+	return _job ? _job->core : click_current_cpu_id();
+}
+#endif
+
+CLICK_ENDDECLS
+#endif
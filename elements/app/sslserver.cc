@@ -28,16 +28,22 @@
 #include <click/args.hh>
 #include <click/error.hh>
 #include <click/standard/scheduleinfo.hh>
+#include <click/userutils.hh>
+#include <click/confparse.hh>
 #if HAVE_OPENSSL
 # include <openssl/err.h>
 #endif
 #include <click/tcpanno.hh>
 #include "elements/tcp/tcpinfo.hh"
 #include "sslserver.hh"
+#include "sslbio.hh"
 CLICK_DECLS
 
 #if HAVE_OPENSSL
-SSLServer::SSLServer() : _verbose(false)
+SSLServer::SSLServer()
+	: _rotate_timer(this), _cache_size(16384), _cache_timeout(300),
+	  _use_tickets(true), _ticket_keys(2), _ticket_rotate(3600),
+	  _crypto_ring(256), _verbose(false)
 {
 }
 
@@ -51,6 +57,7 @@ SSLServer::configure(Vector<String> &conf, ErrorHandler *errh)
 	_o  = "Organization";
 	_ou = "OrganizationalUnit";
 	_cn = "CommonName";
+	String crypto;
 
 	if (Args(conf, this, errh)
 	    .read("CERT_FILE", _cert_file)
@@ -61,9 +68,35 @@ SSLServer::configure(Vector<String> &conf, ErrorHandler *errh)
 	    .read("O", _o)
 	    .read("OU", _ou)
 	    .read("CN", _cn)
+	    .read("MSS", _mss)
+	    .read("COALESCE", _coalesce)
+	    .read("SESSION_CACHE", _cache_size)
+	    .read("SESSION_TIMEOUT", _cache_timeout)
+	    .read("TICKETS", _use_tickets)
+	    .read("TICKET_KEY_FILE", _ticket_key_file)
+	    .read("TICKET_KEYS", _ticket_keys)
+	    .read("TICKET_ROTATE", _ticket_rotate)
+	    .read("CRYPTO_THREADS", AnyArg(), crypto)
+	    .read("CRYPTO_RING", _crypto_ring)
 	    .complete() < 0)
 		return -1;
 
+	// Cores running the handshakes offloaded by the network cores
+	Vector<String> v;
+	cp_spacevec(crypto, v);
+	for (int i = 0; i < v.size(); i++) {
+		int cpu;
+		if (!IntArg().parse(v[i], cpu) || cpu < 0)
+			return errh->error("CRYPTO_THREADS must be a list of cores");
+		_crypto_cpus.push_back(cpu);
+	}
+
+	if (_crypto_cpus.size() && _crypto_ring < 1)
+		return errh->error("CRYPTO_RING must be positive");
+
+	if (_use_tickets && _ticket_keys < 1)
+		return errh->error("TICKET_KEYS must be at least 1");
+
     return 0;
 }
 
@@ -204,13 +237,43 @@ SSLServer::initialize(ErrorHandler *errh)
 	SSL_CTX_set_tmp_rsa(_ctx, rsa);
 	RSA_free(rsa);
 
-	_nthreads = master()->nthreads();
-	_thread = new ThreadData[_nthreads];
-	
-	for (uint32_t c = 0; c < _nthreads; c++) {
-		// Resize socket table
-		_thread[c]._socket.resize(TCPInfo::usr_capacity());
+	r = initialize_threads(errh);
+	if (r < 0)
+		return r;
+
+	// Sessions resumed by ID are kept in a per-core cache, looked up in
+	// the other cores if the client reconnects through another core
+	SSL_CTX_set_session_id_context(_ctx, (const unsigned char *)"ClickNF", 7);
+	SSL_CTX_set_timeout(_ctx, _cache_timeout);
+
+	if (_cache.configure(_ctx, _nthreads, _cache_size) < 0)
+		return errh->error("error configuring session cache");
+
+	// Stateless resumption with session tickets
+	if (_use_tickets) {
+		String key;
+		if (_ticket_key_file) {
+			key = file_string(_ticket_key_file, errh);
+			if (key.length() != sizeof(SSLTicketKeys::Key))
+				return errh->error("%s: ticket key must have %d bytes",
+				        _ticket_key_file.c_str(), sizeof(SSLTicketKeys::Key));
+		}
+
+		if (_tickets.configure(_ctx, _nthreads, _ticket_keys, key) < 0)
+			return errh->error("error configuring session ticket keys");
+
+		if (_ticket_rotate) {
+			_rotate_timer.initialize(this);
+			_rotate_timer.schedule_after_sec(_ticket_rotate);
+		}
 	}
+	else
+		SSL_CTX_set_options(_ctx, SSL_OP_NO_TICKET);
+
+	// Handshake offload
+	if (_crypto_cpus.size() &&
+	    _crypto.start(_crypto_cpus, _nthreads, _crypto_ring) < 0)
+		return errh->error("error starting crypto threads");
 
 	return 0;
 }
@@ -218,11 +281,17 @@ SSLServer::initialize(ErrorHandler *errh)
 void
 SSLServer::cleanup(CleanupStage)
 {
+	// No handshake may be running when SSL objects are freed
+	_crypto.stop();
+
 	for (uint32_t c = 0; c < _nthreads; c++) {
 		for (int i = 0; i < _thread[c]._socket.capacity(); i++) {
 			SSLSocket *s = &(_thread[c]._socket[i]);
 
 			if (s->ssl) {
+				if (s->busy)
+					SSLBIO::end_offload(s->bio);
+
 				SSL_shutdown(s->ssl);
 				SSL_free(s->ssl);
 				s->clear();
@@ -231,6 +300,51 @@ SSLServer::cleanup(CleanupStage)
 	}
 }
 
+void
+SSLServer::run_timer(Timer *)
+{
+	if (_tickets.rotate() < 0)
+		click_chatter("%s: error rotating session ticket keys", class_name());
+
+	_rotate_timer.reschedule_after_sec(_ticket_rotate);
+}
+
+String
+SSLServer::read_handler(Element *e, void *thunk)
+{
+	SSLServer *s = static_cast<SSLServer *>(e);
+
+	if (thunk)
+		return s->_crypto.enabled() ? s->_crypto.unparse() : String();
+
+	String r = s->_cache.unparse();
+	if (s->_use_tickets)
+		r += s->_tickets.unparse();
+
+	return r;
+}
+
+int
+SSLServer::write_handler(const String &, Element *e, void *, ErrorHandler *errh)
+{
+	SSLServer *s = static_cast<SSLServer *>(e);
+
+	if (!s->_use_tickets)
+		return errh->error("session tickets are disabled");
+	if (s->_tickets.rotate() < 0)
+		return errh->error("error rotating session ticket keys");
+
+	return 0;
+}
+
+void
+SSLServer::add_handlers()
+{
+	add_read_handler("sessions", read_handler, 0);
+	add_read_handler("crypto", read_handler, 1);
+	add_write_handler("rotate_ticket_key", write_handler, 0);
+}
+
 void
 SSLServer::push(int port, Packet *p)
 {
@@ -249,20 +363,10 @@ SSLServer::push(int port, Packet *p)
 	case SSL_SERVER__IN_NET_PORT:
 		// If new connection, create SSL socket
 		if (!s->ssl && TCP_SOCK_ADD_FLAG_ANNO(p)) {
-			// Make sure this is a new connection
-			assert(!s->ssl);
-
-			// Create SSL object
-			s->ssl = SSL_new(_ctx);
-			assert(s->ssl);
-
-			// Create basic I/O (BIO) pair
-			s->rbio = BIO_new(BIO_s_mem());
-			s->wbio = BIO_new(BIO_s_mem());
-			assert(s->rbio && s->wbio);
-
-			// Attach BIO pair to SSL object
-			SSL_set_bio(s->ssl, s->wbio, s->rbio);
+			// Create SSL object and attach a packet BIO to it
+			int r = ssl_attach(s, _ctx);
+			assert(r == 0);
+			(void)r;
 
 			// Set behavior
 			SSL_set_accept_state(s->ssl);
@@ -277,6 +381,12 @@ SSLServer::push(int port, Packet *p)
 			return;
 		}
 
+		// Handshake running on a crypto thread, replay when it completes
+		if (s->busy) {
+			s->held.push_back(p);
+			return;
+		}
+
 		// Connection closed by peer
 		if (TCP_SOCK_DEL_FLAG_ANNO(p)) {
 			SSL_shutdown(s->ssl);
@@ -297,41 +407,31 @@ SSLServer::push(int port, Packet *p)
 			return;
 		}
 
-		// Insert packet into RX queue
-		s->rxq.push_back(p);
-
-		while (!s->rxq.empty()) {
-			Packet *q = s->rxq.front();
+		// Hand the ciphertext over to the BIO without copying
+		SSLBIO::append(s->bio, p);
 
-			int numWr = BIO_write(s->wbio, q->data(), q->length());
-			int err = SSL_get_error(s->ssl, numWr);
-
-			// No errors
-			if (err == SSL_ERROR_NONE) {
-				q->pull(numWr);
-				if (!q->length()) {
-					s->rxq.pop_front();
-					q->kill();
-				}
-				continue;
+		// If handshake is not finished yet, call do_hanshake
+		if (!SSL_is_init_finished(s->ssl)) {
+			if (_crypto.enabled()) {
+				ssl_offload(t, s, sockfd);
+				return;
 			}
 
-			// Check if a serious error occurred
-			if (err != SSL_ERROR_WANT_READ && err != SSL_ERROR_WANT_WRITE) {
-				click_chatter("%s: bad BIO_write()", class_name());
-				SSL_shutdown(s->ssl);
+			int r = SSL_do_handshake(s->ssl);
+			int err = (r <= 0 ? SSL_get_error(s->ssl, r) : SSL_ERROR_NONE);
+			unsigned long error = ERR_peek_error();
+			ERR_clear_error();
+
+			if (err != SSL_ERROR_NONE && err != SSL_ERROR_WANT_READ &&
+			    err != SSL_ERROR_WANT_WRITE) {
+				handshake_failed(s, sockfd, err, error);
+				return;
 			}
 
-			break;
+			if (SSL_is_init_finished(s->ssl))
+				handshake_done(s, sockfd);
 		}
 
-		// If handshake is not finished yet, call do_hanshake
-		if (!SSL_is_init_finished(s->ssl))
-			SSL_do_handshake(s->ssl);
-
-		if (_verbose)
-			click_chatter("%s: SSL Handshake finished on sockfd %d", class_name(), sockfd);
-		
 		break;
 
 	case SSL_SERVER__IN_APP_PORT:
@@ -354,46 +454,147 @@ SSLServer::push(int port, Packet *p)
 			return;
 		}
 
-		// Insert packet into TX queue
-		s->txq.push_back(p);
-
 		// If SSL handshake is not finished, try again later
-		if (!SSL_is_init_finished(s->ssl)){
-			if (_verbose)
-				click_chatter("%s: SSL Handshake on sockfd %d not finished yet", class_name(), sockfd);
+		if (!SSL_is_init_finished(s->ssl) && _verbose)
+			click_chatter("%s: SSL Handshake on sockfd %d not finished yet", class_name(), sockfd);
+
+		// Queue plaintext, records are written once coalesced
+		ssl_enqueue(t, s, sockfd, p);
+		return;
+
+	default:
+		assert(0);
+	}
+
+	ssl_process(t, s, sockfd);
+}
+
+void
+SSLServer::handshake_done(SSLSocket *s, int sockfd)
+{
+	_cache.handshake_done(s->ssl);
+
+	if (_verbose)
+		click_chatter("%s: SSL Handshake finished on sockfd %d%s", class_name(), sockfd, SSL_session_reused(s->ssl) ? " (resumed)" : "");
+}
+
+void
+SSLServer::handshake_failed(SSLSocket *s, int sockfd, int err, unsigned long error)
+{
+	_cache.handshake_failed();
+
+	if (_verbose) {
+		char buf[256];
+		ERR_error_string_n(error, buf, sizeof(buf));
+		click_chatter("%s: SSL Handshake failed on sockfd %d (error %d, %s)", class_name(), sockfd, err, buf);
+	}
+
+	// Send the alert, if any, and release the socket. After a fatal error
+	// SSL_shutdown() must not be called.
+	ssl_flush(s, sockfd, SSL_SERVER_OUT_NET_PORT);
+	SSL_free(s->ssl);
+	s->clear();
+
+	Packet *q = Packet::make((const void *)NULL, 0);
+	SET_TCP_SOCKFD_ANNO(q, sockfd);
+	SET_TCP_SOCK_DEL_FLAG_ANNO(q);
+
+	output(SSL_SERVER_OUT_NET_PORT).push(q);
+}
+
+void
+SSLServer::ssl_offload(ThreadData *t, SSLSocket *s, int sockfd)
+{
+	// The socket belongs to the crypto thread until the job completes
+	s->busy = true;
+	SSLBIO::begin_offload(s->bio);
+
+	SSLCrypto::Job j;
+	j.ssl = s->ssl;
+	j.sockfd = sockfd;
+	if (!_crypto.submit(j))
+		t->_backlog.push_back(sockfd);
+
+	t->_task->reschedule();
+}
+
+bool
+SSLServer::ssl_poll(ThreadData *t)
+{
+	if (!_crypto.enabled())
+		return false;
+
+	bool work = false;
+
+	// Retry handshakes that found the submission ring full
+	int i = 0;
+	for (; i < t->_backlog.size(); i++) {
+		int sockfd = t->_backlog[i];
+		SSLCrypto::Job j;
+		j.ssl = t->_socket[sockfd].ssl;
+		j.sockfd = sockfd;
+		if (!_crypto.submit(j))
 			break;
+	}
+	if (i > 0) {
+		t->_backlog.erase(t->_backlog.begin(), t->_backlog.begin() + i);
+		work = true;
+	}
+
+	SSLCrypto::Job j;
+	while (_crypto.complete(j)) {
+		SSLSocket *s = &(t->_socket[j.sockfd]);
+		assert(s->busy && s->ssl == j.ssl);
+
+		SSLBIO::end_offload(s->bio);
+		s->busy = false;
+		work = true;
+
+		if (j.err != SSL_ERROR_NONE && j.err != SSL_ERROR_WANT_READ &&
+		    j.err != SSL_ERROR_WANT_WRITE) {
+			handshake_failed(s, j.sockfd, j.err, j.error);
+			continue;
 		}
 
-		// If handshake is over and there are packets in the queue, send them
-		while (!s->txq.empty()) {
-			Packet *q = s->txq.front();
-
-			int numWr = SSL_write(s->ssl, q->data(), q->length());
-			int err = SSL_get_error(s->ssl, numWr);
-
-			// No errors
-			if (err == SSL_ERROR_NONE) {
-				q->pull(numWr);
-				if (!q->length()) {
-					s->txq.pop_front();
-					q->kill();
-				}
-				continue;
-			}
+		if (SSL_is_init_finished(s->ssl))
+			handshake_done(s, j.sockfd);
 
-			// Check if a serious error occurred
-			if (err != SSL_ERROR_WANT_READ && err != SSL_ERROR_WANT_WRITE) {
-				click_chatter("%s: bad SSL_write()", class_name());
-				SSL_shutdown(s->ssl);
-			}
+		// Send the handshake messages and any plaintext queued meanwhile
+		ssl_process(t, s, j.sockfd);
 
-			break;
+		// Replay the ciphertext received meanwhile, in order, until the
+		// socket is closed or the handshake is offloaded again
+		Packet *p;
+		while (s->ssl && !s->busy && (p = s->held.front())) {
+			s->held.pop_front();
+			push(SSL_SERVER__IN_NET_PORT, p);
 		}
+	}
 
-		break;
+	// Keep polling while handshakes are outstanding
+	if (_crypto.inflight() || !t->_backlog.empty())
+		t->_task->fast_reschedule();
 
-	default:
-		assert(0);
+	return work;
+}
+
+void
+SSLServer::ssl_process(ThreadData *t, SSLSocket *s, int sockfd)
+{
+	// The SSL object is owned by a crypto thread
+	if (s->busy)
+		return;
+
+	// If handshake is over and there are packets in the queue, send them
+	if (SSL_is_init_finished(s->ssl) && !s->txq.empty()) {
+		int err = ssl_write(t, s);
+
+		// Check if a serious error occurred
+		if (err != SSL_ERROR_NONE && err != SSL_ERROR_WANT_READ &&
+		    err != SSL_ERROR_WANT_WRITE) {
+			click_chatter("%s: bad SSL_write()", class_name());
+			SSL_shutdown(s->ssl);
+		}
 	}
 
 	if (s->txq.empty() && s->shutdown){
@@ -403,42 +604,18 @@ SSLServer::push(int port, Packet *p)
 	}
 
 	// Read cleartext and send it to the application
-	while (SSL_pending(s->ssl) || BIO_ctrl_pending(s->wbio)) {
-		Packet *k = Packet::make((const void *)NULL, 0);
-		if (k) {
-			WritablePacket *q = k->uniqueify();
-			assert(q);
-			int numRd = SSL_read(s->ssl, q->data(), q->tailroom());
-   			if (numRd > 0) {
-				q = q->put(numRd);
-				SET_TCP_SOCKFD_ANNO(q, sockfd);
-				output(SSL_SERVER_OUT_APP_PORT).push(q);
-			}
-			else {
-				q->kill();
-				break;
-			}
-		}
+	int err = ssl_read(s, sockfd, SSL_SERVER_OUT_APP_PORT);
+
+	// The client closed the connection, or a serious error occurred
+	if (err == SSL_ERROR_ZERO_RETURN)
+		SSL_shutdown(s->ssl);
+	else if (err != SSL_ERROR_NONE) {
+		click_chatter("%s: bad SSL_read()", class_name());
+		SSL_shutdown(s->ssl);
 	}
 
 	// Read encrypted text and send it to the network
-	while (BIO_ctrl_pending(s->rbio)) {
-		Packet *k = Packet::make((const void *)NULL, 0);
-		if (k) {
-			WritablePacket *q = k->uniqueify();
-			assert(q);
-			int numRd = BIO_read(s->rbio, q->data(), q->tailroom());
-			if (numRd > 0) {
-				q = q->put(numRd);
-				SET_TCP_SOCKFD_ANNO(q, sockfd);
-				output(SSL_SERVER_OUT_NET_PORT).push(q);
-			}
-			else {
-				q->kill();
-				break;
-			}
-		}
-	}
+	ssl_flush(s, sockfd, SSL_SERVER_OUT_NET_PORT);
 
 	// If the connection shutdown was clean, release resources
 	if (SSL_get_shutdown(s->ssl) & (SSL_SENT_SHUTDOWN|SSL_RECEIVED_SHUTDOWN)) {
@@ -458,4 +635,5 @@ SSLServer::push(int port, Packet *p)
 #endif
 
 CLICK_ENDDECLS
+ELEMENT_REQUIRES(SSLSessionCache SSLTicketKeys SSLCrypto)
 EXPORT_ELEMENT(SSLServer)
@@ -32,11 +32,15 @@
 #include <click/string.hh>
 #include <click/packet.hh>
 #include <click/packetqueue.hh>
+#include <click/timer.hh>
 #if HAVE_OPENSSL
 # include <openssl/bio.h>
 # include <openssl/ssl.h>
 #endif
 #include "sslbase.hh"
+#include "sslcrypto.hh"
+#include "sslsessioncache.hh"
+#include "sslticketkeys.hh"
 CLICK_DECLS
 
 
@@ -57,16 +61,21 @@ class SSLServer : public SSLBase { public:
     int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
     int initialize(ErrorHandler *) CLICK_COLD;
     void cleanup(CleanupStage) CLICK_COLD;
+    void add_handlers() CLICK_COLD;
     void push(int, Packet *);
-	
-    struct ThreadData {
-		Vector<SSLSocket> _socket;
-		ThreadData() { }
-    } CLICK_ALIGNED(CLICK_CACHE_LINE_SIZE);
-
+    void run_timer(Timer *);
 
   private:
 
+	void ssl_process(ThreadData *, SSLSocket *, int);
+	bool ssl_poll(ThreadData *);
+	void ssl_offload(ThreadData *, SSLSocket *, int);
+	void handshake_done(SSLSocket *, int);
+	void handshake_failed(SSLSocket *, int, int, unsigned long);
+
+	static String read_handler(Element *, void *) CLICK_COLD;
+	static int write_handler(const String &, Element *, void *, ErrorHandler *) CLICK_COLD;
+
 	String _pkey_file;
 	String _cert_file;
 	String _c;
@@ -76,8 +85,18 @@ class SSLServer : public SSLBase { public:
 	String _ou;
 	String _cn;
 	SSL_CTX *_ctx;
-	ThreadData *_thread;
-	uint32_t _nthreads;
+	SSLSessionCache _cache;
+	SSLTicketKeys _tickets;
+	Timer _rotate_timer;
+	uint32_t _cache_size;
+	uint32_t _cache_timeout;
+	bool _use_tickets;
+	String _ticket_key_file;
+	uint32_t _ticket_keys;
+	uint32_t _ticket_rotate;
+	SSLCrypto _crypto;
+	Vector<int> _crypto_cpus;
+	uint32_t _crypto_ring;
 	bool _verbose;
 
 # endif
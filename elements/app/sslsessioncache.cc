@@ -0,0 +1,260 @@
+/*
+ * sslsessioncache.{cc,hh} -- per-core TLS session cache with cross-core lookup
+ * Rafael Laufer, Massimo Gallo
+ *
+ * Copyright (c) 2019 Nokia Bell Labs
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+ *    in the documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ */
+
+#include <click/config.h>
+#include <click/glue.hh>
+#include <click/straccum.hh>
+#include "sslsessioncache.hh"
+#include "sslcrypto.hh"
+CLICK_DECLS
+
+#if HAVE_OPENSSL
+int SSLSessionCache::_index = -1;
+
+SSLSessionCache::SSLSessionCache()
+	: _core(NULL), _nthreads(0), _capacity(0)
+{
+}
+
+SSLSessionCache::~SSLSessionCache()
+{
+	for (uint32_t c = 0; c < _nthreads; c++)
+		for (Table::iterator it = _core[c].table.begin(); it; ++it)
+			SSL_SESSION_free(it.value());
+
+	delete[] _core;
+}
+
+int
+SSLSessionCache::configure(SSL_CTX *ctx, uint32_t nthreads, uint32_t capacity)
+{
+	if (_index < 0)
+		_index = SSL_CTX_get_ex_new_index(0, NULL, NULL, NULL, NULL);
+	if (_index < 0 || !SSL_CTX_set_ex_data(ctx, _index, this))
+		return -1;
+
+	_nthreads = nthreads;
+	_capacity = capacity;
+	_core = new Core[_nthreads];
+
+	// Without a capacity only handshakes are counted
+	if (!_capacity) {
+		SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_OFF);
+		return 0;
+	}
+
+	for (uint32_t c = 0; c < _nthreads; c++)
+		_core[c].order.resize(_capacity);
+
+	// Only use our cache, OpenSSL's internal one is a single locked table
+	SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER |
+	                            SSL_SESS_CACHE_NO_INTERNAL |
+	                            SSL_SESS_CACHE_NO_AUTO_CLEAR);
+	SSL_CTX_sess_set_new_cb(ctx, new_cb);
+	SSL_CTX_sess_set_get_cb(ctx, get_cb);
+	SSL_CTX_sess_set_remove_cb(ctx, remove_cb);
+
+	return 0;
+}
+
+SSLSessionCache *
+SSLSessionCache::cache(SSL_CTX *ctx)
+{
+	return (SSLSessionCache *)SSL_CTX_get_ex_data(ctx, _index);
+}
+
+void
+SSLSessionCache::handshake_done(SSL *ssl)
+{
+	Core &m = _core[click_current_cpu_id()];
+	if (SSL_session_reused(ssl))
+		m.resumed++;
+	else
+		m.full++;
+}
+
+void
+SSLSessionCache::handshake_failed()
+{
+	_core[click_current_cpu_id()].failed++;
+}
+
+int
+SSLSessionCache::new_cb(SSL *ssl, SSL_SESSION *sess)
+{
+	SSLSessionCache *sc = cache(SSL_get_SSL_CTX(ssl));
+
+	// Stored by the core that owns the connection. If it cannot be deferred,
+	// OpenSSL keeps its reference and the session is not cached.
+	return SSLCrypto::defer(store, sc, sess) ? 1 : 0;
+}
+
+void
+SSLSessionCache::store(void *a, void *b)
+{
+	SSLSessionCache *sc = (SSLSessionCache *)a;
+	SSL_SESSION *sess = (SSL_SESSION *)b;
+	Core &m = sc->_core[click_current_cpu_id()];
+
+	unsigned int len;
+	const unsigned char *id = SSL_SESSION_get_id(sess, &len);
+	String key((const char *)id, len);
+
+	m.lock.acquire();
+
+	// Replace a previous session with the same ID in place, keeping its
+	// entry in the ring, which would otherwise evict the new one early
+	SSL_SESSION *prev = m.table.get(key);
+	if (prev) {
+		SSL_SESSION_free(prev);
+		m.table.set(key, sess);
+		m.stored++;
+		m.lock.release();
+		return;
+	}
+
+	// Evict the oldest sessions to make room. Every cached session has an
+	// entry in the ring, possibly stale if OpenSSL removed it meanwhile.
+	while (m.count >= sc->_capacity) {
+		String &old = m.order[m.head];
+		SSL_SESSION *s = m.table.get(old);
+		if (s) {
+			m.table.erase(old);
+			SSL_SESSION_free(s);
+			m.evicted++;
+		}
+		m.head = (m.head + 1) % sc->_capacity;
+		m.count--;
+	}
+
+	m.table.set(key, sess);
+	m.order[(m.head + m.count) % sc->_capacity] = key;
+	m.count++;
+	m.stored++;
+
+	m.lock.release();
+}
+
+SSL_SESSION *
+SSLSessionCache::get_cb(SSL *ssl, const unsigned char *id, int len, int *copy)
+{
+	SSLSessionCache *sc = cache(SSL_get_SSL_CTX(ssl));
+	unsigned c = SSLCrypto::core();
+	String key((const char *)id, len);
+
+	// Hand OpenSSL its own reference, taken under the lock so that the
+	// owner core cannot evict and free the session in the meantime
+	*copy = 0;
+
+	for (uint32_t i = 0; i < sc->_nthreads; i++) {
+		Core &m = sc->_core[(c + i) % sc->_nthreads];
+
+		m.lock.acquire();
+		SSL_SESSION *s = m.table.get(key);
+		if (s)
+			SSL_SESSION_up_ref(s);
+		m.lock.release();
+
+		if (s) {
+			if (i == 0)
+				SSLCrypto::count(&sc->_core[c].hits_local);
+			else
+				SSLCrypto::count(&sc->_core[c].hits_remote);
+			return s;
+		}
+	}
+
+	SSLCrypto::count(&sc->_core[c].misses);
+	return NULL;
+}
+
+void
+SSLSessionCache::remove_cb(SSL_CTX *ctx, SSL_SESSION *sess)
+{
+	SSLSessionCache *sc = cache(ctx);
+	if (!sc)
+		return;
+
+	unsigned int len;
+	const unsigned char *id = SSL_SESSION_get_id(sess, &len);
+	String key((const char *)id, len);
+
+	for (uint32_t c = 0; c < sc->_nthreads; c++) {
+		Core &m = sc->_core[c];
+
+		m.lock.acquire();
+		SSL_SESSION *s = m.table.get(key);
+		if (s)
+			m.table.erase(key);
+		m.lock.release();
+
+		if (s) {
+			SSL_SESSION_free(s);
+			return;
+		}
+	}
+}
+
+String
+SSLSessionCache::unparse() const
+{
+	uint64_t full = 0, resumed = 0, failed = 0, hits_local = 0, hits_remote = 0;
+	uint64_t misses = 0, stored = 0, evicted = 0, size = 0;
+
+	for (uint32_t c = 0; c < _nthreads; c++) {
+		const Core &m = _core[c];
+		full += m.full;
+		resumed += m.resumed;
+		failed += m.failed;
+		hits_local += m.hits_local;
+		hits_remote += m.hits_remote;
+		misses += m.misses;
+		stored += m.stored;
+		evicted += m.evicted;
+		size += m.table.size();
+	}
+
+	uint64_t total = full + resumed;
+
+	StringAccum sa;
+	sa << "handshakes " << total << '\n'
+	   << "full " << full << '\n'
+	   << "resumed " << resumed << '\n';
+	sa.snprintf(64, "resumption_rate %.4f\n", total ? (double)resumed/total : 0.);
+	sa << "failed " << failed << '\n';
+	sa << "cache_size " << size << '\n'
+	   << "cache_hits_local " << hits_local << '\n'
+	   << "cache_hits_remote " << hits_remote << '\n'
+	   << "cache_misses " << misses << '\n'
+	   << "cache_stored " << stored << '\n'
+	   << "cache_evicted " << evicted << '\n';
+
+	return sa.take_string();
+}
+#endif // HAVE_OPENSSL
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(SSLCrypto)
+ELEMENT_PROVIDES(SSLSessionCache)
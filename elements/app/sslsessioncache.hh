@@ -0,0 +1,91 @@
+/*
+ * sslsessioncache.{cc,hh} -- per-core TLS session cache with cross-core lookup
+ * Rafael Laufer, Massimo Gallo
+ *
+ * Copyright (c) 2019 Nokia Bell Labs
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+ *    in the documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ */
+
+#ifndef CLICK_SSLSESSIONCACHE_HH
+#define CLICK_SSLSESSIONCACHE_HH
+#include <click/config.h>
+#include <click/string.hh>
+#include <click/vector.hh>
+#include <click/hashtable.hh>
+#include <click/sync.hh>
+#if HAVE_OPENSSL
+# include <openssl/ssl.h>
+#endif
+CLICK_DECLS
+
+#if HAVE_OPENSSL
+// Sessions are stored in the cache of the core that created them. A lookup
+// checks the local core first and then the other cores, so a client that
+// reconnects through another core still resumes its session.
+class SSLSessionCache { public:
+
+	SSLSessionCache();
+	~SSLSessionCache();
+
+	int configure(SSL_CTX *, uint32_t nthreads, uint32_t capacity);
+	void handshake_done(SSL *);
+	void handshake_failed();
+	String unparse() const;
+
+  private:
+
+	typedef HashTable<String, SSL_SESSION *> Table;
+
+	struct Core {
+		Spinlock lock;
+		Table table;
+		Vector<String> order;           // insertion order for eviction
+		uint32_t head;
+		uint32_t count;
+		uint64_t full;                  // full handshakes
+		uint64_t resumed;               // abbreviated handshakes
+		uint64_t failed;                // handshakes ended by an error
+		uint64_t hits_local;            // found in the local cache
+		uint64_t hits_remote;           // found in another core's cache
+		uint64_t misses;
+		uint64_t stored;
+		uint64_t evicted;
+
+		Core() : table(NULL), head(0), count(0), full(0), resumed(0), failed(0),
+		         hits_local(0), hits_remote(0), misses(0), stored(0), evicted(0) { }
+	} CLICK_ALIGNED(CLICK_CACHE_LINE_SIZE);
+
+	static SSLSessionCache *cache(SSL_CTX *);
+	static int new_cb(SSL *, SSL_SESSION *);
+	static void store(void *, void *);
+	static SSL_SESSION *get_cb(SSL *, const unsigned char *, int, int *);
+	static void remove_cb(SSL_CTX *, SSL_SESSION *);
+
+	static int _index;
+
+	Core *_core;
+	uint32_t _nthreads;
+	uint32_t _capacity;
+
+};
+#endif
+
+CLICK_ENDDECLS
+#endif
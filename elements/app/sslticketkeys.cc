@@ -0,0 +1,239 @@
+/*
+ * sslticketkeys.{cc,hh} -- rotating TLS session ticket keys
+ * Rafael Laufer, Massimo Gallo
+ *
+ * Copyright (c) 2019 Nokia Bell Labs
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+ *    in the documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ */
+
+#include <click/config.h>
+#include <click/glue.hh>
+#include <click/straccum.hh>
+#if HAVE_OPENSSL
+# include <openssl/rand.h>
+#endif
+#include "sslticketkeys.hh"
+#include "sslcrypto.hh"
+CLICK_DECLS
+
+#if HAVE_OPENSSL
+int SSLTicketKeys::_index = -1;
+
+SSLTicketKeys::SSLTicketKeys()
+	: _current(0), _valid(0), _rotations(0), _core(NULL), _nthreads(0)
+{
+}
+
+SSLTicketKeys::~SSLTicketKeys()
+{
+	OPENSSL_cleanse(_keys.data(), _keys.size() * sizeof(Key));
+	delete[] _core;
+}
+
+int
+SSLTicketKeys::configure(SSL_CTX *ctx, uint32_t nthreads, uint32_t nkeys,
+                         const String &key)
+{
+	if (_index < 0)
+		_index = SSL_CTX_get_ex_new_index(0, NULL, NULL, NULL, NULL);
+	if (_index < 0 || !SSL_CTX_set_ex_data(ctx, _index, this))
+		return -1;
+
+	_nthreads = nthreads;
+	_core = new Core[_nthreads];
+	_keys.resize(nkeys);
+
+	// Either use the given key, so that several servers can share it, or
+	// generate a random one
+	if (key) {
+		if (key.length() != sizeof(Key))
+			return -1;
+		memcpy(&_keys[0], key.data(), sizeof(Key));
+		_current = 0;
+		_valid = 1;
+	}
+	else if (rotate() < 0)
+		return -1;
+
+# if OPENSSL_VERSION_NUMBER >= 0x30000000L
+	SSL_CTX_set_tlsext_ticket_key_evp_cb(ctx, ticket_cb);
+# else
+	SSL_CTX_set_tlsext_ticket_key_cb(ctx, ticket_cb);
+# endif
+
+	return 0;
+}
+
+int
+SSLTicketKeys::rotate()
+{
+	Key k;
+	if (RAND_bytes((unsigned char *)&k, sizeof(k)) != 1)
+		return -1;
+
+	_lock.acquire();
+	_current = (_valid ? (_current + 1) % _keys.size() : 0);
+	_keys[_current] = k;
+	if (_valid < (uint32_t)_keys.size())
+		_valid++;
+	_rotations++;
+	_lock.release();
+
+	OPENSSL_cleanse(&k, sizeof(k));
+	return 0;
+}
+
+// Pick the key for a ticket, returning the OpenSSL callback result
+int
+SSLTicketKeys::ticket_key(unsigned char *name, unsigned char *iv, int enc, Key *k)
+{
+	Core &m = _core[SSLCrypto::core()];
+
+	if (enc) {
+		// Seal a new ticket with the newest key
+		if (RAND_bytes(iv, EVP_MAX_IV_LENGTH) != 1)
+			return -1;
+
+		_lock.acquire();
+		*k = _keys[_current];
+		_lock.release();
+
+		memcpy(name, k->name, sizeof(k->name));
+		SSLCrypto::count(&m.issued);
+		return 1;
+	}
+
+	// Look for the key that sealed this ticket, newest first
+	uint32_t i, n = _keys.size();
+
+	_lock.acquire();
+	for (i = 0; i < _valid; i++) {
+		const Key &x = _keys[(_current + n - i) % n];
+		if (memcmp(name, x.name, sizeof(x.name)) == 0) {
+			*k = x;
+			break;
+		}
+	}
+	bool found = (i < _valid);
+	_lock.release();
+
+	if (!found) {
+		SSLCrypto::count(&m.unknown);
+		return 0;
+	}
+
+	// Ask for a new ticket if sealed with an older key
+	if (i == 0) {
+		SSLCrypto::count(&m.resumed);
+		return 1;
+	}
+
+	SSLCrypto::count(&m.renewed);
+	return 2;
+}
+
+int
+SSLTicketKeys::cipher_init(EVP_CIPHER_CTX *ctx, const Key &k, unsigned char *iv,
+                           int enc)
+{
+	if (enc)
+		return EVP_EncryptInit_ex(ctx, EVP_aes_256_cbc(), NULL, k.aes, iv);
+	else
+		return EVP_DecryptInit_ex(ctx, EVP_aes_256_cbc(), NULL, k.aes, iv);
+}
+
+# if OPENSSL_VERSION_NUMBER >= 0x30000000L
+int
+SSLTicketKeys::ticket_cb(SSL *ssl, unsigned char *name, unsigned char *iv,
+                         EVP_CIPHER_CTX *ctx, EVP_MAC_CTX *hctx, int enc)
+{
+	SSLTicketKeys *tk = (SSLTicketKeys *)
+	                    SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), _index);
+	Key k;
+
+	int r = tk->ticket_key(name, iv, enc, &k);
+	if (r <= 0)
+		return r;
+
+	OSSL_PARAM params[3];
+	params[0] = OSSL_PARAM_construct_octet_string(OSSL_MAC_PARAM_KEY,
+	                                              k.hmac, sizeof(k.hmac));
+	params[1] = OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST,
+	                                             (char *)"SHA256", 0);
+	params[2] = OSSL_PARAM_construct_end();
+
+	if (EVP_MAC_CTX_set_params(hctx, params) != 1)
+		r = -1;
+	else if (cipher_init(ctx, k, iv, enc) != 1)
+		r = -1;
+
+	OPENSSL_cleanse(&k, sizeof(k));
+	return r;
+}
+# else
+int
+SSLTicketKeys::ticket_cb(SSL *ssl, unsigned char *name, unsigned char *iv,
+                         EVP_CIPHER_CTX *ctx, HMAC_CTX *hctx, int enc)
+{
+	SSLTicketKeys *tk = (SSLTicketKeys *)
+	                    SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), _index);
+	Key k;
+
+	int r = tk->ticket_key(name, iv, enc, &k);
+	if (r <= 0)
+		return r;
+
+	if (HMAC_Init_ex(hctx, k.hmac, sizeof(k.hmac), EVP_sha256(), NULL) != 1)
+		r = -1;
+	else if (cipher_init(ctx, k, iv, enc) != 1)
+		r = -1;
+
+	OPENSSL_cleanse(&k, sizeof(k));
+	return r;
+}
+# endif
+
+String
+SSLTicketKeys::unparse() const
+{
+	uint64_t issued = 0, resumed = 0, renewed = 0, unknown = 0;
+
+	for (uint32_t c = 0; c < _nthreads; c++) {
+		issued += _core[c].issued;
+		resumed += _core[c].resumed;
+		renewed += _core[c].renewed;
+		unknown += _core[c].unknown;
+	}
+
+	StringAccum sa;
+	sa << "ticket_keys " << _valid << '\n'
+	   << "ticket_rotations " << _rotations << '\n'
+	   << "tickets_issued " << issued << '\n'
+	   << "tickets_resumed " << resumed << '\n'
+	   << "tickets_renewed " << renewed << '\n'
+	   << "tickets_unknown " << unknown << '\n';
+
+	return sa.take_string();
+}
+#endif // HAVE_OPENSSL
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(SSLCrypto)
+ELEMENT_PROVIDES(SSLTicketKeys)
@@ -0,0 +1,98 @@
+/*
+ * sslticketkeys.{cc,hh} -- rotating TLS session ticket keys
+ * Rafael Laufer, Massimo Gallo
+ *
+ * Copyright (c) 2019 Nokia Bell Labs
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+ *    in the documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ */
+
+#ifndef CLICK_SSLTICKETKEYS_HH
+#define CLICK_SSLTICKETKEYS_HH
+#include <click/config.h>
+#include <click/string.hh>
+#include <click/vector.hh>
+#include <click/sync.hh>
+#if HAVE_OPENSSL
+# include <openssl/ssl.h>
+# include <openssl/evp.h>
+# if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#  include <openssl/core_names.h>
+#  include <openssl/params.h>
+# else
+#  include <openssl/hmac.h>
+# endif
+#endif
+CLICK_DECLS
+
+#if HAVE_OPENSSL
+// Session ticket keys shared by all cores. New tickets are always sealed
+// with the newest key, while the previous keys are kept to open tickets
+// issued before a rotation, which are then renewed with the newest key.
+class SSLTicketKeys { public:
+
+	struct Key {
+		unsigned char name[16];
+		unsigned char aes[32];
+		unsigned char hmac[32];
+	};
+
+	SSLTicketKeys();
+	~SSLTicketKeys();
+
+	int configure(SSL_CTX *, uint32_t nthreads, uint32_t nkeys, const String &key);
+	int rotate();
+	String unparse() const;
+
+  private:
+
+	struct Core {
+		uint64_t issued;                // tickets sealed
+		uint64_t resumed;               // tickets opened with the newest key
+		uint64_t renewed;               // tickets opened with an older key
+		uint64_t unknown;               // tickets with an unknown key
+		Core() : issued(0), resumed(0), renewed(0), unknown(0) { }
+	} CLICK_ALIGNED(CLICK_CACHE_LINE_SIZE);
+
+	int ticket_key(unsigned char *, unsigned char *, int, Key *);
+	static int cipher_init(EVP_CIPHER_CTX *, const Key &, unsigned char *, int);
+
+# if OPENSSL_VERSION_NUMBER >= 0x30000000L
+	static int ticket_cb(SSL *, unsigned char *, unsigned char *,
+	                     EVP_CIPHER_CTX *, EVP_MAC_CTX *, int);
+# else
+	static int ticket_cb(SSL *, unsigned char *, unsigned char *,
+	                     EVP_CIPHER_CTX *, HMAC_CTX *, int);
+# endif
+
+	static int _index;
+
+	Spinlock _lock;
+	Vector<Key> _keys;                  // ring of keys
+	uint32_t _current;                  // index of the newest key
+	uint32_t _valid;                    // number of valid keys in the ring
+	uint64_t _rotations;
+	Core *_core;
+	uint32_t _nthreads;
+
+};
+#endif
+
+CLICK_ENDDECLS
+#endif
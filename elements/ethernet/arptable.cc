@@ -31,13 +31,19 @@
 CLICK_DECLS
 
 ARPTable::ARPTable()
-    : _entry_capacity(0), _packet_capacity(2048), _entry_packet_capacity(0), _capacity_slim_factor(2), _expire_timer(this)
+    : _entry_capacity(0), _packet_capacity(2048), _entry_packet_capacity(0), _capacity_slim_factor(2),
+      _snap(0), _retired(0), _epoch(1), _expire_timer(this)
 {
     _entry_count = _packet_count = _drops = 0;
+    _generation = 1;
+    _nreaders = click_max_cpu_ids();
+    _reader = new Reader[_nreaders];
 }
 
 ARPTable::~ARPTable()
 {
+    free_snapshots();
+    delete[] _reader;
 }
 
 int
@@ -71,6 +77,7 @@ ARPTable::cleanup(CleanupStage)
 void
 ARPTable::clear()
 {
+    _lock.acquire_write();
     // Walk the arp cache table and free any stored packets and arp entries.
     for (Table::iterator it = _table.begin(); it; ) {
 	ARPEntry *ae = _table.erase(it);
@@ -83,6 +90,9 @@ ARPTable::clear()
     }
     _entry_count = _packet_count = 0;
     _age.__clear();
+    _generation++;
+    publish();
+    _lock.release_write();
 }
 
 void
@@ -96,6 +106,7 @@ ARPTable::take_state(Element *e, ErrorHandler *errh)
 	return;
     }
 
+    _lock.acquire_write();
     _table.swap(arpt->_table);
     _age.swap(arpt->_age);
     _entry_count = arpt->_entry_count;
@@ -105,12 +116,94 @@ ARPTable::take_state(Element *e, ErrorHandler *errh)
 
     arpt->_entry_count = 0;
     arpt->_packet_count = 0;
+    _generation++;
+    publish();
+    _lock.release_write();
+}
+
+void
+ARPTable::publish()
+{
+    // Called with the write lock held
+    uint32_t n = 16;
+    while (n < 2 * _table.size())
+	n <<= 1;
+
+    Snapshot *s = new Snapshot;
+    s->_mask = n - 1;
+    s->_epoch = 0;
+    s->_next = 0;
+    s->_slot = new SnapshotSlot[n];
+
+    for (Table::iterator it = _table.begin(); it; ++it)
+	if (it->_known) {
+	    uint32_t i = snapshot_hash(it->_ip.addr()) & s->_mask;
+	    while (s->_slot[i]._ip)
+		i = (i + 1) & s->_mask;
+	    s->_slot[i]._ip = it->_ip.addr();
+	    s->_slot[i]._eth = it->_eth;
+	    s->_slot[i]._live_at_j = it->_live_at_j;
+	}
+
+    Snapshot *old = _snap;
+    __atomic_store_n(&_snap, s, __ATOMIC_RELEASE);
+
+    // Retire the old snapshot in the current epoch and start a new one
+    if (old) {
+	old->_epoch = _epoch;
+	old->_next = _retired;
+	_retired = old;
+	uint32_t epoch = _epoch + 1;
+	__atomic_store_n(&_epoch, epoch ? epoch : 1, __ATOMIC_RELEASE);
+    }
+
+    reclaim();
 }
 
 void
+ARPTable::reclaim()
+{
+    // Readers that announced an epoch after the fence see the new snapshot
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    uint32_t oldest = 0;
+    for (uint32_t c = 0; c < _nreaders; c++) {
+	uint32_t e = __atomic_load_n(&_reader[c]._epoch, __ATOMIC_ACQUIRE);
+	if (e && (!oldest || (int32_t)(e - oldest) < 0))
+	    oldest = e;
+    }
+
+    // Free snapshots retired before the oldest epoch still being read
+    Snapshot **pprev = &_retired;
+    while (Snapshot *s = *pprev)
+	if (!oldest || (int32_t)(s->_epoch - oldest) < 0) {
+	    *pprev = s->_next;
+	    delete[] s->_slot;
+	    delete s;
+	} else
+	    pprev = &s->_next;
+}
+
+void
+ARPTable::free_snapshots()
+{
+    while (Snapshot *s = _retired) {
+	_retired = s->_next;
+	delete[] s->_slot;
+	delete s;
+    }
+    if (_snap) {
+	delete[] _snap->_slot;
+	delete _snap;
+	_snap = 0;
+    }
+}
+
+bool
 ARPTable::slim(click_jiffies_t now)
 {
     ARPEntry *ae;
+    bool removed = false;
 
     // Delete old entries.
     while ((ae = _age.front())
@@ -118,6 +211,10 @@ ARPTable::slim(click_jiffies_t now)
 	       || (_entry_capacity && _entry_count > _entry_capacity))) {
 	_table.erase(ae->_ip);
 	_age.pop_front();
+	if (ae->_known) {
+	    _generation++;
+	    removed = true;
+	}
 
 	while (Packet *p = ae->_head) {
 	    ae->_head = p->next();
@@ -148,6 +245,8 @@ ARPTable::slim(click_jiffies_t now)
 	    ae = ae->_age_link.next();
 	}
     }
+
+    return removed;
 }
 
 void
@@ -156,7 +255,10 @@ ARPTable::run_timer(Timer *timer)
     // Expire any old entries, and make sure there's room for at least one
     // packet.
     _lock.acquire_write();
-    slim(click_jiffies());
+    if (slim(click_jiffies()))
+	publish();
+    else
+	reclaim();
     _lock.release_write();
     if (_timeout_j)
 	timer->schedule_after_sec(_timeout_j / CLICK_HZ + 1);
@@ -175,8 +277,8 @@ ARPTable::ensure(IPAddress ip, click_jiffies_t now)
 	}
 
 	++_entry_count;
-	if (_entry_capacity && _entry_count > _entry_capacity)
-	    slim(now);
+	if (_entry_capacity && _entry_count > _entry_capacity && slim(now))
+	    publish();
 
 	ARPEntry *ae = new(x) ARPEntry(ip);
 	ae->_live_at_j = now;
@@ -196,10 +298,21 @@ ARPTable::insert(IPAddress ip, const EtherAddress &eth, Packet **head)
     if (!ae)
 	return -ENOMEM;
 
+    bool was_known = ae->_known;
+    bool changed = (ae->_eth != eth);
+    if (ae->_known && changed)
+	_generation++;
     ae->_eth = eth;
     ae->_known = !eth.is_broadcast();
 
     ae->_live_at_j = now;
+
+    // Refresh the snapshot in place unless the mapping itself changed
+    SnapshotSlot *e = (_snap && was_known ? snapshot_find(_snap, ip.addr()) : 0);
+    if (ae->_known != was_known || (ae->_known && (changed || !e)))
+	publish();
+    else if (e)
+	__atomic_store_n(&e->_live_at_j, now, __ATOMIC_RELAXED);
     ae->_num_polls_since_reply = 0;
     ae->_polled_at_j = ae->_live_at_j - CLICK_HZ;
 
@@ -260,8 +373,8 @@ ARPTable::append_query(IPAddress ip, Packet *p)
     }
 
     ++_packet_count;
-    if (_packet_capacity && _packet_count > _packet_capacity)
-	slim(now);
+    if (_packet_capacity && _packet_count > _packet_capacity && slim(now))
+	publish();
 
     if (ae->_tail)
 	ae->_tail->set_next(p);
@@ -57,6 +57,17 @@ service attack.
 Time value.  The amount of time after which an ARP entry will expire.  Default
 is 5 minutes.  Zero means ARP entries never expire.
 
+=back
+
+Lookups of known entries are lock-free.  Besides the locked table, ARPTable
+keeps a read-only snapshot of the known mappings that is looked up without
+taking the lock.  Whenever a mapping is added, changed, or removed, a new
+snapshot is built and published, and the old one is freed once no thread can
+still be reading it (epoch-based reclamation).  Refreshing an existing
+mapping only updates its timestamp in place.  Lookups that miss the snapshot,
+or that find an entry that is expired or due for a poll, use the locked table
+as before.
+
 =h table r
 
 Return a table of the ARP entries.  The returned string has four
@@ -107,6 +118,8 @@ class ARPTable : public Element { public:
     void cleanup(CleanupStage) CLICK_COLD;
 
     int lookup(IPAddress ip, EtherAddress *eth, uint32_t poll_timeout_j);
+    inline int lookup_snapshot(IPAddress ip, EtherAddress *eth, uint32_t poll_timeout_j);
+    inline int lookup_locked(IPAddress ip, EtherAddress *eth, uint32_t poll_timeout_j);
     EtherAddress lookup(IPAddress ip);
     IPAddress reverse_lookup(const EtherAddress &eth);
     int insert(IPAddress ip, const EtherAddress &en, Packet **head = 0);
@@ -157,6 +170,12 @@ class ARPTable : public Element { public:
     uint32_t length() const {
 	return _packet_count;
     }
+    /** @brief Return the table generation, which changes whenever a known
+     * IP-to-Ethernet mapping changes or is removed. Lets callers cache
+     * lookup results without taking the lock. */
+    uint32_t generation() const {
+	return _generation;
+    }
 
     void run_timer(Timer *);
 
@@ -208,6 +227,27 @@ class ARPTable : public Element { public:
 
   private:
 
+    // Read-only open-addressed copy of the known mappings
+    struct SnapshotSlot {
+	uint32_t _ip;		// 0 means empty
+	EtherAddress _eth;
+	click_jiffies_t _live_at_j;
+	SnapshotSlot() : _ip(0), _live_at_j(0) {
+	}
+    };
+    struct Snapshot {
+	uint32_t _mask;
+	uint32_t _epoch;	// epoch in which it was retired
+	Snapshot *_next;	// next retired snapshot
+	SnapshotSlot *_slot;
+    };
+    // Epoch announced by a reading thread, 0 when not reading
+    struct Reader {
+	uint32_t _epoch;
+	Reader() : _epoch(0) {
+	}
+    } CLICK_ALIGNED(CLICK_CACHE_LINE_SIZE);
+
     ReadWriteLock _lock;
 
     typedef HashContainer<ARPEntry> Table;
@@ -222,16 +262,84 @@ class ARPTable : public Element { public:
     uint32_t _capacity_slim_factor;
     uint32_t _timeout_j;
     atomic_uint32_t _drops;
+    atomic_uint32_t _generation;
+    Snapshot *_snap;
+    Snapshot *_retired;
+    Reader *_reader;
+    uint32_t _nreaders;
+    uint32_t _epoch;
     SizedHashAllocator<sizeof(ARPEntry)> _alloc;
     Timer _expire_timer;
 
     ARPEntry *ensure(IPAddress ip, click_jiffies_t now);
-    void slim(click_jiffies_t now);
+    bool slim(click_jiffies_t now);
+
+    static inline uint32_t snapshot_hash(uint32_t ip) {
+	return ((uint64_t) ip * 0x9E3779B97F4A7C15ULL) >> 32;
+    }
+    static inline SnapshotSlot *snapshot_find(Snapshot *s, uint32_t ip);
+    void publish();
+    void reclaim();
+    void free_snapshots();
 
 };
 
+inline ARPTable::SnapshotSlot *
+ARPTable::snapshot_find(Snapshot *s, uint32_t ip)
+{
+    // Load factor is at most 1/2, so there is always an empty slot
+    for (uint32_t i = snapshot_hash(ip) & s->_mask; s->_slot[i]._ip; i = (i + 1) & s->_mask)
+	if (s->_slot[i]._ip == ip)
+	    return &s->_slot[i];
+    return 0;
+}
+
+/** @brief Look up @a ip in the snapshot without taking the lock.
+ *
+ * Returns 0 and sets @a eth if @a ip is known, not expired, and not due for
+ * a poll, and -1 otherwise, in which case the caller should use the locked
+ * table. */
+inline int
+ARPTable::lookup_snapshot(IPAddress ip, EtherAddress *eth, uint32_t poll_timeout_j)
+{
+    unsigned c = click_current_cpu_id();
+    if (c >= _nreaders)
+	return -1;
+
+    // Announce the epoch before loading the snapshot, which pairs with the
+    // fence in reclaim()
+    Reader &rd = _reader[c];
+    __atomic_store_n(&rd._epoch, __atomic_load_n(&_epoch, __ATOMIC_ACQUIRE), __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    int r = -1;
+    Snapshot *s = __atomic_load_n(&_snap, __ATOMIC_ACQUIRE);
+    if (SnapshotSlot *e = (s ? snapshot_find(s, ip.addr()) : 0)) {
+	click_jiffies_t live_at_j = __atomic_load_n(&e->_live_at_j, __ATOMIC_RELAXED);
+	click_jiffies_t now = 0;
+	if ((_timeout_j > 0) || (poll_timeout_j > 0))
+	    now = click_jiffies();
+	if ((!_timeout_j || !click_jiffies_less(live_at_j + _timeout_j, now))
+	    && (!poll_timeout_j || click_jiffies_less(now, live_at_j + poll_timeout_j))) {
+	    *eth = e->_eth;
+	    r = 0;
+	}
+    }
+
+    __atomic_store_n(&rd._epoch, 0, __ATOMIC_RELEASE);
+    return r;
+}
+
 inline int
 ARPTable::lookup(IPAddress ip, EtherAddress *eth, uint32_t poll_timeout_j)
+{
+    if (lookup_snapshot(ip, eth, poll_timeout_j) == 0)
+	return 0;
+    return lookup_locked(ip, eth, poll_timeout_j);
+}
+
+inline int
+ARPTable::lookup_locked(IPAddress ip, EtherAddress *eth, uint32_t poll_timeout_j)
 {
     _lock.acquire_read();
     int r = -1;
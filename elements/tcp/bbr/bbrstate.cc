@@ -26,6 +26,7 @@
 #include <click/config.h>
 #include <click/machine.hh>
 #include "bbrstate.hh"
+#include "../tcpclock.hh"
 #include <algorithm>
 #include <random>
 #define SRTT_DEFAULT 1000
@@ -36,7 +37,7 @@ CLICK_DECLS
 
 BBRState::BBRState(TCPState *s) :
 		pacing_rate(0), cycle_ustamp(0), probe_rtt_done_stamp(0), rtprop_stamp(
-				Timestamp::now_steady().usecval()), gain_cycle_len(8), prev_ca_state(
+				TCPClock::now_usec()), gain_cycle_len(8), prev_ca_state(
 		TCP_CA_Open), pacing_shift(0), prior_cwnd(0), full_bw(0), rtprop(
 				s->snd_srtt ? s->snd_srtt : INFINITY), send_quantum(0), delivered(
 				0), target_cwnd(0), full_bw_cnt(0), next_round_delivered(0), min_pipe_cwnd(
@@ -395,12 +396,12 @@ void BBRState::update_rtprop(TCPState *s) {
 
 	// Track min RTT seen in the min_rtt_win_sec filter window:
 	rtprop_expired =
-			(uint64_t) Timestamp::now_steady().usecval() > rtprop_stamp + RTpropFilterLen * SEC_TO_USEC;
+			(uint64_t) TCPClock::now_usec() > rtprop_stamp + RTpropFilterLen * SEC_TO_USEC;
 
 	// Calculating rtt in the estimator and the value is sent here only upon condition of !is_delayed_ack
 	if (s->last_rtt > 0 && (s->last_rtt <= rtprop || (rtprop_expired))) {
 		rtprop = s->last_rtt;
-		rtprop_stamp = Timestamp::now_steady().usecval();
+		rtprop_stamp = TCPClock::now_usec();
 	}
 
 	if (state != BBRState_PROBE_RTT && rtprop_expired && !idle_restart
@@ -412,9 +413,9 @@ void BBRState::update_rtprop(TCPState *s) {
 		s->app_limited = (s->delivered + s->tcp_packets_in_flight()) ? : 1;
 		if (!probe_rtt_done_stamp
 				&& s->tcp_packets_in_flight() <= MinTargetCwnd) {
-			probe_rtt_done_stamp = (uint64_t)Timestamp::now_steady().usecval()
+			probe_rtt_done_stamp = (uint64_t)TCPClock::now_usec()
 					+ (ProbeRTTDuration * 1000);
-			//click_chatter("setting round probe rtt at t= %u", Timestamp::now_steady().usecval());
+			//click_chatter("setting round probe rtt at t= %u", TCPClock::now_usec());
 			probe_rtt_round_done = 0;
 			next_round_delivered = s->delivered;
 		} else if (probe_rtt_done_stamp) {
@@ -423,10 +424,10 @@ void BBRState::update_rtprop(TCPState *s) {
 			}
 			if (probe_rtt_round_done
 					&& (probe_rtt_done_stamp
-							&& (uint64_t) Timestamp::now_steady().usecval()
+							&& (uint64_t) TCPClock::now_usec()
 									> probe_rtt_done_stamp)) {
 				//click_chatter("exiting at %u", probe_rtt_done_stamp);
-				rtprop_stamp = Timestamp::now_steady().usecval();
+				rtprop_stamp = TCPClock::now_usec();
 				restore_cwnd(s);
 				exit_probe_rtt(s);
 			}
@@ -542,7 +543,7 @@ void BBRState::update_gains() {
 }
 
 void BBRState::enter_probe_rtt() {
-	//click_chatter("enter probe rtt at t=%u",Timestamp::now_steady().usecval());
+	//click_chatter("enter probe rtt at t=%u",TCPClock::now_usec());
 	state = BBRState_PROBE_RTT;
 }
 
@@ -573,7 +574,7 @@ uint32_t BBRState::packets_in_net_at_edt(TCPState *s, uint32_t inflight_now) {
 	uint64_t now_us, edt_us, interval_us;
 	uint32_t interval_delivered, inflight_at_edt;
 
-	now_us = (uint64_t) Timestamp::now_steady().usecval();
+	now_us = (uint64_t) TCPClock::now_usec();
 	edt_us = std::max((uint64_t) s->next_send_time, now_us);
 	interval_us = edt_us - now_us;
 	interval_delivered = (uint64_t) max_bw() * interval_us >> BW_SCALE;
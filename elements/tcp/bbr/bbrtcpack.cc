@@ -34,6 +34,8 @@
 #include "bbrstate.hh"
 #include "../tcpstate.hh"
 #include "../tcpinfo.hh"
+#include "../tcpmib.hh"
+#include "../tcptrace.hh"
 #include "../util.hh"
 
 CLICK_DECLS
@@ -143,13 +145,12 @@ BBRTCPAck::handle_ack(Packet *p) {
 			if (s->snd_parack++ == 0) {
 				s->bbr->packet_conservation = false;
 				s->snd_rto = TCP_RTO_INIT;
-				s->rtx_timer.unschedule();
 				Timestamp now = p->timestamp_anno();
 				if (now) {
 					Timestamp tmo = now + Timestamp::make_msec(s->snd_rto);
-					s->rtx_timer.schedule_at_steady(tmo);
+					s->rtx_timer.defer_at_steady(tmo);
 				} else
-					s->rtx_timer.schedule_after_msec(s->snd_rto);
+					s->rtx_timer.defer_after_msec(s->snd_rto);
 			}
 
 			if (TCPInfo::verbose())
@@ -158,6 +159,8 @@ BBRTCPAck::handle_ack(Packet *p) {
 
 			// Increment RTX counter
 			s->snd_rtx_count++;
+			s->snd_rtx_total++;
+			TCPMib::inc(TCP_MIB_RETRANS_SEGS);
 
 			// Send retransmission
 			output(1).push(wp);
@@ -209,8 +212,10 @@ BBRTCPAck::handle_old(Packet *p) {
 			(len == 0) &&                 // (b)
 			(!syn && !fin) &&                 // (c)
 			(ack == s->snd_una) &&                 // (d)
-			(win << s->snd_wscale) == s->snd_wnd)  // (e)
+			(win << s->snd_wscale) == s->snd_wnd) { // (e)
 		s->snd_dupack++;
+		TCPMib::inc(TCP_MIB_DUP_ACKS);
+	}
 	else {
 		s->snd_dupack = 0;
 		return p;
@@ -268,6 +273,10 @@ BBRTCPAck::handle_old(Packet *p) {
 
 		// Increment RTX counter
 		s->snd_rtx_count++;
+		s->snd_rtx_total++;
+		TCPMib::inc(TCP_MIB_RETRANS_SEGS);
+		TCPMib::inc(TCP_MIB_FAST_RETRANS);
+		TCPTrace::record(TCP_TRACE_LOSS, s, s->snd_dupack);
 
 		if (TCPInfo::verbose())
 			click_chatter("%s: old, %s, dup ack %d, ack %u", class_name(),
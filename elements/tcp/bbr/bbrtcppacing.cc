@@ -30,6 +30,8 @@
 #include <click/tcpanno.hh>
 #include "bbrtcppacing.hh"
 #include "../tcpstate.hh"
+#include "../tcpclock.hh"
+#include "../tcptrace.hh"
 CLICK_DECLS
 
 BBRTCPPacing::BBRTCPPacing() {
@@ -39,24 +41,25 @@ Packet * BBRTCPPacing::smaction(Packet *p) {
 	TCPState *s = TCP_STATE_ANNO(p);
 	if (s->next_send_time == 0
 			or (uint64_t)(s->next_send_time/1000)
-					<= (uint64_t) Timestamp::now_steady().msecval()) {
+					<= (uint64_t) TCPClock::now().msecval()) {
         if (s->bbr->pacing_rate)
-            s->next_send_time = (uint64_t)((uint64_t) Timestamp::now_steady().usecval()
+            s->next_send_time = (uint64_t)((uint64_t) TCPClock::now_usec()
 				+ (uint32_t) (p->seg_len() * 1000000 / s->bbr->pacing_rate));
         else 
-            s->next_send_time = (uint64_t) Timestamp::now_steady().usecval();
+            s->next_send_time = (uint64_t) TCPClock::now_usec();
+		TCPTrace::record(TCP_TRACE_PACE, s, s->bbr->pacing_rate);
 		return p;
 	} else {
 		s->bbr->pcq.push_back(p);
 		if (!s->tx_timer.scheduled()) {
 			s->tx_timer.schedule_after_msec(
 					(uint64_t)((s->next_send_time
-							- (uint64_t) Timestamp::now_steady().usecval())/1000));
+							- (uint64_t) TCPClock::now_usec())/1000));
             if (s->bbr->pacing_rate)
-                s->next_send_time = (uint64_t)((uint64_t) Timestamp::now_steady().usecval()
+                s->next_send_time = (uint64_t)((uint64_t) TCPClock::now_usec()
 					+ (uint32_t) (p->seg_len() * 1000000 / s->bbr->pacing_rate));
             else 
-                s->next_send_time = (uint64_t) Timestamp::now_steady().usecval();
+                s->next_send_time = (uint64_t) TCPClock::now_usec();
 		}
 	}
 	return NULL;
@@ -44,19 +44,27 @@ BBRTCPProcessAck::smaction(Packet *p) {
 	// Get acknowledgment number
 	uint32_t ack = TCP_ACK(th);
 	if (s->state >= TCP_ESTABLISHED) {
-		// Get RTX queue head
-		pkt_state *ps = s->rs->pkt_states.front();
-		while (ps) {
+		// Take the delivery snapshot of each segment fully acknowledged in
+		// the RTX queue, before TCPProcessAck removes them
+		uint32_t delivered = 0;
+		Packet *h = s->rtxq.front();
+		Packet *q = h;
+		while (q) {
 			// If ACK does not fully acknowledge the packet, get out
-			if (unlikely(SEQ_GEQ(ps->end, ack))) {
+			if (SEQ_GEQ(TCP_END(q), ack))
 				break;
-			}
-			tcp_rate_delivered(s, p, ps);
-			s->delivered += ack - s->snd_una;
-			rate_gen(s, (s->delivered - ps->delivered));
-			s->rs->pkt_states.pop_front();
-			ps = s->rs->pkt_states.front();
 
+			tcp_rate_delivered(s, p, q);
+			delivered++;
+
+			q = q->next();
+			if (q == h)
+				break;
+		}
+
+		if (delivered) {
+			s->delivered += delivered;
+			rate_gen(s, delivered);
 		}
 		// Update on ack BBR states
 		if (s->rs->prior_delivered > 0) {
@@ -68,22 +76,24 @@ BBRTCPProcessAck::smaction(Packet *p) {
 
 // method should be called when we receive the ack/sack
 void BBRTCPProcessAck::tcp_rate_delivered(TCPState *s, Packet *p,
-		pkt_state *ps) {
+		Packet *q) {
 
-	if (!ps->delivered_time) {
+	uint32_t delivered_time = TCP_DELIVERED_TIME_ANNO(q);
+	if (!delivered_time) {
 		return;
 	}
 
-	if (!s->rs->prior_delivered || ps->delivered > s->rs->prior_delivered) {
+	uint32_t delivered = TCP_DELIVERED_ANNO(q);
+	if (!s->rs->prior_delivered || delivered > s->rs->prior_delivered) {
 		s->rs->prior_in_flight = s->tcp_packets_in_flight();
-		s->rs->prior_delivered = ps->delivered;
-		s->rs->prior_ustamp = ps->delivered_time;
-		s->rs->is_app_limited = ps->app_limited;
+		s->rs->prior_delivered = delivered;
+		s->rs->prior_ustamp = delivered_time;
+		s->rs->is_app_limited = TCP_APP_LIMITED_ANNO(q);
 		s->rs->is_retrans = s->sacked & TCPCB_RETRANS;
 		//Record send time of most recently ACKed packet:
 		s->first_sent_time = p->timestamp_anno().usecval();
 		// Find the duration of the "send phase" of this window:
-		s->rs->interval_us = s->first_sent_time - ps->first_sent_time;
+		s->rs->interval_us = (uint32_t)s->first_sent_time - TCP_FIRST_SENT_ANNO(q);
 
 	}
 	/* Mark off the skb delivered once it's sacked to avoid being
@@ -91,7 +101,7 @@ void BBRTCPProcessAck::tcp_rate_delivered(TCPState *s, Packet *p,
 	 * we don't need to reset since it'll be freed soon.
 	 */
 	if (s->sacked & TCPCB_SACKED_ACKED) {
-		ps->delivered_time = (uint64_t) 0;
+		SET_TCP_DELIVERED_TIME_ANNO(q, 0);
 	}
 }
 
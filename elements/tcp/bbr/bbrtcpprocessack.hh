@@ -41,7 +41,7 @@ class BBRTCPProcessAck final : public Element { public:
 	const char *port_count() const { return "1/1"; }
 	const char *processing() const { return PROCESSING_A_AH; }
 
-	void tcp_rate_delivered(TCPState *s, Packet *p, pkt_state *ps);
+	void tcp_rate_delivered(TCPState *s, Packet *p, Packet *q);
 	void rate_gen(TCPState *s, uint32_t delivered);
 
 	Packet *smaction(Packet *);
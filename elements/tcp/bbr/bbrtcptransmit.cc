@@ -30,6 +30,7 @@
 #include <click/tcpanno.hh>
 #include "bbrtcptransmit.hh"
 #include "../tcpstate.hh"
+#include "../tcpclock.hh"
 CLICK_DECLS
 
 BBRTCPTransmit::BBRTCPTransmit() {
@@ -38,7 +39,7 @@ BBRTCPTransmit::BBRTCPTransmit() {
 Packet *
 BBRTCPTransmit::smaction(Packet *p) {
 	TCPState *s = TCP_STATE_ANNO(p);
-	click_assert(s && !s->txq.empty() && !s->rtxq.empty());
+	click_assert(s);
 	/**
 	 * If there are packets already in flight, then we need to start
 	 * delivery rate samples from the time we received the most recent ACK,
@@ -51,7 +52,7 @@ BBRTCPTransmit::smaction(Packet *p) {
 	 *
 	 */
 	if (!s->txq.empty() || !s->rtxq.empty()) {
-		uint64_t tstamp_us = (uint64_t) Timestamp::now_steady().usecval();
+		uint64_t tstamp_us = (uint64_t) TCPClock::now_usec();
 		s->first_sent_time = tstamp_us;
 		s->delivered_ustamp = tstamp_us;
 	}
@@ -60,12 +61,21 @@ BBRTCPTransmit::smaction(Packet *p) {
 	const click_tcp *th = p->tcp_header();
 	click_assert(ip && th);
 	if (s->state == TCP_ESTABLISHED) {
+		// Store the delivery snapshot in the RTX queue copy of the segment,
+		// which is the queue tail for new data or its head for a
+		// retransmission
 		uint32_t seq = TCP_SEQ(th);
-		uint32_t end = TCP_END(ip, th);
-		pkt_state *p_s = new pkt_state(seq, end, s->delivered,
-				s->first_sent_time, s->delivered_ustamp, s->app_limited, NULL,
-				NULL);
-		s->rs->pkt_states.push_back(p_s);
+		if (TCP_SNS(ip, th) > 0 && !s->rtxq.empty()) {
+			Packet *q = s->rtxq.back();
+			if (TCP_SEQ(q) != seq)
+				q = s->rtxq.front();
+			if (TCP_SEQ(q) == seq) {
+				SET_TCP_DELIVERED_ANNO(q, s->delivered);
+				SET_TCP_DELIVERED_TIME_ANNO(q, (uint32_t)s->delivered_ustamp);
+				SET_TCP_FIRST_SENT_ANNO(q, (uint32_t)s->first_sent_time);
+				SET_TCP_APP_LIMITED_ANNO(q, s->app_limited);
+			}
+		}
 		s->bbr->handle_restart_from_idle(s);
 	}
 	return p;
@@ -26,7 +26,6 @@
 #ifndef CLICK_RateSample_HH
 #define CLICK_RateSample_HH
 #include "../tcpstate.hh"
-#include "pktstatequeue.hh"
 #define BW_SCALE 24
 #define BW_UNIT (1 << BW_SCALE)
 
@@ -54,7 +53,6 @@ class RateSample { public:
 	bool		is_app_limited,
 				is_retrans,
 				is_ack_delayed;
-	PktStateQueue pkt_states;
 
 
 };
@@ -0,0 +1,370 @@
+/*
+ * cycleprofiler.{cc,hh} -- sampling per-element cycle profiler
+ * Rafael Laufer, Massimo Gallo
+ *
+ * Copyright (c) 2019 Nokia Bell Labs
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+ *    in the documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ */
+
+#include <click/config.h>
+#include <click/glue.hh>
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/straccum.hh>
+#include <click/router.hh>
+#include <click/master.hh>
+#include "cycleprofiler.hh"
+CLICK_DECLS
+
+CycleProfiler *CycleProfiler::_p = NULL;
+
+CycleProfiler::CycleProfiler()
+	: _thread(NULL), _nthreads(0), _sample(1000), _depth(32), _active(false)
+{
+}
+
+int
+CycleProfiler::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+	bool active = true;
+
+	if (_p)
+		return errh->error("CycleProfiler can only be configured once");
+
+	if (Args(conf, this, errh)
+		.read("SAMPLE", _sample)
+		.read("DEPTH", _depth)
+		.read("ACTIVE", active)
+		.complete() < 0)
+		return -1;
+
+#if CLICK_STATS >= 2
+	return errh->error("not available with CLICK_STATS >= 2, use the cycles handlers");
+#endif
+	if (_sample == 0)
+		return errh->error("SAMPLE must be positive");
+	if (_depth == 0 || _depth > MAX_DEPTH)
+		return errh->error("DEPTH must be between 1 and %d", MAX_DEPTH);
+
+	_p = this;
+	_active = active;
+
+	return 0;
+}
+
+int
+CycleProfiler::initialize(ErrorHandler *)
+{
+	_nthreads = master()->nthreads();
+	_thread = new Thread[_nthreads];
+
+	set_active(_active);
+
+	return 0;
+}
+
+void
+CycleProfiler::cleanup(CleanupStage)
+{
+	set_active(false);
+
+	delete[] _thread;
+	_thread = NULL;
+	_p = NULL;
+}
+
+void
+CycleProfiler::set_active(bool active)
+{
+	_active = active && _thread;
+	Element::push_hook = (_active ? push_hook : NULL);
+	Element::pull_hook = (_active ? pull_hook : NULL);
+}
+
+inline CycleProfiler::Thread *
+CycleProfiler::thread()
+{
+	unsigned c = click_current_cpu_id();
+	if (unlikely(!_p || c >= (unsigned)_p->_nthreads))
+		return NULL;
+	return &_p->_thread[c];
+}
+
+// Returns true if the transfer is measured. The depth is incremented in
+// either case, so that sampling only starts at the root of a path.
+inline bool
+CycleProfiler::enter(Thread *t, const Port &port, bool pull)
+{
+	if (!t->sampling) {
+		if (t->depth > 0 || --t->countdown > 0) {
+			t->depth++;
+			return false;
+		}
+		t->countdown = _p->_sample;
+		t->sampling = true;
+	}
+
+	uint32_t d = t->depth++;
+	if (d >= _p->_depth)
+		return false;
+
+	uint64_t parent = (d ? t->stack[d - 1].key : 0);
+	uint64_t k = parent ^ (((uint64_t)port.element()->eindex() << 32) |
+	                       ((uint64_t)port.port() << 1) | pull);
+	k *= 0x9E3779B97F4A7C15ULL;
+	k ^= k >> 29;
+
+	t->stack[d].key = k;
+	t->stack[d].children = 0;
+	return true;
+}
+
+inline void
+CycleProfiler::leave(Thread *t, const Port &port, bool pull, click_cycles_t start)
+{
+	click_cycles_t all = click_get_cycles() - start;
+	uint32_t d = --t->depth;
+	Frame &f = t->stack[d];
+
+	t->lock.acquire();
+	Node &n = t->nodes[f.key];
+	if (!n.calls) {
+		n.parent = (d ? t->stack[d - 1].key : 0);
+		n.eindex = port.element()->eindex();
+		n.port = port.port();
+		n.pull = pull;
+	}
+	n.calls++;
+	n.cycles += all - f.children;
+	t->lock.release();
+
+	// Charge the accounting above to the parent's children, not to its own
+	if (d)
+		t->stack[d - 1].children += click_get_cycles() - start;
+	else
+		t->sampling = false;
+}
+
+void
+CycleProfiler::push_hook(const Port &port, Packet *p)
+{
+	Thread *t = thread();
+	if (!t) {
+		port.element()->push(port.port(), p);
+		return;
+	}
+
+	if (likely(!enter(t, port, false))) {
+		port.element()->push(port.port(), p);
+		t->depth--;
+		return;
+	}
+
+	click_cycles_t start = click_get_cycles();
+	port.element()->push(port.port(), p);
+	leave(t, port, false, start);
+}
+
+Packet *
+CycleProfiler::pull_hook(const Port &port)
+{
+	Thread *t = thread();
+	if (!t)
+		return port.element()->pull(port.port());
+
+	Packet *p;
+	if (likely(!enter(t, port, true))) {
+		p = port.element()->pull(port.port());
+		t->depth--;
+		return p;
+	}
+
+	click_cycles_t start = click_get_cycles();
+	p = port.element()->pull(port.port());
+	leave(t, port, true, start);
+	return p;
+}
+
+void
+CycleProfiler::merge(HashTable<uint64_t, Node> &nodes)
+{
+	for (int c = 0; c < _nthreads && _thread; c++) {
+		Thread *t = &_thread[c];
+		t->lock.acquire();
+		for (HashTable<uint64_t, Node>::iterator it = t->nodes.begin(); it; ++it) {
+			Node &n = nodes[it.key()];
+			if (!n.calls) {
+				n.parent = it.value().parent;
+				n.eindex = it.value().eindex;
+				n.port = it.value().port;
+				n.pull = it.value().pull;
+			}
+			n.calls += it.value().calls;
+			n.cycles += it.value().cycles;
+		}
+		t->lock.release();
+	}
+}
+
+static String
+unparse_port(const String &name, int port, bool pull)
+{
+	if (!port && !pull)
+		return name;
+	return name + (pull ? "@out" : "@in") + String(port);
+}
+
+String
+CycleProfiler::unparse_folded()
+{
+	HashTable<uint64_t, Node> nodes;
+	merge(nodes);
+
+	StringAccum sa;
+	Vector<String> stack;
+	for (HashTable<uint64_t, Node>::iterator it = nodes.begin(); it; ++it) {
+		if (!it.value().cycles)
+			continue;
+
+		stack.clear();
+		uint64_t k = it.key();
+		while (k && stack.size() < MAX_DEPTH) {
+			HashTable<uint64_t, Node>::iterator n = nodes.find(k);
+			if (!n)
+				break;
+			Element *e = router()->element(n.value().eindex);
+			stack.push_back(unparse_port(e ? e->name() : String("?"),
+			                             n.value().port, n.value().pull));
+			k = n.value().parent;
+		}
+
+		for (int i = stack.size() - 1; i >= 0; i--)
+			sa << stack[i] << (i ? ";" : " ");
+		sa << it.value().cycles << '\n';
+	}
+
+	return sa.take_string();
+}
+
+int
+CycleProfiler::cycles_compar(const void *a, const void *b, void *)
+{
+	click_cycles_t x = ((const Node *)a)->cycles;
+	click_cycles_t y = ((const Node *)b)->cycles;
+	return (x < y) - (x > y);
+}
+
+String
+CycleProfiler::unparse_elements()
+{
+	HashTable<uint64_t, Node> nodes;
+	merge(nodes);
+
+	// Aggregate paths per element port
+	HashTable<uint64_t, Node> ports;
+	for (HashTable<uint64_t, Node>::iterator it = nodes.begin(); it; ++it) {
+		const Node &n = it.value();
+		uint64_t k = ((uint64_t)n.eindex << 32) | (n.port << 1) | n.pull;
+		Node &m = ports[k];
+		m.eindex = n.eindex;
+		m.port = n.port;
+		m.pull = n.pull;
+		m.calls += n.calls;
+		m.cycles += n.cycles;
+	}
+
+	Vector<Node> v;
+	for (HashTable<uint64_t, Node>::iterator it = ports.begin(); it; ++it)
+		v.push_back(it.value());
+	click_qsort(v.begin(), v.size(), sizeof(Node), cycles_compar);
+
+	StringAccum sa;
+	sa.snprintf(128, "%-40s %6s %12s %16s %10s\n",
+	            "element", "port", "calls", "cycles", "per_call");
+	for (int i = 0; i < v.size(); i++) {
+		Element *e = router()->element(v[i].eindex);
+		String port = String(v[i].pull ? "out" : "in") + String(v[i].port);
+		sa.snprintf(160, "%-40s %6s %12llu %16llu %10llu\n",
+		            (e ? e->name().c_str() : "?"), port.c_str(),
+		            (unsigned long long)v[i].calls,
+		            (unsigned long long)v[i].cycles,
+		            (unsigned long long)(v[i].cycles / v[i].calls));
+	}
+
+	return sa.take_string();
+}
+
+enum { H_FOLDED, H_ELEMENTS, H_ACTIVE, H_RESET };
+
+String
+CycleProfiler::read_handler(Element *e, void *thunk)
+{
+	CycleProfiler *p = static_cast<CycleProfiler *>(e);
+
+	switch ((intptr_t)thunk) {
+	case H_FOLDED:
+		return p->unparse_folded();
+	case H_ELEMENTS:
+		return p->unparse_elements();
+	case H_ACTIVE:
+		return String(p->_active);
+	default:
+		return String();
+	}
+}
+
+int
+CycleProfiler::write_handler(const String &str, Element *e, void *thunk, ErrorHandler *errh)
+{
+	CycleProfiler *p = static_cast<CycleProfiler *>(e);
+
+	switch ((intptr_t)thunk) {
+	case H_ACTIVE: {
+		bool active;
+		if (!BoolArg().parse(str, active))
+			return errh->error("syntax error");
+		p->set_active(active);
+		break;
+	}
+	case H_RESET:
+		for (int c = 0; c < p->_nthreads && p->_thread; c++) {
+			Thread *t = &p->_thread[c];
+			t->lock.acquire();
+			t->nodes.clear();
+			t->lock.release();
+		}
+		break;
+	}
+
+	return 0;
+}
+
+void
+CycleProfiler::add_handlers()
+{
+	add_read_handler("folded", read_handler, H_FOLDED);
+	add_read_handler("elements", read_handler, H_ELEMENTS);
+	add_read_handler("active", read_handler, H_ACTIVE);
+	add_write_handler("active", write_handler, H_ACTIVE);
+	add_write_handler("reset", write_handler, H_RESET, Handler::BUTTON);
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(CycleProfiler)
@@ -0,0 +1,167 @@
+/*
+ * cycleprofiler.{cc,hh} -- sampling per-element cycle profiler
+ * Rafael Laufer, Massimo Gallo
+ *
+ * Copyright (c) 2019 Nokia Bell Labs
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+ *    in the documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ */
+
+#ifndef CLICK_CYCLEPROFILER_HH
+#define CLICK_CYCLEPROFILER_HH
+#include <click/element.hh>
+#include <click/hashtable.hh>
+#include <click/sync.hh>
+CLICK_DECLS
+
+/*
+=c
+
+CycleProfiler([I<keywords> SAMPLE, DEPTH, ACTIVE])
+
+=s tcp
+
+samples per-element cycle counts at runtime
+
+=d
+
+Measures with the TSC the cycles spent in each element for one of every
+SAMPLE packets entering the graph, following the packet through every push()
+and pull() it causes. Cycles are aggregated per element, per port, and per
+path from the element where the packet entered. Unlike CLICK_STATS, it can be
+turned on and off on a running router, and costs a single test of a static
+pointer per transfer when off.
+
+Only packets whose transfer starts from a router thread are sampled. Cycles
+of the profiler itself are excluded from the parent's own cycles.
+
+Keyword arguments are:
+
+=over 8
+
+=item SAMPLE
+
+Integer. Sample one of every SAMPLE packets entering the graph, per thread.
+Default is 1000.
+
+=item DEPTH
+
+Integer. Maximum path length. Deeper transfers are charged to the last
+element within DEPTH. Default is 32.
+
+=item ACTIVE
+
+Boolean. Whether to start profiling right away. Default is true.
+
+=back
+
+=h folded read-only
+
+One line per path with the element names separated by semicolons and the
+cycles spent in the last element, as expected by flamegraph.pl.
+
+=h elements read-only
+
+Calls, own cycles, and own cycles per call of each element port, sorted by
+own cycles.
+
+=h active read/write
+
+Whether profiling is active.
+
+=h reset write-only
+
+Resets all counts.
+
+=a TCPTrace
+*/
+
+class CycleProfiler final : public Element { public:
+
+	CycleProfiler() CLICK_COLD;
+
+	const char *class_name() const { return "CycleProfiler"; }
+	const char *port_count() const { return PORTS_0_0; }
+
+	int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
+	int initialize(ErrorHandler *) CLICK_COLD;
+	void cleanup(CleanupStage) CLICK_COLD;
+
+	void add_handlers() CLICK_COLD;
+
+  private:
+
+	enum { MAX_DEPTH = 64 };
+
+	// Path node, keyed by a hash of its parent key and its transfer
+	struct Node {
+		uint64_t parent;
+		int eindex;
+		int port;
+		bool pull;
+		uint64_t calls;
+		click_cycles_t cycles;     // own cycles, excluding children
+
+		Node() : parent(0), eindex(-1), port(0), pull(false), calls(0), cycles(0) { }
+	};
+
+	struct Frame {
+		uint64_t key;
+		click_cycles_t children;
+	};
+
+	struct Thread {
+		HashTable<uint64_t, Node> nodes;
+		Spinlock lock;             // Taken by readers and sampled transfers
+		uint32_t countdown;
+		uint32_t depth;
+		bool sampling;
+		Frame stack[MAX_DEPTH];
+
+		Thread() : countdown(1), depth(0), sampling(false) { }
+	} CLICK_ALIGNED(CLICK_CACHE_LINE_SIZE);
+
+	static inline Thread *thread();
+	static inline bool enter(Thread *t, const Port &port, bool pull);
+	static inline void leave(Thread *t, const Port &port, bool pull, click_cycles_t start);
+
+	static void push_hook(const Port &port, Packet *p);
+	static Packet *pull_hook(const Port &port);
+
+	void set_active(bool active);
+	void merge(HashTable<uint64_t, Node> &nodes);
+	String unparse_folded();
+	String unparse_elements();
+	static int cycles_compar(const void *, const void *, void *);
+
+	static String read_handler(Element *, void *) CLICK_COLD;
+	static int write_handler(const String &, Element *, void *, ErrorHandler *) CLICK_COLD;
+
+	Thread *_thread;
+	int _nthreads;
+	uint32_t _sample;
+	uint32_t _depth;
+	bool _active;
+
+	static CycleProfiler *_p;
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -32,6 +32,8 @@
 #include <click/straccum.hh>
 #include "dctcpnewrenoack.hh"
 #include "../tcpinfo.hh"
+#include "../tcpmib.hh"
+#include "../tcptrace.hh"
 #include "../util.hh"
 
 #include <clicknet/ip.h>
@@ -156,14 +158,13 @@ DCTCPNewRenoAck::handle_ack(Packet *p) {
 			// Reset the retransmission timer if this is the first partial ACK
 			if (s->snd_parack++ == 0) {
 				s->snd_rto = TCP_RTO_INIT;
-				s->rtx_timer.unschedule();
 				Timestamp now = p->timestamp_anno();
 				if (now) {
 					Timestamp tmo = now + Timestamp::make_msec(s->snd_rto);
-					s->rtx_timer.schedule_at_steady(tmo);
+					s->rtx_timer.defer_at_steady(tmo);
 				}
 				else
-					s->rtx_timer.schedule_after_msec(s->snd_rto);
+					s->rtx_timer.defer_after_msec(s->snd_rto);
 			}
 
 			if (TCPInfo::verbose())
@@ -172,6 +173,8 @@ DCTCPNewRenoAck::handle_ack(Packet *p) {
 
 			// Increment RTX counter
 			s->snd_rtx_count++;
+			s->snd_rtx_total++;
+			TCPMib::inc(TCP_MIB_RETRANS_SEGS);
 
 			// Send retransmission
 			output(1).push(wp);
@@ -299,8 +302,10 @@ DCTCPNewRenoAck::handle_old(Packet *p) {
 			(len == 0) &&                 // (b)
 			(!syn && !fin) &&                 // (c)
 			(ack == s->snd_una) &&                 // (d)
-			(win << s->snd_wscale) == s->snd_wnd)  // (e)
+			(win << s->snd_wscale) == s->snd_wnd) { // (e)
 		s->snd_dupack++;
+		TCPMib::inc(TCP_MIB_DUP_ACKS);
+	}
 	else {
 		s->snd_dupack = 0;
 		return handle_ack(p);
@@ -366,6 +371,10 @@ DCTCPNewRenoAck::handle_old(Packet *p) {
 
 		// Increment RTX counter
 		s->snd_rtx_count++;
+		s->snd_rtx_total++;
+		TCPMib::inc(TCP_MIB_RETRANS_SEGS);
+		TCPMib::inc(TCP_MIB_FAST_RETRANS);
+		TCPTrace::record(TCP_TRACE_LOSS, s, s->snd_dupack);
 
 		if (TCPInfo::verbose())
 			click_chatter("%s: old, %s, dup ack %d, ack %u", class_name(),
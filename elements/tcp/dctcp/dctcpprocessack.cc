@@ -31,6 +31,7 @@
 #include "../tcptimers.hh"
 #include "../tcpstate.hh"
 #include "../tcpinfo.hh"
+#include "../tcptrace.hh"
 #include "../util.hh"
 CLICK_DECLS
 
@@ -76,6 +77,9 @@ DCTCPProcessAck::smaction(Packet *p)
 	// Get packet timestamp
 	Timestamp now = p->timestamp_anno();
 				
+	// State before this segment, for the state change trace
+	uint8_t prev = s->state;
+
 	//   "if the ACK bit is on"
 	switch (s->state) {
 	case TCP_SYN_RECV:
@@ -97,6 +101,7 @@ DCTCPProcessAck::smaction(Packet *p)
 		}
 
 		s->state = TCP_ESTABLISHED;
+		TCPTrace::record(TCP_TRACE_STATE, s, prev);
 		if (s->snd_reinitialize_timer)
 			s->snd_rto = 3 * TCP_RTO_INIT;
 
@@ -203,14 +208,13 @@ DCTCPProcessAck::smaction(Packet *p)
 			// Restart keepalive timer
 			if (s->state == TCP_ESTABLISHED || s->state == TCP_CLOSE_WAIT) {
 				s->snd_keepalive_count = 0;
-				s->keepalive_timer.unschedule();
 				if (now) {
 					Timestamp tmo = 
 					           now + Timestamp::make_msec(TCP_KEEPALIVE);
-					s->keepalive_timer.schedule_at_steady(tmo);
+					s->keepalive_timer.defer_at_steady(tmo);
 				}
 				else 
-					s->keepalive_timer.schedule_after_msec(TCP_KEEPALIVE);
+					s->keepalive_timer.defer_after_msec(TCP_KEEPALIVE);
 			}
 #endif
 			// Update window
@@ -235,7 +239,10 @@ DCTCPProcessAck::smaction(Packet *p)
 			s->snd_rtx_count = 0;
 
 			// Advance window
+			uint32_t acked = ack - s->snd_una;
+			s->snd_acked_total += acked;
 			s->snd_una = ack;
+			TCPTrace::record(TCP_TRACE_ACK, s, acked);
 		}
 		// If not, check if ACK is a duplicate
 		else if (SEQ_LEQ(ack, s->snd_una))
@@ -253,8 +260,10 @@ DCTCPProcessAck::smaction(Packet *p)
 			//  our FIN is now acknowledged then enter FIN-WAIT-2 and continue
 			//  processing in that state."
 //			if (SEQ_LT(s->snd_fsn, ack))
-			if (SEQ_LEQ(s->snd_nxt, ack))
+			if (SEQ_LEQ(s->snd_nxt, ack)) {
 				s->state = TCP_FIN_WAIT2;
+				TCPTrace::record(TCP_TRACE_STATE, s, prev);
+			}
 
 			// fallthrough
 		case TCP_FIN_WAIT2:
@@ -276,6 +285,7 @@ DCTCPProcessAck::smaction(Packet *p)
 //			if (SEQ_LT(s->snd_fsn, ack)) {
 			if (SEQ_LEQ(s->snd_nxt, ack)) {
 				s->state = TCP_TIME_WAIT;
+				TCPTrace::record(TCP_TRACE_STATE, s, prev);
 
 				// Initialize and schedule TIME-WAIT timer overloading RTX timer
 				unsigned c = click_current_cpu_id();
@@ -341,13 +351,12 @@ DCTCPProcessAck::smaction(Packet *p)
 		//  the 2 MSL timeout."
 		if (TCP_FIN(th)) {
 			output(DCTCP_PROCESS_ACK_OUT_ACK).push(p);
-			s->rtx_timer.unschedule();
 			if (now) {
 				Timestamp tmo = now + Timestamp::make_msec(TCP_MSL << 1);
-				s->rtx_timer.schedule_at_steady(tmo);
+				s->rtx_timer.defer_at_steady(tmo);
 			}
 			else 
-				s->rtx_timer.schedule_after_msec(TCP_MSL << 1);
+				s->rtx_timer.defer_after_msec(TCP_MSL << 1);
 		}
 		else
 			p->kill();
@@ -24,6 +24,7 @@
  */
 
 #include <click/config.h>
+#include <clicknet/ip.h>
 #include <clicknet/tcp.h>
 #include "dectcpseqno.hh"
 #include "tcpstate.hh"
@@ -44,7 +45,13 @@ DecTCPSeqNo::smaction(Packet *q)
 	click_assert(th);
 
 	// TCP header
-	th->th_seq = htonl(ntohl(th->th_seq) - 1);
+	uint32_t seq = htonl(ntohl(th->th_seq) - 1);
+
+	// Update a software checksum, if already set (RFC 1624)
+	if (TCP_CSUM_FLAG_ANNO(p))
+		click_update_in_cksum32(&th->th_sum, th->th_seq, seq);
+
+	th->th_seq = seq;
 
 	return p;
 }
@@ -41,7 +41,9 @@ decrements the TCP sequence number in the packet
 
 Incoming packets are expected to have the IP and TCP headers, but not data.
 This element just decrements the TCP sequence number in the packet. This is
-useful to create TCP keepalive packets to test for connectivity.
+useful to create TCP keepalive packets to test for connectivity. A TCP
+checksum already in the packet is updated incrementally if it is marked valid
+in the TCP flags annotation (see SetTCPChecksum's CSUM_ANNO).
 
 =e
 
@@ -29,16 +29,11 @@
 #include <clicknet/ip.h>
 #include <click/args.hh>
 #include <click/straccum.hh>
+#include "fastrules.hh"
 
 CLICK_DECLS
 
-struct Rule {
-    uint32_t mask;
-    uint32_t result;
-    uint16_t offset;
-};
-
-typedef Rule rule;
+#define FAST_CLASSIFIER_BURST 32    // packets classified together
 
 class FastClassifier : public Element {
 
@@ -46,46 +41,51 @@ class FastClassifier : public Element {
 
  public:
 
-    FastClassifier() { }
+    FastClassifier() CLICK_COLD;
     ~FastClassifier() { }
 
     const char *class_name() const { return "FastClassifier"; }
     const char *port_count() const { return "1/-"; }
     const char *processing() const { return PUSH; }
     int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
+    void add_handlers() CLICK_COLD;
 
     inline Vector<rule> parse_rule(String);
     void push(int, Packet *) final;
 
     Vector<Vector<rule> > rules; 
+    FastRules _fast;
 
+    inline const uint8_t *header(const Packet *p);
     inline int match(const Packet *p);
+
+#if CLICK_STATS >= 2
+    uint64_t _packets;
+    click_cycles_t _cycles;
+
+    static String read_handler(Element *, void *) CLICK_COLD;
+    static int write_handler(const String &, Element *, void *, ErrorHandler *) CLICK_COLD;
+#endif
 };
 
+inline const uint8_t *
+FastClassifier::header(const Packet *p)
+{
+    if (p->length() < 22)
+        return NULL;
+
+    return reinterpret_cast<const uint8_t *>(p->data());
+}
+
 inline int
 FastClassifier::match(const Packet *p)
 {
-    if (p->length() < 22)
+    const uint8_t *data = header(p);
+    if (!data)
         return rules.size();
 
-    const uint8_t *data = reinterpret_cast<const uint8_t *>(p->data());
     //NOTE Send to first port matching.
-    int i;
-    for( i = 0; i<rules.size(); i++){
-        bool matching = true;
-        for(int j = 0; j<rules[i].size(); j++){
-            const uint32_t* d = reinterpret_cast<const uint32_t *>(data+rules[i][j].offset);
-//            click_chatter ("%d: Data %" PRIu32 " Mask %" PRIu32 " result %" PRIu32 " ",j,(*d),rules[i][j].mask, rules[i][j].result);
-            if ( ((*d) & rules[i][j].mask) != rules[i][j].result){
-                matching = false;
-                break;
-            }
-        }
-        if (matching)
-            return i;
-
-    }
-    return i;
+    return _fast.match(data);
 }
 
 inline Vector<rule>
@@ -29,6 +29,14 @@
 CLICK_DECLS
 
 
+FastIPClassifier::FastIPClassifier()
+{
+#if CLICK_STATS >= 2
+    _packets = 0;
+    _cycles = 0;
+#endif
+}
+
 int
 FastIPClassifier::configure(Vector<String> &conf, ErrorHandler *errh)
 {
@@ -40,45 +48,101 @@ FastIPClassifier::configure(Vector<String> &conf, ErrorHandler *errh)
     for (int i = 0; i < conf.size(); i++)
 	rules.push_back(parse_rule(conf[i]));
 
+    //Flatten the rules of all ports for matching
+    _fast.compile(rules);
+
     return 0;
 }
 
-
 void
 FastIPClassifier::push(int, Packet *p)
 {
     Packet* head = NULL;
     unsigned int r = 0;
 #if HAVE_BATCH
-    Packet* curr = p;
     Packet* prev = NULL;
-    Packet* next = NULL;
-    while (curr){
-	next = curr->next();
-	curr->set_next(NULL);
-	r = match(curr);
-	//Keep the batch on port 0, unbatch the rest
-	if (r == 0){  
-	    if (head == NULL)
-		head = curr;
-	    else
-		prev->set_next(curr);
-	    prev = curr;
+    Packet* pkt[FAST_CLASSIFIER_BURST];
+    const uint8_t* data[FAST_CLASSIFIER_BURST];
+    int port[FAST_CLASSIFIER_BURST];
+    while (p){
+#if CLICK_STATS >= 2
+	click_cycles_t start_cycles = click_get_cycles();
+#endif
+	//Classify up to a burst of packets at once
+	int n = 0;
+	for (; p && n < FAST_CLASSIFIER_BURST; n++){
+	    pkt[n] = p;
+	    data[n] = header(p);
+	    p = p->next();
 	}
-	else{
-	    //Not output.port(0) send curr to output port
-	    checked_output_push(r, curr);
+	_fast.match(data, n, port);
+#if CLICK_STATS >= 2
+	_cycles += click_get_cycles() - start_cycles;
+	_packets += n;
+#endif
+	for (int i = 0; i < n; i++){
+	    Packet* curr = pkt[i];
+	    curr->set_next(NULL);
+	    //Keep the batch on port 0, unbatch the rest
+	    if (port[i] == 0){
+		if (head == NULL)
+		    head = curr;
+		else
+		    prev->set_next(curr);
+		prev = curr;
+	    }
+	    else{
+		//Not output.port(0) send curr to output port
+		checked_output_push(port[i], curr);
+	    }
 	}
-	curr = next;
     }
     r = 0; //Send the batch to port 0
 #else
     head = p;
+# if CLICK_STATS >= 2
+    click_cycles_t start_cycles = click_get_cycles();
+# endif
     r = match(p);
+# if CLICK_STATS >= 2
+    _cycles += click_get_cycles() - start_cycles;
+    _packets++;
+# endif
 #endif //HAVE_BATCH
     if (head)
 	checked_output_push(r, head); 
 }
 
+#if CLICK_STATS >= 2
+String
+FastIPClassifier::read_handler(Element *e, void *)
+{
+    FastIPClassifier *c = static_cast<FastIPClassifier *>(e);
+    StringAccum sa;
+    sa << "packets " << c->_packets << "\n";
+    sa << "cycles " << c->_cycles << "\n";
+    sa << "cycles_per_packet " << (c->_packets ? (double)c->_cycles / c->_packets : 0) << "\n";
+    return sa.take_string();
+}
+
+int
+FastIPClassifier::write_handler(const String &, Element *e, void *, ErrorHandler *)
+{
+    FastIPClassifier *c = static_cast<FastIPClassifier *>(e);
+    c->_packets = 0;
+    c->_cycles = 0;
+    return 0;
+}
+#endif
+
+void
+FastIPClassifier::add_handlers()
+{
+#if CLICK_STATS >= 2
+    add_read_handler("match_cycles", read_handler, 0);
+    add_write_handler("reset_match_cycles", write_handler, 0, Handler::BUTTON);
+#endif
+}
+
 CLICK_ENDDECLS
 EXPORT_ELEMENT(FastIPClassifier)
@@ -39,24 +39,35 @@ class FastIPClassifier : public Element {
   
  public:
   
-    FastIPClassifier() { }
+    FastIPClassifier() CLICK_COLD;
     ~FastIPClassifier() { }
     
     const char *class_name() const { return "FastIPClassifier"; }
     const char *port_count() const { return "1/-"; }
     const char *processing() const { return PUSH; }
     int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
+    void add_handlers() CLICK_COLD;
     
     inline Vector<rule> parse_rule(String);
     void push(int, Packet *) final;
 
     Vector<Vector<rule> > rules;
+    FastRules _fast;
     
+    inline const uint8_t *header(const Packet *p);
     inline int match(const Packet *p);
+
+#if CLICK_STATS >= 2
+    uint64_t _packets;
+    click_cycles_t _cycles;
+
+    static String read_handler(Element *, void *) CLICK_COLD;
+    static int write_handler(const String &, Element *, void *, ErrorHandler *) CLICK_COLD;
+#endif
 };
 
-inline int 
-FastIPClassifier::match(const Packet *p)
+inline const uint8_t *
+FastIPClassifier::header(const Packet *p)
 {
     int l = p->network_length();
     
@@ -66,25 +77,20 @@ FastIPClassifier::match(const Packet *p)
 	l += 256;
     
     if (l < 276)
-	return rules.size(); //Discard Packet sending it to max port + 1
+	return NULL; //Discard Packet sending it to max port + 1
     
-    const uint8_t *net_data = reinterpret_cast<const uint8_t *>(p->network_header());
+    return reinterpret_cast<const uint8_t *>(p->network_header());
+}
+
+inline int 
+FastIPClassifier::match(const Packet *p)
+{
+    const uint8_t *net_data = header(p);
+    if (!net_data)
+	return rules.size();
+
     //NOTE Send to first port matching.
-    int i;
-    for( i = 0; i<rules.size(); i++){
-	bool matching = true;
-	for(int j = 0; j<rules[i].size(); j++){
-	    const uint32_t* d = reinterpret_cast<const uint32_t *>(net_data+rules[i][j].offset);
-//            click_chatter ("%d: Data %" PRIu32 " Mask %" PRIu32 " result %" PRIu32 " ",j,(*d),rules[i][j].mask, rules[i][j].result);
-            if ( ((*d) & rules[i][j].mask) != rules[i][j].result){
-                matching = false;
-                break;
-            }
-	}
-	if (matching)
-	    return i;
-    }
-    return i;
+    return _fast.match(net_data);
 }
 
 inline Vector<rule>
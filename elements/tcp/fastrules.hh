@@ -0,0 +1,216 @@
+/*
+ * fastrules.hh -- Compiled rule set for FastClassifier and FastIPClassifier
+ * Massimo Gallo, Anandatirtha Nandugudi
+ *
+ * Copyright (c) 2019 Nokia Bell Labs
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+ *    in the documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ */
+
+#ifndef CLICK_FASTRULES_HH
+#define CLICK_FASTRULES_HH
+#include <click/glue.hh>
+#include <click/vector.hh>
+CLICK_DECLS
+
+#if __AVX2__
+# define FAST_RULES_LANES 8    // packets matched at once
+#else
+# define FAST_RULES_LANES 4
+#endif
+#define FAST_RULES_WORDS 16    // distinct header words matched with SIMD
+
+struct Rule {
+    uint32_t mask;
+    uint32_t result;
+    uint16_t offset;
+};
+
+typedef Rule rule;
+
+// The rules of all ports compiled into a flat array of terms. Each distinct
+// 32-bit header word is loaded once per packet, and a burst is matched
+// FAST_RULES_LANES packets at a time, one vector lane per packet. The first
+// matching port wins, nrules() means no match.
+class FastRules { public:
+
+    FastRules() : _nrules(0), _simd(false) { }
+
+    void compile(const Vector<Vector<rule> > &);
+
+    inline int nrules() const { return _nrules; }
+    inline int match(const uint8_t *) const;
+    inline void match(const uint8_t * const *, int, int *) const;
+
+  private:
+
+    struct Term {
+	uint32_t mask;
+	uint32_t value;
+	uint16_t offset;
+	uint16_t word;
+    };
+
+    typedef uint32_t vec __attribute__((vector_size(FAST_RULES_LANES * 4)));
+
+    static inline uint32_t load(const uint8_t *p) {
+	uint32_t w;
+	memcpy(&w, p, sizeof(w));
+	return w;
+    }
+
+    Vector<uint16_t> _offset;   // distinct word offsets
+    Vector<Term> _term;         // terms of the live rules, rule after rule
+    Vector<int> _first;         // first term of each live rule, plus sentinel
+    Vector<int> _port;          // output port of each live rule
+    Vector<uint8_t> _zero;      // loaded instead of packets that cannot match
+    int _nrules;
+    bool _simd;
+
+};
+
+inline void
+FastRules::compile(const Vector<Vector<rule> > &rules)
+{
+    _offset.clear();
+    _term.clear();
+    _first.clear();
+    _port.clear();
+    _nrules = rules.size();
+
+    for (int i = 0; i < rules.size(); i++) {
+	Vector<Term> t;
+	bool dead = false;
+
+	for (int j = 0; j < rules[i].size(); j++) {
+	    const rule &r = rules[i][j];
+
+	    // Bits outside the mask can never be equal
+	    if (r.result & ~r.mask)
+		dead = true;
+
+	    int w = 0;
+	    while (w < _offset.size() && _offset[w] != r.offset)
+		w++;
+	    if (w == _offset.size())
+		_offset.push_back(r.offset);
+
+	    // Merge terms on the same word, a conflict never matches
+	    int k = 0;
+	    while (k < t.size() && t[k].word != w)
+		k++;
+	    if (k < t.size()) {
+		if ((t[k].value ^ r.result) & t[k].mask & r.mask)
+		    dead = true;
+		t[k].mask |= r.mask;
+		t[k].value |= r.result;
+	    }
+	    else {
+		Term x = { r.mask, r.result, r.offset, (uint16_t)w };
+		t.push_back(x);
+	    }
+	}
+
+	if (dead)
+	    continue;
+
+	_port.push_back(i);
+	_first.push_back(_term.size());
+	for (int k = 0; k < t.size(); k++)
+	    _term.push_back(t[k]);
+
+	// A rule without terms matches everything, later ones are unreachable
+	if (t.empty())
+	    break;
+    }
+    _first.push_back(_term.size());
+
+    int end = 0;
+    for (int w = 0; w < _offset.size(); w++)
+	if (_offset[w] + 4 > end)
+	    end = _offset[w] + 4;
+    _zero.assign(end, 0);
+
+    _simd = (_offset.size() <= FAST_RULES_WORDS);
+}
+
+inline int
+FastRules::match(const uint8_t *data) const
+{
+    for (int i = 0; i < _port.size(); i++) {
+	int j = _first[i];
+	for (; j < _first[i + 1]; j++) {
+	    const Term &t = _term[j];
+	    if ((load(data + t.offset) & t.mask) != t.value)
+		break;
+	}
+	if (j == _first[i + 1])
+	    return _port[i];
+    }
+    return _nrules;
+}
+
+inline void
+FastRules::match(const uint8_t * const *data, int n, int *port) const
+{
+    if (!_simd) {
+	for (int i = 0; i < n; i++)
+	    port[i] = data[i] ? match(data[i]) : _nrules;
+	return;
+    }
+
+    const uint8_t *zero = _zero.begin();
+
+    for (int b = 0; b < n; b += FAST_RULES_LANES) {
+	int k = (n - b < FAST_RULES_LANES ? n - b : FAST_RULES_LANES);
+
+	// Packets that cannot match and unused lanes load zeros
+	const uint8_t *d[FAST_RULES_LANES];
+	for (int l = 0; l < FAST_RULES_LANES; l++)
+	    d[l] = (l < k && data[b + l] ? data[b + l] : zero);
+
+	// Gather each header word of the packets into a vector
+	vec word[FAST_RULES_WORDS];
+	for (int w = 0; w < _offset.size(); w++) {
+	    uint32_t lane[FAST_RULES_LANES];
+	    for (int l = 0; l < FAST_RULES_LANES; l++)
+		lane[l] = load(d[l] + _offset[w]);
+	    memcpy(&word[w], lane, sizeof(lane));
+	}
+
+	// Evaluate the rules in order, the first hit of each lane wins
+	vec result = (vec){} + (uint32_t)_nrules;
+	vec found = (vec){};
+	for (int i = 0; i < _port.size(); i++) {
+	    vec hit = ~found;
+	    for (int j = _first[i]; j < _first[i + 1]; j++) {
+		const Term &t = _term[j];
+		hit &= (vec)((word[t.word] & t.mask) == t.value);
+	    }
+	    result = (result & ~hit) | (hit & (uint32_t)_port[i]);
+	    found |= hit;
+	}
+
+	for (int l = 0; l < k; l++)
+	    port[b + l] = (data[b + l] ? (int)result[l] : _nrules);
+    }
+}
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,148 @@
+/*
+ * latencyhistogram.hh -- log-linear latency histogram
+ * Rafael Laufer, Massimo Gallo
+ *
+ * Copyright (c) 2019 Nokia Bell Labs
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+ *    in the documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ */
+
+#ifndef CLICK_LATENCYHISTOGRAM_HH
+#define CLICK_LATENCYHISTOGRAM_HH
+#include <click/glue.hh>
+#include <click/string.hh>
+#include <click/straccum.hh>
+CLICK_DECLS
+
+#define LATENCY_HISTOGRAM_SUB_BITS 5   // 32 linear buckets per power of 2
+
+// Values are grouped by their most significant bit and each group is split
+// into 2^LATENCY_HISTOGRAM_SUB_BITS linear buckets, as in HdrHistogram, so
+// recording is a couple of instructions and percentiles are within ~3%.
+class LatencyHistogram { public:
+
+	enum {
+		SUB_BITS = LATENCY_HISTOGRAM_SUB_BITS,
+		SUB_COUNT = 1 << SUB_BITS,
+		BUCKETS = (64 - SUB_BITS + 1) << SUB_BITS
+	};
+
+	LatencyHistogram() {
+		reset();
+	}
+
+	inline void reset() {
+		memset(_bucket, 0, sizeof(_bucket));
+		_count = 0;
+		_sum = 0;
+		_min = ~(uint64_t)0;
+		_max = 0;
+	}
+
+	inline void record(uint64_t v) {
+		_bucket[index(v)]++;
+		_count++;
+		_sum += v;
+		if (v < _min)
+			_min = v;
+		if (v > _max)
+			_max = v;
+	}
+
+	inline void merge(const LatencyHistogram &h) {
+		for (int i = 0; i < BUCKETS; i++)
+			_bucket[i] += h._bucket[i];
+		_count += h._count;
+		_sum += h._sum;
+		if (h._min < _min)
+			_min = h._min;
+		if (h._max > _max)
+			_max = h._max;
+	}
+
+	inline uint64_t count() const { return _count; }
+	inline uint64_t min() const { return _count ? _min : 0; }
+	inline uint64_t max() const { return _max; }
+	inline uint64_t mean() const { return _count ? _sum / _count : 0; }
+
+	// Value at quantile @a q (0 < q <= 1)
+	inline uint64_t percentile(double q) const {
+		if (_count == 0)
+			return 0;
+
+		uint64_t rank = (uint64_t)(q * _count + 0.5);
+		if (rank == 0)
+			rank = 1;
+
+		uint64_t seen = 0;
+		for (int i = 0; i < BUCKETS; i++) {
+			seen += _bucket[i];
+			if (seen >= rank) {
+				uint64_t v = value(i);
+				return (v > _max ? _max : v < _min ? _min : v);
+			}
+		}
+		return _max;
+	}
+
+	// Summary as "<prefix>p50=... <prefix>p90=... ..." divided by @a scale
+	inline String unparse(const char *prefix, uint64_t scale = 1) const {
+		StringAccum sa;
+		sa << prefix << "min=" << min() / scale << ' '
+		   << prefix << "mean=" << mean() / scale << ' '
+		   << prefix << "p50=" << percentile(0.50) / scale << ' '
+		   << prefix << "p90=" << percentile(0.90) / scale << ' '
+		   << prefix << "p99=" << percentile(0.99) / scale << ' '
+		   << prefix << "p999=" << percentile(0.999) / scale << ' '
+		   << prefix << "max=" << max() / scale;
+		return sa.take_string();
+	}
+
+  private:
+
+	static inline int index(uint64_t v) {
+		if (v < SUB_COUNT)
+			return (int)v;
+
+		int e = 63 - __builtin_clzll(v);
+		int shift = e - SUB_BITS;
+		return ((shift + 1) << SUB_BITS) + (int)((v >> shift) - SUB_COUNT);
+	}
+
+	// Middle of the range of values mapped to bucket @a i
+	static inline uint64_t value(int i) {
+		int group = i >> SUB_BITS;
+		uint64_t sub = i & (SUB_COUNT - 1);
+		if (group == 0)
+			return sub;
+
+		int shift = group - 1;
+		return ((SUB_COUNT + sub) << shift) + ((1ULL << shift) >> 1);
+	}
+
+	uint64_t _bucket[BUCKETS];
+	uint64_t _count;
+	uint64_t _sum;
+	uint64_t _min;
+	uint64_t _max;
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,375 @@
+/*
+ * linkemulator.{cc,hh} -- emulates a WAN link with delay, loss, reordering and rate limits
+ * Rafael Laufer, Massimo Gallo
+ *
+ * Copyright (c) 2019 Nokia Bell Labs
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+ *    in the documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ */
+
+#include <click/config.h>
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/master.hh>
+#include <click/standard/scheduleinfo.hh>
+#include "linkemulator.hh"
+#include "tcpclock.hh"
+#include "util.hh"
+CLICK_DECLS
+
+LinkEmulator::LinkEmulator()
+	: _core(NULL), _nthreads(0), _rate(0), _limit(0), _delay(0), _jitter(0),
+	  _loss(0), _ge_p(0), _ge_r(0), _ge_loss(0), _reorder(0), _duplicate(0),
+	  _shift(0), _slots(0), _mask(0), _burst(256), _seed(0)
+{
+}
+
+LinkEmulator::~LinkEmulator()
+{
+}
+
+int
+LinkEmulator::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+	uint32_t rate = 0;
+	uint32_t limit = 0;
+	Timestamp delay, jitter;
+	Timestamp resolution = Timestamp::make_usec(4);
+	double loss = 0, ge_p = 0, ge_r = 0, ge_loss = 1, reorder = 0, dup = 0;
+	uint32_t slots = 65536;
+	uint32_t burst = 256;
+	uint32_t seed = 0;
+
+	if (Args(conf, this, errh)
+		.read("BANDWIDTH", BandwidthArg(), rate)
+		.read("LIMIT", limit)
+		.read("DELAY", delay)
+		.read("JITTER", jitter)
+		.read("LOSS", loss)
+		.read("GE_P", ge_p)
+		.read("GE_R", ge_r)
+		.read("GE_LOSS", ge_loss)
+		.read("REORDER", reorder)
+		.read("DUPLICATE", dup)
+		.read("RESOLUTION", resolution)
+		.read("SLOTS", slots)
+		.read("BURST", burst)
+		.read("SEED", seed)
+		.complete() < 0)
+		return -1;
+
+	double p[] = { loss, ge_p, ge_r, ge_loss, reorder, dup };
+	for (unsigned i = 0; i < sizeof(p)/sizeof(p[0]); i++)
+		if (p[i] < 0 || p[i] > 1)
+			return errh->error("probabilities must be between 0 and 1");
+	if (resolution.nsecval() <= 0)
+		return errh->error("RESOLUTION must be positive");
+	if (slots == 0 || slots > (1U << 30))
+		return errh->error("SLOTS out of range");
+	if (burst == 0)
+		return errh->error("BURST must be positive");
+
+	_rate = rate;
+	_limit = limit;
+	_delay = delay.nsecval();
+	_jitter = jitter.nsecval();
+	_loss = prob(loss);
+	_ge_p = prob(ge_p);
+	_ge_r = prob(ge_r);
+	_ge_loss = prob(ge_loss);
+	_reorder = prob(reorder);
+	_duplicate = prob(dup);
+	_burst = burst;
+
+	// The delay line cannot be resized while packets are in flight
+	if (!_core) {
+		_shift = 0;
+		while ((2ULL << _shift) <= (uint64_t)resolution.nsecval())
+			_shift++;
+
+		_slots = 1;
+		while (_slots < slots)
+			_slots <<= 1;
+		_mask = _slots - 1;
+
+		_seed = seed;
+	}
+
+	return 0;
+}
+
+int
+LinkEmulator::initialize(ErrorHandler *errh)
+{
+	_nthreads = master()->nthreads();
+	_core = new CoreData[_nthreads];
+
+	for (int c = 0; c < _nthreads; c++) {
+		CoreData *d = &_core[c];
+
+		d->wheel = new Slot[_slots];
+		if (!d->wheel)
+			return errh->error("out of memory");
+		memset(d->wheel, 0, _slots * sizeof(Slot));
+
+		// Seed must be nonzero and different for each core
+		uint64_t seed = (_seed ? _seed : click_random());
+		d->rng = (seed << 32) | (c + 1);
+
+		// Per-core task releasing packets from the delay line
+		d->task = new Task(this);
+		ScheduleInfo::initialize_task(this, d->task, false, errh);
+		d->task->move_thread(c);
+	}
+
+	return 0;
+}
+
+void
+LinkEmulator::cleanup(CleanupStage)
+{
+	for (int c = 0; _core && c < _nthreads; c++) {
+		CoreData *d = &_core[c];
+
+		for (uint32_t i = 0; d->wheel && i < _slots; i++) {
+			Packet *p = d->wheel[i].head;
+			while (p) {
+				Packet *next = p->next();
+				p->kill();
+				p = next;
+			}
+		}
+
+		delete[] d->wheel;
+		delete d->task;
+	}
+
+	delete[] _core;
+}
+
+inline bool
+LinkEmulator::lost(CoreData *d)
+{
+	// Bernoulli loss
+	if (!_ge_p)
+		return chance(d, _loss);
+
+	// Gilbert-Elliott loss
+	if (d->bad) {
+		if (chance(d, _ge_r))
+			d->bad = false;
+	}
+	else if (chance(d, _ge_p))
+		d->bad = true;
+
+	return chance(d, d->bad ? _ge_loss : _loss);
+}
+
+inline void
+LinkEmulator::insert(CoreData *d, Packet *p, uint64_t when)
+{
+	// Never release a packet before it is due
+	uint64_t tick = (when + (1ULL << _shift) - 1) >> _shift;
+	if (tick < d->cursor)
+		tick = d->cursor;
+
+	// Packets beyond the horizon go around the wheel more than once
+	Slot &s = d->wheel[tick & _mask];
+	p->set_timestamp_anno(Timestamp::make_nsec(when));
+	p->set_next(NULL);
+	if (s.tail)
+		s.tail->set_next(p);
+	else
+		s.head = p;
+	s.tail = p;
+
+	d->inflight++;
+}
+
+inline void
+LinkEmulator::transmit(CoreData *d, Packet *p, uint64_t now)
+{
+	uint64_t depart = now;
+
+	// Serialization at the link rate
+	if (_rate) {
+		uint64_t start = MAX(now, d->link_free);
+		if (_limit && (start - now) * _rate > _limit * 1000000000ULL) {
+			d->stats.overflows++;
+			p->kill();
+			return;
+		}
+
+		depart = start + p->length() * 1000000000ULL / _rate;
+		d->link_free = depart;
+	}
+
+	// Propagation delay, skipped by reordered packets
+	uint64_t delay = _delay;
+	if (chance(d, _reorder)) {
+		d->stats.reorders++;
+		delay = 0;
+	}
+	else if (_jitter) {
+		uint64_t r = ((uint64_t)random(d) * (2 * _jitter + 1)) >> 32;
+		delay = (delay + r > _jitter ? delay + r - _jitter : 0);
+	}
+
+	insert(d, p, depart + delay);
+}
+
+void
+LinkEmulator::push(int, Packet *p)
+{
+	unsigned c = click_current_cpu_id();
+	CoreData *d = &_core[c];
+	uint64_t now = TCPClock::now().nsecval();
+
+	// Skip the buckets that went by while the link was idle
+	if (!d->inflight) {
+		d->cursor = MAX(d->cursor, now >> _shift);
+		d->task->reschedule();
+	}
+
+	while (p) {
+		Packet *next = p->next();
+		p->set_next(NULL);
+
+		if (lost(d)) {
+			d->stats.drops++;
+			p->kill();
+			p = next;
+			continue;
+		}
+
+		if (chance(d, _duplicate)) {
+			if (Packet *q = p->clone()) {
+				d->stats.duplicates++;
+				transmit(d, q, now);
+			}
+		}
+
+		transmit(d, p, now);
+		p = next;
+	}
+}
+
+bool
+LinkEmulator::run_task(Task *task)
+{
+	unsigned c = click_current_cpu_id();
+	CoreData *d = &_core[c];
+	uint64_t now = TCPClock::refresh().nsecval();
+	uint64_t now_tick = now >> _shift;
+	uint32_t count = 0;
+
+	while (d->cursor <= now_tick && count < _burst) {
+		// Advance first, packets pushed back to us go to a later bucket
+		uint64_t tick = d->cursor++;
+		Slot &s = d->wheel[tick & _mask];
+		Packet *p = s.head;
+		s.head = s.tail = NULL;
+
+		while (p) {
+			Packet *next = p->next();
+			uint64_t when = p->timestamp_anno().nsecval();
+			d->inflight--;
+
+			// Due in a later round, put it back
+			if (((when + (1ULL << _shift) - 1) >> _shift) > tick)
+				insert(d, p, when);
+			else {
+				p->set_next(NULL);
+				output(0).push(p);
+				count++;
+			}
+
+			p = next;
+		}
+	}
+
+	d->stats.count += count;
+
+	if (d->inflight)
+		task->fast_reschedule();
+
+	return count > 0;
+}
+
+enum { H_COUNT, H_DROPS, H_OVERFLOWS, H_DUPLICATES, H_REORDERS, H_INFLIGHT };
+
+String
+LinkEmulator::read_handler(Element *e, void *thunk)
+{
+	LinkEmulator *l = static_cast<LinkEmulator *>(e);
+	uint64_t n = 0;
+
+	for (int c = 0; c < l->_nthreads && l->_core; c++) {
+		CoreData *d = &l->_core[c];
+		switch ((intptr_t)thunk) {
+		case H_COUNT:
+			n += d->stats.count;
+			break;
+		case H_DROPS:
+			n += d->stats.drops;
+			break;
+		case H_OVERFLOWS:
+			n += d->stats.overflows;
+			break;
+		case H_DUPLICATES:
+			n += d->stats.duplicates;
+			break;
+		case H_REORDERS:
+			n += d->stats.reorders;
+			break;
+		case H_INFLIGHT:
+			n += d->inflight;
+			break;
+		}
+	}
+
+	return String(n);
+}
+
+int
+LinkEmulator::write_handler(const String &, Element *e, void *, ErrorHandler *)
+{
+	LinkEmulator *l = static_cast<LinkEmulator *>(e);
+
+	for (int c = 0; c < l->_nthreads && l->_core; c++)
+		l->_core[c].stats = Stats();
+
+	return 0;
+}
+
+void
+LinkEmulator::add_handlers()
+{
+	add_read_handler("count", read_handler, H_COUNT);
+	add_read_handler("drops", read_handler, H_DROPS);
+	add_read_handler("overflows", read_handler, H_OVERFLOWS);
+	add_read_handler("duplicates", read_handler, H_DUPLICATES);
+	add_read_handler("reorders", read_handler, H_REORDERS);
+	add_read_handler("inflight", read_handler, H_INFLIGHT);
+	add_write_handler("reset_counts", write_handler, 0, Handler::BUTTON);
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(Util TCPClock)
+EXPORT_ELEMENT(LinkEmulator)
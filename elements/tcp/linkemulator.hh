@@ -0,0 +1,290 @@
+/*
+ * linkemulator.{cc,hh} -- emulates a WAN link with delay, loss, reordering and rate limits
+ * Rafael Laufer, Massimo Gallo
+ *
+ * Copyright (c) 2019 Nokia Bell Labs
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+ *    in the documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ */
+
+#ifndef CLICK_LINKEMULATOR_HH
+#define CLICK_LINKEMULATOR_HH
+#include <click/element.hh>
+#include <click/task.hh>
+CLICK_DECLS
+
+/*
+=c
+
+LinkEmulator([I<keywords> BANDWIDTH, LIMIT, DELAY, JITTER, LOSS, GE_P, GE_R,
+GE_LOSS, REORDER, DUPLICATE, RESOLUTION, SLOTS, BURST, SEED])
+
+=s tcp
+
+emulates a WAN link with delay, loss, reordering and rate limits
+
+=d
+
+Impairs the packets pushed on its input and emits them on its output after
+the emulated transmission and propagation delay, so that loss recovery,
+pacing, and AQM can be tuned without real WAN links, e.g., between the
+endpoints of a LoopbackLink.
+
+Each core emulates its own link, that is, packets pushed by a core are
+emitted by the same core and BANDWIDTH applies to each core separately.
+Packets in flight wait in a per-core delay line, a timing wheel of SLOTS
+buckets of RESOLUTION each, linked through the packets themselves. Inserting
+and releasing a packet is therefore O(1) and no timer is needed per packet.
+Packets due in the same bucket are emitted in arrival order. Delays longer
+than the wheel horizon, i.e., SLOTS times RESOLUTION, are supported, but
+these packets go around the wheel more than once.
+
+For each packet, in this order, LinkEmulator
+
+=over 4
+
+=item *
+
+drops it with probability LOSS. If GE_P is positive, the loss follows a
+Gilbert-Elliott model instead, moving from the good to the bad state with
+probability GE_P and back with probability GE_R at every packet, and losing
+packets with probability LOSS in the good state and GE_LOSS in the bad one;
+
+=item *
+
+duplicates it with probability DUPLICATE;
+
+=item *
+
+serializes it at BANDWIDTH, dropping it if more than LIMIT bytes are
+already waiting for transmission;
+
+=item *
+
+delays it by DELAY plus a uniform random value in [-JITTER, JITTER], unless
+it is reordered with probability REORDER, in which case it skips the delay
+and overtakes the packets in flight.
+
+=back
+
+The timestamp annotation of emitted packets is set to the time they leave
+the link.
+
+Keyword arguments are:
+
+=over 8
+
+=item BANDWIDTH
+
+Bandwidth. Link rate per core. Default is 0, i.e., no rate limit.
+
+=item LIMIT
+
+Integer. Bytes waiting for transmission at BANDWIDTH above which packets are
+dropped. Default is 0, i.e., no limit.
+
+=item DELAY
+
+Time. One-way propagation delay. Default is 0.
+
+=item JITTER
+
+Time. Maximum random deviation from DELAY. Default is 0.
+
+=item LOSS
+
+Double between 0 and 1. Loss probability, in the good state for the
+Gilbert-Elliott model. Default is 0.
+
+=item GE_P, GE_R
+
+Doubles between 0 and 1. Gilbert-Elliott transition probabilities from the
+good to the bad state and back. Default is 0, i.e., Bernoulli loss.
+
+=item GE_LOSS
+
+Double between 0 and 1. Loss probability in the bad state. Default is 1.
+
+=item REORDER
+
+Double between 0 and 1. Probability that a packet skips the delay. Default
+is 0.
+
+=item DUPLICATE
+
+Double between 0 and 1. Duplication probability. Default is 0.
+
+=item RESOLUTION
+
+Time. Bucket width of the delay line, rounded down to a power of two
+nanoseconds. Default is 4us.
+
+=item SLOTS
+
+Integer. Number of buckets in the delay line, rounded up to a power of two.
+Default is 65536.
+
+=item BURST
+
+Integer. Number of packets emitted per task run before other tasks get to
+run. Default is 256.
+
+=item SEED
+
+Integer. Seed of the random number generators. Default is 0, i.e., random.
+
+=back
+
+All keywords but RESOLUTION and SLOTS may be changed at run time through the
+config handler.
+
+=h count read-only
+
+Returns the number of packets emitted.
+
+=h drops read-only
+
+Returns the number of packets lost.
+
+=h overflows read-only
+
+Returns the number of packets dropped because LIMIT was reached.
+
+=h duplicates read-only
+
+Returns the number of duplicated packets.
+
+=h reorders read-only
+
+Returns the number of packets that skipped the delay.
+
+=h inflight read-only
+
+Returns the number of packets currently in the delay line.
+
+=h reset_counts write-only
+
+Resets the counters.
+
+=e
+
+Emulates a 100 Mbps path with 20 ms RTT and 1% loss in both directions:
+
+    tcp_layer[0]
+      -> rq :: IPClassifier(dst host 10.0.0.2, -)
+      -> LinkEmulator(BANDWIDTH 100Mbps, LIMIT 250000, DELAY 10ms, LOSS 0.01)
+      -> [0]link :: LoopbackLink(PEER 1 0);
+    rq[1]
+      -> LinkEmulator(BANDWIDTH 100Mbps, LIMIT 250000, DELAY 10ms, LOSS 0.01)
+      -> [1]link;
+
+=a LoopbackLink */
+
+class LinkEmulator final : public Element { public:
+
+	LinkEmulator() CLICK_COLD;
+	~LinkEmulator() CLICK_COLD;
+
+	const char *class_name() const { return "LinkEmulator"; }
+	const char *port_count() const { return PORTS_1_1; }
+	const char *processing() const { return PUSH; }
+
+	int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
+	bool can_live_reconfigure() const { return true; }
+	int initialize(ErrorHandler *) CLICK_COLD;
+	void cleanup(CleanupStage) CLICK_COLD;
+	void add_handlers() CLICK_COLD;
+
+	void push(int, Packet *) final;
+	bool run_task(Task *);
+
+  private:
+
+	// Packets due in the same bucket, linked through Packet::next()
+	struct Slot {
+		Packet *head;
+		Packet *tail;
+	};
+
+	struct Stats {
+		uint64_t count;
+		uint64_t drops;
+		uint64_t overflows;
+		uint64_t duplicates;
+		uint64_t reorders;
+		Stats() : count(0), drops(0), overflows(0), duplicates(0), reorders(0) { }
+	};
+
+	struct CoreData {
+		Slot *wheel;
+		uint64_t cursor;      // Next bucket to release, in ticks
+		uint64_t link_free;   // Time the link becomes idle, in nsec
+		uint64_t rng;         // xorshift64* state
+		uint32_t inflight;
+		bool bad;             // Gilbert-Elliott state
+		Task *task;
+		Stats stats;
+		CoreData() : wheel(NULL), cursor(0), link_free(0), rng(0),
+		             inflight(0), bad(false), task(NULL) { }
+	} CLICK_ALIGNED(CLICK_CACHE_LINE_SIZE);
+
+	// Uniform 32-bit random number
+	static inline uint32_t random(CoreData *d) {
+		d->rng ^= d->rng >> 12;
+		d->rng ^= d->rng << 25;
+		d->rng ^= d->rng >> 27;
+		return (d->rng * 2685821657736338717ULL) >> 32;
+	}
+
+	// True with the probability encoded in @a p, see prob()
+	static inline bool chance(CoreData *d, uint64_t p) {
+		return p && random(d) < p;
+	}
+
+	static uint64_t prob(double p) { return (uint64_t)(p * 4294967296.0); }
+
+	inline bool lost(CoreData *d);
+	inline void insert(CoreData *d, Packet *p, uint64_t when);
+	inline void transmit(CoreData *d, Packet *p, uint64_t now);
+
+	CoreData *_core;
+	int _nthreads;
+	uint64_t _rate;           // Bytes per second, 0 for no limit
+	uint64_t _limit;          // Maximum backlog in bytes, 0 for no limit
+	uint64_t _delay;          // nsec
+	uint64_t _jitter;         // nsec
+	uint64_t _loss;           // Probabilities scaled by 2^32
+	uint64_t _ge_p;
+	uint64_t _ge_r;
+	uint64_t _ge_loss;
+	uint64_t _reorder;
+	uint64_t _duplicate;
+	uint32_t _shift;          // log2 of the bucket width in nsec
+	uint32_t _slots;
+	uint32_t _mask;
+	uint32_t _burst;
+	uint32_t _seed;
+
+	static String read_handler(Element *, void *) CLICK_COLD;
+	static int write_handler(const String &, Element *, void *, ErrorHandler *) CLICK_COLD;
+
+};
+
+CLICK_ENDDECLS
+#endif
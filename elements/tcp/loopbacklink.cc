@@ -0,0 +1,223 @@
+/*
+ * loopbacklink.{cc,hh} -- back-to-back link between cores, without a NIC
+ * Rafael Laufer, Massimo Gallo
+ *
+ * Copyright (c) 2019 Nokia Bell Labs
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+ *    in the documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ */
+
+#include <click/config.h>
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/master.hh>
+#include <click/straccum.hh>
+#include <click/standard/scheduleinfo.hh>
+#include "loopbacklink.hh"
+#include "tcpclock.hh"
+CLICK_DECLS
+
+LoopbackLink::LoopbackLink()
+	: _ring(NULL), _stats(NULL), _nthreads(0), _burst(32), _capacity(4096),
+	  _timestamp(true)
+{
+}
+
+LoopbackLink::~LoopbackLink()
+{
+}
+
+int
+LoopbackLink::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+	String peer;
+
+	if (Args(conf, this, errh)
+		.read_p("PEER", AnyArg(), peer)
+		.read("BURST", _burst)
+		.read("CAPACITY", _capacity)
+		.read("TIMESTAMP", _timestamp)
+		.complete() < 0)
+		return -1;
+
+	if (_burst == 0)
+		return errh->error("BURST must be positive");
+	if (_capacity < _burst)
+		return errh->error("CAPACITY must be at least BURST");
+
+	_nthreads = master()->nthreads();
+
+	// Core emitting the packets of input 0, identity by default
+	_peer[0].resize(_nthreads, -1);
+	Vector<String> v;
+	cp_spacevec(cp_unquote(peer), v);
+	if (v.empty())
+		for (int c = 0; c < _nthreads; c++)
+			_peer[0][c] = c;
+	else if (v.size() != _nthreads)
+		return errh->error("PEER must have one core per thread (%d)", _nthreads);
+	else
+		for (int c = 0; c < _nthreads; c++)
+			if (!IntArg().parse(v[c], _peer[0][c]) ||
+			    _peer[0][c] < 0 || _peer[0][c] >= _nthreads)
+				return errh->error("PEER core %<%s%> out of range", v[c].c_str());
+
+	// Replies go back through the inverse permutation
+	_peer[1].resize(_nthreads, -1);
+	for (int c = 0; c < _nthreads; c++) {
+		int d = _peer[0][c];
+		if (_peer[1][d] != -1)
+			return errh->error("PEER must be a permutation of the threads");
+		_peer[1][d] = c;
+	}
+
+	return 0;
+}
+
+int
+LoopbackLink::initialize(ErrorHandler *errh)
+{
+	_ring = new Ring[2 * _nthreads];
+	_stats = new Stats[_nthreads];
+	_poll.resize(_nthreads);
+
+	for (int i = 0; i < 2; i++)
+		for (int c = 0; c < _nthreads; c++) {
+			if (ring(i, c).initialize(_capacity) < 0)
+				return errh->error("out of memory");
+			_poll[_peer[i][c]].push_back(i * _nthreads + c);
+		}
+
+	// Per-core task polling the rings, like the NIC RX queues
+	for (int c = 0; c < _nthreads; c++) {
+		Task *t = new Task(this);
+		ScheduleInfo::initialize_task(this, t, errh);
+		t->move_thread(c);
+		_task.push_back(t);
+	}
+
+	return 0;
+}
+
+void
+LoopbackLink::cleanup(CleanupStage)
+{
+	for (int i = 0; i < _task.size(); i++)
+		delete _task[i];
+
+	if (_ring)
+		for (int r = 0; r < 2 * _nthreads; r++) {
+			Packet *p;
+			while (_ring[r].pop(p))
+				p->kill();
+		}
+
+	delete[] _ring;
+	delete[] _stats;
+}
+
+void
+LoopbackLink::push(int port, Packet *p)
+{
+	unsigned c = click_current_cpu_id();
+	Ring &r = ring(port, c);
+
+	while (p) {
+		Packet *next = p->next();
+		p->set_next(NULL);
+
+		if (unlikely(!r.push(p))) {
+			_stats[c].drops++;
+			p->kill();
+		}
+
+		p = next;
+	}
+}
+
+bool
+LoopbackLink::run_task(Task *task)
+{
+	unsigned c = click_current_cpu_id();
+	const Vector<int> &poll = _poll[c];
+	uint32_t count = 0;
+	Timestamp now;
+
+	for (int k = 0; k < poll.size(); k++) {
+		Ring &r = _ring[poll[k]];
+		int port = poll[k] / _nthreads;
+
+		Packet *p;
+		for (uint32_t n = 0; n < _burst && r.pop(p); n++) {
+			// Getting the current time is costly, do it once per run
+			if (_timestamp && !now)
+				now = TCPClock::refresh();
+
+			// Fresh packet, as if received from a NIC
+			p->clear_annotations();
+			if (_timestamp)
+				p->set_timestamp_anno(now);
+
+			output(port).push(p);
+			count++;
+		}
+	}
+
+	_stats[c].count += count;
+
+	task->fast_reschedule();
+	return count > 0;
+}
+
+String
+LoopbackLink::read_handler(Element *e, void *thunk)
+{
+	LoopbackLink *l = static_cast<LoopbackLink *>(e);
+	uint64_t count = 0, drops = 0;
+
+	for (int c = 0; c < l->_nthreads && l->_stats; c++) {
+		count += l->_stats[c].count;
+		drops += l->_stats[c].drops;
+	}
+
+	return String(thunk ? drops : count);
+}
+
+int
+LoopbackLink::write_handler(const String &, Element *e, void *, ErrorHandler *)
+{
+	LoopbackLink *l = static_cast<LoopbackLink *>(e);
+
+	for (int c = 0; c < l->_nthreads && l->_stats; c++)
+		l->_stats[c] = Stats();
+
+	return 0;
+}
+
+void
+LoopbackLink::add_handlers()
+{
+	add_read_handler("count", read_handler, 0);
+	add_read_handler("drops", read_handler, 1);
+	add_write_handler("reset_counts", write_handler, 0, Handler::BUTTON);
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(TCPClock)
+EXPORT_ELEMENT(LoopbackLink)
@@ -0,0 +1,156 @@
+/*
+ * loopbacklink.{cc,hh} -- back-to-back link between cores, without a NIC
+ * Rafael Laufer, Massimo Gallo
+ *
+ * Copyright (c) 2019 Nokia Bell Labs
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+ *    in the documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ */
+
+#ifndef CLICK_LOOPBACKLINK_HH
+#define CLICK_LOOPBACKLINK_HH
+#include <click/element.hh>
+#include <click/task.hh>
+#include "spscring.hh"
+CLICK_DECLS
+
+/*
+=c
+
+LoopbackLink([PEER, I<keywords> BURST, CAPACITY, TIMESTAMP])
+
+=s tcp
+
+connects two TCP endpoints in the same process, possibly across cores
+
+=d
+
+Replaces the NIC in benchmarks, so that a client and a server (or a client,
+a proxy, and a server) can talk to each other through the same TCP layer.
+Packets pushed on input I<i> are emitted on output I<i> by another core,
+as if they had crossed a wire and arrived through RSS. Input 0 carries
+packets towards the servers, input 1 the replies.
+
+A packet pushed on input 0 by core I<c> is emitted by core PEER[I<c>], and a
+packet pushed on input 1 is emitted by the core I<d> with PEER[I<d>] = I<c>.
+Hence, both directions of a flow are handled by the same pair of cores. Each
+(input, core) pair has a lock-free single-producer ring and each core polls
+the rings it consumes from, emitting at most BURST packets from each at a
+time.
+
+Annotations are cleared and the timestamp annotation is set to the current
+time, as done by DPDK on reception.
+
+Keyword arguments are:
+
+=over 8
+
+=item PEER
+
+Space-separated list of cores. PEER[I<c>] is the core emitting the packets
+pushed on input 0 by core I<c>. Must be a permutation of all threads. Default
+is the identity, i.e., packets stay on the same core.
+
+=item BURST
+
+Integer. Maximum number of packets emitted from a ring at a time. Default is
+32.
+
+=item CAPACITY
+
+Integer. Number of packets each ring can hold. Packets are dropped if the
+ring is full. Default is 4096.
+
+=item TIMESTAMP
+
+Boolean. Set the timestamp annotation on emitted packets. Default is true.
+
+=back
+
+=h count read-only
+
+Returns the number of packets emitted.
+
+=h drops read-only
+
+Returns the number of packets dropped due to full rings.
+
+=h reset_counts write-only
+
+Resets the counters.
+
+=e
+
+    tcp_layer[0]
+      -> rq :: IPClassifier(dst host 10.0.0.2, -)
+      -> [0]link :: LoopbackLink(PEER 1 0);
+    rq[1] -> [1]link;
+
+    link[0] -> CheckIPHeader(CHECKSUM false) -> ... -> [0]tcp_layer;
+    link[1] -> CheckIPHeader(CHECKSUM false) -> ... -> [0]tcp_layer;
+
+=a DPDK */
+
+class LoopbackLink final : public Element { public:
+
+	LoopbackLink() CLICK_COLD;
+	~LoopbackLink() CLICK_COLD;
+
+	const char *class_name() const { return "LoopbackLink"; }
+	const char *port_count() const { return "2/2"; }
+	const char *processing() const { return PUSH; }
+
+	int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
+	int initialize(ErrorHandler *) CLICK_COLD;
+	void cleanup(CleanupStage) CLICK_COLD;
+	void add_handlers() CLICK_COLD;
+
+	void push(int, Packet *) final;
+	bool run_task(Task *);
+
+  private:
+
+	typedef SPSCRing<Packet *> Ring;
+
+	struct Stats {
+		uint64_t count;
+		uint64_t drops;
+		Stats() : count(0), drops(0) { }
+	} CLICK_ALIGNED(CLICK_CACHE_LINE_SIZE);
+
+	// Ring of packets pushed on input i by core c
+	inline Ring &ring(int i, int c) { return _ring[i * _nthreads + c]; }
+
+	Ring *_ring;
+	Stats *_stats;
+	Vector<Task *> _task;
+	Vector<int> _peer[2];           // emitting core per input and core
+	Vector<Vector<int> > _poll;     // rings polled per core
+	int _nthreads;
+	uint32_t _burst;
+	uint32_t _capacity;
+	bool _timestamp;
+
+	static String read_handler(Element *, void *) CLICK_COLD;
+	static int write_handler(const String &, Element *, void *, ErrorHandler *) CLICK_COLD;
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -59,6 +59,7 @@ PktQueue::insert_after(Packet *x, Packet *p)
 
 	_bytes += p->length();
 	_packets++;
+	TCPMemory::charge(p->length(), 1);
 }
 
 void 
@@ -74,6 +75,29 @@ PktQueue::pull_front(uint32_t len)
 	click_assert(!empty());
 	front()->pull(len);
 	_bytes -= len;
+	TCPMemory::charge(-(int32_t)len, 0);
+}
+
+// Append data to a queued packet, as much as its tailroom allows, and return
+// how many bytes were appended. Shared and chained packets are left as is.
+uint32_t
+PktQueue::append(Packet *x, const void *data, uint32_t len)
+{
+	click_assert(x);
+	if (x->shared() || x->segments() > 1)
+		return 0;
+
+	if (len > x->tailroom())
+		len = x->tailroom();
+	if (len == 0)
+		return 0;
+
+	WritablePacket *w = x->put(len);
+	memcpy(w->end_data() - len, data, len);
+
+	_bytes += len;
+	TCPMemory::charge(len, 0);
+	return len;
 }
 
 void
@@ -85,6 +109,7 @@ PktQueue::push_back(Packet *p)
 		_head = p;
 		_bytes = p->length();
 		_packets = 1;
+		TCPMemory::charge(p->length(), 1);
 		return;
 	}
 
@@ -112,6 +137,7 @@ PktQueue::replace(Packet *x, Packet *y)
 	p->set_next(y);
 
 	_bytes += y->length() - x->length();
+	TCPMemory::charge((int32_t)y->length() - (int32_t)x->length(), 0);
 }
 
 void
@@ -135,6 +161,7 @@ PktQueue::pop_front()
 	}
 	_bytes -= len;
 	_packets--;
+	TCPMemory::charge(-(int32_t)len, -1);
 }
 
 void
@@ -149,4 +176,5 @@ PktQueue::flush()
 
 CLICK_ENDDECLS
 #undef click_assert
+ELEMENT_REQUIRES(TCPMemory)
 ELEMENT_PROVIDES(PktQueue)
@@ -26,6 +26,7 @@
 #ifndef CLICK_PKTQUEUE_HH
 #define CLICK_PKTQUEUE_HH
 #include <click/packet.hh>
+#include "tcpmemory.hh"
 CLICK_DECLS
 
 class PktQueue { public:
@@ -39,6 +40,7 @@ class PktQueue { public:
 	inline Packet *front(void) const;
 	inline Packet *back(void) const;
 	void pull_front(uint32_t);
+	uint32_t append(Packet *, const void *, uint32_t);
 	void push_back(Packet *);
 	void push_front(Packet *);
 	void insert_after(Packet *, Packet *);
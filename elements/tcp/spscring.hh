@@ -0,0 +1,123 @@
+/*
+ * spscring.hh -- lock-free single-producer single-consumer ring
+ * Rafael Laufer, Massimo Gallo
+ *
+ * Copyright (c) 2019 Nokia Bell Labs
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+ *    in the documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ */
+
+#ifndef CLICK_SPSCRING_HH
+#define CLICK_SPSCRING_HH
+#include <click/glue.hh>
+CLICK_DECLS
+
+template <typename T>
+class SPSCRing { public:
+
+	/** @brief Construct an empty ring, call initialize() before use. */
+	SPSCRing()
+		: _ring(NULL), _mask(0), _head(0), _tail_cache(0),
+		  _tail(0), _head_cache(0) {
+	}
+
+	~SPSCRing() {
+		delete[] _ring;
+	}
+
+	/** @brief Allocate room for at least @a n elements. */
+	int initialize(uint32_t n) {
+		uint32_t capacity = 2;
+		while (capacity < n)
+			capacity <<= 1;
+
+		delete[] _ring;
+		_ring = new T[capacity];
+		if (!_ring)
+			return -1;
+
+		_mask = capacity - 1;
+		_head = _tail = _head_cache = _tail_cache = 0;
+		return 0;
+	}
+
+	/** @brief Return the ring capacity. */
+	inline uint32_t capacity() const {
+		return _mask + 1;
+	}
+
+	/** @brief Return the number of elements (approximate if concurrent). */
+	inline uint32_t size() const {
+		return __atomic_load_n(&_tail, __ATOMIC_ACQUIRE) -
+		       __atomic_load_n(&_head, __ATOMIC_ACQUIRE);
+	}
+
+	/** @brief Return true if the ring is empty. */
+	inline bool empty() const {
+		return size() == 0;
+	}
+
+	/** @brief Insert @a x, only called by the producer. */
+	inline bool push(const T &x) {
+		uint32_t tail = _tail;
+		if (tail - _head_cache > _mask) {
+			_head_cache = __atomic_load_n(&_head, __ATOMIC_ACQUIRE);
+			if (tail - _head_cache > _mask)
+				return false;
+		}
+
+		_ring[tail & _mask] = x;
+		__atomic_store_n(&_tail, tail + 1, __ATOMIC_RELEASE);
+		return true;
+	}
+
+	/** @brief Remove the oldest element into @a x, only called by the consumer. */
+	inline bool pop(T &x) {
+		uint32_t head = _head;
+		if (head == _tail_cache) {
+			_tail_cache = __atomic_load_n(&_tail, __ATOMIC_ACQUIRE);
+			if (head == _tail_cache)
+				return false;
+		}
+
+		x = _ring[head & _mask];
+		__atomic_store_n(&_head, head + 1, __ATOMIC_RELEASE);
+		return true;
+	}
+
+  private:
+
+	T *_ring;
+	uint32_t _mask;
+
+	// Consumer side, with a cached copy of the producer index
+	uint32_t _head CLICK_ALIGNED(CLICK_CACHE_LINE_SIZE);
+	uint32_t _tail_cache;
+
+	// Producer side, with a cached copy of the consumer index
+	uint32_t _tail CLICK_ALIGNED(CLICK_CACHE_LINE_SIZE);
+	uint32_t _head_cache;
+
+	SPSCRing(const SPSCRing &);
+	SPSCRing &operator=(const SPSCRing &);
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -65,12 +65,11 @@ TCPAckEncap::smaction(Packet *q)
 	/**
 	 * DCTCP end
 	 */
-	th->th_win    = htons(s->rcv_wnd >> s->rcv_wscale);
+	th->th_win    = htons(s->advertised_window());
 	th->th_sum    = 0;
 	th->th_urp    = 0;
 #if HAVE_TCP_DELAYED_ACK
-	if (s->delayed_ack_timer.scheduled())
-		s->delayed_ack_timer.unschedule();
+	s->delayed_ack_timer.cancel();
 #endif 
 	return p;
 }
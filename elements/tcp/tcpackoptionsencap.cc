@@ -30,6 +30,7 @@
 #include "tcpsack.hh"
 #include "tcpstate.hh"
 #include "util.hh"
+#include "tcpclock.hh"
 CLICK_DECLS
 
 TCPAckOptionsEncap::TCPAckOptionsEncap()
@@ -121,7 +122,7 @@ TCPAckOptionsEncap::smaction(Packet *q)
 		// Get now, preferably from packet timestamp
 		uint32_t now = (uint32_t)p->timestamp_anno().usecval();
 		if (now == 0)
-			now = (uint32_t)Timestamp::now_steady().usecval();
+			now = (uint32_t)TCPClock::now_usec();
 
 		// Pointers to the timestamps
 		uint32_t *ts_val = (uint32_t *)(ptr + 4);
@@ -30,6 +30,7 @@
 #include "tcpinfo.hh"
 #include "tcpstate.hh"
 #include "util.hh"
+#include "tcpclock.hh"
 CLICK_DECLS
 
 TCPAckOptionsParse::TCPAckOptionsParse()
@@ -114,7 +115,7 @@ TCPAckOptionsParse::smaction(Packet *p)
 				// Get now, preferably from packet timestamp
 				uint32_t now = (uint32_t)p->timestamp_anno().usecval();
 				if (now == 0)
-					now = (uint32_t)Timestamp::now_steady().usecval();
+					now = (uint32_t)TCPClock::now_usec();
 
 				// Get timestamp parameters
 				uint32_t ts_val = ntohl(*(const uint32_t *)&ptr[2]);
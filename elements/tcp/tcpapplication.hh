@@ -42,11 +42,11 @@ class TCPApplication : public Element { public:
 	inline int click_fcntl(int sockfd, int cmd);
 	inline int click_bind(int sockfd, IPAddress &addr, uint16_t &port);
 	inline int click_setsockopt(int sockfd, int level, int optname, const void *optval, socklen_t optlen);
-	inline int click_getsockopt(int sockfd, int level, int optname, const void *optval, socklen_t optlen);
+	inline int click_getsockopt(int sockfd, int level, int optname, void *optval, socklen_t *optlen);
 	inline int click_listen(int sockfd, int backlog);
 	inline int click_accept(int sockfd, IPAddress &addr, uint16_t &port);
 	inline int click_connect(int sockfd, IPAddress addr, uint16_t port);
-	inline int click_send(int sockfd, const char *msg, size_t len);
+	inline int click_send(int sockfd, const char *msg, size_t len, int flags = 0);
 	inline int click_recv(int sockfd, char *msg, size_t len);
 	inline int click_close(int sockfd);
 	inline int click_fsync(int sockfd);
@@ -54,6 +54,7 @@ class TCPApplication : public Element { public:
 	// Zero-copy (ZC) API
 	inline int click_push(int sockfd, Packet *p);
 	inline Packet *click_pull(int sockfd, int npkts = 1);
+	inline int click_splice(int fd_in, int fd_out);
 	
 	//State modifications
 	inline void click_set_task(int sockfd, BlockingTask * t);
@@ -115,7 +116,7 @@ TCPApplication::click_setsockopt(int sockfd, int level, int optname, const void
 }
 
 inline int
-TCPApplication::click_getsockopt(int sockfd, int level, int optname, const void *optval, socklen_t optlen)
+TCPApplication::click_getsockopt(int sockfd, int level, int optname, void *optval, socklen_t *optlen)
 {
 	return TCPSocket::getsockopt(_pid, sockfd, level, optname, optval, optlen);
 }
@@ -139,9 +140,9 @@ TCPApplication::click_connect(int sockfd, IPAddress addr, uint16_t port)
 }
 
 inline int
-TCPApplication::click_send(int sockfd, const char *msg, size_t len)
+TCPApplication::click_send(int sockfd, const char *msg, size_t len, int flags)
 {
-	return TCPSocket::send(_pid, sockfd, msg, len);
+	return TCPSocket::send(_pid, sockfd, msg, len, flags);
 }
 
 inline int
@@ -174,6 +175,12 @@ TCPApplication::click_pull(int sockfd, int npkts)
 	return TCPSocket::pull(_pid, sockfd, npkts);
 }
 
+inline int
+TCPApplication::click_splice(int fd_in, int fd_out)
+{
+	return TCPSocket::splice(_pid, fd_in, fd_out);
+}
+
 inline void 
 TCPApplication::click_set_task(int sockfd, BlockingTask * t)
 {
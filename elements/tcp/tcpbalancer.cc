@@ -0,0 +1,488 @@
+/*
+ * tcpbalancer.{cc,hh} -- hands new connections off from loaded cores to idle ones
+ * Rafael Laufer, Massimo Gallo
+ *
+ * Copyright (c) 2019 Nokia Bell Labs
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+ *    in the documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ */
+
+#include <click/config.h>
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/master.hh>
+#include <click/straccum.hh>
+#include <click/standard/scheduleinfo.hh>
+#include "tcpbalancer.hh"
+#include "tcpstate.hh"
+#include "tcpinfo.hh"
+#include "tcptimers.hh"
+CLICK_DECLS
+
+TCPBalancer *TCPBalancer::_balancer = NULL;
+
+static const TCPInfo::Balancer hooks = {
+	TCPBalancer::handoff, TCPBalancer::steer, TCPBalancer::unsteer,
+	TCPBalancer::poll
+};
+
+TCPBalancer::TCPBalancer()
+	: _ring(NULL), _core(NULL), _nthreads(0), _threshold(16), _burst(8),
+	  _capacity(256)
+{
+}
+
+int
+TCPBalancer::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+	if (Args(conf, this, errh)
+		.read("THRESHOLD", _threshold)
+		.read("BURST", _burst)
+		.read("CAPACITY", _capacity)
+		.complete() < 0)
+		return -1;
+
+	if (_burst == 0)
+		return errh->error("BURST must be positive");
+	if (_capacity < _burst)
+		return errh->error("CAPACITY must be at least BURST");
+
+	return 0;
+}
+
+int
+TCPBalancer::initialize(ErrorHandler *errh)
+{
+	if (_balancer)
+		return errh->error("only one TCPBalancer allowed");
+	if (!TCPInfo::redirect())
+		return errh->error("TCPBalancer requires TCPLayer(REDIRECT true)");
+
+	_nthreads = master()->nthreads();
+	_core = new CoreData[_nthreads];
+
+	// Nothing to balance with a single core
+	if (_nthreads == 1)
+		return 0;
+
+	_ring = new Ring[_nthreads * _nthreads];
+	for (int r = 0; r < _nthreads * _nthreads; r++)
+		if (_ring[r].initialize(_capacity) < 0)
+			return errh->error("out of memory");
+
+	// Per-core task, only scheduled when there is something to do
+	for (int c = 0; c < _nthreads; c++) {
+		Task *t = new Task(this);
+		ScheduleInfo::initialize_task(this, t, false, errh);
+		t->move_thread(c);
+		_task.push_back(t);
+	}
+
+	_balancer = this;
+	TCPInfo::set_balancer(&hooks);
+	return 0;
+}
+
+void
+TCPBalancer::cleanup(CleanupStage)
+{
+	if (_balancer == this) {
+		TCPInfo::set_balancer(NULL);
+		_balancer = NULL;
+	}
+
+	for (int i = 0; i < _task.size(); i++)
+		delete _task[i];
+
+	delete[] _ring;
+	delete[] _core;
+	_ring = NULL;
+	_core = NULL;
+}
+
+bool
+TCPBalancer::handoff(TCPState *l)
+{
+	return _balancer->defer(l);
+}
+
+int
+TCPBalancer::steer(const IPFlowID &flow)
+{
+	CoreData &d = _balancer->_core[click_current_cpu_id()];
+	if (d.steer.empty())
+		return -1;
+
+	HashTable<IPFlowID, int>::const_iterator it = d.steer.find(flow);
+	return (it ? it.value() : -1);
+}
+
+void
+TCPBalancer::poll()
+{
+	_balancer->drain(click_current_cpu_id(), ~0U);
+}
+
+// Least loaded core if core c is above it by more than THRESHOLD, or -1
+int
+TCPBalancer::target(int c)
+{
+	uint32_t load = TCPInfo::flow_count(c);
+	uint32_t min = load;
+	int t = -1;
+
+	for (int d = 0; d < _nthreads; d++) {
+		if (d == c)
+			continue;
+		uint32_t l = TCPInfo::flow_count(d);
+		if (l < min) {
+			min = l;
+			t = d;
+		}
+	}
+
+	return (load > min + _threshold ? t : -1);
+}
+
+bool
+TCPBalancer::defer(TCPState *l)
+{
+	int c = click_current_cpu_id();
+	if (!_ring || target(c) < 0)
+		return false;
+
+	// Remember the listener by flow, as it may be gone when the task runs
+	Vector<IPFlowID> &pending = _core[c].pending;
+	int i = 0;
+	while (i < pending.size() && pending[i] != l->flow)
+		i++;
+	if (i == pending.size())
+		pending.push_back(l->flow);
+
+	_task[c]->reschedule();
+	return true;
+}
+
+bool
+TCPBalancer::send(int src, int dst, const Msg &m)
+{
+	if (!ring(src, dst).push(m))
+		return false;
+
+	_task[dst]->reschedule();
+	return true;
+}
+
+// Send a message that must not be lost, later if the ring is full
+void
+TCPBalancer::post(int src, int dst, const Msg &m)
+{
+	CoreData &d = _core[src];
+
+	// Behind the deferred ones, to keep the order
+	if (d.deferred.empty() && send(src, dst, m))
+		return;
+
+	d.deferred.push_back(Deferred(m, dst));
+	d.full++;
+	_task[src]->reschedule();
+}
+
+// Send deferred messages again, true if some are left
+bool
+TCPBalancer::flush(int c)
+{
+	Vector<Deferred> &q = _core[c].deferred;
+
+	int n = 0;
+	while (n < q.size() && send(c, q[n].dst, q[n].m))
+		n++;
+	if (n > 0)
+		q.erase(q.begin(), q.begin() + n);
+
+	return !q.empty();
+}
+
+bool
+TCPBalancer::movable(TCPState *s)
+{
+	return s->state == TCP_ESTABLISHED && s->rxq.empty() && s->rxb.empty()
+	    && s->txq.empty() && s->rtxq.empty() && !s->txs_owner
+	    && !s->rtx_timer.scheduled() && !s->tx_timer.scheduled();
+}
+
+void
+TCPBalancer::move_timers(TCPState *s, unsigned c)
+{
+	s->stop_timers();
+	s->rtx_timer.initialize(TCPTimers::element(), c);
+	s->tx_timer.initialize(TCPTimers::element(), c);
+#if HAVE_TCP_KEEPALIVE
+	s->keepalive_timer.initialize(TCPTimers::element(), c);
+#endif
+#if HAVE_TCP_DELAYED_ACK
+	s->delayed_ack_timer.initialize(TCPTimers::element(), c);
+#endif
+}
+
+void
+TCPBalancer::migrate(int c, TCPState *l)
+{
+	CoreData &d = _core[c];
+
+	for (uint32_t n = 0; n < _burst && !l->acq_empty(); n++) {
+		int t = target(c);
+		if (t < 0)
+			break;
+
+		// Newest connection first, the oldest may be accepted soon
+		TCPState *s = l->acq_prev;
+		if (!movable(s) || ring(c, t).size() >= ring(c, t).capacity())
+			break;
+
+		Msg m;
+		m.s = s;
+		m.origin = c;
+		m.type = MSG_ADOPT;
+#if HAVE_TCP_KEEPALIVE
+		if (s->keepalive_timer.scheduled())
+			m.keepalive = s->keepalive_timer.expiry_steady();
+#endif
+#if HAVE_TCP_DELAYED_ACK
+		if (s->delayed_ack_timer.scheduled())
+			m.delayed_ack = s->delayed_ack_timer.expiry_steady();
+#endif
+		l->acq_erase(s);
+		TCPInfo::flow_remove(s);
+		move_timers(s, t);
+
+		// Its packets still arrive here, redirect them
+		d.steer.set(s->flow, t);
+		s->home = c;
+
+		send(c, t, m);
+		d.out++;
+	}
+
+	// Wake up the application for the rest, TCPProcessAck did not
+	if (!l->acq_empty())
+		l->wake_up(TCP_WAIT_ACQ_NONEMPTY);
+#if HAVE_ALLOW_EPOLL
+	else if (l->event && l->epfd > 0) {
+		// Same as in TCPSocket::accept() once the queue is empty
+		l->event->event &= ~(TCP_WAIT_ACQ_NONEMPTY);
+		if (l->event->event == 0) {
+			TCPInfo::epoll_eq_erase(l->pid, l->epfd, l->event);
+			delete(l->event);
+			l->event = NULL;
+		}
+	}
+#endif
+}
+
+void
+TCPBalancer::place(Msg &m, TCPState *l)
+{
+	TCPState *s = m.s;
+
+	// Inherit the application of the listener on this core
+	s->parent = l;
+	s->pid    = l->pid;
+	s->task   = l->task;
+	s->flags  = l->flags;
+	TCPInfo::flow_insert(s);
+
+#if HAVE_TCP_KEEPALIVE
+	if (m.keepalive)
+		s->keepalive_timer.schedule_at_steady(m.keepalive);
+#endif
+#if HAVE_TCP_DELAYED_ACK
+	if (m.delayed_ack)
+		s->delayed_ack_timer.schedule_at_steady(m.delayed_ack);
+#endif
+
+	l->acq_push_back(s);
+	l->wake_up(TCP_WAIT_ACQ_NONEMPTY);
+}
+
+void
+TCPBalancer::receive(int c, Msg &m)
+{
+	CoreData &d = _core[c];
+
+	if (m.type == MSG_UNSTEER) {
+		d.steer.erase(m.flow);
+		return;
+	}
+
+	TCPState *s = m.s;
+	if (m.type == MSG_RETURN) {
+		d.steer.erase(s->flow);
+		s->home = -1;
+
+		// Packets are no longer sent to the core that gave it back, which
+		// can drop the entry bouncing them here
+		Msg u;
+		u.flow = s->flow;
+		u.type = MSG_UNSTEER;
+		post(c, m.from, u);
+	}
+
+	// Listening socket for the same address and port on this core
+	IPFlowID flow = s->flow;
+	flow.set_daddr(IPAddress());
+	flow.set_dport(0);
+	TCPState *l = TCPInfo::flow_lookup(flow);
+
+	if (l && l->state == TCP_LISTEN && l->acq_size < l->backlog) {
+		place(m, l);
+		if (m.type == MSG_ADOPT)
+			d.in++;
+		return;
+	}
+
+	// Give it back to the core receiving its packets, which also drops
+	// its redirection entry there. Until then, packets it has already
+	// redirected here are sent back.
+	if (m.type == MSG_ADOPT) {
+		move_timers(s, m.origin);
+		d.steer.set(s->flow, m.origin);
+		m.type = MSG_RETURN;
+		m.from = c;
+		post(c, m.origin, m);
+		d.returned++;
+		return;
+	}
+
+	// No listener left anywhere, the peer gets a RST on its next segment
+	TCPState::deallocate(s);
+}
+
+// Process up to burst messages from each other core, true if some are left
+bool
+TCPBalancer::drain(int c, uint32_t burst)
+{
+	bool more = false;
+
+	for (int src = 0; src < _nthreads; src++) {
+		if (src == c)
+			continue;
+
+		Ring &r = ring(src, c);
+		Msg m;
+		uint32_t n = 0;
+		for (; n < burst && r.pop(m); n++)
+			receive(c, m);
+
+		if (n == burst)
+			more = true;
+	}
+
+	return more;
+}
+
+bool
+TCPBalancer::run_task(Task *task)
+{
+	int c = click_current_cpu_id();
+	CoreData &d = _core[c];
+
+	bool more = flush(c);
+	more |= drain(c, _burst);
+
+	// Deferred hand-offs, listeners are looked up again
+	for (int i = 0; i < d.pending.size(); i++) {
+		TCPState *l = TCPInfo::flow_lookup(d.pending[i]);
+		if (l && l->state == TCP_LISTEN)
+			migrate(c, l);
+	}
+	d.pending.clear();
+
+	if (more)
+		task->fast_reschedule();
+	return true;
+}
+
+void
+TCPBalancer::unsteer(TCPState *s)
+{
+	int c = click_current_cpu_id();
+	int home = s->home;
+	s->home = -1;
+
+	if (home == c)
+		return;
+
+	Msg m;
+	m.flow = s->flow;
+	m.type = MSG_UNSTEER;
+	_balancer->post(c, home, m);
+}
+
+enum { H_LOAD, H_MIGRATIONS };
+
+String
+TCPBalancer::read_handler(Element *e, void *thunk)
+{
+	TCPBalancer *b = static_cast<TCPBalancer *>(e);
+	StringAccum sa;
+	uint64_t out = 0;
+
+	for (int c = 0; c < b->_nthreads && b->_core; c++) {
+		CoreData &d = b->_core[c];
+		out += d.out;
+		sa << c << ' ' << TCPInfo::flow_count(c) << ' ' << d.out << ' '
+		   << d.in << ' ' << d.returned << ' ' << d.steer.size() << ' '
+		   << d.full << '\n';
+	}
+
+	switch ((intptr_t)thunk) {
+	case H_LOAD:
+		return sa.take_string();
+	case H_MIGRATIONS:
+		return String(out);
+	default:
+		return String();
+	}
+}
+
+int
+TCPBalancer::write_handler(const String &, Element *e, void *, ErrorHandler *)
+{
+	TCPBalancer *b = static_cast<TCPBalancer *>(e);
+
+	for (int c = 0; c < b->_nthreads && b->_core; c++) {
+		CoreData &d = b->_core[c];
+		d.out = d.in = d.returned = d.full = 0;
+	}
+
+	return 0;
+}
+
+void
+TCPBalancer::add_handlers()
+{
+	add_read_handler("load", read_handler, H_LOAD);
+	add_read_handler("migrations", read_handler, H_MIGRATIONS);
+	add_write_handler("reset_counts", write_handler, 0, Handler::BUTTON);
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(TCPInfo TCPTimers TCPFlowRedirect)
+EXPORT_ELEMENT(TCPBalancer)
@@ -0,0 +1,214 @@
+/*
+ * tcpbalancer.{cc,hh} -- hands new connections off from loaded cores to idle ones
+ * Rafael Laufer, Massimo Gallo
+ *
+ * Copyright (c) 2019 Nokia Bell Labs
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+ *    in the documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ */
+
+#ifndef CLICK_TCPBALANCER_HH
+#define CLICK_TCPBALANCER_HH
+#include <click/element.hh>
+#include <click/task.hh>
+#include <click/ipflowid.hh>
+#include <click/hashtable.hh>
+#include <click/timestamp.hh>
+#include "spscring.hh"
+CLICK_DECLS
+
+/*
+=c
+
+TCPBalancer([I<keywords> THRESHOLD, BURST, CAPACITY])
+
+=s tcp
+
+hands new connections off from loaded cores to idle ones
+
+=d
+
+Connections stay on the core chosen by RSS, so hash skew leaves some cores
+with many more connections than others. With TCPBalancer in the
+configuration, a connection that completes the handshake on a core with more
+than THRESHOLD connections above the least loaded core is handed off to
+that core before the application accepts it. The load of a core is the
+number of flows in its flow table.
+
+The hand-off is done by a per-core task, after the connection has been
+placed in the accept queue of the listening socket, but without waking up
+the application. Only connections with empty queues and no pending
+retransmission are moved. The connection is removed from the flow table of
+its core, its timers are moved, and it is passed to the other core through
+a lock-free ring. There, it joins the accept queue of the listening socket
+for the same address and port, so the application must listen on every
+core, as the epoll servers do. If the other core has no such socket or its
+accept queue is full, the connection goes back to the original core, and
+packets already redirected to the other core are sent back there as well
+until the original core has taken the connection back.
+Messages that must not be lost, such as these returns and the removal of
+redirection entries, wait on the sending core while the ring is full and
+are sent again by its task.
+
+Packets of a migrated flow still arrive on the original core, which keeps a
+redirection entry for it until the connection is closed. TCPFlowRedirect
+looks these entries up and forwards the packets to the new core, so the TCP
+layer must have REDIRECT true. Steering with NIC flow rules is not done.
+
+Keyword arguments are:
+
+=over 8
+
+=item THRESHOLD
+
+Integer. Number of connections a core must have above the least loaded one
+to hand connections off. Default is 16.
+
+=item BURST
+
+Integer. Maximum number of connections handed off or taken over by a core
+at a time. Default is 8.
+
+=item CAPACITY
+
+Integer. Number of messages each ring between two cores can hold. Default
+is 256.
+
+=back
+
+=h load read-only
+
+Returns one line per core with the number of flows, connections handed off
+to other cores, connections taken over from other cores, connections given
+back, redirection entries, and messages deferred because a ring was full.
+
+=h migrations read-only
+
+Returns the number of connections handed off to another core.
+
+=h reset_counts write-only
+
+Resets the counters.
+
+=e
+
+    TCPBalancer(THRESHOLD 32);
+    tcp_layer :: TCPLayer(ADDRS $ADDR0, REDIRECT true);
+
+=a TCPFlowRedirect, TCPEpollServer */
+
+class TCPState;
+
+class TCPBalancer final : public Element { public:
+
+	TCPBalancer() CLICK_COLD;
+
+	const char *class_name() const { return "TCPBalancer"; }
+
+	int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
+	int initialize(ErrorHandler *) CLICK_COLD;
+	void cleanup(CleanupStage) CLICK_COLD;
+	void add_handlers() CLICK_COLD;
+
+	bool run_task(Task *);
+
+	// Hooks called through TCPInfo, see TCPInfo::Balancer
+
+	// Connection just placed in the accept queue of listener l, returns
+	// true if it may be handed off and the application was not woken up
+	static bool handoff(TCPState *l);
+
+	// Core that took over a migrated flow arriving on this core, or -1
+	static int steer(const IPFlowID &flow);
+
+	// Connection migrated here is gone, drop its redirection entry
+	static void unsteer(TCPState *s);
+
+	// Take over connections migrated to this core
+	static void poll();
+
+  private:
+
+	enum { MSG_ADOPT, MSG_RETURN, MSG_UNSTEER };
+
+	struct Msg {
+		TCPState *s;
+		IPFlowID flow;                  // flow to unsteer
+		Timestamp keepalive;            // timer expiries to restore
+		Timestamp delayed_ack;
+		int origin;                     // core receiving the flow
+		int from;                       // core giving it back
+		int type;
+		Msg() : s(NULL), origin(-1), from(-1), type(MSG_ADOPT) { }
+	};
+
+	typedef SPSCRing<Msg> Ring;
+
+	// Message waiting for room in the ring to core dst
+	struct Deferred {
+		Msg m;
+		int dst;
+		Deferred() : dst(-1) { }
+		Deferred(const Msg &m_, int dst_) : m(m_), dst(dst_) { }
+	};
+
+	struct CoreData {
+		uint64_t out;
+		uint64_t in;
+		uint64_t returned;
+		uint64_t full;                  // messages that found a ring full
+		Vector<IPFlowID> pending;       // listeners with deferred hand-offs
+		Vector<Deferred> deferred;      // messages to send again, in order
+		HashTable<IPFlowID, int> steer; // migrated flows arriving here
+		CoreData() : out(0), in(0), returned(0), full(0) { }
+	} CLICK_ALIGNED(CLICK_CACHE_LINE_SIZE);
+
+	// Ring of messages from core src to core dst
+	inline Ring &ring(int src, int dst) { return _ring[dst * _nthreads + src]; }
+
+	int target(int c);
+	bool defer(TCPState *l);
+	bool send(int src, int dst, const Msg &m);
+	void post(int src, int dst, const Msg &m);
+	bool flush(int c);
+	bool drain(int c, uint32_t burst);
+	void migrate(int c, TCPState *l);
+	void receive(int c, Msg &m);
+	void place(Msg &m, TCPState *l);
+
+	static bool movable(TCPState *s);
+	static void move_timers(TCPState *s, unsigned c);
+
+	static String read_handler(Element *, void *) CLICK_COLD;
+	static int write_handler(const String &, Element *, void *, ErrorHandler *) CLICK_COLD;
+
+	static TCPBalancer *_balancer;
+
+	Ring *_ring;
+	CoreData *_core;
+	Vector<Task *> _task;
+	int _nthreads;
+	uint32_t _threshold;
+	uint32_t _burst;
+	uint32_t _capacity;
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -313,6 +313,21 @@ TCPBuffer::remove(uint32_t rcv_nxt)
 	return NULL;
 }
 
+uint32_t
+TCPBuffer::purge()
+{
+	// Drop all buffered segments and return the amount of data released
+	uint32_t length = 0;
+	while (Packet *p = front()) {
+		length += TCP_LEN(p);
+		pop_front();
+		p->kill();
+	}
+	_last = NULL;
+
+	return length;
+}
+
 String
 TCPBuffer::unparse() const
 {
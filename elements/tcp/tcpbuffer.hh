@@ -47,6 +47,7 @@ class TCPBuffer : private PktQueue { public:
 	int insert(Packet *);
 	bool peek(uint32_t);
 	Packet *remove(uint32_t);
+	uint32_t purge();
 	TCPSack sack() const;
 	String unparse() const;
 
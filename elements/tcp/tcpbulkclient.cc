@@ -29,25 +29,30 @@
 #include <click/error.hh>
 #include <click/router.hh>
 #include <click/routervisitor.hh>
+#include <click/straccum.hh>
 #include <click/standard/scheduleinfo.hh>
 #include <clicknet/ip.h>
 #include <clicknet/tcp.h>
 #include "tcpbulkclient.hh"
+#include "tcpinfo.hh"
 #include "util.hh"
 CLICK_DECLS
 
 TCPBulkClient::TCPBulkClient()
-	: _task(this), _mss(0), _length(0), _buflen(0), _batch(0), _verbose(false)
+	: _task(this), _end_h(NULL), _total(0), _mss(0), _length(0), _buflen(0),
+	  _batch(0), _verbose(false)
 {
 }
 
 int
 TCPBulkClient::configure(Vector<String> &conf, ErrorHandler *errh)
 {
-	_mss = 1448;
+	// Leave room for the timestamp option
+	_mss = TCPInfo::mss() - (TCPOLEN_TIMESTAMP + 2);
 	_batch = 128;
 	String length = "0";
 	String buflen = "64K";
+	bool stop = false;
 
 	if (Args(conf, this, errh)
 		.read_mp("ADDRESS", _addr)
@@ -56,11 +61,12 @@ TCPBulkClient::configure(Vector<String> &conf, ErrorHandler *errh)
 		.read("LENGTH", length)
 		.read("BUFLEN", buflen)
 		.read("BATCH", _batch)
+		.read("STOP", stop)
 		.read("VERBOSE", _verbose)
 		.complete() < 0)
 		return -1;
 
-	if (_mss > 1448)
+	if (_mss > TCPInfo::mss() - (TCPOLEN_TIMESTAMP + 2))
 		return errh->error("MSS out of range");
 
 	int l_shift = get_shift(length);
@@ -75,6 +81,9 @@ TCPBulkClient::configure(Vector<String> &conf, ErrorHandler *errh)
 	_length <<= l_shift;
 	_buflen <<= b_shift;
 
+	if (stop)
+		_end_h = new HandlerCall("stop");
+
 	return 0;
 }
 
@@ -85,11 +94,21 @@ TCPBulkClient::initialize(ErrorHandler *errh)
 	if (r < 0)
 		return r;
 
+	// Stop after the transfer
+	if (_end_h && _end_h->initialize_write(this, errh) < 0)
+		return -1;
+
 	ScheduleInfo::initialize_task(this, &_task, errh);
 
 	return 0;
 }
 
+void
+TCPBulkClient::cleanup(CleanupStage)
+{
+	delete _end_h;
+}
+
 void
 TCPBulkClient::push(int, Packet *p)
 {
@@ -125,12 +144,13 @@ TCPBulkClient::run_task(Task *task)
 
 	uint64_t total = 0;
 	Timestamp begin = Timestamp::now_steady();
+	_begin = begin;
 	do {
 		uint32_t pkts = 0;
 		Packet *p = NULL;
 		Packet *t = NULL;
 		do {
-			Packet *q = Packet::make(TCP_HEADROOM, NULL, _mss, 0);
+			Packet *q = Packet::make_chain(TCP_HEADROOM, NULL, _mss);
 			if (!q) {
 				errno = ENOMEM;
 				perror("make");
@@ -171,6 +191,8 @@ TCPBulkClient::run_task(Task *task)
 
 	click_fsync(sockfd);	
 	Timestamp end = Timestamp::now_steady();
+	_end = end;
+	_total = total;
 
 	if (_verbose)
 		click_chatter("%s: closing sockfd %d", class_name(), sockfd);
@@ -185,9 +207,31 @@ TCPBulkClient::run_task(Task *task)
 	else
 		click_chatter("%s: TX rate %.3f Gbps", class_name(), rate_mbps/1000);
 
+	if (_end_h)
+		(void)_end_h->call_write();
+
 	return false;
 }
 
+String
+TCPBulkClient::read_handler(Element *e, void *)
+{
+	TCPBulkClient *b = static_cast<TCPBulkClient *>(e);
+	StringAccum sa;
+
+	double time = (b->_end - b->_begin).doubleval();
+	sa << "bytes=" << b->_total << ' ';
+	sa << "seconds=" << time << ' ';
+	sa << "throughput_mbps=" << (time > 0 ? (b->_total << 3) / time / 1e6 : 0);
+	return sa.take_string();
+}
+
+void
+TCPBulkClient::add_handlers()
+{
+	add_read_handler("stats", read_handler, 0);
+}
+
 CLICK_ENDDECLS
 EXPORT_ELEMENT(TCPBulkClient)
 ELEMENT_REQUIRES(Util)
@@ -26,6 +26,7 @@
 #ifndef CLICK_TCPBULKCLIENT_HH
 #define CLICK_TCPBULKCLIENT_HH
 #include <click/element.hh>
+#include <click/handlercall.hh>
 #include "tcpapplication.hh"
 #include "blockingtask.hh"
 CLICK_DECLS
@@ -40,13 +41,21 @@ class TCPBulkClient final : public TCPApplication { public:
 
 	int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
 	int initialize(ErrorHandler *) CLICK_COLD;
+	void cleanup(CleanupStage) CLICK_COLD;
+	void add_handlers() CLICK_COLD;
 
 	void push(int, Packet *) final;
 	bool run_task(Task *);
 
   private:
 
+	static String read_handler(Element *, void *) CLICK_COLD;
+
 	BlockingTask _task;
+	HandlerCall *_end_h;
+	Timestamp _begin;
+	Timestamp _end;
+	uint64_t _total;
 	IPAddress _addr;
 	uint16_t _mss;
 	uint16_t _port;
@@ -1,8 +1,8 @@
 /*
- * pktqueue.{cc,hh} -- simple packet queue
- * Rafael Laufer
+ * tcpclock.{cc,hh} -- per-core cached TSC clock
+ * Rafael Laufer, Massimo Gallo
  *
- * Copyright (c) 2017 Nokia Bell Labs
+ * Copyright (c) 2019 Nokia Bell Labs
  *
  * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
  * 
@@ -24,96 +24,78 @@
  */
 
 #include <click/config.h>
+#include <click/glue.hh>
+#include <click/straccum.hh>
 #include <click/machine.hh>
-
-#include "pktstatequeue.hh"
-#define CLICK_DEBUG_PKTSTATEQUEUE 0
-#if CLICK_DEBUG_PKTSTTEQUEUE
-# define click_assert(x) assert(x)
-#else
-# define click_assert(x) ((void)(0))
+#include "tcpclock.hh"
+#if CLICK_USERLEVEL
+# include <unistd.h>
 #endif
 CLICK_DECLS
 
-PktStateQueue::PktStateQueue() :
-		_head(NULL), _size(0) {
-}
-
-PktStateQueue::~PktStateQueue() {
-	flush();
-}
+TCPClock::Core TCPClock::_core[CLICK_CPU_MAX];
+double TCPClock::_nsec_per_cycle = 0;
+click_cycles_t TCPClock::_resync = 0;
 
-void PktStateQueue::insert_after(pkt_state*& x, pkt_state* p) {
-	click_assert(x);
-	pkt_state *n = x->next;
-	p->prev = x;
-	p->next = n;
-	x->next = p;
-	n->prev = p;
+void
+TCPClock::calibrate()
+{
+	if (_nsec_per_cycle)
+		return;
 
-	_size++;
-}
+	// No usable cycle counter, fall back to the system clock
+	click_cycles_t c0 = click_get_cycles();
+	Timestamp t0 = Timestamp::now_steady_unwarped();
+	if (!c0)
+		return;
 
-void PktStateQueue::insert_before(struct pkt_state *x, struct pkt_state *p) {
-	click_assert(x);
-	insert_after(x->prev, p);
-}
+#if CLICK_USERLEVEL
+	usleep(20000);
+#else
+	while (Timestamp::now_steady_unwarped() - t0 < Timestamp::make_msec(20))
+		click_relax_fence();
+#endif
 
-void PktStateQueue::push_back(struct pkt_state* p) {
-	if (_head == NULL) {
-		p->next = p;
-		p->prev = p;
-		_head = p;
-		_size = 1;
+	click_cycles_t c1 = click_get_cycles();
+	Timestamp t1 = Timestamp::now_steady_unwarped();
+	if (c1 <= c0)
 		return;
-	}
-	insert_after(_head->prev, p);
-}
 
-void PktStateQueue::push_front(struct pkt_state* p) {
-	push_back(p);
-	_head = p;
-}
+	_resync = (click_cycles_t)((c1 - c0) * TCP_CLOCK_RESYNC_MS / ((t1 - t0).doubleval() * 1000));
+	_nsec_per_cycle = (t1 - t0).nsecval() / (double)(c1 - c0);
 
-void PktStateQueue::replace(struct pkt_state *x, struct pkt_state *y) {
-	click_assert(x && y);
-	struct pkt_state *n = x->next;
-	struct pkt_state *p = x->prev;
-
-	y->prev = p;
-	y->next = n;
+	// Force a resync on the first refresh of each core
+	for (int c = 0; c < CLICK_CPU_MAX; c++)
+		_core[c].tsc = 0;
+}
 
-	n->prev = y;
-	p->next = y;
+void
+TCPClock::sync(Core &m, click_cycles_t tsc)
+{
+	m.base = Timestamp::now_steady();
+	m.tsc = tsc;
+	m.syncs++;
 
+	if (m.base > m.now)
+		m.now = m.base;
 }
 
-void PktStateQueue::pop_front() {
-	if (!empty()) {
-		pkt_state *p = _head;
-		pkt_state *next = p->next;
-		pkt_state *prev = p->prev;
-		p->next = NULL;
-		p->prev = NULL;
+String
+TCPClock::unparse()
+{
+	StringAccum sa;
+	uint64_t refreshes = 0, syncs = 0;
 
-		if (next->end == p->end && prev->end == p->end)
-			_head = NULL;
-		else {
-			next->prev = prev;
-			prev->next = next;
-			_head = next;
-		}
-		_size--;
+	for (unsigned c = 0; c < click_max_cpu_ids(); c++) {
+		refreshes += _core[c].refreshes;
+		syncs += _core[c].syncs;
 	}
-}
 
-void PktStateQueue::flush() {
-	while (front()) {
-		pop_front();
-	}
-	click_assert(!_head && !_size);
+	sa << "tsc_mhz " << (_nsec_per_cycle ? 1000 / _nsec_per_cycle : 0) << '\n';
+	sa << "refreshes " << refreshes << '\n';
+	sa << "clock_gettime " << syncs << '\n';
+	return sa.take_string();
 }
 
 CLICK_ENDDECLS
-#undef click_assert
-ELEMENT_PROVIDES(PktStateQueue)
+ELEMENT_PROVIDES(TCPClock)
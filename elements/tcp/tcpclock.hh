@@ -0,0 +1,118 @@
+/*
+ * tcpclock.{cc,hh} -- per-core cached TSC clock
+ * Rafael Laufer, Massimo Gallo
+ *
+ * Copyright (c) 2019 Nokia Bell Labs
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+ *    in the documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ */
+
+#ifndef CLICK_TCPCLOCK_HH
+#define CLICK_TCPCLOCK_HH
+#include <click/glue.hh>
+#include <click/timestamp.hh>
+#include <click/string.hh>
+CLICK_DECLS
+
+#define TCP_CLOCK_RESYNC_MS 100    // resync with the system clock
+
+// Steady time cached per core. The driver refreshes it from the TSC once
+// per iteration and DPDK once per RX batch, so the TCP data path reads a
+// variable instead of calling clock_gettime() for every packet. The TSC is
+// resynchronized with Timestamp::now_steady() every TCP_CLOCK_RESYNC_MS.
+class TCPClock { public:
+
+	static void calibrate();
+	static inline bool enabled() { return _nsec_per_cycle != 0; }
+
+	// Cached time, at most one driver iteration or RX batch old
+	static inline Timestamp now();
+	static inline uint64_t now_usec();
+
+	// Current time, also updating the cached one
+	static inline Timestamp refresh();
+	static inline Timestamp fresh() { return refresh(); }
+
+	static String unparse();
+
+  private:
+
+	struct Core {
+		Timestamp now;          // cached time
+		Timestamp base;         // system time at the last resync
+		click_cycles_t tsc;     // TSC at the last resync
+		uint64_t refreshes;
+		uint64_t syncs;
+	} CLICK_ALIGNED(CLICK_CACHE_LINE_SIZE);
+
+	static void sync(Core &, click_cycles_t);
+
+	static Core _core[CLICK_CPU_MAX];
+	static double _nsec_per_cycle;  // 0 if the TSC is not used
+	static click_cycles_t _resync;
+
+};
+
+inline Timestamp
+TCPClock::refresh()
+{
+	Core &m = _core[click_current_cpu_id()];
+	m.refreshes++;
+
+	if (unlikely(!_nsec_per_cycle)) {
+		m.syncs++;
+		return m.now = Timestamp::now_steady();
+	}
+
+	click_cycles_t tsc = click_get_cycles();
+	click_cycles_t delta = tsc - m.tsc;
+	if (unlikely(delta >= _resync)) {
+		sync(m, tsc);
+		return m.now;
+	}
+
+	// Never go backwards, e.g., right after a resync
+	Timestamp t = m.base + Timestamp::make_nsec((Timestamp::value_type)(delta * _nsec_per_cycle));
+	if (t > m.now)
+		m.now = t;
+
+	return m.now;
+}
+
+inline Timestamp
+TCPClock::now()
+{
+	Core &m = _core[click_current_cpu_id()];
+
+	// Without the TSC nothing refreshes the cached time, and a core may
+	// read it before its first refresh
+	if (unlikely(!_nsec_per_cycle || !m.now))
+		return refresh();
+
+	return m.now;
+}
+
+inline uint64_t
+TCPClock::now_usec()
+{
+	return now().usecval();
+}
+
+CLICK_ENDDECLS
+#endif
@@ -30,13 +30,16 @@
 #include <click/master.hh>
 #include <click/router.hh>
 #include <click/standard/scheduleinfo.hh>
+#include <click/straccum.hh>
 #include <iostream>
 #include "tcpechoclientepollzc.hh"
+#include "tcpinfo.hh"
+#include "tcpclock.hh"
 #include "util.hh"
 CLICK_DECLS
 
 TCPEchoClientEpollZC::TCPEchoClientEpollZC()
-	: _thread(0), _end_h(0), _verbose(0)
+	: _thread(0), _end_h(0), _proxy_port(0), _wait(true), _verbose(0)
 {
 }
 
@@ -55,12 +58,16 @@ TCPEchoClientEpollZC::configure(Vector<String> &conf, ErrorHandler *errh)
 		.read("LENGTH", _length)
 		.read("CONNECTIONS", _connections)
 		.read("PARALLEL", _parallel)
+		.read("PROXY_ADDRESS", _proxy_addr)
+		.read("PROXY_PORT", _proxy_port)
+		.read("WAIT", _wait)
 		.read("VERBOSE", _verbose)
 		.complete() < 0)
 		return -1;
 
-    if (_length > 1448)
-		return errh->error("LENGTH must be less than or equal to 1448");
+	uint32_t mss = TCPInfo::mss() - (TCPOLEN_TIMESTAMP + 2);
+	if (_length > mss)
+		return errh->error("LENGTH must be less than or equal to %u", mss);
 
 	if (_connections == 0)
 		return errh->error("CONNECTIONS must be positive");
@@ -68,6 +75,9 @@ TCPEchoClientEpollZC::configure(Vector<String> &conf, ErrorHandler *errh)
 	if (_parallel == 0)
 		return errh->error("PARALLEL must be positive");
 
+	if (_proxy_addr && !_proxy_port)
+		return errh->error("PROXY_PORT must be set with PROXY_ADDRESS");
+
 	if (stop)
 		_end_h = new HandlerCall("stop");
 
@@ -93,9 +103,11 @@ TCPEchoClientEpollZC::initialize(ErrorHandler *errh)
 	click_assert(_thread);        
 	
 	//Useful to synchronize multiple clients //TODO synchronize through socket?
-	click_chatter("Press Enter to start the experiment:");
-        std::cin.get();
-        click_chatter("Experiment started");
+	if (_wait) {
+		click_chatter("Press Enter to start the experiment:");
+	        std::cin.get();
+	        click_chatter("Experiment started");
+	}
 	
 	
 	// Start per-core tasks
@@ -120,41 +132,9 @@ TCPEchoClientEpollZC::run_task(Task *)
 	assert(t->epfd > 0);
 
 	// Create concurrent sockets and initiate TCP handshake
-	for (uint32_t i = 0; i < MIN(_parallel, _connections); i++) {
-		// Socket
-		int sockfd = click_socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
-		if (sockfd < 0) {
-			perror("socket");
-			return false;
-		}
-
-		// Setsockopt
-		struct linger lin = { .l_onoff = 1, .l_linger = 0 };
-		int s = sizeof(struct linger);
-		if (click_setsockopt(sockfd, SOL_SOCKET, SO_LINGER, (void*)(&lin), s)) {
-			perror("setsockopt");
-			return false;
-		}
-
-		// Connect
-		int err = click_connect(sockfd, _addr, _port);
-		if (err == -1 && errno != EINPROGRESS) {
-			perror("connect");
+	for (uint32_t i = 0; i < MIN(_parallel, _connections); i++)
+		if (!open_connection(t))
 			return false;
-		}
-
-		// Add sockfd to the list of watched file descriptors
-		struct epoll_event ev;
-		ev.events = EPOLLOUT | EPOLLIN;
-		ev.data.fd = sockfd;
-		if (click_epoll_ctl(t->epfd, EPOLL_CTL_ADD, sockfd, &ev) < 0) {
-			perror("epoll_ctl");
-			return false;
-		}
-
-		// Increment open connection counter
-		t->conn_o++;
-	}
 
 	int maxevents = 4096;
 	struct epoll_event events[maxevents];
@@ -216,6 +196,126 @@ TCPEchoClientEpollZC::cleanup(CleanupStage)
 		delete _end_h;
 }
 
+bool
+TCPEchoClientEpollZC::open_connection(ThreadData *t)
+{
+	// Socket
+	int sockfd = click_socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+	if (sockfd < 0) {
+		perror("socket");
+		return false;
+	}
+
+	// Setsockopt
+	struct linger lin = { .l_onoff = 1, .l_linger = 0 };
+	int s = sizeof(struct linger);
+	if (click_setsockopt(sockfd, SOL_SOCKET, SO_LINGER, (void*)(&lin), s)) {
+		perror("setsockopt");
+		return false;
+	}
+
+	// Connect, either directly or through the SOCKS4 proxy
+	int err;
+	if (_proxy_addr)
+		err = click_connect(sockfd, _proxy_addr, _proxy_port);
+	else
+		err = click_connect(sockfd, _addr, _port);
+	if (err == -1 && errno != EINPROGRESS) {
+		perror("connect");
+		return false;
+	}
+
+	// Add sockfd to the list of watched file descriptors
+	struct epoll_event ev;
+	ev.events = EPOLLOUT | EPOLLIN;
+	ev.data.fd = sockfd;
+	if (click_epoll_ctl(t->epfd, EPOLL_CTL_ADD, sockfd, &ev) < 0) {
+		perror("epoll_ctl");
+		return false;
+	}
+
+	// Remember when the connection started
+	if (sockfd >= t->start.size()) {
+		t->start.resize(sockfd + 1);
+		t->stage.resize(sockfd + 1);
+		t->rcvd.resize(sockfd + 1);
+	}
+	t->start[sockfd] = TCPClock::fresh();
+	t->stage[sockfd] = STAGE_CONNECT;
+	t->rcvd[sockfd] = 0;
+
+	// Increment open connection counter
+	t->conn_o++;
+
+	return true;
+}
+
+bool
+TCPEchoClientEpollZC::send_request(int sockfd)
+{
+	Packet *p;
+
+	// SOCKS4 CONNECT request with an empty user ID
+	if (_proxy_addr && _thread[click_current_cpu_id()].stage[sockfd] == STAGE_CONNECT) {
+		WritablePacket *q = Packet::make(TCP_HEADROOM, NULL, 9, 0);
+		if (q) {
+			unsigned char *data = q->data();
+			data[0] = 4;
+			data[1] = 1;
+			*(uint16_t *)&data[2] = htons(_port);
+			*(uint32_t *)&data[4] = _addr.addr();
+			data[8] = 0;
+		}
+		p = q;
+	}
+	else
+		p = Packet::make_chain(TCP_HEADROOM, NULL, _length);
+
+	if (!p) {
+		errno = ENOMEM;
+		perror("send");
+		return false;
+	}
+
+	// Send packet
+	click_push(sockfd, p);
+	if (errno) {
+		perror("send");
+		p->kill();
+		return false;
+	}
+
+	return true;
+}
+
+void
+TCPEchoClientEpollZC::close_connection(ThreadData *t, int sockfd, bool done)
+{
+	// Remove sockfd from the list of watched file descriptors
+	if (click_epoll_ctl(t->epfd, EPOLL_CTL_DEL, sockfd, NULL) < 0) {
+		perror("epoll_ctl");
+		if (done)
+			return;
+	}
+
+	// Close connection
+	click_close(sockfd);
+
+	// Record the connection latency
+	if (done)
+		t->latency.record((TCPClock::fresh() - t->start[sockfd]).nsecval());
+
+	// Increment closed connection counter
+	t->conn_c++;
+
+	// Check for connection threshold
+	if (t->conn_o >= _connections)
+		return;
+
+	// Create another socket
+	(void)open_connection(t);
+}
+
 void
 TCPEchoClientEpollZC::selected(int sockfd, int revents)
 {
@@ -237,31 +337,15 @@ TCPEchoClientEpollZC::selected(int sockfd, int revents)
 			return;
 		}
 
-		// Create packet
-		Packet *p = Packet::make(TCP_HEADROOM, NULL, _length, 0);
-		if (!p) {
-			errno = ENOMEM;
-			perror("send");
-
-			if (click_epoll_ctl(t->epfd, EPOLL_CTL_DEL, sockfd, NULL) < 0)
-				perror("epoll_ctl");
-
-			click_close(sockfd);
-			return;
-		}
-
-		// Send packet
-		click_push(sockfd, p);
-		if (errno) {
-			perror("send");
-			p->kill();
-
+		// Send either the SOCKS4 request or the echo message
+		if (!send_request(sockfd)) {
 			if (click_epoll_ctl(t->epfd, EPOLL_CTL_DEL, sockfd, NULL) < 0)
 				perror("epoll_ctl");
 
 			click_close(sockfd);
 			return;
 		}
+		t->stage[sockfd] = (_proxy_addr ? STAGE_PROXY : STAGE_ECHO);
 	}
 
 	if (revents & EPOLLIN) {
@@ -275,65 +359,38 @@ TCPEchoClientEpollZC::selected(int sockfd, int revents)
 			return;
 		}
 
-		// Check message size
-		if (p->length() != _length) {
-			click_chatter("message length %d != %d", p->length(), _length);
+		// Check the SOCKS4 reply and send the echo message
+		if (t->stage[sockfd] == STAGE_PROXY) {
+			bool granted = (p->length() == 8 && p->data()[1] == 0x5a);
 			p->kill();
-			return;
-		}
-
-		// Kill received packet
-		p->kill();
 
-		// Remove sockfd from the list of watched file descriptors
-		if (click_epoll_ctl(t->epfd, EPOLL_CTL_DEL, sockfd, NULL) < 0) {
-			perror("epoll_ctl");
-			return;
-		}
-
-		// Close connection
-		click_close(sockfd);
-
-		// Increment closed connection counter
-		t->conn_c++;
-
-		// Check for connection threshold
-		if (t->conn_o >= _connections)
-			return;
+			if (!granted) {
+				click_chatter("%s: SOCKS4 request rejected", class_name());
+				close_connection(t, sockfd, false);
+				return;
+			}
 
-		// Create another socket
-		sockfd = click_socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
-		if (sockfd < 0) {
-			perror("socket");
+			t->stage[sockfd] = STAGE_ECHO;
+			if (!send_request(sockfd))
+				close_connection(t, sockfd, false);
 			return;
 		}
 
-		// Setsockopt
-		struct linger lin = { .l_onoff = 1, .l_linger = 0 };
-		int s = sizeof(struct linger);
-		if (click_setsockopt(sockfd, SOL_SOCKET, SO_LINGER, (void*)(&lin), s)) {
-			perror("setsockopt");
+		// The echo may span several packets (e.g., jumbo frame segments)
+		uint32_t rcvd = (t->rcvd[sockfd] += p->length());
+		p->kill();
+		if (rcvd < _length)
 			return;
-		}
 
-		// Connect
-		int err = click_connect(sockfd, _addr, _port);
-		if (err == -1 && errno != EINPROGRESS) {
-			perror("connect");
-			return;
-		}
-
-		// Add sockfd to the list of watched file descriptors
-		struct epoll_event ev;
-		ev.events = EPOLLOUT | EPOLLIN;
-		ev.data.fd = sockfd;
-		if (click_epoll_ctl(t->epfd, EPOLL_CTL_ADD, sockfd, &ev) < 0) {
-			perror("epoll_ctl");
+		// Check message size
+		t->rcvd[sockfd] = 0;
+		if (rcvd != _length) {
+			click_chatter("message length %d != %d", rcvd, _length);
 			return;
 		}
 
-		// Increment open connection counter
-		t->conn_o++;
+		// Close connection and open another one
+		close_connection(t, sockfd, true);
 	}
 
 	// Check for errors
@@ -342,56 +399,38 @@ TCPEchoClientEpollZC::selected(int sockfd, int revents)
 			click_chatter("%s: core %d, EPOLLERR|EPOLLHUP on sockfd %d", 
 			                                           class_name(), c, sockfd);
 
-		// Remove sockfd from the list of watched file descriptors
-		if (click_epoll_ctl(t->epfd, EPOLL_CTL_DEL, sockfd, NULL) < 0)
-			perror("epoll_ctl");
-
-		// Close connection
-		click_close(sockfd);
-
-		// Increment closed connection counter
-		t->conn_c++;
-
-		// Check for connection threshold
-		if (t->conn_o >= _connections)
-			return;
-
-		// Create another socket
-		sockfd = click_socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
-		if (sockfd < 0) {
-			perror("socket");
-			return;
-		}
+		// Close connection and open another one
+		close_connection(t, sockfd, false);
+	}
+}
 
-		// Setsockopt
-		struct linger lin = { .l_onoff = 1, .l_linger = 0 };
-		int s = sizeof(struct linger);
-		if (click_setsockopt(sockfd, SOL_SOCKET, SO_LINGER, (void*)(&lin), s)) {
-			perror("setsockopt");
-			return;
-		}
+String
+TCPEchoClientEpollZC::read_handler(Element *e, void *)
+{
+	TCPEchoClientEpollZC *ec = static_cast<TCPEchoClientEpollZC *>(e);
+	LatencyHistogram latency;
+	uint64_t conn = 0;
 
-		// Connect
-		int err = click_connect(sockfd, _addr, _port);
-		if (err == -1 && errno != EINPROGRESS) {
-			perror("connect");
-			return;
-		}
+	for (uint32_t c = 0; c < ec->_nthreads; c++) {
+		conn += ec->_thread[c].conn_c;
+		latency.merge(ec->_thread[c].latency);
+	}
 
-		// Add sockfd to the list of watched file descriptors
-		struct epoll_event ev;
-		ev.events = EPOLLOUT | EPOLLIN;
-		ev.data.fd = sockfd;
-		if (click_epoll_ctl(t->epfd, EPOLL_CTL_ADD, sockfd, &ev) < 0) {
-			perror("epoll_ctl");
-			return;
-		}
+	StringAccum sa;
+	double time = (ec->_end - ec->_begin).doubleval();
+	sa << "connections=" << conn << ' ';
+	sa << "seconds=" << time << ' ';
+	sa << "conn_per_sec=" << (time > 0 ? conn / time : 0) << ' ';
+	sa << latency.unparse("latency_us_", 1000);
+	return sa.take_string();
+}
 
-		// Increment open connection counter
-		t->conn_o++;
-	}
+void
+TCPEchoClientEpollZC::add_handlers()
+{
+	add_read_handler("stats", read_handler, 0);
 }
 
 CLICK_ENDDECLS
 EXPORT_ELEMENT(TCPEchoClientEpollZC)
-ELEMENT_REQUIRES(TCPApplication)
+ELEMENT_REQUIRES(TCPApplication TCPClock)
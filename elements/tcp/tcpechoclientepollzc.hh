@@ -29,6 +29,7 @@
 #include <click/handlercall.hh>
 #include "tcpapplication.hh"
 #include "blockingtask.hh"
+#include "latencyhistogram.hh"
 CLICK_DECLS
 
 class TCPEchoClientEpollZC final : public TCPApplication { public:
@@ -43,30 +44,47 @@ class TCPEchoClientEpollZC final : public TCPApplication { public:
 	int initialize(ErrorHandler *) CLICK_COLD;
 	void cleanup(CleanupStage) CLICK_COLD;
 
+	void add_handlers() CLICK_COLD;
+
 	bool run_task(Task *) final;
 	void selected(int sockfd, int revents);
 
+	enum { STAGE_CONNECT, STAGE_PROXY, STAGE_ECHO };
+
 	struct ThreadData {
 		BlockingTask *task;
 		int epfd;
 		uint32_t conn_o;
 		uint32_t conn_c;
+		Vector<Timestamp> start;  // Connection start time per sockfd
+		Vector<uint8_t> stage;    // Connection stage per sockfd
+		Vector<uint32_t> rcvd;    // Echo bytes received per sockfd
+		LatencyHistogram latency; // Connect-to-echo latency in nsec
 
 		ThreadData() : task(NULL), epfd(-1), conn_o(0), conn_c(0) { }
 	} CLICK_ALIGNED(CLICK_CACHE_LINE_SIZE);
 
   private:
 
+	bool open_connection(ThreadData *t);
+	bool send_request(int sockfd);
+	void close_connection(ThreadData *t, int sockfd, bool done);
+
+	static String read_handler(Element *, void *) CLICK_COLD;
+
 	ThreadData *_thread;
 	HandlerCall *_end_h;
 	Timestamp _begin;
 	Timestamp _end;
 	IPAddress _addr;
+	IPAddress _proxy_addr;
 	uint32_t _nthreads;
 	uint32_t _length;
 	uint32_t _connections;
 	uint32_t _parallel;
 	uint16_t _port;
+	uint16_t _proxy_port;
+	bool _wait;
 	bool _verbose;	
 	
 };
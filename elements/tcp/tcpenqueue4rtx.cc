@@ -30,6 +30,7 @@
 #include <clicknet/tcp.h>
 #include "tcpenqueue4rtx.hh"
 #include "tcpstate.hh"
+#include "tcpclock.hh"
 CLICK_DECLS
 
 TCPEnqueue4RTX::TCPEnqueue4RTX()
@@ -68,7 +69,7 @@ TCPEnqueue4RTX::smaction(Packet *p)
 
 	// If timestamp not supported and packet timestamp not set, get current time
 	if (s->snd_ts_ok == false && p->timestamp_anno() == 0)
-		p->set_timestamp_anno(Timestamp::now_steady());
+		p->set_timestamp_anno(TCPClock::now());
 
 	// Clone the packet to insert it into the RTX queue
 	Packet *c = p->clone();
@@ -95,10 +96,10 @@ TCPEnqueue4RTX::smaction(Packet *p)
 		Timestamp now = p->timestamp_anno();
 		if (now) {
 			Timestamp tmo = now + Timestamp::make_msec(s->snd_rto);
-			s->rtx_timer.schedule_at_steady(tmo);
+			s->rtx_timer.defer_at_steady(tmo);
 		}
 		else 
-			s->rtx_timer.schedule_after_msec(s->snd_rto);
+			s->rtx_timer.defer_after_msec(s->snd_rto);
 	}
 
 	// Send out original packet
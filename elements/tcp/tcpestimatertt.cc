@@ -32,6 +32,7 @@
 #include "tcpstate.hh"
 #include "tcpinfo.hh"
 #include "util.hh"
+#include "tcpclock.hh"
 CLICK_DECLS
 
 TCPEstimateRTT::TCPEstimateRTT()
@@ -72,7 +73,7 @@ TCPEstimateRTT::smaction(Packet *p)
 		if (SEQ_LT(TCP_END(q), TCP_ACK(th))) {
 			Timestamp now = p->timestamp_anno();
 			if (now == 0)
-				now = Timestamp::now_steady();
+				now = TCPClock::now();
 
 			Timestamp rtt_ts = now - q->timestamp_anno();
 			rtt = MAX(1, rtt_ts.usecval());
@@ -138,21 +139,7 @@ TCPEstimateRTT::smaction(Packet *p)
 	//  (2.5) A maximum value MAY be placed on RTO provided it is at least 60
 	//        seconds.
 
-#if BBR_ENABLED
-	s->last_rtt = rtt;
-#endif
-	uint32_t rto;
-	if (unlikely(s->snd_srtt == 0)) {
-		s->snd_srtt = rtt;
-		s->snd_rttvar = (rtt >> 1);
-		rto = 3*rtt;
-	}
-	else {
-		s->snd_rttvar = ((3*s->snd_rttvar + absdiff(s->snd_srtt, rtt)) >> 2);
-		s->snd_srtt = ((7*s->snd_srtt + rtt) >> 3);
-		rto = s->snd_srtt + MAX(1, (s->snd_rttvar << 2));
-	}
-	s->snd_rto = MIN(MAX(TCP_RTO_MIN, rto/1000), TCP_RTO_MAX);
+	s->update_rtt(rtt);
 	click_assert(s->snd_rto > 0);
 
 	if (TCPInfo::verbose())
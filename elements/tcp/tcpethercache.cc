@@ -0,0 +1,186 @@
+/*
+ * tcpethercache.{cc,hh} -- prepends a per-connection cached Ethernet header
+ * Rafael Laufer, Massimo Gallo
+ *
+ * Copyright (c) 2019 Nokia Bell Labs
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+ *    in the documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ */
+
+#include <click/config.h>
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/glue.hh>
+#include <click/master.hh>
+#include <clicknet/ether.h>
+#include "tcpethercache.hh"
+#include "tcpstate.hh"
+#include "tcpclock.hh"
+#include "../ethernet/arptable.hh"
+CLICK_DECLS
+
+TCPEtherCache::TCPEtherCache()
+	: _core(NULL), _arpq(NULL), _arpt(NULL), _refresh(1000000), _nthreads(0), _shared(false)
+{
+}
+
+int
+TCPEtherCache::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+	if (Args(conf, this, errh)
+		.read_mp("ETH", _eth)
+		.read_mp("ARPQUERIER", ElementArg(), _arpq)
+		.read("REFRESH", SecondsArg(6), _refresh)
+		.read("SHAREDPKT", _shared)
+		.complete() < 0)
+		return -1;
+
+	return 0;
+}
+
+int
+TCPEtherCache::initialize(ErrorHandler *errh)
+{
+	// The ARP table of ARPQuerier only exists after its configure()
+	_arpt = static_cast<ARPTable *>(_arpq->cast("ARPTable"));
+	if (!_arpt)
+		return errh->error("%s is not an ARPQuerier", _arpq->name().c_str());
+
+	_nthreads = master()->nthreads();
+	_core = new CoreData[_nthreads];
+
+	return 0;
+}
+
+void
+TCPEtherCache::cleanup(CleanupStage)
+{
+	delete[] _core;
+	_core = NULL;
+}
+
+void
+TCPEtherCache::push(int, Packet *p)
+{
+	TCPState *s = TCP_STATE_ANNO(p);
+	CoreData *d = &_core[click_current_cpu_id()];
+
+	if (unlikely(!s)) {
+		d->misses++;
+		output(1).push(p);
+		return;
+	}
+
+	// Let ARPQuerier see the flow, so that it polls the peer before the
+	// entry expires, and look it up again on the next packet
+	if (_refresh) {
+		uint64_t now = TCPClock::now_usec();
+		if (unlikely(now >= s->l2_refresh)) {
+			s->l2_refresh = now + _refresh;
+			s->l2_gen = 0;
+			d->misses++;
+			output(1).push(p);
+			return;
+		}
+	}
+
+	uint32_t gen = _arpt->generation();
+	if (unlikely(s->l2_gen != gen)) {
+		// Resolve the next hop as ARPQuerier would, i.e., the destination
+		// IP annotation set by routing, or else the peer itself
+		IPAddress nexthop = p->dst_ip_anno();
+		if (!nexthop)
+			nexthop = s->flow.daddr();
+
+		EtherAddress dst;
+		if (_arpt->lookup(nexthop, &dst, 0) < 0) {
+			d->misses++;
+			output(1).push(p);
+			return;
+		}
+
+		memcpy(s->l2_hdr.ether_dhost, dst.data(), 6);
+		memcpy(s->l2_hdr.ether_shost, _eth.data(), 6);
+		s->l2_hdr.ether_type = htons(ETHERTYPE_IP);
+		s->l2_gen = gen;
+	}
+
+	WritablePacket *q;
+	if (_shared)
+		q = (WritablePacket *) p->nonunique_push(sizeof(click_ether));
+	else
+		q = p->push_mac_header(sizeof(click_ether));
+	if (!q)
+		return;
+
+	memcpy(q->data(), &s->l2_hdr, sizeof(click_ether));
+	q->set_mac_header(q->data(), sizeof(click_ether));
+
+	d->hits++;
+	output(0).push(q);
+}
+
+enum { H_HITS, H_MISSES, H_HIT_RATE };
+
+String
+TCPEtherCache::read_handler(Element *e, void *thunk)
+{
+	TCPEtherCache *c = static_cast<TCPEtherCache *>(e);
+	uint64_t hits = 0, misses = 0;
+
+	for (int i = 0; i < c->_nthreads && c->_core; i++) {
+		hits += c->_core[i].hits;
+		misses += c->_core[i].misses;
+	}
+
+	switch ((intptr_t)thunk) {
+	case H_HITS:
+		return String(hits);
+	case H_MISSES:
+		return String(misses);
+	case H_HIT_RATE:
+		return String(hits + misses ? (double)hits / (hits + misses) : 0.0);
+	default:
+		return String();
+	}
+}
+
+int
+TCPEtherCache::write_handler(const String &, Element *e, void *, ErrorHandler *)
+{
+	TCPEtherCache *c = static_cast<TCPEtherCache *>(e);
+
+	for (int i = 0; i < c->_nthreads && c->_core; i++)
+		c->_core[i] = CoreData();
+
+	return 0;
+}
+
+void
+TCPEtherCache::add_handlers()
+{
+	add_read_handler("hits", read_handler, H_HITS);
+	add_read_handler("misses", read_handler, H_MISSES);
+	add_read_handler("hit_rate", read_handler, H_HIT_RATE);
+	add_write_handler("reset_counts", write_handler, 0, Handler::BUTTON);
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(ARPTable)
+EXPORT_ELEMENT(TCPEtherCache)
@@ -0,0 +1,149 @@
+/*
+ * tcpethercache.{cc,hh} -- prepends a per-connection cached Ethernet header
+ * Rafael Laufer, Massimo Gallo
+ *
+ * Copyright (c) 2019 Nokia Bell Labs
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+ *    in the documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ */
+
+#ifndef CLICK_TCPETHERCACHE_HH
+#define CLICK_TCPETHERCACHE_HH
+#include <click/element.hh>
+#include <click/etheraddress.hh>
+CLICK_DECLS
+
+/*
+=c
+
+TCPEtherCache(ETH, ARPQUERIER [, I<keywords> REFRESH, SHAREDPKT])
+
+=s tcp
+
+encapsulates outgoing TCP packets in the Ethernet header cached in their
+connection
+
+=d
+
+Sits between the TCP layer output and ARPQuerier. Packets must have the TCP
+state annotation set. The first packet of a connection looks up its next hop,
+i.e., the destination IP address annotation or, if unset, the peer, in the
+ARP table of ARPQUERIER and, if it is known, the resulting Ethernet header
+is stored in the connection. Later packets just get the cached header
+prepended and are pushed on output 0, without taking the ARP table lock or
+hashing the destination address.
+
+Cached headers are tagged with the ARP table generation, which changes
+whenever a known mapping changes or is removed (e.g., expires), so a stale
+header is never used. Packets without a TCP state, or whose peer is not
+known yet, are pushed unchanged on output 1, which must be connected to
+ARPQUERIER.
+
+Since cached packets bypass ARPQUERIER, it would never poll the peer and the
+ARP entry would expire under an active connection, stalling it until a new
+query is answered. Every REFRESH, a connection therefore sends one packet on
+output 1 and looks up the peer again on the next one. ARPQUERIER then polls
+the peer once its entry is older than POLL_TIMEOUT, which keeps the entry
+alive, and a changed or expired entry replaces the cached header.
+
+ETH is the source Ethernet address and should match the one of ARPQUERIER.
+
+Keyword arguments are:
+
+=over 8
+
+=item REFRESH
+
+Time. How often each connection sends a packet through ARPQUERIER. Should be
+well below the ARPQUERIER TIMEOUT minus its POLL_TIMEOUT. Zero means never.
+Default is 1 sec.
+
+=item SHAREDPKT
+
+Boolean. If true, the Ethernet header is pushed without uniqueifying the
+packet, as done by ARPQuerier. Default is false.
+
+=back
+
+=h hits read-only
+
+Returns the number of packets sent with a cached header.
+
+=h misses read-only
+
+Returns the number of packets sent to ARPQUERIER, including refreshes.
+
+=h hit_rate read-only
+
+Returns the fraction of packets sent with a cached header.
+
+=h reset_counts write-only
+
+Resets the counters.
+
+=e
+
+    tcp_layer[0]
+    -> l2 :: TCPEtherCache($DEV0, arpq, SHAREDPKT true)
+    -> dpdk0;
+
+    l2[1] -> GetIPAddress(16) -> [0]arpq;
+
+=a ARPQuerier, ARPTable */
+
+class ARPTable;
+
+class TCPEtherCache final : public Element { public:
+
+	TCPEtherCache() CLICK_COLD;
+
+	const char *class_name() const { return "TCPEtherCache"; }
+	const char *port_count() const { return "1/2"; }
+	const char *processing() const { return PUSH; }
+
+	int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
+	int initialize(ErrorHandler *) CLICK_COLD;
+	void cleanup(CleanupStage) CLICK_COLD;
+	void add_handlers() CLICK_COLD;
+
+	void push(int, Packet *) final;
+
+  private:
+
+	struct CoreData {
+		uint64_t hits;
+		uint64_t misses;
+		CoreData() : hits(0), misses(0) { }
+	} CLICK_ALIGNED(CLICK_CACHE_LINE_SIZE);
+
+	static String read_handler(Element *, void *) CLICK_COLD;
+	static int write_handler(const String &, Element *, void *, ErrorHandler *) CLICK_COLD;
+
+	CoreData *_core;
+	Element *_arpq;
+	ARPTable *_arpt;
+	EtherAddress _eth;
+	uint32_t _refresh;
+	int _nthreads;
+	bool _shared;
+
+};
+
+CLICK_ENDDECLS
+#endif
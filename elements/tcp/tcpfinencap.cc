@@ -54,7 +54,7 @@ TCPFinEncap::smaction(Packet *q)
 	th->th_off    = (sizeof(click_tcp) + TCP_OPLEN_ANNO(p)) >> 2;
 	th->th_flags2 = 0;
 	th->th_flags  = TH_FIN | TH_ACK;
-	th->th_win    = htons(s->rcv_wnd >> s->rcv_wscale);
+	th->th_win    = htons(s->advertised_window());
 	th->th_sum    = 0;
 	th->th_urp    = 0;
 
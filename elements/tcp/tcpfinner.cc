@@ -73,7 +73,7 @@ TCPFinner::smaction(Packet *pp)
 	th->th_off    = 5;
 	th->th_flags2 = 0;
 	th->th_flags  = TH_FIN | TH_ACK;
-	th->th_win    = htons(s->rcv_wnd >> s->rcv_wscale);
+	th->th_win    = htons(s->advertised_window());
 	th->th_sum    = 0;
 	th->th_urp    = 0;
 
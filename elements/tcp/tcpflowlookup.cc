@@ -31,6 +31,7 @@
 #include "tcpflowlookup.hh"
 #include "tcpstate.hh"
 #include "tcpinfo.hh"
+#include "tcpmib.hh"
 #include "../userlevel/dpdk.hh"
 
 CLICK_DECLS
@@ -39,13 +40,14 @@ TCPFlowLookup::TCPFlowLookup()
 {
 }
 
-Packet *
-TCPFlowLookup::smaction(Packet *p)
+TCPState *
+TCPFlowLookup::lookup(Packet *p)
 {
 //	const click_ip *ip = p->ip_header();
 //	const click_tcp *th = p->tcp_header();
     TCPState *s;
     struct rte_mbuf *mbuf;
+
     // Get flow tuple with our address as the source
     IPFlowID flow(p, true);
 
@@ -83,9 +85,17 @@ TCPFlowLookup::smaction(Packet *p)
 		for (uint32_t i = 0; i < sizeof(TCPState); i += CLICK_CACHE_LINE_SIZE)
 			prefetch0((char *)s + i);
 	}
-	
+
+	return s;
+}
+
+Packet *
+TCPFlowLookup::smaction(Packet *p)
+{
+	TCPMib::inc(TCP_MIB_IN_SEGS);
+
 	// Set packet annotation
-	SET_TCP_STATE_ANNO(p, (uint64_t)s);
+	SET_TCP_STATE_ANNO(p, (uint64_t)lookup(p));
 
 	return p;
 }
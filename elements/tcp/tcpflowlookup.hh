@@ -28,6 +28,8 @@
 #include <click/element.hh>
 CLICK_DECLS
 
+class TCPState;
+
 class TCPFlowLookup final : public Element { public:
 
 	TCPFlowLookup() CLICK_COLD;
@@ -40,9 +42,11 @@ class TCPFlowLookup final : public Element { public:
 	void push(int, Packet *) final;
 	Packet *pull(int);
 
+	static TCPState *lookup(Packet *p);
+
   private:
 
-	inline void prefetch0(const volatile void *p) {
+	static inline void prefetch0(const volatile void *p) {
 		asm volatile ("prefetcht0 %[p]" : : [p] "m" (*(const volatile char*)p));
 	}
 };
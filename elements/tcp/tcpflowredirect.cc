@@ -0,0 +1,284 @@
+/*
+ * tcpflowredirect.{cc,hh} -- hands packets of flows owned by other cores over to them
+ * Rafael Laufer, Massimo Gallo
+ *
+ * Copyright (c) 2019 Nokia Bell Labs
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+ *    in the documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ */
+
+#include <click/config.h>
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/master.hh>
+#include <click/straccum.hh>
+#include <click/standard/scheduleinfo.hh>
+#include "tcpflowredirect.hh"
+#include "tcpflowlookup.hh"
+#include "tcpstate.hh"
+#include "tcpsocket.hh"
+#include "tcpinfo.hh"
+CLICK_DECLS
+
+TCPFlowRedirect::TCPFlowRedirect()
+	: _ring(NULL), _core(NULL), _nthreads(0), _burst(32), _capacity(1024)
+{
+}
+
+int
+TCPFlowRedirect::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+	if (Args(conf, this, errh)
+		.read("BURST", _burst)
+		.read("CAPACITY", _capacity)
+		.complete() < 0)
+		return -1;
+
+	if (_burst == 0)
+		return errh->error("BURST must be positive");
+	if (_capacity < _burst)
+		return errh->error("CAPACITY must be at least BURST");
+
+	return 0;
+}
+
+int
+TCPFlowRedirect::initialize(ErrorHandler *errh)
+{
+	_nthreads = master()->nthreads();
+	_core = new CoreData[_nthreads];
+
+	// No rings needed with a single core or if disabled in the TCP layer
+	if (_nthreads == 1 || !TCPInfo::redirect())
+		return 0;
+
+	_ring = new Ring[_nthreads * _nthreads];
+	for (int r = 0; r < _nthreads * _nthreads; r++)
+		if (_ring[r].initialize(_capacity) < 0)
+			return errh->error("out of memory");
+
+	// Per-core task draining the rings, only scheduled when they have packets
+	for (int c = 0; c < _nthreads; c++) {
+		Task *t = new Task(this);
+		ScheduleInfo::initialize_task(this, t, false, errh);
+		t->move_thread(c);
+		_task.push_back(t);
+	}
+
+	return 0;
+}
+
+void
+TCPFlowRedirect::cleanup(CleanupStage)
+{
+	for (int i = 0; i < _task.size(); i++)
+		delete _task[i];
+
+	if (_ring)
+		for (int r = 0; r < _nthreads * _nthreads; r++) {
+			Packet *p;
+			while (_ring[r].pop(p))
+				p->kill();
+		}
+
+	delete[] _ring;
+	delete[] _core;
+	_ring = NULL;
+	_core = NULL;
+}
+
+inline int
+TCPFlowRedirect::owner(Packet *p)
+{
+	// Same tuple orientation as in TCPFlowLookup, symmetric RSS anyway
+	IPFlowID flow(p, true);
+
+	// Flows handed off by TCPBalancer go where they were migrated
+	int c = TCPInfo::balancer_steer(flow);
+	if (c >= 0)
+		return c;
+
+#if HAVE_DPDK
+	return TCPSocket::rss_core(flow);
+#else
+	return click_current_cpu_id();
+#endif
+}
+
+void
+TCPFlowRedirect::push(int, Packet *p)
+{
+	int c = click_current_cpu_id();
+	CoreData *d = &_core[c];
+	d->count++;
+
+	// Connection found, or no other core to ask
+	TCPState *s = TCP_STATE_ANNO(p);
+	if (likely((s && s->state != TCP_LISTEN) || !_ring)) {
+		output(0).push(p);
+		return;
+	}
+
+	int o = owner(p);
+	if (o == c) {
+		output(0).push(p);
+		return;
+	}
+
+	forward(c, o, p);
+}
+
+// Hand packet p over from core c to core o
+inline void
+TCPFlowRedirect::forward(int c, int o, Packet *p)
+{
+	CoreData *d = &_core[c];
+
+	Ring &r = ring(c, o);
+	if (unlikely(!r.push(p))) {
+		d->drops++;
+		p->kill();
+		return;
+	}
+
+	d->redirected++;
+
+	// Wake up the owner only if it may have drained the ring already, so
+	// once per batch. Pairs with the fence in run_task().
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (r.size() == 1)
+		_task[o]->reschedule();
+}
+
+bool
+TCPFlowRedirect::run_task(Task *task)
+{
+	int c = click_current_cpu_id();
+	CoreData *d = &_core[c];
+	uint32_t count = 0;
+	bool more = false;
+
+	for (int src = 0; src < _nthreads; src++) {
+		if (src == c)
+			continue;
+
+		Ring &r = ring(src, c);
+		Packet *p;
+		uint32_t n = 0;
+		for (; n < _burst && r.pop(p); n++) {
+			// Look the flow up again, now in the table of its owner
+			TCPState *s = TCPFlowLookup::lookup(p);
+
+			// The connection may have been migrated here just before
+			if (!s || s->state == TCP_LISTEN) {
+				TCPInfo::balancer_poll();
+				s = TCPFlowLookup::lookup(p);
+			}
+
+			// Or given back to the core it came from, send it there too
+			// instead of letting TCPListen reset it
+			if (!s || s->state == TCP_LISTEN) {
+				int o = TCPInfo::balancer_steer(IPFlowID(p, true));
+				if (o >= 0 && o != c) {
+					forward(c, o, p);
+					continue;
+				}
+			}
+
+			SET_TCP_STATE_ANNO(p, (uint64_t)s);
+			output(0).push(p);
+		}
+
+		count += n;
+		if (n == _burst)
+			more = true;
+	}
+
+	d->taken += count;
+
+	// Packets pushed before the fence are seen here, later ones wake us up
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	for (int src = 0; src < _nthreads && !more; src++)
+		if (src != c && !ring(src, c).empty())
+			more = true;
+
+	if (more)
+		task->fast_reschedule();
+	return count > 0;
+}
+
+enum { H_COUNT, H_REDIRECTED, H_REDIRECT_RATE, H_DROPS, H_STATS };
+
+String
+TCPFlowRedirect::read_handler(Element *e, void *thunk)
+{
+	TCPFlowRedirect *r = static_cast<TCPFlowRedirect *>(e);
+	uint64_t count = 0, redirected = 0, drops = 0;
+	StringAccum sa;
+
+	for (int c = 0; c < r->_nthreads && r->_core; c++) {
+		CoreData *d = &r->_core[c];
+		count += d->count;
+		redirected += d->redirected;
+		drops += d->drops;
+		sa << c << ' ' << d->count << ' ' << d->redirected << ' '
+		   << d->taken << ' ' << d->drops << '\n';
+	}
+
+	switch ((intptr_t)thunk) {
+	case H_COUNT:
+		return String(count);
+	case H_REDIRECTED:
+		return String(redirected);
+	case H_REDIRECT_RATE:
+		return String(count ? (double)redirected / count : 0.0);
+	case H_DROPS:
+		return String(drops);
+	case H_STATS:
+		return sa.take_string();
+	default:
+		return String();
+	}
+}
+
+int
+TCPFlowRedirect::write_handler(const String &, Element *e, void *, ErrorHandler *)
+{
+	TCPFlowRedirect *r = static_cast<TCPFlowRedirect *>(e);
+
+	for (int c = 0; c < r->_nthreads && r->_core; c++)
+		r->_core[c] = CoreData();
+
+	return 0;
+}
+
+void
+TCPFlowRedirect::add_handlers()
+{
+	add_read_handler("count", read_handler, H_COUNT);
+	add_read_handler("redirected", read_handler, H_REDIRECTED);
+	add_read_handler("redirect_rate", read_handler, H_REDIRECT_RATE);
+	add_read_handler("drops", read_handler, H_DROPS);
+	add_read_handler("stats", read_handler, H_STATS);
+	add_write_handler("reset_counts", write_handler, 0, Handler::BUTTON);
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(TCPFlowLookup TCPSocket TCPInfo)
+EXPORT_ELEMENT(TCPFlowRedirect)
@@ -0,0 +1,161 @@
+/*
+ * tcpflowredirect.{cc,hh} -- hands packets of flows owned by other cores over to them
+ * Rafael Laufer, Massimo Gallo
+ *
+ * Copyright (c) 2019 Nokia Bell Labs
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+ *    in the documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ */
+
+#ifndef CLICK_TCPFLOWREDIRECT_HH
+#define CLICK_TCPFLOWREDIRECT_HH
+#include <click/element.hh>
+#include <click/task.hh>
+#include "spscring.hh"
+CLICK_DECLS
+
+/*
+=c
+
+TCPFlowRedirect([I<keywords> BURST, CAPACITY])
+
+=s tcp
+
+hands packets of flows owned by other cores over to them
+
+=d
+
+The TCP layer expects all packets of a flow on the core owning its TCPState,
+which is the core picked by symmetric RSS. Without symmetric RSS in the NIC,
+with ECMP-hashed return traffic, or with tunnels the NIC cannot hash, packets
+may arrive on another core and miss the flow table.
+
+Incoming packets must have the TCP state annotation set, i.e., the element
+is placed right after TCPFlowLookup. Packets of a connection found on this
+core are pushed on output 0 unchanged. Otherwise, i.e., if no connection or
+only a listening socket was found, the owner core is computed in software
+with the same RSS hash used to pick source ports for active opens. If it is
+another core, the packet is handed over to it through a lock-free
+single-producer ring per pair of cores. The owner core looks up the flow
+again in its own table and pushes the packet on output 0.
+
+A core is only woken up when one of its rings becomes non-empty, and it then
+drains each ring in bursts, so no core polls when packets arrive where they
+belong. Redirection is only enabled with REDIRECT true in TCPLayer (i.e.,
+TCPInfo) and with DPDK; otherwise, packets just go through.
+
+Keyword arguments are:
+
+=over 8
+
+=item BURST
+
+Integer. Maximum number of packets taken from a ring at a time. Default is
+32.
+
+=item CAPACITY
+
+Integer. Number of packets each ring can hold. Packets are dropped if the
+ring is full. Default is 1024.
+
+=back
+
+=h count read-only
+
+Returns the number of packets received.
+
+=h redirected read-only
+
+Returns the number of packets handed over to another core.
+
+=h redirect_rate read-only
+
+Returns the fraction of packets handed over to another core.
+
+=h drops read-only
+
+Returns the number of packets dropped due to full rings.
+
+=h stats read-only
+
+Returns one line per core with the number of packets received, handed over
+to other cores, taken over from other cores, and dropped.
+
+=h reset_counts write-only
+
+Resets the counters.
+
+=e
+
+    input[0]
+    -> TCPFlowLookup
+    -> TCPFlowRedirect
+    -> hdrpred :: TCPHeaderPrediction
+    ...
+
+=a TCPFlowLookup, TCPSocket */
+
+class TCPFlowRedirect final : public Element { public:
+
+	TCPFlowRedirect() CLICK_COLD;
+
+	const char *class_name() const { return "TCPFlowRedirect"; }
+	const char *port_count() const { return PORTS_1_1; }
+	const char *processing() const { return PUSH; }
+
+	int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
+	int initialize(ErrorHandler *) CLICK_COLD;
+	void cleanup(CleanupStage) CLICK_COLD;
+	void add_handlers() CLICK_COLD;
+
+	void push(int, Packet *) final;
+	bool run_task(Task *);
+
+  private:
+
+	typedef SPSCRing<Packet *> Ring;
+
+	struct CoreData {
+		uint64_t count;
+		uint64_t redirected;
+		uint64_t taken;
+		uint64_t drops;
+		CoreData() : count(0), redirected(0), taken(0), drops(0) { }
+	} CLICK_ALIGNED(CLICK_CACHE_LINE_SIZE);
+
+	// Ring of packets from core src to core dst
+	inline Ring &ring(int src, int dst) { return _ring[dst * _nthreads + src]; }
+
+	inline int owner(Packet *p);
+	inline void forward(int c, int o, Packet *p);
+
+	Ring *_ring;
+	CoreData *_core;
+	Vector<Task *> _task;
+	int _nthreads;
+	uint32_t _burst;
+	uint32_t _capacity;
+
+	static String read_handler(Element *, void *) CLICK_COLD;
+	static int write_handler(const String &, Element *, void *, ErrorHandler *) CLICK_COLD;
+
+};
+
+CLICK_ENDDECLS
+#endif
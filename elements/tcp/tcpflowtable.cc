@@ -53,6 +53,39 @@ TCPFlowTable::configure(unsigned int _buckets)
     return 0;
 }
 
+void
+TCPFlowTable::reclaim()
+{
+	TCPMemory::Core &m = TCPMemory::core();
+
+	for (FlowTable::iterator it = _flowTable.begin(); it; it++) {
+		TCPState *s = it.get();
+
+		// Collapse the out-of-order buffer, the peer will retransmit it
+		if (!s->rxb.empty()) {
+			m.ofo_pruned += s->rxb.packets();
+			s->rcv_wnd += s->rxb.purge();
+		}
+
+		// Free received data that a closed socket will never read
+		switch (s->state) {
+		case TCP_FIN_WAIT1:
+		case TCP_FIN_WAIT2:
+		case TCP_CLOSING:
+		case TCP_TIME_WAIT:
+		case TCP_LAST_ACK:
+			if (!s->rxq.empty()) {
+				s->rcv_wnd += s->rxq.bytes();
+				s->rxq.flush();
+				m.sock_pruned++;
+			}
+			break;
+		default:
+			break;
+		}
+	}
+}
+
 int
 TCPFlowTable::h_flow(int, String &s, Element *e, 
                                             const Handler *, ErrorHandler *errh)
@@ -45,6 +45,9 @@ class TCPFlowTable final { public:
 	inline int insert(TCPState *s);
 	inline int remove(TCPState *s);
 	inline int remove(const IPFlowID &flow);
+	inline uint32_t size() const { return _flowTable.size(); }
+
+	void reclaim();
 
 	typedef HashContainer<TCPState> FlowTable;
 
@@ -44,7 +44,7 @@
 CLICK_DECLS
 
 TCPHashAllocator::TCPHashAllocator(size_t size)
-    : _free(0), _buffer(0), _size(size)
+    : _free(0), _remote(0), _buffer(0), _size(size)
 {
 #ifdef VALGRIND_CREATE_MEMPOOL
     VALGRIND_CREATE_MEMPOOL(this, 0, 0);
@@ -125,6 +125,10 @@ void TCPHashAllocator::swap(TCPHashAllocator &x)
     _free = x._free;
     x._free = xfree;
 
+    link *xremote = _remote;
+    _remote = x._remote;
+    x._remote = xremote;
+
     buffer *xbuffer = _buffer;
     _buffer = x._buffer;
     x._buffer = xbuffer;
@@ -50,6 +50,9 @@ class TCPHashAllocator { public:
     inline void *allocate();
     inline void deallocate(void *p);
 
+    // Free from another thread, the memory is reused by the owner
+    inline void deallocate_remote(void *p);
+
     void swap(TCPHashAllocator &x);
 
 //  private:
@@ -68,6 +71,7 @@ class TCPHashAllocator { public:
 
 
     link *_free;
+    link *_remote;	// freed by other threads, taken by allocate()
     buffer *_buffer;
     size_t _size;
     unsigned int min_buffer_size;
@@ -104,6 +108,10 @@ inline void *TCPHashAllocator::allocate()
 	VALGRIND_MAKE_MEM_UNDEFINED(&l->next, sizeof(l->next));
 #endif
 	return l;
+    } else if (__atomic_load_n(&_remote, __ATOMIC_RELAXED)) {
+	// Take all the remotely freed memory at once, so no ABA problem
+	_free = __atomic_exchange_n(&_remote, (link *) 0, __ATOMIC_ACQUIRE);
+	return allocate();
     } else if (_buffer && _buffer->pos < _buffer->maxpos) {
 	void *data = reinterpret_cast<char *>(_buffer) + _buffer->pos;
 	_buffer->pos += _size;
@@ -126,5 +134,20 @@ inline void TCPHashAllocator::deallocate(void *p)
     }
 }
 
+inline void TCPHashAllocator::deallocate_remote(void *p)
+{
+    if (p) {
+	link *l = reinterpret_cast<link *>(p);
+	link *head = __atomic_load_n(&_remote, __ATOMIC_RELAXED);
+	do {
+	    l->next = head;
+	} while (!__atomic_compare_exchange_n(&_remote, &head, l, true,
+					      __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+#ifdef VALGRIND_MEMPOOL_FREE
+	VALGRIND_MEMPOOL_FREE(this, p);
+#endif
+    }
+}
+
 CLICK_ENDDECLS
 #endif
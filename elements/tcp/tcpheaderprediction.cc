@@ -0,0 +1,287 @@
+/*
+ * tcpheaderprediction.{cc,hh} -- fast path for in-order segments in ESTABLISHED
+ * Rafael Laufer, Massimo Gallo
+ *
+ * Copyright (c) 2019 Nokia Bell Labs
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+ *    in the documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ */
+
+
+#include <click/config.h>
+#include <click/glue.hh>
+#include <click/master.hh>
+#include <clicknet/ip.h>
+#include <clicknet/tcp.h>
+#include "tcpheaderprediction.hh"
+#include "tcpstate.hh"
+#include "tcpinfo.hh"
+#include "tcpsocket.hh"
+#include "tcptrace.hh"
+#include "tcpclock.hh"
+#include "util.hh"
+CLICK_DECLS
+
+// NOP, NOP, TIMESTAMP, as sent by most stacks
+#define TCP_HP_TSTAMP_HDR \
+	((TCPOPT_NOP << 24) | (TCPOPT_NOP << 16) | \
+	 (TCPOPT_TIMESTAMP << 8) | TCPOLEN_TIMESTAMP)
+
+TCPHeaderPrediction::TCPHeaderPrediction()
+	: _core(NULL), _nthreads(0)
+{
+}
+
+TCPHeaderPrediction::~TCPHeaderPrediction()
+{
+}
+
+int
+TCPHeaderPrediction::initialize(ErrorHandler *)
+{
+	_nthreads = master()->nthreads();
+	_core = new CoreData[_nthreads];
+
+	return 0;
+}
+
+void
+TCPHeaderPrediction::cleanup(CleanupStage)
+{
+	delete[] _core;
+	_core = NULL;
+}
+
+inline bool
+TCPHeaderPrediction::predict(TCPState *s, Packet *p)
+{
+	const click_ip *ip = p->ip_header();
+	const click_tcp *th = p->tcp_header();
+
+	if (s->state != TCP_ESTABLISHED || TCPInfo::cong_control() != 0)
+		return false;
+
+	// Only ACK (and maybe PSH) set
+	if ((th->th_flags & (TH_SYN|TH_FIN|TH_RST|TH_URG|TH_ACK)) != TH_ACK)
+		return false;
+
+	// Next expected segment, nothing out of order, window unchanged
+	if (TCP_SEQ(th) != s->rcv_nxt || !s->rxb.empty() ||
+	    ((uint32_t)TCP_WIN(th) << s->snd_wscale) != s->snd_wnd)
+		return false;
+
+	// Duplicate ACKs and loss recovery take the slow path
+	uint32_t ack = TCP_ACK(th);
+	uint16_t len = TCP_LEN(ip, th);
+	if (s->snd_dupack || SEQ_LT(ack, s->snd_una) || SEQ_LT(s->snd_nxt, ack) ||
+	    (len == 0 && ack == s->snd_una) || len > s->rcv_wnd)
+		return false;
+
+	// Options must be exactly one timestamp, if negotiated
+	if (!s->snd_ts_ok)
+		return th->th_off == 5;
+
+	if (th->th_off != 8)
+		return false;
+
+	const uint32_t *opt = (const uint32_t *)(th + 1);
+	return opt[0] == htonl(TCP_HP_TSTAMP_HDR) &&
+	       SEQ_GEQ(ntohl(opt[1]), s->ts_recent);
+}
+
+Packet *
+TCPHeaderPrediction::process(TCPState *s, Packet *p)
+{
+	const click_ip *ip = p->ip_header();
+	const click_tcp *th = p->tcp_header();
+	uint32_t seq = TCP_SEQ(th);
+	uint32_t ack = TCP_ACK(th);
+	uint16_t len = TCP_LEN(ip, th);
+	Timestamp now = p->timestamp_anno();
+	bool acceptable = s->is_acceptable_ack(ack);
+
+	SET_TCP_RTT_ANNO(p, 0);
+	SET_TCP_ACKED_ANNO(p, 0);
+	RESET_TCP_MS_FLAG_ANNO(p);
+	RESET_TCP_ACK_FLAG_ANNO(p);
+
+	// Timestamp (TCPAckOptionsParse) and RTT (TCPEstimateRTT)
+	uint32_t rtt = 0;
+	if (s->snd_ts_ok) {
+		const uint32_t *opt = (const uint32_t *)(th + 1);
+		uint32_t usec = (uint32_t)now.usecval();
+		if (usec == 0)
+			usec = (uint32_t)TCPClock::now_usec();
+
+		if (SEQ_LEQ(seq, s->ts_last_ack_sent)) {
+			s->ts_recent = ntohl(opt[1]);
+			s->ts_recent_update = usec;
+		}
+
+		if (acceptable) {
+			rtt = MAX(1, usec - (ntohl(opt[2]) - s->ts_offset));
+			SET_TCP_RTT_ANNO(p, rtt);
+		}
+	}
+	else if (acceptable && s->snd_rtx_count == 0 && !s->rtxq.empty()) {
+		Packet *q = s->rtxq.front();
+		if (SEQ_LT(TCP_END(q), ack)) {
+			Timestamp t = (now ? now : TCPClock::now());
+			rtt = MAX(1, (t - q->timestamp_anno()).usecval());
+		}
+	}
+	if (rtt)
+		s->update_rtt(rtt);
+
+	// ACK (TCPProcessAck)
+#if HAVE_TCP_KEEPALIVE
+	s->snd_keepalive_count = 0;
+	if (now) {
+		Timestamp tmo = now + Timestamp::make_msec(TCP_KEEPALIVE);
+		s->keepalive_timer.defer_at_steady(tmo);
+	}
+	else
+		s->keepalive_timer.defer_after_msec(TCP_KEEPALIVE);
+#endif
+	if (SEQ_LT(s->snd_wl1, seq) ||
+	      (s->snd_wl1 == seq && SEQ_LEQ(s->snd_wl2, ack))) {
+		s->snd_wl1 = seq;
+		s->snd_wl2 = ack;
+	}
+
+	if (acceptable) {
+		uint32_t acked = ack - s->snd_una;
+		SET_TCP_ACKED_ANNO(p, acked);
+		s->clean_rtx_queue(ack);
+		s->snd_rtx_count = 0;
+		s->snd_acked_total += acked;
+		s->snd_una = ack;
+		TCPTrace::record(TCP_TRACE_ACK, s, acked);
+	}
+
+	if (len == 0)
+		return p;
+
+	// Text (TCPProcessTxt)
+	Packet *q = p->seg_split();
+	Packet *c = p->clone();
+	if (q)
+		p->seg_join(q);
+
+	p->pull((ip->ip_hl + th->th_off) << 2);
+	while (p) {
+		q = p->seg_split();
+		s->rxq.push_back(p);
+		p = q;
+	}
+
+	s->rcv_nxt += len;
+	s->rcv_wnd -= len;
+
+#if HAVE_TCP_DELAYED_ACK
+	if (s->delayed_ack_timer.scheduled() ||
+	    len >= ((s->rcv_mss - (s->snd_ts_ok ? 12 : 0)) << 1)) {
+		s->delayed_ack_timer.cancel();
+		SET_TCP_ACK_FLAG_ANNO(c);
+	}
+	else {
+		uint32_t timeout = MIN(TCP_DELAYED_ACK, TCP_RTO_MIN >> 1);
+		if (now) {
+			Timestamp tmo = now + Timestamp::make_msec(timeout);
+			s->delayed_ack_timer.defer_at_steady(tmo);
+		}
+		else
+			s->delayed_ack_timer.defer_after_msec(timeout);
+	}
+#else
+	SET_TCP_ACK_FLAG_ANNO(c);
+#endif
+
+	if (unlikely(s->splice_to))
+		TCPSocket::splice_forward(s);
+	else
+		s->wake_up(TCP_WAIT_RXQ_NONEMPTY);
+
+	return c;
+}
+
+void
+TCPHeaderPrediction::push(int, Packet *p)
+{
+	TCPState *s = TCP_STATE_ANNO(p);
+	CoreData *d = &_core[click_current_cpu_id()];
+
+	if (s && predict(s, p)) {
+		d->hits++;
+		output(1).push(process(s, p));
+	}
+	else {
+		d->misses++;
+		output(0).push(p);
+	}
+}
+
+enum { H_HITS, H_MISSES, H_HIT_RATE };
+
+String
+TCPHeaderPrediction::read_handler(Element *e, void *thunk)
+{
+	TCPHeaderPrediction *h = static_cast<TCPHeaderPrediction *>(e);
+	uint64_t hits = 0, misses = 0;
+
+	for (int c = 0; c < h->_nthreads && h->_core; c++) {
+		hits += h->_core[c].hits;
+		misses += h->_core[c].misses;
+	}
+
+	switch ((intptr_t)thunk) {
+	case H_HITS:
+		return String(hits);
+	case H_MISSES:
+		return String(misses);
+	case H_HIT_RATE:
+		return String(hits + misses ? (double)hits / (hits + misses) : 0.0);
+	default:
+		return String();
+	}
+}
+
+int
+TCPHeaderPrediction::write_handler(const String &, Element *e, void *, ErrorHandler *)
+{
+	TCPHeaderPrediction *h = static_cast<TCPHeaderPrediction *>(e);
+
+	for (int c = 0; c < h->_nthreads && h->_core; c++)
+		h->_core[c] = CoreData();
+
+	return 0;
+}
+
+void
+TCPHeaderPrediction::add_handlers()
+{
+	add_read_handler("hits", read_handler, H_HITS);
+	add_read_handler("misses", read_handler, H_MISSES);
+	add_read_handler("hit_rate", read_handler, H_HIT_RATE);
+	add_write_handler("reset_counts", write_handler, 0, Handler::BUTTON);
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(TCPClock)
+EXPORT_ELEMENT(TCPHeaderPrediction)
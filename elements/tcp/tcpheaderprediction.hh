@@ -0,0 +1,124 @@
+/*
+ * tcpheaderprediction.{cc,hh} -- fast path for in-order segments in ESTABLISHED
+ * Rafael Laufer, Massimo Gallo
+ *
+ * Copyright (c) 2019 Nokia Bell Labs
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+ *    in the documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ */
+
+
+#ifndef CLICK_TCPHEADERPREDICTION_HH
+#define CLICK_TCPHEADERPREDICTION_HH
+#include <click/element.hh>
+CLICK_DECLS
+
+/*
+=c
+
+TCPHeaderPrediction
+
+=s tcp
+
+processes the common case of an ESTABLISHED connection in one step
+
+=d
+
+Van Jacobson's header prediction. Incoming packets are expected to have the
+TCP state annotation set, i.e., the element is placed right after
+TCPFlowLookup. A segment is predicted if the connection is ESTABLISHED, no
+SYN, FIN, RST, or URG flag is set, the sequence number is RCV.NXT with
+nothing buffered out of order, the advertised window is unchanged, the
+acknowledgment is in SND.UNA..SND.NXT (and acknowledges new data if the
+segment is a pure ACK), the connection is not in loss recovery, and the only
+option is a timestamp, in the usual NOP, NOP, TS layout, that is not older
+than TS.Recent.
+
+Predicted segments go through option parsing, RTT estimation, ACK processing,
+and text processing in a single function and are pushed on output 1, which
+must be connected to the congestion control element of the ESTABLISHED
+pipeline. Everything else is pushed unchanged on output 0, which must be
+connected to the full modular pipeline, i.e., TCPStateDemux. Only NewReno
+uses the fast path, as the other congestion control algorithms need their own
+ACK processing.
+
+=h hits read-only
+
+Returns the number of predicted segments.
+
+=h misses read-only
+
+Returns the number of segments sent to the full pipeline.
+
+=h hit_rate read-only
+
+Returns the fraction of predicted segments.
+
+=h reset_counts write-only
+
+Resets the counters.
+
+=e
+
+    TCPFlowLookup
+    -> hp :: TCPHeaderPrediction
+    -> dmx :: TCPStateDemux;
+    ...
+    hp[1] -> congcon;
+
+=a TCPFlowLookup, TCPStateDemux */
+
+class TCPState;
+
+class TCPHeaderPrediction final : public Element { public:
+
+	TCPHeaderPrediction() CLICK_COLD;
+	~TCPHeaderPrediction() CLICK_COLD;
+
+	const char *class_name() const { return "TCPHeaderPrediction"; }
+	const char *port_count() const { return "1/2"; }
+	const char *processing() const { return PUSH; }
+
+	int initialize(ErrorHandler *) CLICK_COLD;
+	void cleanup(CleanupStage) CLICK_COLD;
+	void add_handlers() CLICK_COLD;
+
+	void push(int, Packet *) final;
+
+  private:
+
+	struct CoreData {
+		uint64_t hits;
+		uint64_t misses;
+		CoreData() : hits(0), misses(0) { }
+	} CLICK_ALIGNED(CLICK_CACHE_LINE_SIZE);
+
+	static inline bool predict(TCPState *s, Packet *p);
+	Packet *process(TCPState *s, Packet *p);
+
+	static String read_handler(Element *, void *) CLICK_COLD;
+	static int write_handler(const String &, Element *, void *, ErrorHandler *) CLICK_COLD;
+
+	CoreData *_core;
+	int _nthreads;
+
+};
+
+CLICK_ENDDECLS
+#endif
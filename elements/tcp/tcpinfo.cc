@@ -29,6 +29,10 @@
 #include <click/error.hh>
 #include "tcpinfo.hh"
 #include "tcpstate.hh"
+#include "tcpmemory.hh"
+#include "tcpclock.hh"
+#include "tcptimerset.hh"
+#include "tcpmib.hh"
 CLICK_DECLS
 
 bool TCPInfo::_verbose(false);
@@ -36,6 +40,8 @@ uint64_t TCPInfo::_buckets;
 bool TCPInfo::_initialized(false);
 uint32_t TCPInfo::_rmem(TCP_RMEM_DEFAULT);
 uint32_t TCPInfo::_wmem(TCP_WMEM_DEFAULT);
+uint16_t TCPInfo::_mss(TCP_RCV_MSS_DEFAULT);
+bool TCPInfo::_redirect(false);
 uint32_t TCPInfo::_usr_capacity(TCP_USR_CAPACITY);
 thread_local TCPInfo::SockCount TCPInfo::_usr_sockets(MAX_PIDS,0);
 uint32_t TCPInfo::_sys_capacity(TCP_SYS_CAPACITY);
@@ -43,6 +49,7 @@ thread_local uint32_t TCPInfo::_sys_sockets;
 Vector<IPAddress> TCPInfo::_addr;
 uint32_t TCPInfo::_nthreads;
 uint32_t TCPInfo::_cong_control(0);
+const TCPInfo::Balancer *TCPInfo::_balancer(NULL);
 
 // Per-core port table
 TCPInfo::PortTable TCPInfo::_portTable;  // Per-core port table
@@ -66,13 +73,20 @@ TCPInfo::configure(Vector<String> &conf, ErrorHandler *errh)
 		return errh->error("TCPInfo can only be configured once");
 
 	_verbose = false;
+	uint64_t mem_low = 0, mem_pressure = 0, mem_high = 0;
+	uint32_t mtu = TCP_MTU_DEFAULT;
 
 	if (Args(conf, this, errh)
 		.read("CONGCTRL", _cong_control)	 
 		.read_mp("ADDRS", _addr)
 		.read("RMEM", _rmem)
 		.read("WMEM", _wmem)
+		.read("MTU", mtu)
+		.read("REDIRECT", _redirect)
 		.read("BUCKETS", _buckets)
+		.read("MEM_LOW", mem_low)
+		.read("MEM_PRESSURE", mem_pressure)
+		.read("MEM_HIGH", mem_high)
 		.read("VERBOSE", _verbose)
 		.complete() < 0)
 		return -1;
@@ -87,7 +101,17 @@ TCPInfo::configure(Vector<String> &conf, ErrorHandler *errh)
 		return errh->error("WMEM too low");
 	if (_wmem > TCP_WMEM_MAX)
 		return errh->error("WMEM too high");
+	if (mtu < TCP_SND_MSS_MIN + 40 || mtu > TCP_SND_MSS_MAX + 40)
+		return errh->error("MTU out of range");
+	_mss = mtu - sizeof(click_ip) - sizeof(click_tcp);
+	if (!mem_high && (mem_low || mem_pressure))
+		return errh->error("MEM_LOW and MEM_PRESSURE require MEM_HIGH");
+	if (TCPMemory::configure(mem_low, mem_pressure, mem_high) < 0)
+		return errh->error("MEM_LOW <= MEM_PRESSURE <= MEM_HIGH required");
 	
+	// Cached per-core time for the data path
+	TCPClock::calibrate();
+
 	// Get the number of threads
 	_nthreads = master()->nthreads();
 
@@ -118,5 +142,38 @@ TCPInfo::configure(Vector<String> &conf, ErrorHandler *errh)
     return 0;
 }
 
+String
+TCPInfo::read_handler(Element *e, void *thunk)
+{
+	switch ((intptr_t)thunk) {
+	case 1:
+		return TCPClock::unparse();
+	case 2:
+		return TCPTimerSet::unparse(e->master());
+	case 3:
+		return TCPMib::unparse();
+	default:
+		return TCPMemory::unparse();
+	}
+}
+
+void
+TCPInfo::add_handlers()
+{
+	add_read_handler("mem", read_handler, 0);
+	add_read_handler("clock", read_handler, 1);
+	add_read_handler("timers", read_handler, 2);
+	add_read_handler("mib", read_handler, 3);
+	add_write_handler("mib_reset", mib_reset_handler, 0, Handler::BUTTON);
+}
+
+int
+TCPInfo::mib_reset_handler(const String &, Element *, void *, ErrorHandler *)
+{
+	TCPMib::reset();
+	return 0;
+}
+
 CLICK_ENDDECLS
+ELEMENT_REQUIRES(TCPMib)
 EXPORT_ELEMENT(TCPInfo)
@@ -51,11 +51,14 @@ class TCPInfo final : public Element { public:
 	const char *class_name() const	{ return "TCPInfo"; }
 	int configure_phase() const		{ return CONFIGURE_PHASE_FIRST; }
 	int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
+	void add_handlers() CLICK_COLD;
 
 	// TCP info API
 	static inline bool verbose();
 	static inline uint32_t rmem();
 	static inline uint32_t wmem();
+	static inline uint16_t mss();
+	static inline bool redirect();
 	static inline uint32_t sys_capacity();
 	static inline uint32_t sys_sockets();
 	static inline void inc_sys_sockets();
@@ -66,6 +69,7 @@ class TCPInfo final : public Element { public:
 	static inline void dec_usr_sockets(int);
 	static inline const Vector<IPAddress> &addr();
 	static inline uint32_t cong_control();
+	static inline void mem_reclaim();
 
 #if HAVE_ALLOW_EPOLL	
 	typedef TCPTable<TCPEventQueue *> EpollTableThread;
@@ -80,6 +84,19 @@ class TCPInfo final : public Element { public:
 	static inline int flow_insert(TCPState *s);
 	static inline int flow_remove(TCPState *s);
 	static inline int flow_remove(const IPFlowID &flow);
+	static inline uint32_t flow_count(unsigned c);
+
+	// Balancer, hooks set by TCPBalancer if configured
+	struct Balancer {
+		bool (*handoff)(TCPState *l);       // connection in accept queue of l
+		int (*steer)(const IPFlowID &flow); // core that took over flow, or -1
+		void (*unsteer)(TCPState *s);       // migrated connection is gone
+		void (*poll)();                     // take over migrated connections
+	};
+	static inline void set_balancer(const Balancer *b);
+	static inline bool balancer_handoff(TCPState *l);
+	static inline int balancer_steer(const IPFlowID &flow);
+	static inline void balancer_poll();
 
 	// Port
 	typedef TCPPortTable* PortTable;
@@ -114,10 +131,15 @@ class TCPInfo final : public Element { public:
 
   private:
 
+	static String read_handler(Element *, void *) CLICK_COLD;
+	static int mib_reset_handler(const String &, Element *, void *, ErrorHandler *) CLICK_COLD;
+
 	static bool _verbose;
 	static bool _initialized;
 	static uint32_t _rmem;
 	static uint32_t _wmem;
+	static uint16_t _mss;
+	static bool _redirect;
 	static uint32_t _usr_capacity;
 	static thread_local SockCount _usr_sockets;
 	static uint32_t _sys_capacity;
@@ -130,6 +152,7 @@ class TCPInfo final : public Element { public:
 	static SockFDesc _sockFDesc;
 	static uint32_t _nthreads;
 	static uint32_t _cong_control;
+	static const Balancer *_balancer;
 #if HAVE_ALLOW_EPOLL
 	static EpollTable _epollTable;
 	static EpollFDesc _epollFDesc;
@@ -155,6 +178,18 @@ TCPInfo::wmem()
 	return _wmem;
 }
 
+inline uint16_t
+TCPInfo::mss()
+{
+	return _mss;
+}
+
+inline bool
+TCPInfo::redirect()
+{
+	return _redirect;
+}
+
 inline uint32_t
 TCPInfo::sys_capacity()
 {
@@ -214,6 +249,18 @@ inline uint32_t TCPInfo::cong_control()
 	return _cong_control;
 }
 
+inline void
+TCPInfo::mem_reclaim()
+{
+	// Walk the flow table only once per pressure episode
+	TCPMemory::Core &m = TCPMemory::core();
+	if (m.reclaimed)
+		return;
+
+	m.reclaimed = true;
+	_flowTable[click_current_cpu_id()].reclaim();
+}
+
 inline TCPState *
 TCPInfo::flow_lookup(const IPFlowID &flow)
 {
@@ -238,9 +285,50 @@ TCPInfo::flow_remove(TCPState *s)
 		delete(s->event);
 		s->event = NULL;
 	}
+	// Drop the redirection entry of a migrated flow on its home core
+	if (unlikely(s->home >= 0) && _balancer)
+		_balancer->unsteer(s);
 	return _flowTable[c].remove(s);
 }
 
+inline uint32_t
+TCPInfo::flow_count(unsigned c)
+{
+	// Read without synchronization from other cores, only an estimate
+	return _flowTable[c].size();
+}
+
+inline void
+TCPInfo::set_balancer(const Balancer *b)
+{
+	_balancer = b;
+}
+
+inline bool
+TCPInfo::balancer_handoff(TCPState *l)
+{
+	if (likely(!_balancer))
+		return false;
+
+	return _balancer->handoff(l);
+}
+
+inline int
+TCPInfo::balancer_steer(const IPFlowID &flow)
+{
+	if (likely(!_balancer))
+		return -1;
+
+	return _balancer->steer(flow);
+}
+
+inline void
+TCPInfo::balancer_poll()
+{
+	if (unlikely(_balancer))
+		_balancer->poll();
+}
+
 inline bool
 TCPInfo::port_get(const IPAddress &addr, uint16_t port, TCPState *s)
 {
@@ -30,6 +30,7 @@
 #include <clicknet/tcp.h>
 #include "tcpipencap.hh"
 #include "tcpstate.hh"
+#include "tcpmib.hh"
 CLICK_DECLS
 
 TCPIPEncap::TCPIPEncap()
@@ -89,6 +90,8 @@ TCPIPEncap::smaction(Packet *q)
 	ip->ip_src = s->flow.saddr().in_addr();
 	ip->ip_dst = s->flow.daddr().in_addr();
 
+	TCPMib::inc(TCP_MIB_OUT_SEGS);
+
 	return p;
 }
 
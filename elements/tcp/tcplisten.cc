@@ -33,6 +33,8 @@
 #include "tcpstate.hh"
 #include "tcpinfo.hh"
 #include "tcptimers.hh"
+#include "tcpmib.hh"
+#include "tcptrace.hh"
 CLICK_DECLS
 
 TCPListen::TCPListen()
@@ -102,10 +104,23 @@ TCPListen::smaction(Packet *p)
 //		if (unlikely(s->acq.size() == uint32_t(s->backlog))) {
 		if (unlikely(s->acq_size == s->backlog)) {
 //			s->lock.release();
+			TCPMib::inc(TCP_MIB_LISTEN_OVERFLOWS);
+			TCPMib::inc(TCP_MIB_LISTEN_DROPS);
 			p->kill();
 			return NULL;
 		}
 
+		// Refuse new connections while under memory pressure
+		if (unlikely(TCPMemory::under_pressure())) {
+			TCPInfo::mem_reclaim();
+			if (TCPMemory::under_pressure()) {
+				TCPMemory::core().syn_refused++;
+				TCPMib::inc(TCP_MIB_LISTEN_DROPS);
+				p->kill();
+				return NULL;
+			}
+		}
+
 		// If not, create a new state entry and populate it
 		TCPState *t = TCPState::allocate();
 		click_assert(t);
@@ -130,6 +145,7 @@ TCPListen::smaction(Packet *p)
 //		t->rcv_nxt    = t->rcv_isn + 1;
 		t->rcv_nxt    = TCP_SEQ(th) + 1;
 		t->rcv_wnd    = TCPInfo::rmem();
+		t->rcv_adv    = t->rcv_nxt + MIN(t->rcv_wnd, 65535);
 
 		t->snd_isn    = click_random(0, 0xFFFFFFFF);
 		t->snd_una    = t->snd_isn;
@@ -165,6 +181,9 @@ TCPListen::smaction(Packet *p)
 
 		// Insert it into flow table
 		TCPInfo::flow_insert(t);
+		TCPMib::inc(TCP_MIB_PASSIVE_OPENS);
+		// The new connection comes out of the listener's LISTEN state
+		TCPTrace::record(TCP_TRACE_STATE, t, s->state);
 
 		// Set packet annotation
 		SET_TCP_STATE_ANNO(p, (uint64_t)t);
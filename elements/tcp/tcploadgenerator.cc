@@ -0,0 +1,483 @@
+/*
+ * tcploadgenerator.{cc,hh} -- an open-loop request/response load generator
+ * Rafael Laufer, Massimo Gallo
+ *
+ * Copyright (c) 2019 Nokia Bell Labs
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+ *    in the documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ */
+
+#include <click/config.h>
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/master.hh>
+#include <click/router.hh>
+#include <click/straccum.hh>
+#include <click/standard/scheduleinfo.hh>
+#include <math.h>
+#include "tcploadgenerator.hh"
+#include "tcpinfo.hh"
+#include "tcpclock.hh"
+#include "util.hh"
+CLICK_DECLS
+
+#define TCP_LOADGEN_MSS     (TCPInfo::mss() - (TCPOLEN_TIMESTAMP + 2))
+#define TCP_LOADGEN_EVENTS  1024
+#define TCP_LOADGEN_DRAIN   1000000000ULL  // Wait for responses, in nsec
+
+TCPLoadGenerator::TCPLoadGenerator()
+	: _thread(NULL), _end_h(NULL), _nthreads(0), _verbose(false)
+{
+}
+
+int
+TCPLoadGenerator::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+	_rate = 10000;
+	_connections = 16;
+	_request = 64;
+	_response = 0;
+	_pending = 65536;
+	String distribution = "poisson";
+	Timestamp think;
+	Timestamp duration = Timestamp::make_sec(10);
+	Timestamp warmup;
+	bool stop = true;
+
+	if (Args(conf, this, errh)
+		.read_mp("ADDRESS", _addr)
+		.read_mp("PORT", _port)
+		.read("RATE", _rate)
+		.read("DISTRIBUTION", WordArg(), distribution)
+		.read("CONNECTIONS", _connections)
+		.read("REQUEST", _request)
+		.read("RESPONSE", _response)
+		.read("THINK", think)
+		.read("DURATION", duration)
+		.read("WARMUP", warmup)
+		.read("PENDING", _pending)
+		.read("STOP", stop)
+		.read("VERBOSE", _verbose)
+		.complete() < 0)
+		return -1;
+
+	if (_rate == 0)
+		return errh->error("RATE must be positive");
+
+	if (distribution == "poisson")
+		_poisson = true;
+	else if (distribution == "fixed")
+		_poisson = false;
+	else
+		return errh->error("DISTRIBUTION must be fixed or poisson");
+
+	if (_connections == 0)
+		return errh->error("CONNECTIONS must be positive");
+
+	if (_request == 0)
+		return errh->error("REQUEST must be positive");
+
+	if (_response == 0)
+		_response = _request;
+
+	if (warmup >= duration)
+		return errh->error("WARMUP must be shorter than DURATION");
+
+	_think = think.nsecval();
+	_duration = duration.nsecval();
+	_warmup = warmup.nsecval();
+
+	if (stop)
+		_end_h = new HandlerCall("stop");
+
+	return 0;
+}
+
+int
+TCPLoadGenerator::initialize(ErrorHandler *errh)
+{
+	int r = TCPApplication::initialize(errh);
+	if (r < 0)
+		return r;
+
+	// Stop once every core is done
+	if (_end_h && _end_h->initialize_write(this, errh) < 0)
+		return -1;
+	_done = 0;
+
+	_nthreads = master()->nthreads();
+	_thread = new ThreadData[_nthreads];
+	click_assert(_thread);
+
+	// Start per-core tasks
+	for (uint32_t c = 0; c < _nthreads; c++) {
+		ThreadData *t = &_thread[c];
+		t->rng = ((uint64_t)click_random() << 32) | (c + 1);
+		t->conn.resize(_connections);
+
+		BlockingTask *task = new BlockingTask(this);
+		t->task = task;
+		ScheduleInfo::initialize_task(this, task, errh);
+		task->move_thread(c);
+	}
+
+	return 0;
+}
+
+void
+TCPLoadGenerator::cleanup(CleanupStage)
+{
+	for (uint32_t c = 0; _thread && c < _nthreads; c++)
+		delete _thread[c].task;
+
+	delete [] _thread;
+	delete _end_h;
+}
+
+inline uint64_t
+TCPLoadGenerator::interval(ThreadData *t)
+{
+	double mean = 1e9 / _rate;
+	if (!_poisson)
+		return (uint64_t)mean;
+
+	// xorshift64*, then exponential inter-arrival times
+	t->rng ^= t->rng >> 12;
+	t->rng ^= t->rng << 25;
+	t->rng ^= t->rng >> 27;
+	uint32_t r = (t->rng * 2685821657736338717ULL) >> 32;
+	return (uint64_t)(-log((r + 0.5) / 4294967296.0) * mean);
+}
+
+bool
+TCPLoadGenerator::open_connection(ThreadData *t, int i)
+{
+	Conn &conn = t->conn[i];
+
+	int sockfd = click_socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+	if (sockfd < 0) {
+		perror("socket");
+		return false;
+	}
+
+	int err = click_connect(sockfd, _addr, _port);
+	if (err == -1 && errno != EINPROGRESS) {
+		perror("connect");
+		click_close(sockfd);
+		return false;
+	}
+
+	// Add sockfd to the list of watched file descriptors
+	struct epoll_event ev;
+	ev.events = EPOLLOUT | EPOLLIN;
+	ev.data.fd = sockfd;
+	if (click_epoll_ctl(t->epfd, EPOLL_CTL_ADD, sockfd, &ev) < 0) {
+		perror("epoll_ctl");
+		click_close(sockfd);
+		return false;
+	}
+
+	if (sockfd >= t->index.size())
+		t->index.resize(sockfd + 1, -1);
+	t->index[sockfd] = i;
+
+	conn = Conn();
+	conn.sockfd = sockfd;
+
+	return true;
+}
+
+void
+TCPLoadGenerator::close_connection(ThreadData *t, int i)
+{
+	Conn &conn = t->conn[i];
+
+	// The request in flight is lost
+	if (conn.state == CONN_BUSY)
+		t->errors++;
+
+	if (click_epoll_ctl(t->epfd, EPOLL_CTL_DEL, conn.sockfd, NULL) < 0)
+		perror("epoll_ctl");
+	click_close(conn.sockfd);
+
+	t->index[conn.sockfd] = -1;
+	conn = Conn();
+
+	// Remove it from the idle list, the thinking one is checked lazily
+	for (int k = 0; k < t->idle.size(); k++)
+		if (t->idle[k] == i) {
+			t->idle[k] = t->idle.back();
+			t->idle.pop_back();
+			break;
+		}
+}
+
+bool
+TCPLoadGenerator::send_request(ThreadData *t, int i, uint64_t intended)
+{
+	Conn &conn = t->conn[i];
+
+	// Segment large requests, the last segment may be shorter
+	for (uint32_t off = 0; off < _request; off += TCP_LOADGEN_MSS) {
+		uint32_t len = MIN(_request - off, (uint32_t)TCP_LOADGEN_MSS);
+		Packet *p = Packet::make_chain(TCP_HEADROOM, NULL, len);
+		if (!p) {
+			errno = ENOMEM;
+			perror("send");
+			return false;
+		}
+
+		click_push(conn.sockfd, p);
+		if (errno) {
+			perror("send");
+			p->kill();
+			return false;
+		}
+	}
+
+	conn.state = CONN_BUSY;
+	conn.received = 0;
+	conn.intended = intended;
+	t->requests++;
+
+	return true;
+}
+
+void
+TCPLoadGenerator::selected(ThreadData *t, int sockfd, int revents, uint64_t now)
+{
+	int i = (sockfd < t->index.size() ? t->index[sockfd] : -1);
+	if (i < 0)
+		return;
+	Conn &conn = t->conn[i];
+
+	// Connection established, only wait for incoming packets
+	if ((revents & EPOLLOUT) && conn.state == CONN_CONNECTING) {
+		struct epoll_event ev;
+		ev.events = EPOLLIN;
+		ev.data.fd = sockfd;
+		if (click_epoll_ctl(t->epfd, EPOLL_CTL_MOD, sockfd, &ev) < 0) {
+			perror("epoll_ctl");
+			return;
+		}
+
+		conn.state = CONN_IDLE;
+		t->idle.push_back(i);
+	}
+
+	if (revents & EPOLLIN) {
+		Packet *p = click_pull(sockfd, 64);
+		if (!p) {
+			if (errno != EAGAIN)
+				revents |= EPOLLERR;
+		}
+
+		// Count the response bytes, an empty packet means FIN
+		bool fin = false;
+		while (p) {
+			Packet *next = p->next();
+			if (p->length() == 0)
+				fin = true;
+			conn.received += p->length();
+			p->kill();
+			p = next;
+		}
+
+		if (conn.state == CONN_BUSY && conn.received >= _response) {
+			// Latency since the request was generated, including queueing
+			if (conn.intended >= t->begin.nsecval() + _warmup)
+				t->latency.record(now - conn.intended);
+			t->completed++;
+
+			conn.received = 0;
+			if (_think) {
+				conn.state = CONN_THINKING;
+				conn.ready = now + _think;
+				t->thinking.push_back(i);
+			}
+			else {
+				conn.state = CONN_IDLE;
+				t->idle.push_back(i);
+			}
+		}
+
+		if (fin)
+			revents |= EPOLLHUP;
+	}
+
+	// Replace broken connections to keep the pool size
+	if (revents & (EPOLLERR|EPOLLHUP)) {
+		if (_verbose)
+			click_chatter("%s: core %d, connection %d closed", class_name(),
+			                                       click_current_cpu_id(), i);
+		close_connection(t, i);
+		(void)open_connection(t, i);
+	}
+}
+
+bool
+TCPLoadGenerator::run_task(Task *)
+{
+	unsigned c = click_current_cpu_id();
+	ThreadData *t = &_thread[c];
+
+	t->epfd = click_epoll_create(1);
+	assert(t->epfd > 0);
+
+	// Open the connection pool and wait until it is established
+	for (uint32_t i = 0; i < _connections; i++)
+		if (!open_connection(t, i))
+			return false;
+
+	struct epoll_event events[TCP_LOADGEN_EVENTS];
+	while (t->idle.size() < (int)_connections && !home_thread()->stop_flag()) {
+		int n = click_epoll_wait(t->epfd, events, TCP_LOADGEN_EVENTS, -1);
+		uint64_t now = TCPClock::fresh().nsecval();
+		for (int k = 0; k < n; k++)
+			selected(t, events[k].data.fd, events[k].events, now);
+	}
+
+	t->begin = TCPClock::fresh();
+	uint64_t start = t->begin.nsecval();
+	uint64_t stop = start + _duration;
+	uint64_t next = start;
+
+	for (;;) {
+		uint64_t now = TCPClock::fresh().nsecval();
+
+		// Generate the requests due by now, whether or not we can send them
+		while (next <= now && next < stop) {
+			if (t->pending.size() < (int)_pending)
+				t->pending.push_back(next);
+			else
+				t->dropped++;
+			next += interval(t);
+		}
+
+		// Connections done thinking
+		while (!t->thinking.empty()) {
+			Conn &conn = t->conn[t->thinking.front()];
+			if (conn.state == CONN_THINKING && conn.ready > now)
+				break;
+			if (conn.state == CONN_THINKING) {
+				conn.state = CONN_IDLE;
+				t->idle.push_back(t->thinking.front());
+			}
+			t->thinking.pop_front();
+		}
+
+		// Send the oldest requests over idle connections
+		while (!t->pending.empty() && !t->idle.empty()) {
+			int i = t->idle.back();
+			t->idle.pop_back();
+			if (send_request(t, i, t->pending.front()))
+				t->pending.pop_front();
+			else {
+				close_connection(t, i);
+				(void)open_connection(t, i);
+			}
+		}
+
+		// Done once every request is answered or after draining
+		bool busy = !t->pending.empty() || t->requests > t->completed + t->errors;
+		if (now >= stop && (!busy || now >= stop + TCP_LOADGEN_DRAIN))
+			break;
+		if (home_thread()->stop_flag())
+			break;
+
+		// Poll without blocking, requests must leave on time
+		int n = click_epoll_wait(t->epfd, events, TCP_LOADGEN_EVENTS, 0);
+		if (n < 0) {
+			perror("epoll");
+			break;
+		}
+		if (n > 0)
+			now = TCPClock::fresh().nsecval();
+		for (int k = 0; k < n; k++)
+			selected(t, events[k].data.fd, events[k].events, now);
+	}
+	t->end = TCPClock::fresh();
+
+	// Requests never sent or answered count as errors
+	t->errors += t->pending.size();
+	t->pending.clear();
+
+	for (uint32_t i = 0; i < _connections; i++)
+		if (t->conn[i].sockfd >= 0)
+			close_connection(t, i);
+	click_epoll_close(t->epfd);
+
+	if (_verbose)
+		click_chatter("%s: core %d, %llu requests, %llu completed", class_name(),
+		              c, (unsigned long long)t->requests,
+		              (unsigned long long)t->completed);
+
+	// Give other tasks a chance to run
+	Timestamp second = Timestamp::make_sec(1);
+	t->task->yield_timeout(second, false);
+
+	if (_end_h && _done.fetch_and_add(1) + 1 == _nthreads)
+		(void)_end_h->call_write();
+
+	return false;
+}
+
+String
+TCPLoadGenerator::read_handler(Element *e, void *thunk)
+{
+	TCPLoadGenerator *g = static_cast<TCPLoadGenerator *>(e);
+	LatencyHistogram latency;
+	uint64_t requests = 0, completed = 0, errors = 0, dropped = 0;
+	double time = 0;
+
+	for (uint32_t c = 0; g->_thread && c < g->_nthreads; c++) {
+		ThreadData *t = &g->_thread[c];
+		requests += t->requests;
+		completed += t->completed;
+		errors += t->errors;
+		dropped += t->dropped;
+		latency.merge(t->latency);
+		if (t->end > t->begin)
+			time = MAX(time, (t->end - t->begin).doubleval());
+	}
+
+	if (thunk)
+		return latency.unparse("", 1000);
+
+	StringAccum sa;
+	sa << "requests=" << requests << ' ';
+	sa << "completed=" << completed << ' ';
+	sa << "errors=" << errors << ' ';
+	sa << "dropped=" << dropped << ' ';
+	sa << "seconds=" << time << ' ';
+	sa << "rps=" << (time > 0 ? completed / time : 0) << ' ';
+	sa << latency.unparse("latency_us_", 1000);
+	return sa.take_string();
+}
+
+void
+TCPLoadGenerator::add_handlers()
+{
+	add_read_handler("stats", read_handler, 0);
+	add_read_handler("latency", read_handler, 1);
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(TCPLoadGenerator)
+ELEMENT_REQUIRES(TCPApplication TCPClock)
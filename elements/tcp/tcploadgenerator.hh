@@ -0,0 +1,205 @@
+/*
+ * tcploadgenerator.{cc,hh} -- an open-loop request/response load generator
+ * Rafael Laufer, Massimo Gallo
+ *
+ * Copyright (c) 2019 Nokia Bell Labs
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+ *    in the documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ */
+
+#ifndef CLICK_TCPLOADGENERATOR_HH
+#define CLICK_TCPLOADGENERATOR_HH
+#include <click/element.hh>
+#include <click/handlercall.hh>
+#include <click/deque.hh>
+#include <click/atomic.hh>
+#include "tcpapplication.hh"
+#include "blockingtask.hh"
+#include "latencyhistogram.hh"
+CLICK_DECLS
+
+/*
+=c
+
+TCPLoadGenerator(ADDRESS, PORT [, I<keywords> RATE, DISTRIBUTION, CONNECTIONS,
+REQUEST, RESPONSE, THINK, DURATION, WARMUP, PENDING, STOP, VERBOSE])
+
+=s tcp
+
+an open-loop request/response load generator
+
+=d
+
+Sends requests of REQUEST bytes to a server at ADDRESS and PORT and waits for
+responses of RESPONSE bytes, such as those of TCPEchoServerEpollZC, over a
+pool of CONNECTIONS persistent connections per core.
+
+Unlike closed-loop clients, requests are generated at RATE per core, at fixed
+intervals or as a Poisson process, regardless of how fast the server
+responds. A request that finds no idle connection waits in a queue, and its
+latency is measured from the time it was generated until its whole response
+is received. Therefore, the queueing delay caused by a slow server is part
+of the latency instead of being hidden by a lower sending rate.
+
+Each connection carries one request at a time and, after the response, stays
+idle for THINK before it can carry the next one. Latencies are recorded in a
+per-core histogram and merged when read.
+
+Keyword arguments are:
+
+=over 8
+
+=item RATE
+
+Integer. Requests per second per core. Default is 10000.
+
+=item DISTRIBUTION
+
+Either C<fixed> or C<poisson>. Distribution of the request inter-arrival
+times. Default is C<poisson>.
+
+=item CONNECTIONS
+
+Integer. Connections per core. Default is 16.
+
+=item REQUEST
+
+Integer. Request size in bytes. Default is 64.
+
+=item RESPONSE
+
+Integer. Response size in bytes. Default is REQUEST.
+
+=item THINK
+
+Time. Idle time of a connection between a response and the next request.
+Default is 0.
+
+=item DURATION
+
+Time. Duration of the experiment, excluding connection setup. Default is 10s.
+
+=item WARMUP
+
+Time. Latencies of requests generated in the beginning of the experiment are
+not recorded. Default is 0.
+
+=item PENDING
+
+Integer. Maximum number of requests waiting for a connection per core. Newer
+requests are dropped and counted. Default is 65536.
+
+=item STOP
+
+Boolean. Stop the driver once every core is done. Default is true.
+
+=back
+
+=h stats read-only
+
+Returns "requests=... completed=... errors=... dropped=... seconds=... rps=..."
+followed by the latency summary.
+
+=h latency read-only
+
+Returns the minimum, mean, p50, p90, p99, p99.9, and maximum latency in
+microseconds.
+
+=a TCPEchoClientEpollZC, TCPEchoServerEpollZC */
+
+class TCPLoadGenerator final : public TCPApplication { public:
+
+	TCPLoadGenerator() CLICK_COLD;
+
+	const char *class_name() const { return "TCPLoadGenerator"; }
+	const char *port_count() const { return "1/1"; }
+	const char *processing() const { return "h/h"; }
+
+	int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
+	int initialize(ErrorHandler *) CLICK_COLD;
+	void cleanup(CleanupStage) CLICK_COLD;
+	void add_handlers() CLICK_COLD;
+
+	bool run_task(Task *) final;
+
+	enum { CONN_CONNECTING, CONN_IDLE, CONN_BUSY, CONN_THINKING };
+
+	struct Conn {
+		int sockfd;
+		int state;
+		uint32_t received;    // Response bytes received so far
+		uint64_t intended;    // Generation time of the request, in nsec
+		uint64_t ready;       // End of the think time, in nsec
+
+		Conn() : sockfd(-1), state(CONN_CONNECTING), received(0),
+		         intended(0), ready(0) { }
+	};
+
+	struct ThreadData {
+		BlockingTask *task;
+		int epfd;
+		uint64_t rng;
+		Vector<Conn> conn;
+		Vector<int> index;        // Connection index per sockfd
+		Vector<int> idle;         // Connections ready for a request
+		Deque<int> thinking;      // Connections in think time, in order
+		Deque<uint64_t> pending;  // Requests waiting for a connection
+		uint64_t requests;
+		uint64_t completed;
+		uint64_t errors;
+		uint64_t dropped;
+		Timestamp begin;
+		Timestamp end;
+		LatencyHistogram latency; // nsec
+
+		ThreadData() : task(NULL), epfd(-1), rng(0), requests(0),
+		               completed(0), errors(0), dropped(0) { }
+	} CLICK_ALIGNED(CLICK_CACHE_LINE_SIZE);
+
+  private:
+
+	bool open_connection(ThreadData *t, int i);
+	void close_connection(ThreadData *t, int i);
+	bool send_request(ThreadData *t, int i, uint64_t intended);
+	void selected(ThreadData *t, int sockfd, int revents, uint64_t now);
+	inline uint64_t interval(ThreadData *t);
+
+	static String read_handler(Element *, void *) CLICK_COLD;
+
+	ThreadData *_thread;
+	HandlerCall *_end_h;
+	atomic_uint32_t _done;
+	IPAddress _addr;
+	uint32_t _nthreads;
+	uint32_t _rate;
+	uint32_t _connections;
+	uint32_t _request;
+	uint32_t _response;
+	uint32_t _pending;
+	uint64_t _think;
+	uint64_t _duration;
+	uint64_t _warmup;
+	uint16_t _port;
+	bool _poisson;
+	bool _verbose;
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,92 @@
+/*
+ * tcpmemory.{cc,hh} -- per-core TCP memory accounting
+ * Rafael Laufer, Massimo Gallo
+ *
+ * Copyright (c) 2019 Nokia Bell Labs
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+ *    in the documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ */
+
+#include <click/config.h>
+#include <click/glue.hh>
+#include <click/straccum.hh>
+#include "tcpmemory.hh"
+CLICK_DECLS
+
+TCPMemory::Core TCPMemory::_core[CLICK_CPU_MAX];
+uint64_t TCPMemory::_low(0);
+uint64_t TCPMemory::_pressure(0);
+uint64_t TCPMemory::_high(0);
+
+int
+TCPMemory::configure(uint64_t low, uint64_t pressure, uint64_t high)
+{
+	if (!high && (low || pressure))
+		return -1;
+	if (low > pressure || pressure > high)
+		return -1;
+
+	_low = low;
+	_pressure = pressure;
+	_high = high;
+
+	return 0;
+}
+
+String
+TCPMemory::unparse()
+{
+	StringAccum sa;
+	Core t;
+	memset(&t, 0, sizeof(t));
+
+	unsigned n = click_max_cpu_ids();
+	for (unsigned c = 0; c < n && c < CLICK_CPU_MAX; c++) {
+		const Core &m = _core[c];
+		sa << "core " << c << ": bytes " << m.bytes
+		   << " packets " << m.packets
+		   << " state " << (int)m.state << '\n';
+
+		t.bytes += m.bytes;
+		t.packets += m.packets;
+		t.pressure += m.pressure;
+		t.ofo_pruned += m.ofo_pruned;
+		t.syn_refused += m.syn_refused;
+		t.send_refused += m.send_refused;
+		t.wnd_clamped += m.wnd_clamped;
+		t.sock_pruned += m.sock_pruned;
+	}
+
+	sa << "bytes " << t.bytes << '\n'
+	   << "packets " << t.packets << '\n'
+	   << "low " << _low << '\n'
+	   << "pressure " << _pressure << '\n'
+	   << "high " << _high << '\n'
+	   << "pressure_events " << t.pressure << '\n'
+	   << "ofo_pruned " << t.ofo_pruned << '\n'
+	   << "syn_refused " << t.syn_refused << '\n'
+	   << "send_refused " << t.send_refused << '\n'
+	   << "wnd_clamped " << t.wnd_clamped << '\n'
+	   << "sock_pruned " << t.sock_pruned << '\n';
+
+	return sa.take_string();
+}
+
+CLICK_ENDDECLS
+ELEMENT_PROVIDES(TCPMemory)
@@ -0,0 +1,152 @@
+/*
+ * tcpmemory.{cc,hh} -- per-core TCP memory accounting
+ * Rafael Laufer, Massimo Gallo
+ *
+ * Copyright (c) 2019 Nokia Bell Labs
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+ *    in the documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ */
+
+#ifndef CLICK_TCPMEMORY_HH
+#define CLICK_TCPMEMORY_HH
+#include <click/glue.hh>
+#include <click/string.hh>
+CLICK_DECLS
+
+const uint8_t TCP_MEM_NORMAL   = 0;
+const uint8_t TCP_MEM_PRESSURE = 1;
+const uint8_t TCP_MEM_HIGH     = 2;
+
+// Bytes and packets held in the TCP queues (rxq, rxb, txq, rtxq) of all
+// sockets, accounted per core by PktQueue. Watermarks are given per core
+// and follow Linux's tcp_mem semantics: pressure starts above PRESSURE and
+// ends below LOW, while above HIGH new data is refused. Memory pressure is
+// disabled if all three are zero, which is the default.
+class TCPMemory { public:
+
+	struct Core {
+		int64_t bytes;                  // bytes in TCP queues
+		int64_t packets;                // packets in TCP queues
+		uint8_t state;                  // TCP_MEM_*
+		bool reclaimed;                 // reclaim done in this episode
+		uint64_t pressure;              // times pressure was entered
+		uint64_t ofo_pruned;            // OOO segments dropped or purged
+		uint64_t syn_refused;           // SYNs refused
+		uint64_t send_refused;          // send()/push() calls refused
+		uint64_t wnd_clamped;           // advertised windows clamped
+		uint64_t sock_pruned;           // closed sockets whose rxq was freed
+	} CLICK_ALIGNED(CLICK_CACHE_LINE_SIZE);
+
+	static int configure(uint64_t low, uint64_t pressure, uint64_t high);
+
+	static inline void charge(int32_t bytes, int32_t packets);
+	static inline Core &core();
+	static inline uint8_t state();
+	static inline bool enabled();
+	static inline bool under_pressure();
+	static inline bool over_limit();
+	static inline uint32_t clamp_window(uint32_t wnd, uint16_t mss);
+
+	static String unparse();
+
+  private:
+
+	static Core _core[CLICK_CPU_MAX];
+	static uint64_t _low;
+	static uint64_t _pressure;
+	static uint64_t _high;
+
+};
+
+inline void
+TCPMemory::charge(int32_t bytes, int32_t packets)
+{
+	Core &m = core();
+	m.bytes += bytes;
+	m.packets += packets;
+}
+
+inline TCPMemory::Core &
+TCPMemory::core()
+{
+	return _core[click_current_cpu_id()];
+}
+
+inline bool
+TCPMemory::enabled()
+{
+	return _high != 0;
+}
+
+inline uint8_t
+TCPMemory::state()
+{
+	if (likely(!enabled()))
+		return TCP_MEM_NORMAL;
+
+	Core &m = core();
+	uint64_t bytes = (m.bytes > 0 ? m.bytes : 0);
+
+	if (bytes >= _high)
+		m.state = TCP_MEM_HIGH;
+	else if (bytes >= _pressure) {
+		if (m.state == TCP_MEM_NORMAL)
+			m.pressure++;
+		m.state = TCP_MEM_PRESSURE;
+	}
+	else if (bytes < _low) {
+		m.state = TCP_MEM_NORMAL;
+		m.reclaimed = false;
+	}
+	else if (m.state == TCP_MEM_HIGH)
+		m.state = TCP_MEM_PRESSURE;
+
+	return m.state;
+}
+
+inline bool
+TCPMemory::under_pressure()
+{
+	return state() != TCP_MEM_NORMAL;
+}
+
+inline bool
+TCPMemory::over_limit()
+{
+	return state() == TCP_MEM_HIGH;
+}
+
+inline uint32_t
+TCPMemory::clamp_window(uint32_t wnd, uint16_t mss)
+{
+	// Never advertise a zero window, as there is no zero-window probing
+	uint8_t st = state();
+	if (likely(st == TCP_MEM_NORMAL) || mss == 0)
+		return wnd;
+
+	uint32_t max = (st == TCP_MEM_HIGH ? mss : mss << 2);
+	if (wnd <= max)
+		return wnd;
+
+	core().wnd_clamped++;
+	return max;
+}
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,83 @@
+/*
+ * tcpmib.{cc,hh} -- per-core TCP MIB counters
+ * Rafael Laufer, Massimo Gallo
+ *
+ * Copyright (c) 2019 Nokia Bell Labs
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+ *    in the documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ */
+
+#include <click/config.h>
+#include <click/glue.hh>
+#include <click/straccum.hh>
+#include "tcpmib.hh"
+CLICK_DECLS
+
+TCPMib::Core TCPMib::_core[CLICK_CPU_MAX];
+
+const char * const TCPMib::_name[TCP_MIB_MAX] = {
+	"ActiveOpens",
+	"PassiveOpens",
+	"AttemptFails",
+	"EstabResets",
+	"InSegs",
+	"OutSegs",
+	"RetransSegs",
+	"InErrs",
+	"OutRsts",
+	"InCsumErrors",
+	"TCPTimeouts",
+	"TCPFastRetrans",
+	"TCPDupAcks",
+	"TCPOFOQueue",
+	"ListenOverflows",
+	"ListenDrops",
+	"TCPSplices",
+	"TCPSplicedBytes",
+	"TCPTxCoalesced",
+	"TCPRetransCollapsed",
+};
+
+uint64_t
+TCPMib::get(int field)
+{
+	uint64_t n = 0;
+	for (unsigned c = 0; c < click_max_cpu_ids(); c++)
+		n += _core[c].v[field];
+	return n;
+}
+
+void
+TCPMib::reset()
+{
+	for (unsigned c = 0; c < click_max_cpu_ids(); c++)
+		memset(&_core[c], 0, sizeof(Core));
+}
+
+String
+TCPMib::unparse()
+{
+	StringAccum sa;
+	for (int i = 0; i < TCP_MIB_MAX; i++)
+		sa << _name[i] << ' ' << get(i) << '\n';
+	return sa.take_string();
+}
+
+CLICK_ENDDECLS
+ELEMENT_PROVIDES(TCPMib)
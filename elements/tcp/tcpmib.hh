@@ -0,0 +1,86 @@
+/*
+ * tcpmib.{cc,hh} -- per-core TCP MIB counters
+ * Rafael Laufer, Massimo Gallo
+ *
+ * Copyright (c) 2019 Nokia Bell Labs
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+ *    in the documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ */
+
+#ifndef CLICK_TCPMIB_HH
+#define CLICK_TCPMIB_HH
+#include <click/glue.hh>
+#include <click/string.hh>
+CLICK_DECLS
+
+// Counters of RFC 4022 (TCP-MIB) and of Linux's TcpExt, named as in
+// /proc/net/snmp and /proc/net/netstat, plus a few of ClickNF's own
+enum {
+	TCP_MIB_ACTIVE_OPENS,       // connect() sent a SYN
+	TCP_MIB_PASSIVE_OPENS,      // SYN accepted by a listening socket
+	TCP_MIB_ATTEMPT_FAILS,      // SYN_SENT or SYN_RECV to CLOSED
+	TCP_MIB_ESTAB_RESETS,       // ESTABLISHED or CLOSE_WAIT reset
+	TCP_MIB_IN_SEGS,            // segments received
+	TCP_MIB_OUT_SEGS,           // segments sent, including retransmissions
+	TCP_MIB_RETRANS_SEGS,       // segments retransmitted
+	TCP_MIB_IN_ERRS,            // segments dropped as malformed or corrupt
+	TCP_MIB_OUT_RSTS,           // RSTs sent
+	TCP_MIB_IN_CSUM_ERRORS,     // segments with a bad checksum
+	TCP_MIB_TIMEOUTS,           // retransmission timeouts
+	TCP_MIB_FAST_RETRANS,       // fast retransmits
+	TCP_MIB_DUP_ACKS,           // duplicate ACKs received
+	TCP_MIB_OFO_QUEUE,          // segments queued out of order
+	TCP_MIB_LISTEN_OVERFLOWS,   // SYNs dropped with a full accept queue
+	TCP_MIB_LISTEN_DROPS,       // SYNs dropped by a listening socket
+	TCP_MIB_SPLICES,            // connections spliced to a peer
+	TCP_MIB_SPLICED_BYTES,      // bytes moved between spliced connections
+	TCP_MIB_TX_COALESCED,       // send() calls appended to a queued segment
+	TCP_MIB_RETRANS_COLLAPSED,  // segments merged into a retransmission
+	TCP_MIB_MAX
+};
+
+// Counters are kept per core, each core on its own cache lines, and only
+// summed when read, so updating one costs a single increment.
+class TCPMib { public:
+
+	static inline void inc(int field) {
+		_core[click_current_cpu_id()].v[field]++;
+	}
+
+	static inline void add(int field, uint64_t n) {
+		_core[click_current_cpu_id()].v[field] += n;
+	}
+
+	static uint64_t get(int field);
+	static void reset();
+	static String unparse();
+
+  private:
+
+	struct Core {
+		uint64_t v[TCP_MIB_MAX];
+	} CLICK_ALIGNED(CLICK_CACHE_LINE_SIZE);
+
+	static Core _core[CLICK_CPU_MAX];
+	static const char * const _name[TCP_MIB_MAX];
+
+};
+
+CLICK_ENDDECLS
+#endif
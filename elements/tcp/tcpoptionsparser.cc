@@ -30,6 +30,7 @@
 #include "tcpstate.hh"
 #include "tcpoptionsparser.hh"
 #include "util.hh"
+#include "tcpclock.hh"
 CLICK_DECLS
 
 TCPOptionsParser::TCPOptionsParser()
@@ -82,7 +83,7 @@ TCPOptionsParser::handle_syn(Packet *p)
 		case TCPOPT_MAXSEG:           // MSS
 			if (opsize == TCPOLEN_MAXSEG) {
 				uint16_t mss = ntohs(*(const uint16_t *)&ptr[2]);
-				s->snd_mss = MIN(mss, TCP_RCV_MSS_DEFAULT);
+				s->snd_mss = MIN(mss, TCPInfo::mss());
 			}
 			break;
 
@@ -109,7 +110,7 @@ TCPOptionsParser::handle_syn(Packet *p)
 				// Get now, preferably from the packet timestamp
 				uint32_t now = (uint32_t)p->timestamp_anno().usecval();
 				if (now == 0)
-					now = (uint32_t)Timestamp::now_steady().usecval();
+					now = (uint32_t)TCPClock::now_usec();
 
 				// Get timestamp parameters
 				uint32_t ts_val = ntohl(*(const uint32_t *)&ptr[2]);
@@ -228,7 +229,7 @@ TCPOptionsParser::handle_ack(Packet *p)
 				// Get now, preferably from the packet timestamp
 				uint32_t now = (uint32_t)p->timestamp_anno().usecval();
 				if (now == 0)
-					now = (uint32_t)Timestamp::now_steady().usecval();
+					now = (uint32_t)TCPClock::now_usec();
 
 				// Get timestamp parameters
 				uint32_t ts_val = ntohl(*(const uint32_t *)&ptr[2]);
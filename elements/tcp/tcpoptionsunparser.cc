@@ -30,6 +30,7 @@
 #include "tcpstate.hh"
 #include "tcpoptionsunparser.hh"
 #include "util.hh"
+#include "tcpclock.hh"
 CLICK_DECLS
 
 TCPOptionsUnparser::TCPOptionsUnparser()
@@ -140,7 +141,7 @@ TCPOptionsUnparser::handle_syn(Packet *pp)
 		// Get now, preferably from packet timestamp
 		uint32_t now = (uint32_t)p->timestamp_anno().usecval();
 		if (now == 0)
-			now = (uint32_t)Timestamp::now_steady().usecval();
+			now = (uint32_t)TCPClock::now_usec();
 
 		// Pointers to the timestamps
 		uint32_t *ts_val = (uint32_t *)(ptr + 4);
@@ -228,7 +229,7 @@ TCPOptionsUnparser::handle_ack(Packet *pp)
 		// Get now, preferably from packet timestamp
 		uint32_t now = (uint32_t)p->timestamp_anno().usecval();
 		if (now == 0)
-			now = (uint32_t)Timestamp::now_steady().usecval();
+			now = (uint32_t)TCPClock::now_usec();
 
 		// Pointers to the timestamps
 		uint32_t *ts_val = (uint32_t *)(ptr + 4);
@@ -347,7 +348,7 @@ TCPOptionsUnparser::handle_rtx(Packet *pp)
 				// Get now, preferably from packet timestamp
 				uint32_t now = (uint32_t)p->timestamp_anno().usecval();
 				if (now == 0)
-					now = (uint32_t)Timestamp::now_steady().usecval();
+					now = (uint32_t)TCPClock::now_usec();
 
 				// Fill timestamp parameters
 				*ts_val = htonl(s->ts_offset + now);
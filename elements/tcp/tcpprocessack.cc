@@ -31,6 +31,7 @@
 #include "tcptimers.hh"
 #include "tcpstate.hh"
 #include "tcpinfo.hh"
+#include "tcptrace.hh"
 #include "util.hh"
 CLICK_DECLS
 
@@ -64,6 +65,9 @@ TCPProcessAck::smaction(Packet *p)
 	// Get packet timestamp
 	Timestamp now = p->timestamp_anno();
 				
+	// State before this segment, for the state change trace
+	uint8_t prev = s->state;
+
 	//   "if the ACK bit is on"
 	switch (s->state) {
 	case TCP_SYN_RECV:
@@ -85,6 +89,7 @@ TCPProcessAck::smaction(Packet *p)
 		}
 
 		s->state = TCP_ESTABLISHED;
+		TCPTrace::record(TCP_TRACE_STATE, s, prev);
 		if (s->snd_reinitialize_timer)
 			s->snd_rto = 3 * TCP_RTO_INIT;
 
@@ -141,8 +146,9 @@ TCPProcessAck::smaction(Packet *p)
 //			t->acq.push_back(s);
 			t->acq_push_back(s);
 
-			// Wake up parent
-			t->wake_up(TCP_WAIT_ACQ_NONEMPTY);
+			// Wake up parent, unless the connection may go to another core
+			if (!TCPInfo::balancer_handoff(t))
+				t->wake_up(TCP_WAIT_ACQ_NONEMPTY);
 
 			// Unlock socket state
 //			t->lock.release();
@@ -191,14 +197,13 @@ TCPProcessAck::smaction(Packet *p)
 			// Restart keepalive timer
 			if (s->state == TCP_ESTABLISHED || s->state == TCP_CLOSE_WAIT) {
 				s->snd_keepalive_count = 0;
-				s->keepalive_timer.unschedule();
 				if (now) {
 					Timestamp tmo = 
 					           now + Timestamp::make_msec(TCP_KEEPALIVE);
-					s->keepalive_timer.schedule_at_steady(tmo);
+					s->keepalive_timer.defer_at_steady(tmo);
 				}
 				else 
-					s->keepalive_timer.schedule_after_msec(TCP_KEEPALIVE);
+					s->keepalive_timer.defer_after_msec(TCP_KEEPALIVE);
 			}
 #endif
 			// Update window
@@ -223,7 +228,10 @@ TCPProcessAck::smaction(Packet *p)
 			s->snd_rtx_count = 0;
 
 			// Advance window
+			uint32_t acked = ack - s->snd_una;
+			s->snd_acked_total += acked;
 			s->snd_una = ack;
+			TCPTrace::record(TCP_TRACE_ACK, s, acked);
 		}
 		// If not, check if ACK is a duplicate
 		else if (SEQ_LEQ(ack, s->snd_una))
@@ -241,8 +249,10 @@ TCPProcessAck::smaction(Packet *p)
 			//  our FIN is now acknowledged then enter FIN-WAIT-2 and continue
 			//  processing in that state."
 //			if (SEQ_LT(s->snd_fsn, ack))
-			if (SEQ_LEQ(s->snd_nxt, ack))
+			if (SEQ_LEQ(s->snd_nxt, ack)) {
 				s->state = TCP_FIN_WAIT2;
+				TCPTrace::record(TCP_TRACE_STATE, s, prev);
+			}
 
 			// fallthrough
 		case TCP_FIN_WAIT2:
@@ -264,6 +274,7 @@ TCPProcessAck::smaction(Packet *p)
 //			if (SEQ_LT(s->snd_fsn, ack)) {
 			if (SEQ_LEQ(s->snd_nxt, ack)) {
 				s->state = TCP_TIME_WAIT;
+				TCPTrace::record(TCP_TRACE_STATE, s, prev);
 
 				// Initialize and schedule TIME-WAIT timer overloading RTX timer
 				unsigned c = click_current_cpu_id();
@@ -329,13 +340,12 @@ TCPProcessAck::smaction(Packet *p)
 		//  the 2 MSL timeout."
 		if (TCP_FIN(th)) {
 			output(TCP_PROCESS_ACK_OUT_ACK).push(p);
-			s->rtx_timer.unschedule();
 			if (now) {
 				Timestamp tmo = now + Timestamp::make_msec(TCP_MSL << 1);
-				s->rtx_timer.schedule_at_steady(tmo);
+				s->rtx_timer.defer_at_steady(tmo);
 			}
 			else 
-				s->rtx_timer.schedule_after_msec(TCP_MSL << 1);
+				s->rtx_timer.defer_after_msec(TCP_MSL << 1);
 		}
 		else
 			p->kill();
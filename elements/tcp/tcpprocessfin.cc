@@ -31,6 +31,7 @@
 #include "tcptimers.hh"
 #include "tcpstate.hh"
 #include "tcpinfo.hh"
+#include "tcptrace.hh"
 CLICK_DECLS
 
 
@@ -63,7 +64,7 @@ TCPProcessFin::smaction(Packet *p)
 
 #if HAVE_TCP_DELAYED_ACK
 	// Stop delayed ACK timer
-	s->delayed_ack_timer.unschedule();
+	s->delayed_ack_timer.cancel();
 #endif
 
 	// Set ACK flag
@@ -72,10 +73,14 @@ TCPProcessFin::smaction(Packet *p)
 	// Get now from packet timestamp
 	Timestamp now = p->timestamp_anno();
 
+	// State before this segment, for the state change trace
+	uint8_t prev = s->state;
+
 	switch (s->state) {
 	case TCP_SYN_RECV:
 		// "Enter the CLOSE-WAIT state"
 		s->state = TCP_CLOSE_WAIT;
+		TCPTrace::record(TCP_TRACE_STATE, s, prev);
 
 		if (!s->is_passive)
 			s->notify_error(ECONNRESET);
@@ -97,6 +102,7 @@ TCPProcessFin::smaction(Packet *p)
 	case TCP_ESTABLISHED:
 		// "Enter the CLOSE-WAIT state"
 		s->state = TCP_CLOSE_WAIT;
+		TCPTrace::record(TCP_TRACE_STATE, s, prev);
 
 		// Wake up task if waiting to receive data
 		s->wake_up(TCP_WAIT_FIN_RECEIVED);
@@ -110,6 +116,7 @@ TCPProcessFin::smaction(Packet *p)
 		if (SEQ_LEQ(s->snd_nxt, TCP_ACK(th))) {
 			s->stop_timers();
 			s->state = TCP_TIME_WAIT;
+			TCPTrace::record(TCP_TRACE_STATE, s, prev);
 
 			// Initialize and schedule TIME-WAIT timer overloading RTX timer
 			unsigned c = click_current_cpu_id();
@@ -122,8 +129,10 @@ TCPProcessFin::smaction(Packet *p)
 			else 
 				s->rtx_timer.schedule_after_msec(TCP_MSL << 1);
 		}
-		else
+		else {
 			s->state = TCP_CLOSING;
+			TCPTrace::record(TCP_TRACE_STATE, s, prev);
+		}
 
 		// Wake up task if waiting to receive data
 		s->wake_up(TCP_WAIT_FIN_RECEIVED);
@@ -135,6 +144,7 @@ TCPProcessFin::smaction(Packet *p)
 		//  off the other timers."
 		s->stop_timers();
 		s->state = TCP_TIME_WAIT;
+		TCPTrace::record(TCP_TRACE_STATE, s, prev);
 
 		// Initialize and schedule TIME-WAIT timer overloading RTX timer
 		unsigned c = click_current_cpu_id();
@@ -167,14 +177,12 @@ TCPProcessFin::smaction(Packet *p)
 	case TCP_TIME_WAIT:
 		// "Remain in the TIME-WAIT state.  Restart the 2 MSL time-wait
 		//  timeout."
-		s->rtx_timer.unschedule();
-
 		if (now) {
 			Timestamp tmo = now + Timestamp::make_msec(TCP_MSL << 1);
-			s->rtx_timer.schedule_at_steady(tmo);
+			s->rtx_timer.defer_at_steady(tmo);
 		}
 		else 
-			s->rtx_timer.schedule_after_msec(TCP_MSL << 1);
+			s->rtx_timer.defer_after_msec(TCP_MSL << 1);
 		break;
 
    default:
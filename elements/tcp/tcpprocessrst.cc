@@ -30,6 +30,8 @@
 #include "tcpprocessrst.hh"
 #include "tcpstate.hh"
 #include "tcpinfo.hh"
+#include "tcpmib.hh"
+#include "tcptrace.hh"
 CLICK_DECLS
 
 TCPProcessRst::TCPProcessRst()
@@ -66,6 +68,8 @@ TCPProcessRst::smaction(Packet *p)
 		//  active OPEN case, enter the CLOSED state and delete the TCB,
 		//  and return."
 
+		TCPMib::inc(TCP_MIB_ATTEMPT_FAILS);
+
 		// If not a passive socket, notify error to user
 		if (!s->is_passive)
 			s->notify_error(ECONNRESET);
@@ -109,6 +113,8 @@ TCPProcessRst::smaction(Packet *p)
 		//  "connection reset" signal.  Enter the CLOSED state, delete the
 		//  TCB, and return."
 
+		TCPMib::inc(TCP_MIB_ESTAB_RESETS);
+
 		// Remove it from the port table
 		if (!s->is_passive) {
 			uint16_t port = ntohs(s->flow.sport());
@@ -157,7 +163,9 @@ TCPProcessRst::smaction(Packet *p)
 		assert(0);
 	}
 
+	uint8_t prev = s->state;
 	s->state = TCP_CLOSED;
+	TCPTrace::record(TCP_TRACE_STATE, s, prev);
 
 	p->kill();
 	return NULL;
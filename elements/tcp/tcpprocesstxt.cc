@@ -30,6 +30,7 @@
 #include "tcpprocesstxt.hh"
 #include "tcpstate.hh"
 #include "tcpinfo.hh"
+#include "tcpsocket.hh"
 #include "util.hh"
 CLICK_DECLS
 
@@ -116,7 +117,7 @@ TCPProcessTxt::smaction(Packet *p)
 				// fills a gap, send ACK acknowledging everything immmediately
 				if (TCP_ACK_FLAG_ANNO(c) || s->delayed_ack_timer.scheduled() ||
 				    len >= ((s->rcv_mss - (s->snd_ts_ok ? 12 : 0)) << 1)) {
-					s->delayed_ack_timer.unschedule();
+					s->delayed_ack_timer.cancel();
 					SET_TCP_ACK_FLAG_ANNO(c);
 				}
 				else {
@@ -124,10 +125,10 @@ TCPProcessTxt::smaction(Packet *p)
 					Timestamp now = c->timestamp_anno();
 					if (now) {
 						Timestamp tmo = now +  Timestamp::make_msec(timeout);
-						s->delayed_ack_timer.schedule_at_steady(tmo);
+						s->delayed_ack_timer.defer_at_steady(tmo);
 					}
 					else 
-						s->delayed_ack_timer.schedule_after_msec(timeout);
+						s->delayed_ack_timer.defer_after_msec(timeout);
 				}
 #else
 				// Without delayed ACK, send an ACK for every new data packet
@@ -135,8 +136,11 @@ TCPProcessTxt::smaction(Packet *p)
 #endif
 			}
 
-			// Wake user task
-			s->wake_up(TCP_WAIT_RXQ_NONEMPTY);
+			// Forward to a spliced peer or wake user task
+			if (unlikely(s->splice_to))
+				TCPSocket::splice_forward(s);
+			else
+				s->wake_up(TCP_WAIT_RXQ_NONEMPTY);
 
 			// Send the clone to be slaughtered
 			return c;
@@ -25,12 +25,16 @@
 
 
 #include <click/config.h>
+#include <click/error.hh>
+#include <click/master.hh>
+#include <click/standard/scheduleinfo.hh>
 #include <clicknet/ip.h>
 #include <clicknet/tcp.h>
 #include <clicknet/ether.h>
 #include "tcpratecontrol.hh"
 #include "tcpstate.hh"
 #include "tcpinfo.hh"
+#include "tcptxcredit.hh"
 #include "util.hh"
 
 CLICK_DECLS
@@ -39,14 +43,36 @@ TCPRateControl::TCPRateControl()
 {
 }
 
+int
+TCPRateControl::initialize(ErrorHandler *errh)
+{
+	// One task per core resumes the sockets stalled by any instance
+	for (int c = 0; c < master()->nthreads(); c++) {
+		Task *t = new Task(this);
+		if (!TCPTxCredit::set_task(c, t)) {
+			delete t;
+			continue;
+		}
+		ScheduleInfo::initialize_task(this, t, false, errh);
+		t->move_thread(c);
+	}
+
+	return 0;
+}
+
 void
 TCPRateControl::push(int, Packet *p)
 {  
 	TCPState *s = TCP_STATE_ANNO(p);
 	click_assert(s);
 
-	// If TX queue is empty or window is small, do not send any data. 
-	if (s->txq.empty() || s->available_tx_window() < s->snd_mss) {
+	// If TX queue is empty, window is small, or the device queue is full,
+	// do not send any data. 
+	if (s->txq.empty() || s->available_tx_window() < s->snd_mss ||
+	    TCPTxCredit::blocked()) {
+		if (!s->txq.empty() && s->available_tx_window() >= s->snd_mss)
+			TCPTxCredit::stall(s, this);
+
 		if (TCP_ACK_FLAG_ANNO(p))  //Send empty packet if ACK REQUIRED flag set.
 			output(0).push(p);
 		else	
@@ -57,6 +83,12 @@ TCPRateControl::push(int, Packet *p)
 	// Kill original packet, since it is gonna be replaced
 	p->kill();
 
+	send(s);
+}
+
+void
+TCPRateControl::send(TCPState *s)
+{
 	// Get TX queue state
 	bool txq_non_empty = !s->txq.empty();
 //	bool txq_half_full = (s->txq.bytes() > (TCPInfo::wmem() >> 1));
@@ -64,9 +96,20 @@ TCPRateControl::push(int, Packet *p)
 
 	// Keep sending until empty TX queue or small window
 	while (!s->txq.empty() && s->available_tx_window() >= s->snd_mss) {
-		// Get head-of-line (HOL) packet from TX queue
-		Packet *q = s->txq.front();
-		s->txq.pop_front();
+		// Stop if the device queue is full, and resume after it drains
+		if (TCPTxCredit::blocked()) {
+			TCPTxCredit::stall(s, this);
+			break;
+		}
+
+		// Carve the next segment from the TX queue, unless it is held back
+		Packet *q = s->txq_segment();
+		if (!q)
+			break;
+
+		// Refill from the RX queue of a spliced peer
+		if (unlikely(s->splice_from))
+			s->splice_from->splice_move();
 
 		// Get length
 		uint32_t len = q->length();
@@ -94,5 +137,42 @@ TCPRateControl::push(int, Packet *p)
 //	s->lock.release();
 }
 
+bool
+TCPRateControl::run_task(Task *t)
+{
+	unsigned n = 0;
+
+	// Resume stalled sockets in order, each through the instance that
+	// stalled it, until the device queue fills up again
+	while (n < TCP_TX_CREDIT_RESUME) {
+		TCPState *s = TCPTxCredit::resume();
+		if (!s)
+			break;
+
+		TCPRateControl *e = s->txs_owner;
+		s->txs_owner = NULL;
+		e->send(s);
+		n++;
+	}
+
+	if (!TCPTxCredit::blocked() && TCPTxCredit::stalled(click_current_cpu_id()))
+		t->fast_reschedule();
+
+	return n > 0;
+}
+
+String
+TCPRateControl::read_handler(Element *, void *)
+{
+	return TCPTxCredit::unparse();
+}
+
+void
+TCPRateControl::add_handlers()
+{
+	add_read_handler("backpressure", read_handler, 0);
+}
+
 CLICK_ENDDECLS
+ELEMENT_REQUIRES(TCPTxCredit)
 EXPORT_ELEMENT(TCPRateControl)
@@ -47,6 +47,21 @@ allows (i.e., larger than MSS) and the TX queue is not emtpy, more packets may
 be transmitted. After sending all allowed packets, the user task of the
 incoming packet is woken if the TX queue is either empty or half-emtpy.
 
+Segments are carved from the TX queue at transmit time and sized to the
+current MSS. On sockets that coalesce writes (TCP_COALESCE, TCP_CORK, or
+MSG_MORE), a short segment is topped up with the data queued behind it, and a
+short segment at the tail of the queue is held back while the socket is corked
+or the last write had MSG_MORE.
+
+Data is only dequeued while the device TX queue of the current core is below
+its watermark (see the TX_HIGH and TX_LOW keywords of DPDK). Otherwise, data is
+left in the socket TX queue and the socket is appended to a per-core stall
+list. When the device queue drains, stalled sockets are resumed in order.
+
+=h backpressure read-only
+
+Returns the per-core TX backpressure counters.
+
 =e
 
 The TCPRateControl element is only useful if the TCPDataPiggyback element is placed downstream to read the WND annotation and inject data into the packet:
@@ -60,6 +75,8 @@ The TCPRateControl element is only useful if the TCPDataPiggyback element is pla
 
 =a TCPDataPiggyback */
 
+class TCPState;
+
 class TCPRateControl final : public Element { public:
 
 	TCPRateControl() CLICK_COLD;
@@ -68,7 +85,17 @@ class TCPRateControl final : public Element { public:
 	const char *port_count() const { return PORTS_1_1; }
 	const char *processing() const { return PUSH; }
 
+	int initialize(ErrorHandler *) CLICK_COLD;
+	void add_handlers() CLICK_COLD;
+
 	void push(int, Packet *) final;
+	bool run_task(Task *);
+
+	void send(TCPState *s);
+
+  private:
+
+	static String read_handler(Element *, void *) CLICK_COLD;
 
 };
 
@@ -30,6 +30,7 @@
 #include "tcpreordering.hh"
 #include "tcpstate.hh"
 #include "tcpinfo.hh"
+#include "tcpmib.hh"
 #include "util.hh"
 CLICK_DECLS
 
@@ -63,8 +64,20 @@ TCPReordering::push(int, Packet *p)
 	// Reset state annotation as the lock is not held while in the buffer
 	SET_TCP_STATE_ANNO(p, 0);
 
-	// Insert packet into RX buffer and get amount of added data
-	int data = s->rxb.insert(p);
+	// Under memory pressure, do not buffer out-of-order data. Collapse the
+	// RX buffer instead and let the duplicate ACK below trigger recovery.
+	int data;
+	bool ofo = (TCP_SEQ(th) != s->rcv_nxt);
+	if (unlikely(ofo && TCPMemory::under_pressure())) {
+		TCPInfo::mem_reclaim();
+		TCPMemory::Core &m = TCPMemory::core();
+		m.ofo_pruned += 1 + s->rxb.packets();
+		s->rcv_wnd += s->rxb.purge();
+		data = -ENOBUFS;
+	}
+	else
+		// Insert packet into RX buffer and get amount of added data
+		data = s->rxb.insert(p);
 
 	// If packet is not added to the RX buffer, kill it as it is a duplicate
 	if (data < 0) {
@@ -77,6 +90,8 @@ TCPReordering::push(int, Packet *p)
 
 		// Reduce window with new data in RX buffer (it does not include FIN)
 		s->rcv_wnd -= data;
+		if (ofo)
+			TCPMib::inc(TCP_MIB_OFO_QUEUE);
 
 		// If gap is filled, remove a packet from RX buffer and process it
 		while ((p = s->rxb.remove(s->rcv_nxt))) {
@@ -108,7 +123,7 @@ TCPReordering::push(int, Packet *p)
 	if (!p) {
 #if HAVE_TCP_DELAYED_ACK
 		// Stop delayed ACK timer
-		s->delayed_ack_timer.unschedule();
+		s->delayed_ack_timer.cancel();
 #endif
 
 		// Create packet for the ACK
@@ -31,6 +31,7 @@
 #include <clicknet/tcp.h>
 #include "tcpresetter.hh"
 #include "tcpstate.hh"
+#include "tcpmib.hh"
 CLICK_DECLS
 
 TCPResetter::TCPResetter()
@@ -102,6 +103,9 @@ TCPResetter::smaction(Packet *p)
 		th->th_flags |= TH_ACK;
 	}
 
+	TCPMib::inc(TCP_MIB_OUT_SEGS);
+	TCPMib::inc(TCP_MIB_OUT_RSTS);
+
 	return q;
 }
 
@@ -28,6 +28,7 @@
 #include <clicknet/tcp.h>
 #include "tcprstencap.hh"
 #include "tcpstate.hh"
+#include "tcpmib.hh"
 CLICK_DECLS
 
 TCPRstEncap::TCPRstEncap()
@@ -55,10 +56,12 @@ TCPRstEncap::smaction(Packet *q)
 	th->th_off    = (sizeof(click_tcp) + TCP_OPLEN_ANNO(p)) >> 2;
 	th->th_flags2 = 0;
 	th->th_flags  = TH_RST | TH_ACK;
-	th->th_win    = htons(s->rcv_wnd >> s->rcv_wscale);
+	th->th_win    = htons(s->advertised_window());
 	th->th_sum    = 0;
 	th->th_urp    = 0;
 
+	TCPMib::inc(TCP_MIB_OUT_RSTS);
+
 	return p;
 }
 
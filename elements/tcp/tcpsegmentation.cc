@@ -37,11 +37,50 @@ TCPSegmentation::TCPSegmentation()
 {
 }
 
+// Copy @a len bytes of @a p, starting at offset @a poff, into @a q at offset
+// @a qoff, walking the segment chains of both packets
+static void
+seg_copy(Packet *q, uint32_t qoff, const Packet *p, uint32_t poff, uint32_t len)
+{
+	while (poff >= p->seg_len()) {
+		poff -= p->seg_len();
+		p = p->seg_next();
+	}
+	while (qoff >= q->seg_len()) {
+		qoff -= q->seg_len();
+		q = q->seg_next();
+	}
+
+	while (len > 0) {
+		uint32_t n = MIN(len, MIN(p->seg_len() - poff, q->seg_len() - qoff));
+		memcpy(const_cast<unsigned char *>(q->data()) + qoff, p->data() + poff, n);
+		len -= n;
+		if ((poff += n) == p->seg_len() && len > 0) {
+			p = p->seg_next();
+			poff = 0;
+		}
+		if ((qoff += n) == q->seg_len() && len > 0) {
+			q = q->seg_next();
+			qoff = 0;
+		}
+	}
+}
+
+// Number of bytes from offset @a off to the end of its segment
+static uint32_t
+seg_room(const Packet *p, uint32_t off)
+{
+	while (p && off >= p->seg_len()) {
+		off -= p->seg_len();
+		p = p->seg_next();
+	}
+	return (p ? p->seg_len() - off : 0);
+}
+
 void
 TCPSegmentation::push(int, Packet *p)
 {
-	// No support for multisegment packets for now
-	click_assert(TCP_MSS_ANNO(p) && p->segments() == 1);
+	click_assert(TCP_MSS_ANNO(p));
 
 	static int chatter = 0;
 
@@ -50,6 +89,7 @@ TCPSegmentation::push(int, Packet *p)
 	const click_tcp *th = p->tcp_header();
 	click_assert(ip && th);
 
+	uint8_t iplen = ip->ip_hl << 2;                // IP header length
 	uint8_t hlen = (ip->ip_hl + th->th_off) << 2;  // Header length
 	uint32_t len = p->length() - hlen;             // Data length
 	uint32_t seq = TCP_SEQ(th);                    // Sequence number
@@ -69,39 +109,36 @@ TCPSegmentation::push(int, Packet *p)
 		chatter++;
 	}
 
-	// TCP segmentation
+	// TCP segmentation, the data may span a chain of segments (jumbo frames)
 	for (uint32_t offset = 0; offset < len; offset += mss) {
 		bool first = (offset == 0);
 		bool last = (offset + mss >= len);
 		WritablePacket *q;
 
-		if (!last) {
-			// Create packet
-			q = Packet::make(TCP_HEADROOM, NULL, 0, mss);
+		if (last && seg_room(p, offset) >= hlen) {
+			// Reuse original packet, which is written to
+			q = p->uniqueify();
 			click_assert(q);
 
 			// Copy header
-			q = q->push(hlen);
-			click_assert(q);
-			memcpy(q->data(), p->data(), hlen);
-
-			// Copy data
-			q = q->put(mss);
-			click_assert(q);
-			memcpy(q->data() + hlen, p->data() + hlen + offset, mss);
+			seg_copy(q, offset, q, 0, hlen);
+			q = q->seg_pull(offset);
 		}
 		else {
-			// Reuse original packet
-			q = p->uniqueify();
+			// Create packet
+			q = Packet::make_chain(TCP_HEADROOM, NULL, hlen + MIN(mss, len - offset));
 			click_assert(q);
 
-			// Copy header
-			memcpy(q->data() + offset, q->data(), hlen);
-			q->pull(offset);
+			// Copy header and data
+			seg_copy(q, 0, p, 0, hlen);
+			seg_copy(q, hlen, p, hlen + offset, q->length() - hlen);
+
+			if (last)
+				p->kill();
 		}
 
 		// Set IP header
-		q->set_ip_header((click_ip *)q->data(), ip->ip_hl << 2);
+		q->set_ip_header((click_ip *)q->data(), iplen);
 
 		// Get TCP header pointer
 		click_tcp *th = q->tcp_header();
@@ -45,6 +45,8 @@ and the TCP sequence number is updated. If TCP options are present, the MSS is
 reduced to not exceed the MTU. If the SYN flag is active in the original packet,
 it will only be active in the first segment. Similarly, if the FIN flag is
 active in the original packet, it will only be active in the last segment.
+The incoming packet may be a chain of segments (e.g., a jumbo frame spread
+over several DPDK mbufs), and so may the resulting packets.
 
 =e
 
@@ -45,7 +45,7 @@ TCPSetMssAnno::configure(Vector<String> &conf, ErrorHandler *errh)
 		.complete() < 0)
 		return -1;
 
-	if (_mss > 1460)
+	if (_mss > TCP_SND_MSS_MAX)
 		return errh->error("MSS out of range");
 
 	return 0;
@@ -34,6 +34,8 @@
 #include "tcptimers.hh"
 #include "tcpstate.hh"
 #include "tcpinfo.hh"
+#include "tcpmib.hh"
+#include "tcptrace.hh"
 #include "tcplist.hh"
 #include "tcpackoptionsencap.hh"
 #include "util.hh"
@@ -44,6 +46,21 @@ TCPSocket *TCPSocket::_socket = NULL;
 static uint8_t key_be[RSS_HASH_KEY_LENGTH];
 #endif // HAVE_DPDK
 
+// Linux numbering of the TCP states for TCP_INFO, indexed by our own
+static const uint8_t tcpi_state[] = {
+	7,   // TCP_CLOSED      -> TCP_CLOSE
+	10,  // TCP_LISTEN      -> TCP_LISTEN
+	2,   // TCP_SYN_SENT    -> TCP_SYN_SENT
+	3,   // TCP_SYN_RECV    -> TCP_SYN_RECV
+	1,   // TCP_ESTABLISHED -> TCP_ESTABLISHED
+	4,   // TCP_FIN_WAIT1   -> TCP_FIN_WAIT1
+	5,   // TCP_FIN_WAIT2   -> TCP_FIN_WAIT2
+	11,  // TCP_CLOSING     -> TCP_CLOSING
+	6,   // TCP_TIME_WAIT   -> TCP_TIME_WAIT
+	8,   // TCP_CLOSE_WAIT  -> TCP_CLOSE_WAIT
+	9,   // TCP_LAST_ACK    -> TCP_LAST_ACK
+};
+
 TCPSocket::TCPSocket()
 {
 }
@@ -266,7 +283,26 @@ TCPSocket::setsockopt(int pid, int sockfd, int level, int optname, const void *o
 			}
 
 			snd_mss = (uint16_t*) optval;
-			s->snd_mss = MIN(*snd_mss, TCP_SND_MSS_MAX);
+			s->snd_mss = MIN(*snd_mss, TCPInfo::mss());
+			break;
+
+		case TCP_CORK:
+		case TCP_COALESCE:
+			if (optlen < sizeof(int)) {
+				errno = EINVAL;
+				return -1;
+			}
+
+			if (optname == TCP_COALESCE)
+				s->snd_coalesce = (*(const int *)optval != 0);
+			else if (*(const int *)optval)
+				s->snd_cork = true;
+			else if (s->snd_cork) {
+				// Uncorking sends out the partial segment held back
+				s->snd_cork = false;
+				if (!s->txq.empty())
+					tx_trigger(s);
+			}
 			break;
 
 		default:
@@ -295,7 +331,7 @@ TCPSocket::setsockopt(int pid, int sockfd, int level, int optname, const void *o
 }
 
 int
-TCPSocket::getsockopt(int pid, int sockfd, int level, int optname, const void *optval, socklen_t optlen)
+TCPSocket::getsockopt(int pid, int sockfd, int level, int optname, void *optval, socklen_t *optlen)
 {
 #if CLICK_STATS >= 2
 	click_cycles_t start_cycles = click_get_cycles();
@@ -318,14 +354,20 @@ TCPSocket::getsockopt(int pid, int sockfd, int level, int optname, const void *o
 		return -1;
 	}
 
+	if (unlikely(!optval || !optlen)) {
+		errno = EFAULT;
+		return -1;
+	}
+
 	if( level == SOL_SOCKET){
 		switch (optname) {
 		case SO_LINGER:
 			struct linger *ling;
-			if (optlen < sizeof(struct linger)) {
+			if (*optlen < sizeof(struct linger)) {
 				errno = EINVAL;
 				return -1;
 			}
+			*optlen = sizeof(struct linger);
 
 			ling = (struct linger*) optval;
 			if (ling->l_linger != 0) {
@@ -349,15 +391,57 @@ TCPSocket::getsockopt(int pid, int sockfd, int level, int optname, const void *o
 		
 		case TCP_MAXSEG:
 			uint16_t *snd_mss;
-			if (optlen < sizeof(uint16_t)) {
+			if (*optlen < sizeof(uint16_t)) {
 				errno = EINVAL;
 				return -1;
 			}
+			*optlen = sizeof(uint16_t);
 
 			snd_mss = (uint16_t*) optval;
 			*snd_mss = s->snd_mss;
 			break;
+
+		case TCP_CORK:
+		case TCP_COALESCE:
+			if (*optlen < sizeof(int)) {
+				errno = EINVAL;
+				return -1;
+			}
+			*optlen = sizeof(int);
+
+			*(int *)optval = (optname == TCP_CORK ? s->snd_cork : s->snd_coalesce);
+			break;
 			
+		case TCP_INFO: {
+			// Fill in what the stack tracks, leave the rest zeroed
+			struct tcp_info ti;
+			memset(&ti, 0, sizeof(ti));
+
+			ti.tcpi_state          = tcpi_state[s->state];
+			ti.tcpi_retransmits    = s->snd_rtx_count;
+			ti.tcpi_snd_wscale     = s->snd_wscale;
+			ti.tcpi_rcv_wscale     = s->rcv_wscale;
+			ti.tcpi_rto            = s->snd_rto * 1000;
+			ti.tcpi_snd_mss        = s->snd_mss;
+			ti.tcpi_rcv_mss        = s->rcv_mss;
+			ti.tcpi_unacked        = s->rtxq.packets();
+			ti.tcpi_rtt            = s->snd_srtt;
+			ti.tcpi_rttvar         = s->snd_rttvar;
+			ti.tcpi_snd_ssthresh   = s->snd_ssthresh / MAX(s->snd_mss, 1);
+			ti.tcpi_snd_cwnd       = s->snd_cwnd / MAX(s->snd_mss, 1);
+			ti.tcpi_total_retrans  = s->snd_rtx_total;
+			ti.tcpi_bytes_acked    = s->snd_acked_total;
+#if BBR_ENABLED
+			if (s->rate_interval_us > 0)
+				ti.tcpi_delivery_rate = (uint64_t)s->rate_delivered * s->snd_mss *
+				                        1000000 / s->rate_interval_us;
+#endif
+
+			*optlen = MIN(*optlen, (socklen_t)sizeof(ti));
+			memcpy(optval, &ti, *optlen);
+			break;
+		}
+
 		default:
 			errno = EOPNOTSUPP;
 			return -1;
@@ -391,6 +475,14 @@ TCPSocket::rss_hash(IPFlowID flow)
 	return rte_softrss_be((uint32_t *)&tuple, 3, (uint8_t *)key_be);
 }
 
+int
+TCPSocket::rss_core(IPFlowID flow)
+{
+	// Core owning the flow, with the same mapping as rss_sport()
+	uint32_t hash = rss_hash(flow) & 127;
+	return mod(hash, _socket->_nthreads);
+}
+
 int
 TCPSocket::rss_sport(IPFlowID flow)
 {
@@ -597,7 +689,9 @@ TCPSocket::listen(int pid, int sockfd, int backlog)
 	s->flow.set_daddr(IPAddress());
 	s->flow.set_dport(0);
 	s->backlog = backlog;
+	uint8_t prev = s->state;
 	s->state = TCP_LISTEN;
+	TCPTrace::record(TCP_TRACE_STATE, s, prev);
 
 	// Insert flow in the table
 	int r = TCPInfo::flow_insert(s);
@@ -792,13 +886,17 @@ TCPSocket::connect(int pid, int sockfd, IPAddress daddr, uint16_t dport)
 	f.set_daddr(daddr);
 	f.set_dport(htons(dport));
 
+	TCPMib::inc(TCP_MIB_ACTIVE_OPENS);
+
 	// Initialize TCB
+	uint8_t prev = s->state;
 	s->state      = TCP_SYN_SENT;
 	s->flow       = f;
 	s->snd_isn    = click_random(0, 0xFFFFFFFFU);
 	s->snd_una    = s->snd_isn;
 	s->snd_nxt    = s->snd_isn + 1;
 	s->is_passive = false;
+	TCPTrace::record(TCP_TRACE_STATE, s, prev);
 
 	// Reset retranstission timeout
 	s->snd_rto = TCP_RTO_INIT;
@@ -886,7 +984,7 @@ TCPSocket::connect(int pid, int sockfd, IPAddress daddr, uint16_t dport)
 }
 
 int
-TCPSocket::send(int pid, int sockfd, const char *buffer, size_t length)
+TCPSocket::send(int pid, int sockfd, const char *buffer, size_t length, int flags)
 {
 #if CLICK_STATS >= 2
 	click_cycles_t start_cycles = click_get_cycles();
@@ -983,34 +1081,34 @@ TCPSocket::send(int pid, int sockfd, const char *buffer, size_t length)
 		// We allow zero-length and null-buffer send() calls for nonblocking 
 		// sockets to know if there is enough space in the TX queue w/o poll()
 		if (buffer && length > 0) {
-			// Effective MSS when TCP options have maximum length
-			uint16_t mss = s->snd_mss - TCPAckOptionsEncap::min_oplen(s);
-
-			// Segmentation
-			for (uint32_t offset = 0; offset < length; offset += mss) {
-				const char *data = buffer + offset;
-				uint32_t len = MIN(mss, length - offset);
-
-				// Create the packet
-				WritablePacket *p = Packet::make(TCP_HEADROOM, data, len, 0);
-				if (!p) {
-					errno = ENOMEM;
+			// Refuse new data above the memory limit instead of exhausting
+			// the packet pool
+			if (unlikely(TCPMemory::over_limit())) {
+				TCPInfo::mem_reclaim();
+				if (TCPMemory::over_limit()) {
+					TCPMemory::core().send_refused++;
+					errno = ENOBUFS;
 					return -1;
 				}
+			}
+
+			// Segment into the TX queue, and if the pool is exhausted,
+			// return how much was queued so far with errno set, as the
+			// queued segments cannot be taken back once they are sent
+			size_t queued = s->txq_append(buffer, length, flags & MSG_MORE);
 
-				// Insert it into the TX queue
-				s->txq.push_back(p);
+			if (unlikely(queued < length)) {
+				errno = ENOBUFS;
+				if (queued == 0)
+					return -1;
+				length = queued;
 			}
 
-			// Send an empty packet to trigger a potential transmission
-			// Do not clear the annotations, as packet will be killed
-			WritablePacket *q = 
-			             Packet::make(TCP_HEADROOM, NULL, 0, s->snd_mss, false);
-			SET_TCP_STATE_ANNO(q, (uint64_t)s);
+			// Trigger a potential transmission
 #if CLICK_STATS >= 2
 			delta += (click_get_cycles() - start_cycles);
 #endif
-			_socket->output(TCP_SOCKET_OUT_TXT_PORT).push(q);
+			tx_trigger(s);
 #if CLICK_STATS >= 2
 			start_cycles = click_get_cycles();
 #endif
@@ -1105,6 +1203,16 @@ TCPSocket::push(int pid, int sockfd, Packet *p)
 		}
 	}
 
+	// Refuse new data above the memory limit, the caller keeps the packets
+	if (unlikely(TCPMemory::over_limit())) {
+		TCPInfo::mem_reclaim();
+		if (TCPMemory::over_limit()) {
+			TCPMemory::core().send_refused++;
+			errno = ENOBUFS;
+			return -1;
+		}
+	}
+
 	if (TCPInfo::cong_control() == 2)
 		s->rs->rate_check_app_limited(s);
 
@@ -1339,6 +1447,12 @@ TCPSocket::pull(int pid, int sockfd, int npkts)
 		return NULL;
 	}
 
+	// Data received on a spliced connection belongs to its peer
+	if (unlikely(s->splice_to && !s->rxq.empty())) {
+		errno = EAGAIN;
+		return NULL;
+	}
+
 	switch (s->state) {
 	case TCP_CLOSED:
 		errno = ENOTCONN;
@@ -1459,6 +1573,73 @@ TCPSocket::pull(int pid, int sockfd, int npkts)
 	return NULL;
 }
 
+int
+TCPSocket::splice(int pid, int fd_in, int fd_out)
+{
+	errno = 0;
+
+	// Check if pid exists
+	if (unlikely(!TCPInfo::pid_valid(pid))) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	// Get states
+	TCPState *s = TCPInfo::sock_lookup(pid, fd_in);
+	TCPState *t = TCPInfo::sock_lookup(pid, fd_out);
+
+	// Check if both sockfds exist
+	if (unlikely(!s || !t)) {
+		errno = EBADF;
+		return -1;
+	}
+
+	// Each direction can only be spliced once
+	if (unlikely(s == t || s->splice_to || t->splice_from)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (unlikely((s->state != TCP_ESTABLISHED && s->state != TCP_CLOSE_WAIT) ||
+	             (t->state != TCP_ESTABLISHED && t->state != TCP_CLOSE_WAIT))) {
+		errno = ENOTCONN;
+		return -1;
+	}
+
+	s->splice_to = t;
+	t->splice_from = s;
+	TCPMib::inc(TCP_MIB_SPLICES);
+
+	// Forward what was received before the splice
+	splice_forward(s);
+
+	return 0;
+}
+
+void
+TCPSocket::splice_forward(TCPState *s)
+{
+	TCPState *t = s->splice_to;
+
+	if (!s->splice_move())
+		return;
+
+	// Trigger a transmission on the peer
+	tx_trigger(t);
+}
+
+void
+TCPSocket::tx_trigger(TCPState *s)
+{
+	// Send an empty packet to trigger a potential transmission
+	// Do not clear the annotations, as packet will be killed
+	WritablePacket *q = Packet::make(TCP_HEADROOM, NULL, 0, s->snd_mss, false);
+	if (likely(q)) {
+		SET_TCP_STATE_ANNO(q, (uint64_t)s);
+		_socket->output(TCP_SOCKET_OUT_TXT_PORT).push(q);
+	}
+}
+
 int
 TCPSocket::fsync(int pid, int sockfd)
 {
@@ -1568,6 +1749,9 @@ TCPSocket::close(int pid, int sockfd)
 		return -1;
 	}
 
+	// Stop moving data to or from a spliced peer
+	s->splice_unlink();
+
 	// Lock state
 	switch (s->state) {
 	case TCP_CLOSED:
@@ -1593,7 +1777,9 @@ TCPSocket::close(int pid, int sockfd)
 		//  responses.  Delete TCB, enter CLOSED state, and return."
 
 		// Stop listening to new connections
+		uint8_t prev = s->state;
 		s->state = TCP_CLOSED;
+		TCPTrace::record(TCP_TRACE_STATE, s, prev);
 
 		// Clear descriptors in the accept queue but not yet accept()'ed
 		for (TCPState *t = s->acq_front(); t != s; t = t->acq_next) {
@@ -1646,7 +1832,9 @@ TCPSocket::close(int pid, int sockfd)
 		// This should only be possible in nonblocking sockets
 		click_assert(s->flags & SOCK_NONBLOCK);
 
+		uint8_t prev = s->state;
 		s->state = TCP_CLOSED;
+		TCPTrace::record(TCP_TRACE_STATE, s, prev);
 
 		// Stop retransmission timer and flush RTX queue
 		s->stop_timers();
@@ -1703,6 +1891,11 @@ TCPSocket::close(int pid, int sockfd)
 		// If SOCK_LINGER not set (only SO_LINGER {on, 0} supported) wait until the TX queue is empty (or return EAGAIN if nonblocking)
 		int ret = 0;
 		if (!(s->flags & SOCK_LINGER)) {
+			// Push out a partial segment held back by TCP_CORK or MSG_MORE
+			if ((s->snd_cork || s->snd_more) && !s->txq.empty()) {
+				s->snd_cork = s->snd_more = false;
+				tx_trigger(s);
+			}
 		      ret = s->wait_event(TCP_WAIT_TXQ_EMPTY);
 #if CLICK_STATS >= 2
 		start_cycles = click_get_cycles() ;
@@ -1718,10 +1911,12 @@ TCPSocket::close(int pid, int sockfd)
 		      }
 		}
 		
+		uint8_t prev = s->state;
 		if (s->state == TCP_ESTABLISHED)
 			s->state = TCP_FIN_WAIT1;
 		else
 			s->state = TCP_LAST_ACK;
+		TCPTrace::record(TCP_TRACE_STATE, s, prev);
 
 		WritablePacket *p = Packet::make(TCP_HEADROOM, NULL, 0, 0);
 		click_assert(p);
@@ -93,6 +93,9 @@ CLICK_DECLS
 #define TCP_SOCKET_OUT_TXT_PORT 3
 #define TCP_SOCKET_OUT_USR_PORT 4
 
+// SOL_TCP option to coalesce small writes into full segments in the TX queue
+#define TCP_COALESCE 0x4001
+
 class TCPSocket final : public Element { public:
 
 	TCPSocket() CLICK_COLD;
@@ -115,16 +118,19 @@ class TCPSocket final : public Element { public:
 	static int listen(int pid, int sockfd, int backlog);
 	static int accept(int pid, int sockfd, IPAddress &addr, uint16_t &port);
 	static int connect(int pid, int sockfd, IPAddress addr, uint16_t port);
-	static int send(int pid, int sockfd, const char *msg, size_t len);
+	static int send(int pid, int sockfd, const char *msg, size_t len, int flags = 0);
 	static int recv(int pid, int sockfd, char *msg, size_t len);
 	static int close(int pid, int sockfd);
 	static int fsync(int pid, int sockfd);
 	static int setsockopt(int pid, int sockfd, int level, int optname, const void *optval, socklen_t optlen);
-	static int getsockopt(int pid, int sockfd, int level, int optname, const void *optval, socklen_t optlen);
+	static int getsockopt(int pid, int sockfd, int level, int optname, void *optval, socklen_t *optlen);
 
 	// Zero-copy API
 	static int push(int pid, int sockfd, Packet *p);
 	static Packet *pull(int pid, int sockfd, int npkts = 1);
+	static int splice(int pid, int fd_in, int fd_out);
+	static void splice_forward(TCPState *s);
+	static void tx_trigger(TCPState *s);
 	
 	//State modifications
 	static int set_task(int pid, int sockfd, BlockingTask * t);
@@ -133,6 +139,7 @@ class TCPSocket final : public Element { public:
 	//RSS API
 	static int rss_sport(IPFlowID flow);
 	static uint32_t rss_hash(IPFlowID flow);
+	static int rss_core(IPFlowID flow);
 #endif
 
 	// Socket event handling API
@@ -28,6 +28,9 @@
 #include "tcpstate.hh"
 #include "tcpinfo.hh"
 #include "tcptrimpacket.hh"
+#include "tcptxcredit.hh"
+#include "tcpmib.hh"
+#include "tcpackoptionsencap.hh"
 CLICK_DECLS
 
 //static DPDKAllocator *pool[CLICK_CPU_MAX] = { 0 };
@@ -45,14 +48,16 @@ TCPState::TCPState(const IPFlowID &f)
     snd_wscale(0),
     rcv_wscale(0),
     snd_mss(TCP_SND_MSS_MIN),
-    rcv_mss(TCP_RCV_MSS_DEFAULT), 
+    rcv_mss(TCPInfo::mss()),
     acq_size(0),
     backlog(0),
     snd_nxt(0),
     rcv_nxt(0),
     rcv_wnd(0),
+    rcv_adv(0),
     acq_next(this),
     acq_prev(this),
+    txs_owner(NULL),
     snd_wnd(0),
     snd_wl1(0),
     snd_wl2(0),
@@ -75,6 +80,14 @@ TCPState::TCPState(const IPFlowID &f)
     ts_recent_update(0),
     snd_srtt(0),
     snd_rttvar(0),
+    snd_acked_total(0),
+    snd_rtx_total(0),
+    splice_to(NULL),
+    splice_from(NULL),
+    l2_refresh(0),
+    l2_gen(0),
+    home(-1),
+    pool_owner(click_current_cpu_id()),
     pid(-1),
     sockfd(-1),
     epfd(-1),
@@ -86,6 +99,9 @@ TCPState::TCPState(const IPFlowID &f)
     snd_keepalive_count(0),
 #endif
     snd_rtx_count(0),
+    snd_coalesce(false),
+    snd_cork(false),
+    snd_more(false),
     event(NULL)
 {
 }
@@ -111,9 +127,192 @@ TCPState::allocate()
 void
 TCPState::deallocate(TCPState *s)
 {
-    unsigned c = click_current_cpu_id();
-    if (pool[c])
+	unsigned c = click_current_cpu_id();
+	unsigned o = s->pool_owner;
+
+	// A migrated TCB goes back to the pool of the core that allocated it
+	if (o == c)
 		pool[c]->deallocate(s);
+	else
+		pool[o]->deallocate_remote(s);
+}
+
+// Move in-order data from the RX queue of a spliced connection to the TX
+// queue of its peer while the peer has room. The receive window reopens only
+// for the data moved, so the sender is paced by the peer's send buffer.
+uint32_t
+TCPState::splice_move()
+{
+	TCPState *t = splice_to;
+	uint32_t wmem = TCPInfo::wmem();
+	uint32_t moved = 0;
+
+	if (t->state != TCP_ESTABLISHED && t->state != TCP_CLOSE_WAIT)
+		return 0;
+
+	while (!rxq.empty()) {
+		Packet *p = rxq.front();
+		uint32_t len = p->length();
+		if (t->txq.bytes() + len > wmem)
+			break;
+
+		rxq.pop_front();
+		rcv_wnd += len;
+		moved += len;
+		p->clear_annotations();
+
+		// Segments may be larger than the peer's MSS
+		uint16_t mss = t->snd_mss - TCPAckOptionsEncap::min_oplen(t);
+		while (len > mss) {
+			Packet *c = p->clone();
+			if (!c)
+				break;
+			c->take(len - mss);
+			t->txq.push_back(c);
+			p->pull(mss);
+			len -= mss;
+		}
+		t->txq.push_back(p);
+	}
+
+	if (moved) {
+		TCPMib::add(TCP_MIB_SPLICED_BYTES, moved);
+
+		// A FIN received behind the data can now be delivered to the user
+		if (rxq.empty() && state != TCP_ESTABLISHED && state != TCP_FIN_WAIT1 &&
+		    state != TCP_FIN_WAIT2)
+			wake_up(TCP_WAIT_FIN_RECEIVED);
+	}
+
+	return moved;
+}
+
+void
+TCPState::txq_unstall()
+{
+	TCPTxCredit::unstall(this);
+}
+
+// Queue user data for transmission. If writes are coalesced, data is first
+// appended to the segment at the tail of the TX queue while it is shorter
+// than the MSS, and new segments keep tailroom for later writes. Returns the
+// number of bytes queued, which is short only if the packet pool runs out.
+uint32_t
+TCPState::txq_append(const char *data, uint32_t len, bool more)
+{
+	// Effective MSS when TCP options have maximum length
+	uint16_t mss = snd_mss - TCPAckOptionsEncap::min_oplen(this);
+	bool coalesce = (snd_coalesce || snd_cork || snd_more || more);
+	uint32_t offset = 0;
+
+	Packet *b = txq.back();
+	if (coalesce && b && b->length() < mss) {
+		offset = txq.append(b, data, MIN(len, (uint32_t)(mss - b->length())));
+		if (offset)
+			TCPMib::inc(TCP_MIB_TX_COALESCED);
+	}
+
+	// Segmentation
+	for (; offset < len; offset += mss) {
+		uint32_t n = MIN((uint32_t)mss, len - offset);
+		uint32_t tailroom = (coalesce ? mss - n : 0);
+
+		WritablePacket *p = Packet::make_chain(TCP_HEADROOM, data + offset, n, tailroom);
+		if (unlikely(!p))
+			return offset;
+
+		txq.push_back(p);
+	}
+
+	snd_more = more;
+	return len;
+}
+
+// Dequeue the next segment to transmit, sized to the current MSS. With
+// coalescing, a short segment is topped up with the data queued behind it,
+// and a short segment at the tail is held back while the socket is corked.
+Packet *
+TCPState::txq_segment()
+{
+	uint16_t mss = snd_mss - TCPAckOptionsEncap::min_oplen(this);
+	bool coalesce = (snd_coalesce || snd_cork || snd_more);
+	Packet *p = txq.front();
+
+	while (coalesce && p->length() < mss && p->next() != p) {
+		Packet *q = p->next();
+		uint32_t n = MIN((uint32_t)(mss - p->length()), q->length());
+		if (q->segments() > 1 || !(n = txq.append(p, q->data(), n)))
+			break;
+
+		txq.pop_front();
+		if (n == q->length()) {
+			txq.pop_front();
+			q->kill();
+		}
+		else
+			txq.pull_front(n);
+		txq.push_front(p);
+	}
+
+	if (p->length() < mss && p->next() == p && (snd_cork || snd_more))
+		return NULL;
+
+	txq.pop_front();
+
+	// Split a segment queued for a larger MSS
+	if (unlikely(p->length() > mss)) {
+		if (Packet *c = p->clone()) {
+			c = c->seg_pull(mss);
+			txq.push_front(c);
+			p->seg_take(p->length() - mss);
+		}
+	}
+
+	return p;
+}
+
+// Extend the retransmission of the RTX queue head @a p with the data
+// segments queued behind it, up to the MSS, so that small writes are resent
+// in fewer segments. The RTX queue itself is left as is and cleaned by ACKs.
+WritablePacket *
+TCPState::rtx_collapse(WritablePacket *p)
+{
+	uint16_t mss = snd_mss - TCPAckOptionsEncap::min_oplen(this);
+	click_ip *ip = p->ip_header();
+	const click_tcp *th = p->tcp_header();
+	if (TCP_SYN(th) || TCP_FIN(th) || p->segments() > 1)
+		return p;
+
+	Packet *h = rtxq.front();
+	uint32_t len = TCP_LEN(ip, th);
+	uint32_t added = 0;
+	uint32_t merged = 0;
+
+	for (Packet *q = h->next(); q != h; q = q->next()) {
+		const click_ip *qip = q->ip_header();
+		const click_tcp *qth = q->tcp_header();
+		uint32_t n = TCP_LEN(qip, qth);
+
+		if (TCP_SYN(qth) || TCP_FIN(qth) || TCP_SACK_FLAG_ANNO(q) || q->segments() > 1)
+			break;
+		if (len + n > mss || p->tailroom() < n)
+			break;
+
+		const unsigned char *data = q->transport_header() + (qth->th_off << 2);
+		p = p->put(n);
+		memcpy(p->end_data() - n, data, n);
+		len += n;
+		added += n;
+		merged++;
+	}
+
+	if (merged) {
+		ip = p->ip_header();
+		ip->ip_len = htons(ntohs(ip->ip_len) + added);
+		TCPMib::add(TCP_MIB_RETRANS_COLLAPSED, merged);
+	}
+
+	return p;
 }
 
 bool
@@ -168,11 +367,11 @@ TCPState::clean_rtx_queue(uint32_t ack, bool verbose)
 	//        retransmission timer so that it will expire after RTO seconds
 	//        (for the current value of RTO).
 	if (rtxq.empty()) {
-		rtx_timer.unschedule();
+		rtx_timer.cancel();
 		wake_up(TCP_WAIT_RTXQ_EMPTY);
 	}
 	else if (removed)
-		rtx_timer.schedule_after_msec(snd_rto);
+		rtx_timer.defer_after_msec(snd_rto);
 
 	return removed;
 }
@@ -313,5 +512,5 @@ TCPState::wait_event_check(int ev)
 }
 
 CLICK_ENDDECLS
-ELEMENT_REQUIRES(PktQueue TCPBuffer)
+ELEMENT_REQUIRES(PktQueue TCPBuffer TCPTxCredit)
 ELEMENT_PROVIDES(TCPState)
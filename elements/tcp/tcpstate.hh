@@ -29,6 +29,7 @@
 #include <click/ipflowid.hh>
 #include <click/packet.hh>
 #include <click/timer.hh>
+#include <click/list.hh>
 #include <click/string.hh>
 #include <click/straccum.hh>
 #include <click/tcpanno.hh>
@@ -51,6 +52,7 @@ CLICK_DECLS
 class TCPFlowTable;
 class BBRState;
 class RateSample;
+class TCPRateControl;
 
 const uint8_t TCP_CLOSED      =  0;
 const uint8_t TCP_LISTEN      =  1;
@@ -90,8 +92,16 @@ class TCPState { public:
 
 	inline uint32_t available_tx_window() const;
 	inline uint32_t available_rx_window() const;
+	inline uint16_t advertised_window();
+	inline void update_rtt(uint32_t rtt);
 
 	inline void flush_queues();
+	void txq_unstall();
+	uint32_t txq_append(const char *data, uint32_t len, bool more);
+	Packet *txq_segment();
+	WritablePacket *rtx_collapse(WritablePacket *p);
+	uint32_t splice_move();
+	inline void splice_unlink();
 	inline void stop_timers();
 
 	inline int unparse(char *s) const;
@@ -154,9 +164,13 @@ class TCPState { public:
 	//                                    +RCV.WND        
 	uint32_t rcv_nxt;                   // receive next
 	uint32_t rcv_wnd;                   // receive window
+	uint32_t rcv_adv;                   // right edge last advertised
 	
 	TCPState *acq_next;                 // next TCB in accept queue
 	TCPState *acq_prev;                 // prev TCB in accept queue
+
+	List_member<TCPState> txs_link;     // link in the TX stall list
+	TCPRateControl *txs_owner;          // element resuming TX, if stalled
 	
 	uint32_t snd_wnd;                   // send window
 	uint32_t snd_wl1;                   // seqno used for last window update
@@ -189,6 +203,8 @@ class TCPState { public:
 
 	uint32_t snd_srtt;                  // smoothed RTT
 	uint32_t snd_rttvar;                // RTT variance
+	uint64_t snd_acked_total;           // bytes acked since the start
+	uint32_t snd_rtx_total;             // segments retransmitted
 
 	TCPBuffer rxb;                      // RX buffer
 	PktQueue  rxq;                      // RX queue
@@ -196,6 +212,16 @@ class TCPState { public:
 	PktQueue  txq;                      // TX queue
 	PktQueue rtxq;                      // RTX queue
 
+	TCPState *splice_to;                // peer TX queue fed by our RX queue
+	TCPState *splice_from;              // peer RX queue feeding our TX queue
+
+	uint64_t l2_refresh;                // when to send through ARPQuerier
+	uint32_t l2_gen;                    // ARP table generation of l2_hdr
+	click_ether l2_hdr;                 // cached Ethernet header to the peer
+
+	int home;                           // core receiving a migrated flow, or -1
+	int pool_owner;                     // core whose pool the TCB came from
+
 
 	int pid;
 	int sockfd;
@@ -252,9 +278,9 @@ class TCPState { public:
 	uint16_t  snd_rtx_count;             // number of retx for the HOL packet
 
 	uint8_t  bind_address_no_port:1,     // disable port binding when port = 0 
-	         unused4:1,  
-	         unused5:1,  
-	         unused6:1,  
+	         snd_coalesce:1,             // append writes to the TX queue tail
+	         snd_cork:1,                 // TCP_CORK, hold partial segments
+	         snd_more:1,                 // last send() had MSG_MORE
 	         unused7:1,
 	         unused8:1,
 		 unused9:1,
@@ -340,6 +366,45 @@ TCPState::available_rx_window() const
 	return (rcv_wnd > in_buffer ? rcv_wnd - in_buffer : 0);
 }
 
+inline uint16_t
+TCPState::advertised_window()
+{
+	// Under memory pressure, stop opening the window beyond a few segments.
+	// RCV.WND itself is untouched, so data already in flight is accepted.
+	uint32_t wnd = TCPMemory::clamp_window(rcv_wnd, rcv_mss);
+
+	// But never move the right edge left (RFC 7323, Section 2.4), up to the
+	// loss of precision of window scaling
+	uint32_t edge = rcv_adv - rcv_nxt;
+	if (edge > wnd && edge <= rcv_wnd)
+		wnd = edge;
+
+	uint16_t win = MIN(wnd >> rcv_wscale, 65535);
+	rcv_adv = rcv_nxt + ((uint32_t)win << rcv_wscale);
+	return win;
+}
+
+// Update SRTT, RTTVAR, and RTO with an RTT sample in usec (RFC 6298)
+inline void
+TCPState::update_rtt(uint32_t rtt)
+{
+#if BBR_ENABLED
+	last_rtt = rtt;
+#endif
+	uint32_t rto;
+	if (unlikely(snd_srtt == 0)) {
+		snd_srtt = rtt;
+		snd_rttvar = (rtt >> 1);
+		rto = 3*rtt;
+	}
+	else {
+		snd_rttvar = ((3*snd_rttvar + absdiff(snd_srtt, rtt)) >> 2);
+		snd_srtt = ((7*snd_srtt + rtt) >> 3);
+		rto = snd_srtt + MAX(1, (snd_rttvar << 2));
+	}
+	snd_rto = MIN(MAX(TCP_RTO_MIN, rto/1000), TCP_RTO_MAX);
+}
+
 // RFC 793:
 // "There are four cases for the acceptability test for an incoming
 //  segment:
@@ -407,9 +472,25 @@ TCPState::bound() const
 	return flow.saddr() && flow.sport();
 }
 
+inline void
+TCPState::splice_unlink()
+{
+	if (splice_to) {
+		splice_to->splice_from = NULL;
+		splice_to = NULL;
+	}
+	if (splice_from) {
+		splice_from->splice_to = NULL;
+		splice_from = NULL;
+	}
+}
+
 inline void
 TCPState::flush_queues()
 {
+	if (txs_owner)
+		txq_unstall();
+	splice_unlink();
 	txq.flush();
 	rxq.flush();
 	rtxq.flush();
@@ -28,6 +28,7 @@
 #include <clicknet/tcp.h>
 #include "tcpsynoptionsencap.hh"
 #include "tcpstate.hh"
+#include "tcpclock.hh"
 CLICK_DECLS
 
 TCPSynOptionsEncap::TCPSynOptionsEncap()
@@ -89,7 +90,7 @@ TCPSynOptionsEncap::smaction(Packet *q)
 		// Get now, preferably from packet timestamp
 		uint32_t now = (uint32_t)p->timestamp_anno().usecval();
 		if (now == 0)
-			now = (uint32_t)Timestamp::now_steady().usecval();
+			now = (uint32_t)TCPClock::now_usec();
 
 		// TCP timestamp
 		ptr[0] = TCPOPT_TIMESTAMP;
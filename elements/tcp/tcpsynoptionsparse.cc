@@ -30,6 +30,7 @@
 #include "tcpinfo.hh"
 #include "tcpstate.hh"
 #include "util.hh"
+#include "tcpclock.hh"
 CLICK_DECLS
 
 TCPSynOptionsParse::TCPSynOptionsParse()
@@ -79,7 +80,7 @@ TCPSynOptionsParse::smaction(Packet *p)
 		case TCPOPT_MAXSEG:           // MSS
 			if (likely(opsize == TCPOLEN_MAXSEG)) {
 				uint16_t mss = ntohs(*(const uint16_t *)&ptr[2]);
-				s->snd_mss = MAX(TCP_SND_MSS_MIN, MIN(mss, TCP_SND_MSS_MAX));
+				s->snd_mss = MAX(TCP_SND_MSS_MIN, MIN(mss, TCPInfo::mss()));
 			}
 			break;
 
@@ -106,7 +107,7 @@ TCPSynOptionsParse::smaction(Packet *p)
 				// Get now, preferably from packet timestamp
 				uint32_t now = (uint32_t)p->timestamp_anno().usecval();
 				if (now == 0)
-					now = (uint32_t)Timestamp::now_steady().usecval();
+					now = (uint32_t)TCPClock::now_usec();
 
 				// Get timestamp parameters
 				uint32_t ts_val = ntohl(*(const uint32_t *)&ptr[2]);
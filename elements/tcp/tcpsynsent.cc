@@ -33,6 +33,8 @@
 #include "tcpstate.hh"
 #include "tcptimer.hh"
 #include "tcpinfo.hh"
+#include "tcpmib.hh"
+#include "tcptrace.hh"
 CLICK_DECLS
 
 TCPSynSent::TCPSynSent()
@@ -84,6 +86,8 @@ TCPSynSent::smaction(Packet *p)
 		s->stop_timers();
 		s->flush_queues();
 
+		TCPMib::inc(TCP_MIB_ATTEMPT_FAILS);
+
 		// Store the error code and wake user task
 		s->notify_error(ECONNRESET);
 
@@ -133,6 +137,7 @@ TCPSynSent::smaction(Packet *p)
 //		s->rcv_nxt = s->rcv_isn + 1;
 		s->rcv_nxt = TCP_SEQ(th) + 1;
 		s->rcv_wnd = TCPInfo::rmem();
+		s->rcv_adv = s->rcv_nxt + MIN(s->rcv_wnd, 65535);
 
 		s->snd_wnd = TCP_WIN(th);
 		s->snd_wl1 = TCP_SEQ(th);
@@ -150,7 +155,9 @@ TCPSynSent::smaction(Packet *p)
 
 				s->snd_una = ack;
 
+				uint8_t prev = s->state;
 				s->state = TCP_ESTABLISHED;
+				TCPTrace::record(TCP_TRACE_STATE, s, prev);
 
 				if (s->snd_reinitialize_timer)
 					s->snd_rto = 3 * TCP_RTO_INIT;
@@ -179,7 +186,9 @@ TCPSynSent::smaction(Packet *p)
 		}
 
 		// Simultaneous open
+		uint8_t prev = s->state;
 		s->state = TCP_SYN_RECV;
+		TCPTrace::record(TCP_TRACE_STATE, s, prev);
 
 		// Stop retransmission timer
 		s->rtx_timer.unschedule();
@@ -54,10 +54,22 @@ TCPTimer::schedule_at_steady(const Timestamp &when_steady)
 	_thread->tcp_timer_set().schedule_at_steady(this, when_steady);
 }
 
+void
+TCPTimer::defer_after(const Timestamp &delta)
+{
+	_thread->tcp_timer_set().defer_at_steady(this, TCPClock::now() + delta);
+}
+
+void
+TCPTimer::defer_at_steady(const Timestamp &when_steady)
+{
+	_thread->tcp_timer_set().defer_at_steady(this, when_steady);
+}
+
 void
 TCPTimer::unschedule()
 {
-	if (scheduled())
+	if (_bucket >= 0)
 		_thread->tcp_timer_set().unschedule(this);
 }
 
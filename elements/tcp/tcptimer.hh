@@ -176,12 +176,14 @@ class TCPTimer { public:
 	 * expiry.
 	 * @param delta interval until expiration time
 	 *
-	 * If the expiration time is too far in the past, then the new expiration
-	 * time will be silently updated to the current system time.
+	 * The previous expiry is the deadline if the timer is still scheduled,
+	 * since its wheel entry may be older after a defer_at_steady(). If the
+	 * expiration time is too far in the past, then the new expiration time
+	 * will be silently updated to the current system time.
 	 *
-	 * @sa schedule_after */
+	 * @sa schedule_after, expiry_steady */
 	inline void reschedule_after(const Timestamp &delta) {
-		schedule_at_steady(_expiry + delta);
+		schedule_at_steady(expiry_steady() + delta);
 	}
 
 	/** @brief Schedule the timer to fire @a delta_sec seconds after its
@@ -211,6 +213,45 @@ class TCPTimer { public:
 		reschedule_after(Timestamp::make_usec(delta_usec));
 	}
 
+	/** @brief Move the timer's deadline to @a when_steady, lazily.
+	 * @param when_steady expiration time according to the steady clock
+	 *
+	 * If the timer is already in the timing wheel and fires no later than
+	 * @a when_steady, only its deadline is updated.  When the wheel entry
+	 * fires before the deadline, it is re-inserted at the deadline.  This
+	 * keeps the timing wheel out of the ACK path, where the RTX, keepalive
+	 * and delayed ACK timers are restarted for almost every segment.
+	 * Otherwise, this is equivalent to schedule_at_steady().
+	 *
+	 * @sa defer_after, cancel */
+	void defer_at_steady(const Timestamp &when_steady);
+
+	/** @brief Move the timer's deadline to @a delta time in the future.
+	 * @param delta interval until expiration time
+	 *
+	 * @sa defer_at_steady */
+	void defer_after(const Timestamp &delta);
+
+	/** @brief Move the timer's deadline to @a delta_msec milliseconds in the
+	 * future.
+	 * @param delta_msec interval until expiration time, in milliseconds
+	 *
+	 * @sa defer_at_steady */
+	inline void defer_after_msec(uint32_t delta_msec) {
+		defer_after(Timestamp::make_msec(delta_msec));
+	}
+
+	/** @brief Disarm the timer, leaving it in the timing wheel.
+	 *
+	 * The timer is no longer scheduled and does not fire, but its wheel
+	 * entry is only dropped when it expires, or reused by a later
+	 * defer_at_steady().  Use unschedule() if the timer is being destroyed.
+	 *
+	 * @sa unschedule */
+	inline void cancel() {
+		_deadline = Timestamp();
+	}
+
 	/** @brief Unschedule the timer.
 	 *
 	 * The timer's expiration time is not modified. */
@@ -224,7 +265,7 @@ class TCPTimer { public:
 
 	/** @brief Return true iff the timer is currently scheduled. */
 	inline bool scheduled() const {
-		return _bucket >= 0;
+		return _bucket >= 0 && _deadline;
 	}
 
 	/** @brief Return the Timer's steady-clock expiration time.
@@ -236,7 +277,7 @@ class TCPTimer { public:
 	 *
 	 * @sa expiry() */
 	inline const Timestamp &expiry_steady() const {
-		return _expiry;
+		return (scheduled() ? _deadline : _expiry);
 	}
 
 	/** @brief Return the timer's system-clock expiration time.
@@ -251,10 +292,11 @@ class TCPTimer { public:
 	 *
 	 * @sa expiry_steady() */
 	inline Timestamp expiry() const {
-		if (_expiry)
-			return _expiry + Timestamp::recent() - Timestamp::recent_steady();
+		Timestamp e = expiry_steady();
+		if (e)
+			return e + Timestamp::recent() - Timestamp::recent_steady();
 		else
-			return _expiry;
+			return e;
 	}
 
 	/** @brief Return the timer's associated Router. */
@@ -279,7 +321,8 @@ class TCPTimer { public:
 
 	List_member<TCPTimer> _link;
 	int _bucket;
-	Timestamp _expiry;
+	Timestamp _expiry;          // when the wheel entry fires
+	Timestamp _deadline;        // when the timer fires, zero if disarmed
 	TCPTimerCallback _callback;
 	void *_thunk;
 	Element *_owner;
@@ -30,6 +30,10 @@
 #include "tcptimers.hh"
 #include "tcpinfo.hh"
 #include "util.hh"
+#include "tcpclock.hh"
+#include "tcptxcredit.hh"
+#include "tcpmib.hh"
+#include "tcptrace.hh"
 CLICK_DECLS
 
 TCPTimers *TCPTimers::_t = NULL;
@@ -113,6 +117,14 @@ void TCPTimers::rtx_timer_hook(TCPTimer *t, void *data) {
 		p->set_next(NULL);
 		p->set_prev(NULL);
 
+		// Resend small segments behind the HOL packet along with it
+		p = s->rtx_collapse(p);
+
+		s->snd_rtx_total++;
+		TCPMib::inc(TCP_MIB_TIMEOUTS);
+		TCPMib::inc(TCP_MIB_RETRANS_SEGS);
+		TCPTrace::record(TCP_TRACE_RTO, s, s->snd_rtx_count);
+
 		// Send retransmission
 		_t->output(TCP_TIMERS_OUT_RTX).push(p);
 	}
@@ -131,19 +143,26 @@ void TCPTimers::tx_timer_hook(TCPTimer *t, void *data) {
 	// Head-of-line (HOL) packet
 	Packet *q = s->bbr->pcq.front();
 	if (q) {
+		// Hold paced packets while the device queue is full
+		if (TCPTxCredit::blocked()) {
+			t->reschedule_after_msec(1);
+			return;
+		}
+
 		// Send packet
 		s->bbr->pcq.pop_front();
 		if (s->bbr->pacing_rate)
-        	    s->next_send_time = (uint64_t) Timestamp::now_steady().usecval()
+        	    s->next_send_time = (uint64_t) TCPClock::now_usec()
 				+ (uint32_t) (q->seg_len() * 1000000 / s->bbr->pacing_rate);
 	        else
-	            s->next_send_time = (uint64_t) Timestamp::now_steady().usecval();
+	            s->next_send_time = (uint64_t) TCPClock::now_usec();
 		q->set_next(NULL);
 		q->set_prev(NULL);
+		TCPTrace::record(TCP_TRACE_PACE, s, s->bbr->pacing_rate);
 		_t->output(TCP_TIMERS_OUT_PACING).push(q);
 		t->reschedule_after_msec(
 				 (uint64_t)(s->next_send_time
-						- (uint64_t) Timestamp::now_steady().usecval())/1000);
+						- (uint64_t) TCPClock::now_usec())/1000);
 	}
 }
 
@@ -227,4 +246,5 @@ void TCPTimers::tw_timer_hook(TCPTimer *, void *data) {
 }
 
 CLICK_ENDDECLS
+ELEMENT_REQUIRES(TCPTxCredit)
 EXPORT_ELEMENT(TCPTimers)
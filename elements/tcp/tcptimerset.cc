@@ -27,9 +27,11 @@
 #include <click/task.hh>
 #include <click/routerthread.hh>
 #include <click/master.hh>
+#include <click/straccum.hh>
 #include <clicknet/tcp.hh>
 #include "tcptimerset.hh"
 #include "util.hh"
+#include "tcpclock.hh"
 CLICK_DECLS
 
 static double tick_msecval = 0.0;
@@ -44,6 +46,7 @@ TCPTimerSet::TCPTimerSet() : _idx(0), _size(0)
 #endif
 	_timer_stride = _max_timer_stride;
 	_timer_count = 0;
+	memset(&_stats, 0, sizeof(_stats));
 
 	_tick = Timestamp::make_msec(1);
 	tick_msecval = 1/_tick.msecval();
@@ -102,7 +105,7 @@ TCPTimerSet::run_timers(RouterThread *thread, Master *master)
 	thread->set_thread_state(RouterThread::S_RUNTIMER);
 
 	// Get now
-	Timestamp now = Timestamp::now_steady();
+	Timestamp now = TCPClock::refresh();
 
 	if (_now <= now) {
 		// Potentially adjust timer stride
@@ -127,9 +130,24 @@ TCPTimerSet::run_timers(RouterThread *thread, Master *master)
 			while (it != l.end()) {
 				TCPTimer *t = it.get();
 				it++;
+				Timestamp deadline = t->_deadline;
 				unschedule(t);
 
 				click_assert(t->_expiry == _now);
+
+				// Timer cancelled while in the wheel
+				if (!deadline) {
+					_stats.stale++;
+					continue;
+				}
+
+				// Deadline moved forward while in the wheel
+				if (deadline > _now) {
+					_stats.early++;
+					schedule_at_steady(t, deadline);
+					continue;
+				}
+
 				run_one_timer(t);
 			}
 
@@ -149,14 +167,14 @@ TCPTimerSet::schedule_at_steady(TCPTimer *t, Timestamp when_steady)
 {
 	click_assert(t);
 
-	// If timer is scheduled, remove it from timing wheel
-	if (t->scheduled())
+	// If timer is in the timing wheel, remove it
+	if (t->_bucket >= 0)
 		unschedule(t);
 
 	// If no pending timers, reset timing wheel
 	if (_size == 0) {
 		_idx = 0;
-		_now = Timestamp::now_steady().msec_ceil();
+		_now = TCPClock::now().msec_ceil();
 		t->_thread->wake();
 	}
 
@@ -180,10 +198,33 @@ TCPTimerSet::schedule_at_steady(TCPTimer *t, Timestamp when_steady)
 
 	// Save expiry
 	t->_expiry = _now + delta;
+	t->_deadline = t->_expiry;
 
 	// Update timing wheel
 	_bucket[b].push_back(t);
 	_size++;
+	_stats.inserts++;
+}
+
+void
+TCPTimerSet::defer_at_steady(TCPTimer *t, Timestamp when_steady)
+{
+	click_assert(t);
+
+	_stats.defers++;
+
+	// Round expiration time to millisecond granularity
+	when_steady = when_steady.msec_ceil();
+
+	// Keep the wheel entry if it fires first, it is re-inserted at the
+	// deadline when it expires
+	if (t->_bucket >= 0 && t->_expiry <= when_steady) {
+		t->_deadline = when_steady;
+		_stats.lazy++;
+		return;
+	}
+
+	schedule_at_steady(t, when_steady);
 }
 
 void
@@ -191,8 +232,8 @@ TCPTimerSet::unschedule(TCPTimer *t)
 {
 	click_assert(t);
 
-	// If not scheduled, return
-	if (!t->scheduled())
+	// If not in the timing wheel, return
+	if (t->_bucket < 0)
 		return;
 
 	// Get bucket
@@ -201,11 +242,38 @@ TCPTimerSet::unschedule(TCPTimer *t)
 	// Update timing wheel
 	_bucket[b].erase(t);
 	_size--;
+	_stats.removes++;
 
-	// Reset bucket
+	// Reset bucket and deadline
 	t->_bucket = -1;
+	t->_deadline = Timestamp();
 }
 
+String
+TCPTimerSet::unparse(Master *master)
+{
+	StringAccum sa;
+	Stats s;
+	memset(&s, 0, sizeof(s));
+
+	for (int i = 0; i < master->nthreads(); i++) {
+		const Stats &t = master->thread(i)->tcp_timer_set().stats();
+		s.inserts += t.inserts;
+		s.removes += t.removes;
+		s.defers += t.defers;
+		s.lazy += t.lazy;
+		s.early += t.early;
+		s.stale += t.stale;
+	}
+
+	sa << "inserts " << s.inserts << '\n';
+	sa << "removes " << s.removes << '\n';
+	sa << "defers " << s.defers << '\n';
+	sa << "defers_lazy " << s.lazy << '\n';
+	sa << "reinserts " << s.early << '\n';
+	sa << "stale " << s.stale << '\n';
+	return sa.take_string();
+}
 
 void
 TCPTimerSet::kill_router(Router *router)
@@ -28,10 +28,13 @@
 #include <click/sync.hh>
 #include <click/list.hh>
 #include <click/glue.hh>
+#include <click/string.hh>
 #include "tcptimer.hh"
+#include "tcpclock.hh"
 CLICK_DECLS
 
 class Router;
+class Master;
 class RouterThread;
 class TCPTimer;
 
@@ -52,11 +55,26 @@ class TCPTimerSet { public:
 
 	typedef List<TCPTimer, &TCPTimer::_link> TCPTimerList;
 
+	// Timing wheel operations
+	struct Stats {
+		uint64_t inserts;       // entries inserted
+		uint64_t removes;       // entries removed, including on expiry
+		uint64_t defers;        // deadline updates with defer_*()
+		uint64_t lazy;          // ... done without touching the wheel
+		uint64_t early;         // entries re-inserted at their deadline
+		uint64_t stale;         // entries of cancelled timers dropped
+	};
+
+	inline const Stats &stats() const { return _stats; }
+
+	static String unparse(Master *);
+
   private:
 
 	inline void run_one_timer(TCPTimer *);
     inline void schedule_after(TCPTimer *, Timestamp);
 	void schedule_at_steady(TCPTimer *, Timestamp);
+	void defer_at_steady(TCPTimer *, Timestamp);
     void unschedule(TCPTimer *);
 
 
@@ -70,6 +88,8 @@ class TCPTimerSet { public:
 	unsigned _timer_count;
 	unsigned _timer_stride;
 	unsigned _max_timer_stride;
+
+	Stats _stats;
 	
 #if CLICK_LINUXMODULE
 	struct task_struct *_task;
@@ -104,7 +124,7 @@ inline void
 TCPTimerSet::schedule_after(TCPTimer *t, Timestamp delta)
 {
 	assert(!delta.is_negative());
-	schedule_at_steady(t, Timestamp::now_steady() + delta);
+	schedule_at_steady(t, TCPClock::now() + delta);
 }
 
 CLICK_ENDDECLS
@@ -0,0 +1,285 @@
+/*
+ * tcptrace.{cc,hh} -- per-connection event tracing into per-core rings
+ * Rafael Laufer, Massimo Gallo
+ *
+ * Copyright (c) 2019 Nokia Bell Labs
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+ *    in the documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ */
+
+#include <click/config.h>
+#include <click/glue.hh>
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/straccum.hh>
+#include <click/router.hh>
+#include <click/master.hh>
+#include "tcptrace.hh"
+#include "tcpstate.hh"
+#include "tcpclock.hh"
+CLICK_DECLS
+
+TCPTrace *TCPTrace::_t = NULL;
+bool TCPTrace::_active = false;
+
+static const char * const event_name[TCP_TRACE_MAX] = {
+	"", "ack", "rto", "loss", "pace", "state"
+};
+
+static inline void
+make_header(TCPTraceRecord &r)
+{
+	memset(&r, 0, sizeof(r));
+	r.event = TCP_TRACE_HEADER;
+	r.value = TCP_TRACE_HEADER_VALUE;
+}
+
+TCPTrace::TCPTrace()
+	: _core(NULL), _timer(this), _file(NULL), _interval(100),
+	  _capacity(65536), _sample(1), _events(~0U), _port(0)
+{
+}
+
+int
+TCPTrace::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+	String events;
+	bool active = true;
+
+	if (_t)
+		return errh->error("TCPTrace can only be configured once");
+
+	if (Args(conf, this, errh)
+		.read("ADDRESS", _addr)
+		.read("PORT", IPPortArg(IP_PROTO_TCP), _port)
+		.read("EVENTS", AnyArg(), events)
+		.read("SAMPLE", _sample)
+		.read("CAPACITY", _capacity)
+		.read("FILENAME", FilenameArg(), _filename)
+		.read("INTERVAL", SecondsArg(3), _interval)
+		.read("ACTIVE", active)
+		.complete() < 0)
+		return -1;
+
+	if (_sample == 0)
+		return errh->error("SAMPLE must be positive");
+	if (_capacity == 0)
+		return errh->error("CAPACITY must be positive");
+
+	if (events) {
+		Vector<String> v;
+		cp_spacevec(events, v);
+
+		_events = 0;
+		for (int i = 0; i < v.size(); i++) {
+			int e;
+			for (e = 1; e < TCP_TRACE_MAX; e++)
+				if (v[i] == event_name[e])
+					break;
+			if (e == TCP_TRACE_MAX)
+				return errh->error("unknown event %s", v[i].c_str());
+			_events |= (1U << e);
+		}
+	}
+
+	_t = this;
+	_active = active;
+
+	return 0;
+}
+
+int
+TCPTrace::initialize(ErrorHandler *errh)
+{
+	int nthreads = master()->nthreads();
+
+	_core = new Core[nthreads];
+	for (int c = 0; c < nthreads; c++)
+		if (_core[c].ring.initialize(_capacity) < 0)
+			return errh->error("out of memory");
+
+	if (_filename) {
+		_file = fopen(_filename.c_str(), "w");
+		if (!_file)
+			return errh->error("%s: %s", _filename.c_str(), strerror(errno));
+
+		TCPTraceRecord h;
+		make_header(h);
+		fwrite(&h, sizeof(h), 1, _file);
+
+		_timer.initialize(this);
+		_timer.schedule_after_msec(_interval);
+	}
+
+	return 0;
+}
+
+void
+TCPTrace::cleanup(CleanupStage)
+{
+	_active = false;
+
+	if (_file && _core) {
+		drain(NULL);
+		fclose(_file);
+		_file = NULL;
+	}
+
+	delete[] _core;
+	_core = NULL;
+
+	_t = NULL;
+}
+
+void
+TCPTrace::push(uint8_t event, const TCPState *s, uint64_t value)
+{
+	if (!(_events & (1U << event)))
+		return;
+
+	const IPFlowID &f = s->flow;
+	if (_addr && f.saddr() != _addr && f.daddr() != _addr)
+		return;
+	if (_port && ntohs(f.sport()) != _port && ntohs(f.dport()) != _port)
+		return;
+
+	unsigned c = click_current_cpu_id();
+	Core &core = _core[c];
+
+	if (--core.countdown > 0)
+		return;
+	core.countdown = _sample;
+
+	TCPTraceRecord r;
+	r.tstamp       = TCPClock::now().nsecval();
+	r.value        = value;
+	r.saddr        = f.saddr().addr();
+	r.daddr        = f.daddr().addr();
+	r.sport        = f.sport();
+	r.dport        = f.dport();
+	r.event        = event;
+	r.state        = s->state;
+	r.core         = c;
+	r.snd_una      = s->snd_una;
+	r.snd_nxt      = s->snd_nxt;
+	r.snd_cwnd     = s->snd_cwnd;
+	r.snd_ssthresh = s->snd_ssthresh;
+	r.snd_wnd      = s->snd_wnd;
+	r.rcv_nxt      = s->rcv_nxt;
+	r.srtt         = s->snd_srtt;
+	r.rto          = s->snd_rto;
+
+	if (likely(core.ring.push(r)))
+		core.recorded++;
+	else
+		core.dropped++;
+}
+
+void
+TCPTrace::drain(StringAccum *sa)
+{
+	TCPTraceRecord r;
+
+	_lock.acquire();
+	for (int c = 0; c < master()->nthreads(); c++) {
+		while (_core[c].ring.pop(r)) {
+			if (sa)
+				sa->append((const char *)&r, sizeof(r));
+			else
+				fwrite(&r, sizeof(r), 1, _file);
+		}
+	}
+	if (!sa)
+		fflush(_file);
+	_lock.release();
+}
+
+void
+TCPTrace::run_timer(Timer *t)
+{
+	drain(NULL);
+	t->reschedule_after_msec(_interval);
+}
+
+enum { H_STATS, H_DRAIN, H_ACTIVE, H_FLUSH };
+
+String
+TCPTrace::read_handler(Element *e, void *thunk)
+{
+	TCPTrace *t = static_cast<TCPTrace *>(e);
+	StringAccum sa;
+
+	switch ((intptr_t)thunk) {
+	case H_STATS:
+		for (int c = 0; c < t->master()->nthreads() && t->_core; c++)
+			sa << "core " << c << " recorded " << t->_core[c].recorded
+			   << " dropped " << t->_core[c].dropped << "\n";
+		break;
+	case H_DRAIN: {
+		TCPTraceRecord h;
+		make_header(h);
+		sa.append((const char *)&h, sizeof(h));
+		if (t->_core)
+			t->drain(&sa);
+		break;
+	}
+	case H_ACTIVE:
+		sa << _active;
+		break;
+	}
+
+	return sa.take_string();
+}
+
+int
+TCPTrace::write_handler(const String &str, Element *e, void *thunk, ErrorHandler *errh)
+{
+	TCPTrace *t = static_cast<TCPTrace *>(e);
+
+	switch ((intptr_t)thunk) {
+	case H_ACTIVE: {
+		bool active;
+		if (!BoolArg().parse(str, active))
+			return errh->error("syntax error");
+		_active = active && t->_core;
+		break;
+	}
+	case H_FLUSH:
+		if (!t->_file)
+			return errh->error("no FILENAME");
+		t->drain(NULL);
+		break;
+	}
+
+	return 0;
+}
+
+void
+TCPTrace::add_handlers()
+{
+	add_read_handler("stats", read_handler, H_STATS);
+	add_read_handler("drain", read_handler, H_DRAIN);
+	add_read_handler("active", read_handler, H_ACTIVE);
+	add_write_handler("active", write_handler, H_ACTIVE);
+	add_write_handler("flush", write_handler, H_FLUSH, Handler::BUTTON);
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(TCPClock)
+EXPORT_ELEMENT(TCPTrace)
@@ -0,0 +1,172 @@
+/*
+ * tcptrace.{cc,hh} -- per-connection event tracing into per-core rings
+ * Rafael Laufer, Massimo Gallo
+ *
+ * Copyright (c) 2019 Nokia Bell Labs
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+ *    in the documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ */
+
+#ifndef CLICK_TCPTRACE_HH
+#define CLICK_TCPTRACE_HH
+#include <click/element.hh>
+#include <click/ipaddress.hh>
+#include <click/timer.hh>
+#include <click/sync.hh>
+#include "spscring.hh"
+#include "tcptracerecord.h"
+CLICK_DECLS
+
+/*
+=c
+
+TCPTrace([I<keywords> ADDRESS, PORT, EVENTS, SAMPLE, CAPACITY, FILENAME,
+INTERVAL, ACTIVE])
+
+=s tcp
+
+records per-connection TCP events into per-core rings
+
+=d
+
+At the ACK, RTO, loss, pacing and state change hooks of the stack, writes a
+fixed-size binary record with the connection state into a lock-free ring of
+the current core. Records are drained to FILENAME every INTERVAL, or through
+the "drain" handler, and can be turned into CSV with test/tcptrace.
+
+When inactive, each hook costs a single test of a static flag.
+
+Keyword arguments are:
+
+=over 8
+
+=item ADDRESS
+
+IP address. Only trace connections with this local or remote address.
+
+=item PORT
+
+Integer. Only trace connections with this local or remote port.
+
+=item EVENTS
+
+Space-separated list of events to trace among "ack", "rto", "loss", "pace",
+and "state". Default is all of them.
+
+=item SAMPLE
+
+Integer. Record only one of every SAMPLE matching events per core. Default is
+1.
+
+=item CAPACITY
+
+Integer. Number of records per core. Events are dropped when the ring is
+full. Default is 65536.
+
+=item FILENAME
+
+String. File to write the records to.
+
+=item INTERVAL
+
+Time. How often to drain the rings into FILENAME. Default is 100 msec.
+
+=item ACTIVE
+
+Boolean. Whether to start tracing right away. Default is true.
+
+=back
+
+=h stats read-only
+
+Number of records written and dropped per core.
+
+=h drain read-only
+
+Drains the rings and returns a header record followed by the records.
+
+=h flush write-only
+
+Drains the rings into FILENAME.
+
+=h active read/write
+
+Whether tracing is active.
+
+=a TCPInfo, TCPMib
+*/
+
+class TCPState;
+
+class TCPTrace final : public Element { public:
+
+	TCPTrace() CLICK_COLD;
+
+	const char *class_name() const { return "TCPTrace"; }
+	const char *port_count() const { return PORTS_0_0; }
+
+	int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
+	int initialize(ErrorHandler *) CLICK_COLD;
+	void cleanup(CleanupStage) CLICK_COLD;
+
+	void add_handlers() CLICK_COLD;
+
+	void run_timer(Timer *);
+
+	static inline void record(uint8_t event, const TCPState *s, uint64_t value = 0) {
+		if (unlikely(_active))
+			_t->push(event, s, value);
+	}
+
+  private:
+
+	void push(uint8_t event, const TCPState *s, uint64_t value);
+	void drain(StringAccum *sa);
+
+	static String read_handler(Element *, void *) CLICK_COLD;
+	static int write_handler(const String &, Element *, void *, ErrorHandler *) CLICK_COLD;
+
+	struct Core {
+		SPSCRing<TCPTraceRecord> ring;
+		uint64_t recorded;
+		uint64_t dropped;
+		uint32_t countdown;
+
+		Core() : recorded(0), dropped(0), countdown(1) { }
+	};
+
+	Core *_core;
+	Timer _timer;
+	Spinlock _lock;              // Serializes consumers
+	FILE *_file;
+	String _filename;
+	IPAddress _addr;
+	uint32_t _interval;
+	uint32_t _capacity;
+	uint32_t _sample;
+	uint32_t _events;
+	uint16_t _port;
+
+	static TCPTrace *_t;
+	static bool _active;
+
+};
+
+CLICK_ENDDECLS
+#endif
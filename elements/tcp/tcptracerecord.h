@@ -0,0 +1,72 @@
+/*
+ * tcptracerecord.h -- on-disk format of TCPTrace records
+ * Rafael Laufer, Massimo Gallo
+ *
+ * Copyright (c) 2019 Nokia Bell Labs
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+ *    in the documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ */
+
+#ifndef CLICK_TCPTRACERECORD_H
+#define CLICK_TCPTRACERECORD_H
+#include <stdint.h>
+
+// Plain C layout shared by TCPTrace and the offline decoder in test/tcptrace.
+// A trace is a sequence of TCPTraceRecords, in host byte order except for
+// addresses and ports, which are kept in network order. Each drained chunk
+// starts with a header record, so chunks can simply be concatenated.
+
+#define TCP_TRACE_MAGIC    0x54464E43  // "CNFT"
+#define TCP_TRACE_VERSION  1
+
+enum {
+	TCP_TRACE_HEADER = 0, // start of a chunk, value = TCP_TRACE_HEADER_VALUE
+	TCP_TRACE_ACK   = 1,  // ACK advanced snd_una, value = bytes acked
+	TCP_TRACE_RTO   = 2,  // retransmission timeout, value = rtx count
+	TCP_TRACE_LOSS  = 3,  // fast retransmit, value = duplicate ACKs
+	TCP_TRACE_PACE  = 4,  // paced segment released, value = pacing rate (B/s)
+	TCP_TRACE_STATE = 5,  // state change, value = previous state
+	TCP_TRACE_MAX
+};
+
+struct TCPTraceRecord {
+	uint64_t tstamp;         // nsec
+	uint64_t value;          // event specific
+	uint32_t saddr;          // local address
+	uint32_t daddr;          // remote address
+	uint16_t sport;
+	uint16_t dport;
+	uint8_t  event;
+	uint8_t  state;
+	uint16_t core;
+	uint32_t snd_una;
+	uint32_t snd_nxt;
+	uint32_t snd_cwnd;
+	uint32_t snd_ssthresh;
+	uint32_t snd_wnd;
+	uint32_t rcv_nxt;
+	uint32_t srtt;           // usec
+	uint32_t rto;            // msec
+};
+
+#define TCP_TRACE_HEADER_VALUE (((uint64_t)TCP_TRACE_MAGIC << 32) | \
+                                (TCP_TRACE_VERSION << 16) | \
+                                sizeof(struct TCPTraceRecord))
+
+#endif
@@ -0,0 +1,118 @@
+/*
+ * tcptxcredit.{cc,hh} -- per-core TX backpressure from the device queue
+ * Rafael Laufer, Massimo Gallo
+ *
+ * Copyright (c) 2019 Nokia Bell Labs
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+ *    in the documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ */
+
+#include <click/config.h>
+#include <click/glue.hh>
+#include <click/straccum.hh>
+#include "tcptxcredit.hh"
+CLICK_DECLS
+
+TCPTxCredit::Core TCPTxCredit::_core[CLICK_CPU_MAX];
+int TCPTxCredit::_devices = 0;
+
+int
+TCPTxCredit::attach()
+{
+	int dev = __sync_fetch_and_add(&_devices, 1);
+	if (dev >= TCP_TX_CREDIT_DEVICES) {
+		click_chatter("TCPTxCredit: too many devices, no backpressure");
+		return -1;
+	}
+
+	return dev;
+}
+
+void
+TCPTxCredit::stall(TCPState *s, TCPRateControl *owner)
+{
+	if (s->txs_owner)
+		return;
+
+	Core &m = _core[click_current_cpu_id()];
+	s->txs_owner = owner;
+	m.list.push_back(s);
+	m.stalls++;
+}
+
+void
+TCPTxCredit::unstall(TCPState *s)
+{
+	if (!s->txs_owner)
+		return;
+
+	Core &m = _core[click_current_cpu_id()];
+	m.list.erase(s);
+	s->txs_owner = NULL;
+}
+
+TCPState *
+TCPTxCredit::resume()
+{
+	Core &m = _core[click_current_cpu_id()];
+	if (m.blocked || m.list.empty())
+		return NULL;
+
+	TCPState *s = m.list.front();
+	m.list.pop_front();
+	m.resumes++;
+	return s;
+}
+
+bool
+TCPTxCredit::set_task(unsigned c, Task *t)
+{
+	if (_core[c].task)
+		return false;
+
+	_core[c].task = t;
+	return true;
+}
+
+String
+TCPTxCredit::unparse()
+{
+	StringAccum sa;
+	uint64_t blocks = 0, stalls = 0, resumes = 0;
+	uint32_t stalled = 0, blocked = 0;
+
+	for (unsigned c = 0; c < click_max_cpu_ids(); c++) {
+		blocks += _core[c].blocks;
+		stalls += _core[c].stalls;
+		resumes += _core[c].resumes;
+		stalled += _core[c].list.size();
+		blocked += (_core[c].blocked != 0);
+	}
+
+	sa << "devices " << _devices << '\n';
+	sa << "blocked_cores " << blocked << '\n';
+	sa << "stalled_sockets " << stalled << '\n';
+	sa << "blocks " << blocks << '\n';
+	sa << "stalls " << stalls << '\n';
+	sa << "resumes " << resumes << '\n';
+	return sa.take_string();
+}
+
+CLICK_ENDDECLS
+ELEMENT_PROVIDES(TCPTxCredit)
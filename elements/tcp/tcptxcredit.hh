@@ -0,0 +1,112 @@
+/*
+ * tcptxcredit.{cc,hh} -- per-core TX backpressure from the device queue
+ * Rafael Laufer, Massimo Gallo
+ *
+ * Copyright (c) 2019 Nokia Bell Labs
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+ *    in the documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ */
+
+#ifndef CLICK_TCPTXCREDIT_HH
+#define CLICK_TCPTXCREDIT_HH
+#include <click/glue.hh>
+#include <click/list.hh>
+#include <click/task.hh>
+#include <click/string.hh>
+#include "tcpstate.hh"
+CLICK_DECLS
+
+#define TCP_TX_CREDIT_DEVICES 32   // devices reporting their TX backlog
+#define TCP_TX_CREDIT_RESUME  64   // sockets resumed per task run
+
+class TCPRateControl;
+
+// Per-core TX credit. Devices report how many packets wait for the NIC on
+// the current core and the core is blocked while any of them is above its
+// high watermark, until it falls below the low one. Meanwhile, the rate
+// control elements leave data in the socket TX queues and append the
+// sockets to a per-core stall list, which is resumed in order once the
+// device queues drain.
+class TCPTxCredit { public:
+
+	typedef List<TCPState, &TCPState::txs_link> StallList;
+
+	// Device side
+	static int attach();
+	static inline void update(int dev, uint32_t backlog,
+	                          uint32_t high, uint32_t low);
+
+	// Socket side
+	static inline bool blocked();
+	static void stall(TCPState *s, TCPRateControl *owner);
+	static void unstall(TCPState *s);
+	static TCPState *resume();
+
+	static bool set_task(unsigned c, Task *t);
+	static inline bool stalled(unsigned c) { return !_core[c].list.empty(); }
+
+	static String unparse();
+
+  private:
+
+	struct Core {
+		uint32_t blocked;       // devices above the high watermark
+		StallList list;         // sockets waiting for credit
+		Task *task;             // task resuming them
+		uint64_t blocks;
+		uint64_t stalls;
+		uint64_t resumes;
+		Core() : blocked(0), task(NULL), blocks(0), stalls(0), resumes(0) { }
+	} CLICK_ALIGNED(CLICK_CACHE_LINE_SIZE);
+
+	static Core _core[CLICK_CPU_MAX];
+	static int _devices;
+
+};
+
+inline bool
+TCPTxCredit::blocked()
+{
+	return _core[click_current_cpu_id()].blocked != 0;
+}
+
+inline void
+TCPTxCredit::update(int dev, uint32_t backlog, uint32_t high, uint32_t low)
+{
+	if (dev < 0)
+		return;
+
+	Core &m = _core[click_current_cpu_id()];
+	uint32_t bit = (1U << dev);
+
+	if (backlog >= high) {
+		if (!(m.blocked & bit)) {
+			m.blocked |= bit;
+			m.blocks++;
+		}
+	}
+	else if ((m.blocked & bit) && backlog <= low) {
+		m.blocked &= ~bit;
+		if (!m.blocked && !m.list.empty() && m.task)
+			m.task->reschedule();
+	}
+}
+
+CLICK_ENDDECLS
+#endif
@@ -29,6 +29,7 @@
 #include "tcpupdatetimestamp.hh"
 #include "tcpstate.hh"
 #include "util.hh"
+#include "tcpclock.hh"
 CLICK_DECLS
 
 TCPUpdateTimestamp::TCPUpdateTimestamp()
@@ -69,10 +70,18 @@ TCPUpdateTimestamp::smaction(Packet *q)
 			uint32_t *ts_val = (uint32_t *)(ptr + 2);
 			uint32_t *ts_ecr = (uint32_t *)(ptr + 6);
 
-			uint32_t now = (uint32_t)Timestamp::now_steady().usecval();
+			uint32_t now = (uint32_t)TCPClock::now_usec();
+			uint32_t val = htonl(s->ts_offset + now);
+			uint32_t ecr = htonl(s->ts_recent);
 
-			*ts_val = htonl(s->ts_offset + now);
-			*ts_ecr = htonl(s->ts_recent);
+			// Update a software checksum, if already set (RFC 1624)
+			if (TCP_CSUM_FLAG_ANNO(p)) {
+				click_update_in_cksum32(&th->th_sum, *ts_val, val);
+				click_update_in_cksum32(&th->th_sum, *ts_ecr, ecr);
+			}
+
+			*ts_val = val;
+			*ts_ecr = ecr;
 		}
 
 		ptr += opsize;
@@ -25,6 +25,7 @@
 #include <click/error.hh>
 #include <click/bitvector.hh>
 #include <click/straccum.hh>
+#include "elements/tcp/tcpmib.hh"
 CLICK_DECLS
 
 const char *CheckTCPHeader::reason_texts[NREASONS] = {
@@ -75,6 +76,12 @@ CheckTCPHeader::drop(Reason reason, Packet *p)
   if (_reason_drops)
     _reason_drops[reason]++;
 
+  // Segments received in error, as counted by Linux
+  if (reason != NOT_TCP)
+    TCPMib::inc(TCP_MIB_IN_ERRS);
+  if (reason == BAD_CHECKSUM)
+    TCPMib::inc(TCP_MIB_IN_CSUM_ERRORS);
+
   if (noutputs() == 2)
     output(1).push(p);
   else
@@ -101,7 +108,10 @@ CheckTCPHeader::smaction(Packet *p)
     return drop(BAD_LENGTH, p);
 
   if (_checksum) {
-    csum = click_in_cksum((unsigned char *)tcph, len);
+    if (p->segments() > 1)	// e.g., jumbo frames in an mbuf chain
+      csum = ~p->seg_cksum(p->transport_header_offset(), len) & 0xFFFF;
+    else
+      csum = click_in_cksum((unsigned char *)tcph, len);
     if (click_in_cksum_pseudohdr(csum, iph, len) != 0)
       return drop(BAD_CHECKSUM, p);
   }
@@ -205,3 +215,4 @@ CheckTCPHeader::add_handlers()
 
 CLICK_ENDDECLS
 EXPORT_ELEMENT(CheckTCPHeader)
+ELEMENT_REQUIRES(TCPMib)
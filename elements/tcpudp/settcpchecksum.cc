@@ -22,10 +22,11 @@
 #include <click/error.hh>
 #include <clicknet/ip.h>
 #include <clicknet/tcp.h>
+#include <click/tcpanno.hh>
 CLICK_DECLS
 
 SetTCPChecksum::SetTCPChecksum()
-  : _fixoff(false), _sharedpkt(false)
+  : _fixoff(false), _sharedpkt(false), _csum_anno(false)
 {
 }
 
@@ -39,6 +40,7 @@ SetTCPChecksum::configure(Vector<String> &conf, ErrorHandler *errh)
     return Args(conf, this, errh)
 	.read_p("FIXOFF", _fixoff)
     .read("SHAREDPKT", _sharedpkt) 
+	.read("CSUM_ANNO", _csum_anno)
 	.complete();
 }
 
@@ -58,7 +60,7 @@ SetTCPChecksum::smaction(Packet *p_in)
   unsigned csum;
 
   if (!p->has_transport_header() || plen < sizeof(click_tcp)
-      || plen > (unsigned)p->transport_length())
+      || plen > p->length() - p->transport_header_offset())
     goto bad;
 
   if (_fixoff) {
@@ -70,8 +72,13 @@ SetTCPChecksum::smaction(Packet *p_in)
   }
 
   tcph->th_sum = 0;
-  csum = click_in_cksum((unsigned char *)tcph, plen);
+  if (p->segments() > 1)	// e.g., jumbo frames in an mbuf chain
+    csum = ~p->seg_cksum(p->transport_header_offset(), plen) & 0xFFFF;
+  else
+    csum = click_in_cksum((unsigned char *)tcph, plen);
   tcph->th_sum = click_in_cksum_pseudohdr(csum, iph, plen);
+  if (_csum_anno)
+    SET_TCP_CSUM_FLAG_ANNO(p);
 
   return p;
 
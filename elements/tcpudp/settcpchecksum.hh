@@ -6,7 +6,7 @@ CLICK_DECLS
 
 /*
  * =c
- * SetTCPChecksum([FIXOFF])
+ * SetTCPChecksum([FIXOFF, I<keywords> SHAREDPKT, CSUM_ANNO])
  * =s tcp
  * sets TCP packets' checksums
  * =d
@@ -15,6 +15,23 @@ CLICK_DECLS
  * Calculates the TCP header's checksum and sets the checksum header field.
  * Uses the IP header fields to generate the pseudo-header.
  *
+ * Keyword arguments are:
+ *
+ * =over 8
+ *
+ * =item SHAREDPKT
+ *
+ * Boolean. If true, set the checksum in place even if the packet is shared.
+ * Default is false.
+ *
+ * =item CSUM_ANNO
+ *
+ * Boolean. If true, mark the checksum as valid in the TCP flags annotation
+ * (see tcpanno.hh), so that TCP elements after this one, such as DecTCPSeqNo
+ * and TCPUpdateTimestamp, update it incrementally. Default is false.
+ *
+ * =back
+ *
  * =a CheckTCPHeader, SetIPChecksum, CheckIPHeader, SetUDPChecksum
  */
 
@@ -34,6 +51,7 @@ class SetTCPChecksum : public Element { public:
 private:
   bool _fixoff;
   bool _sharedpkt; // set checksum on shared packet 
+  bool _csum_anno;  // set TCP_FLAG_CSUM in the TCP flags annotation
 
 };
 
@@ -41,6 +41,9 @@
 
 # include <string.h>
 # include "dpdk.hh"
+# include "elements/tcp/tcpclock.hh"
+# include "elements/tcp/tcptxcredit.hh"
+# include "elements/tcp/tcpmib.hh"
 #endif // HAVE_DPDK
 CLICK_DECLS
 
@@ -107,6 +110,10 @@ DPDK::configure(Vector<String> &conf, ErrorHandler *errh)
 
 	_drain_us = 100;
 
+	_tx_high = 512;
+	_tx_low = (uint32_t)-1;
+	_tx_credit = -1;
+
 	String speed = "AUTO";
 
 	if (Args(conf, this, errh)
@@ -134,6 +141,8 @@ DPDK::configure(Vector<String> &conf, ErrorHandler *errh)
 	    .read("TX_TCP_CHECKSUM", _tx_tcp_checksum)
 	    .read("TX_UDP_CHECKSUM", _tx_udp_checksum)
 	    .read("TX_TCP_TSO", _tx_tcp_tso)
+	    .read("TX_HIGH", _tx_high)
+	    .read("TX_LOW", _tx_low)
 	    .read("HASH_OFFLOAD", DPDK::rss_hash_enabled)
 		.complete() < 0)
 		return -1;
@@ -178,6 +187,10 @@ DPDK::configure(Vector<String> &conf, ErrorHandler *errh)
 		return errh->error("RX_RING_SIZE out of range");
 	if (_burst < 32 || _burst > _tx_ring_size || _burst > _rx_ring_size)
 		return errh->error("BURST out of range");
+	if (_tx_low == (uint32_t)-1)
+		_tx_low = _tx_high / 2;
+	if (_tx_high && _tx_low >= _tx_high)
+		return errh->error("TX_LOW must be smaller than TX_HIGH");
 # if !HAVE_DPDK_PACKET
 	if (_tx_tcp_tso)
 		return errh->error("TX_TCP_TSO only valid with DPDK packet");
@@ -421,7 +434,8 @@ DPDK::initialize(ErrorHandler *errh)
 	tx_conf.tx_thresh.wthresh = DPDK_TX_WTHRESH;
 	tx_conf.tx_free_thresh = 32;
 	tx_conf.tx_rs_thresh = 0;
-	if (_tx_tcp_tso)
+	// Jumbo frames and TSO packets may span a chain of mbufs
+	if (_tx_tcp_tso || _rx_jumbo_frame)
 		tx_conf.txq_flags &= ~ETH_TXQ_FLAGS_NOMULTSEGS;
 	else
 		tx_conf.txq_flags |= ETH_TXQ_FLAGS_NOMULTSEGS;
@@ -455,6 +469,10 @@ DPDK::initialize(ErrorHandler *errh)
 			return errh->error("TX queue setup failed");
 	}
 
+	// Report the TX backlog to the TCP elements
+	if (_tx_high)
+		_tx_credit = TCPTxCredit::attach();
+
 	// Start notifiers and tasks
 	uint64_t tsc =  rte_rdtsc();
 	for (unsigned int c = 0; c < _nthreads; c++) {
@@ -920,7 +938,7 @@ DPDK::tx_batch()
 	do {
 		uint16_t tx_size = RTE_MIN(t.tx_pkts.size(), _burst);
 		if (tx_size == 0)
-			return tx_count;
+			break;
 
 		struct rte_mbuf *tx_mbuf[tx_size];
 		Packet *p = t.tx_pkts.front();
@@ -974,6 +992,9 @@ DPDK::tx_batch()
 
 	} while (t.tx_pkts.size());
 
+	// Resume the TCP data path if the backlog drained
+	TCPTxCredit::update(_tx_credit, t.tx_pkts.size(), _tx_high, _tx_low);
+
 	return tx_count;
 }
 
@@ -993,9 +1014,10 @@ DPDK::rx_batch()
 	Timestamp now;
 	TaskData &t = _task[c];
 
-	// Getting the current time is costly, do it once per batch
+	// Getting the current time is costly, do it once per batch, which
+	// also refreshes the time cached for the TCP elements on this core
 	if (_rx_timestamp_anno)
-		now = Timestamp::now_steady();
+		now = TCPClock::refresh();
 // 	// Prevent error accumulation in the timestamps
 // 	uint32_t epsilon = 0;
 
@@ -1063,6 +1085,10 @@ DPDK::rx_batch()
 			struct rte_mbuf *m = rx_mbuf[i];
 			uint32_t flags = m->ol_flags;
 			if (unlikely(flags & (PKT_RX_IP_CKSUM_BAD|PKT_RX_L4_CKSUM_BAD))) {
+				if (flags & PKT_RX_L4_CKSUM_BAD) {
+					TCPMib::inc(TCP_MIB_IN_ERRS);
+					TCPMib::inc(TCP_MIB_IN_CSUM_ERRORS);
+				}
 				p->kill();
 				continue;
 			}
@@ -1170,6 +1196,9 @@ DPDK::push(int, Packet *p)
 		t.prev_tsc = curr_tsc;
 	}
 
+	// Stop the TCP data path if the backlog is over the watermark
+	TCPTxCredit::update(_tx_credit, t.tx_pkts.size(), _tx_high, _tx_low);
+
 
 
 	if (!t.task->scheduled())
@@ -1293,6 +1322,6 @@ DPDK::add_handlers()
 
 CLICK_ENDDECLS
 #endif // HAVE_DPDK_H
-ELEMENT_REQUIRES(userlevel dpdk)
+ELEMENT_REQUIRES(userlevel dpdk TCPClock TCPTxCredit TCPMib)
 EXPORT_ELEMENT(DPDK)
 
@@ -58,12 +58,25 @@ Ethernet address. Specifies the DPDK device's Ethernet address.
 =item MTU
 
 Integer. The interface's MTU, including all link headers. Default is 1522 to 
-allow 802.1Q tags. Only used if JUMBO_FRAME is enabled.
+allow 802.1Q tags. Only used if JUMBO_FRAME is enabled, in which case
+multi-segment TX is also enabled so that frames larger than an mbuf can be
+sent as mbuf chains. The TCP MSS follows the MTU given to TCPInfo.
 
 =item BURST
 
 Integer. The maximum number of packets to emit at a time. Default is 32.
 
+=item TX_HIGH
+
+Integer. Number of packets waiting for the TX ring of a core above which the
+TCP elements on that core stop dequeuing data from the socket TX queues
+(see TCPRateControl). Zero disables backpressure. Default is 512.
+
+=item TX_LOW
+
+Integer. Number of packets waiting for the TX ring of a core below which
+stalled sockets are resumed. Default is TX_HIGH/2.
+
 =back
 
 =n
@@ -168,6 +181,9 @@ class DPDK : public Element { public:
 	uint16_t _rx_split_hdr_size;
 	uint32_t _rx_ring_size;
 	uint32_t _tx_ring_size;
+	uint32_t _tx_high;
+	uint32_t _tx_low;
+	int _tx_credit;
 	uint32_t _speed;
 	EtherAddress _macaddr;
 
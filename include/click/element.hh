@@ -251,6 +251,11 @@ class Element { public:
 
     };
 
+    // Called instead of the element's push() and pull() when set, so that a
+    // profiler can be enabled at runtime (see CycleProfiler)
+    static void (*push_hook)(const Port &port, Packet *p);
+    static Packet *(*pull_hook)(const Port &port);
+
     // DEPRECATED
     /** @cond never */
     String id() const CLICK_DEPRECATED;
@@ -634,6 +639,10 @@ Element::Port::push(Packet* p) const
     _e->_xfer_own_cycles += own_delta;
     _owner->_child_cycles += all_delta;
 #else
+    if (unlikely(push_hook)) {
+        push_hook(*this, p);
+        return;
+    }
 # if HAVE_BOUND_PORT_TRANSFER
     _bound.push(_e, _port, p);
 # else
@@ -678,10 +687,14 @@ Element::Port::pull() const
     _e->_xfer_own_cycles += own_delta;
     _owner->_child_cycles += all_delta;
 #else
+    Packet *p;
+    if (unlikely(pull_hook))
+        p = pull_hook(*this);
+    else
 # if HAVE_BOUND_PORT_TRANSFER
-    Packet *p = _bound.pull(_e, _port);
+        p = _bound.pull(_e, _port);
 # else
-    Packet *p = _e->pull(_port);
+        p = _e->pull(_port);
 # endif
 #endif
 #if CLICK_STATS >= 1
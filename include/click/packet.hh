@@ -61,6 +61,8 @@ class Packet { public:
 				uint32_t length, uint32_t tailroom, bool clear_annotations = true) CLICK_WARN_UNUSED_RESULT;
     static inline WritablePacket *make(const void *data, uint32_t length) CLICK_WARN_UNUSED_RESULT;
     static inline WritablePacket *make(uint32_t length) CLICK_WARN_UNUSED_RESULT;
+    static inline WritablePacket *make_chain(uint32_t headroom, const void *data,
+				uint32_t length, uint32_t tailroom = 0) CLICK_WARN_UNUSED_RESULT;
 #if CLICK_LINUXMODULE
     static Packet *make(struct sk_buff *skb) CLICK_WARN_UNUSED_RESULT;
 #endif
@@ -108,6 +110,7 @@ class Packet { public:
     inline uint32_t seg_len() const;
     inline void seg_take(uint32_t len);
     inline Packet *seg_pull(uint32_t len);
+    uint32_t seg_cksum(uint32_t offset, uint32_t len) const;
 
 #if CLICK_LINUXMODULE
     struct sk_buff *skb()		{ return (struct sk_buff *)this; }
@@ -1704,6 +1707,70 @@ Packet::make(uint32_t length)
     return make(default_headroom, (const unsigned char *) 0, length, 0);
 }
 
+/** @brief Create and return a new packet, possibly as a segment chain.
+ * @param headroom headroom in new packet
+ * @param data data to be copied into the new packet
+ * @param length length of packet
+ * @param tailroom tailroom in new packet, in its last segment if chained
+ * @return new packet, or null if no packet could be created
+ *
+ * Like make(@a headroom, @a data, @a length, @a tailroom), except that with
+ * DPDK packets a packet that does not fit in a single mbuf (e.g., a jumbo
+ * frame) is spread over a chain of mbufs, each filled to its tailroom except
+ * the last, which keeps @a tailroom bytes (at most half an mbuf). Other
+ * packet types are always contiguous. */
+inline WritablePacket *
+Packet::make_chain(uint32_t headroom, const void *data, uint32_t length,
+		   uint32_t tailroom)
+{
+#if HAVE_DPDK_PACKET
+    int s = rte_lcore_index(rte_lcore_id());
+    uint32_t room = rte_pktmbuf_data_room_size(mempool[s]);
+    if (headroom + length + tailroom <= room)
+	return make(headroom, data, length, tailroom);
+    if (tailroom > room / 2)
+	tailroom = room / 2;
+
+    WritablePacket *p = make(headroom, (const unsigned char *) 0, 0, 0);
+    if (!p)
+	return 0;
+
+    const unsigned char *d = (const unsigned char *) data;
+    struct rte_mbuf *m = p->mbuf();
+    while (length > 0) {
+	uint32_t n = rte_pktmbuf_tailroom(m);
+	if (n >= length + tailroom)
+	    n = length;
+	else if (n >= length)
+	    // Leave the tailroom, the rest goes into one more segment
+	    n = (n > tailroom ? n - tailroom : 0);
+	char *x = rte_pktmbuf_append(m, n);
+	if (d) {
+	    rte_memcpy(x, d, n);
+	    d += n;
+	}
+	if (m != p->mbuf())
+	    p->seg_join(reinterpret_cast<Packet *>(m));
+	length -= n;
+	if (length == 0)
+	    break;
+
+	// Following segments need no headroom
+	WritablePacket *q = make(0, (const unsigned char *) 0, 0, 0);
+	if (!q) {
+	    p->kill();
+	    return 0;
+	}
+	m = q->mbuf();
+	m->data_off = 0;
+    }
+
+    return p;
+#else
+    return make(headroom, data, length, tailroom);
+#endif
+}
+
 #if CLICK_LINUXMODULE
 /** @brief Change an sk_buff into a Packet (linuxmodule).
  * @param skb input sk_buff
@@ -77,6 +77,29 @@ CLICK_DECLS
 #define TCP_FLAGS_ANNO(p)        (p)->anno_u8(TCP_FLAGS_ANNO_OFFSET)
 #define SET_TCP_FLAGS_ANNO(p, v) (p)->set_anno_u8(TCP_FLAGS_ANNO_OFFSET, (v))
 
+// BBR delivery-rate snapshot taken when a segment is (re)sent, valid only on
+// RTX queue packets. APP_LIMITED overlays WND, which RTX queue packets no
+// longer need.
+#define TCP_DELIVERED_ANNO_OFFSET        32 + DST_IP_ANNO_SIZE
+#define TCP_DELIVERED_ANNO_SIZE           4
+#define TCP_DELIVERED_ANNO(p)            (p)->anno_u32(TCP_DELIVERED_ANNO_OFFSET)
+#define SET_TCP_DELIVERED_ANNO(p, v)     (p)->set_anno_u32(TCP_DELIVERED_ANNO_OFFSET, (v))
+
+#define TCP_DELIVERED_TIME_ANNO_OFFSET   36 + DST_IP_ANNO_SIZE
+#define TCP_DELIVERED_TIME_ANNO_SIZE      4
+#define TCP_DELIVERED_TIME_ANNO(p)       (p)->anno_u32(TCP_DELIVERED_TIME_ANNO_OFFSET)
+#define SET_TCP_DELIVERED_TIME_ANNO(p, v) (p)->set_anno_u32(TCP_DELIVERED_TIME_ANNO_OFFSET, (v))
+
+#define TCP_FIRST_SENT_ANNO_OFFSET       40 + DST_IP_ANNO_SIZE
+#define TCP_FIRST_SENT_ANNO_SIZE          4
+#define TCP_FIRST_SENT_ANNO(p)           (p)->anno_u32(TCP_FIRST_SENT_ANNO_OFFSET)
+#define SET_TCP_FIRST_SENT_ANNO(p, v)    (p)->set_anno_u32(TCP_FIRST_SENT_ANNO_OFFSET, (v))
+
+#define TCP_APP_LIMITED_ANNO_OFFSET      TCP_WND_ANNO_OFFSET
+#define TCP_APP_LIMITED_ANNO_SIZE         4
+#define TCP_APP_LIMITED_ANNO(p)          (p)->anno_u32(TCP_APP_LIMITED_ANNO_OFFSET)
+#define SET_TCP_APP_LIMITED_ANNO(p, v)   (p)->set_anno_u32(TCP_APP_LIMITED_ANNO_OFFSET, (v))
+
 #define TCP_FLAG_SACK      (1 << 0)  // SACKed packets
 #define TCP_FLAG_ACK       (1 << 1)  // ACK needed
 #define TCP_FLAG_MS        (1 << 2)  // More (buffered) segments coming
@@ -86,6 +109,10 @@ CLICK_DECLS
 #define TCP_FLAG_SOCK_ERR  (1 << 6)  // Socket err
 #define TCP_FLAG_ECE       (1 << 7)  // ECE needed
 
+// Valid TCP checksum, header changes must update it. Overlays SOCK_ERR,
+// which is only set on signalling packets between App and TCPEpoll.
+#define TCP_FLAG_CSUM      TCP_FLAG_SOCK_ERR
+
 // Annotations valid only for App - TCPEpoll(Server, Client)
 // NOTE May overwrite TCP Anno
 
@@ -115,6 +142,13 @@ CLICK_DECLS
 #define RESET_TCP_ECE_FLAG_ANNO(p)  \
                      SET_TCP_FLAGS_ANNO(p, TCP_FLAGS_ANNO(p) & (~TCP_FLAG_ECE))
 
+// Valid checksum flag
+#define TCP_CSUM_FLAG_ANNO(p)          (TCP_FLAGS_ANNO(p) & TCP_FLAG_CSUM)
+#define SET_TCP_CSUM_FLAG_ANNO(p)   \
+                     SET_TCP_FLAGS_ANNO(p, TCP_FLAGS_ANNO(p) | TCP_FLAG_CSUM)
+#define RESET_TCP_CSUM_FLAG_ANNO(p) \
+                     SET_TCP_FLAGS_ANNO(p, TCP_FLAGS_ANNO(p) & (~TCP_FLAG_CSUM))
+
 // More (buffered) segments coming
 #define TCP_MS_FLAG_ANNO(p)            (TCP_FLAGS_ANNO(p) & TCP_FLAG_MS)
 #define SET_TCP_MS_FLAG_ANNO(p)    \
@@ -136,6 +136,16 @@ uint16_t click_in_cksum_pseudohdr_raw(uint32_t csum, uint32_t src, uint32_t dst,
 # define click_in_cksum_pseudohdr_raw(csum, src, dst, proto, transport_len) \
 		csum_tcpudp_magic((src), (dst), (transport_len), (proto), ~(csum) & 0xFFFF)
 #endif
+/** @brief Add a data range to a partial Internet checksum.
+ * @param csum partial checksum, as returned by a previous call, or 0
+ * @param x data to add
+ * @param len number of bytes to add
+ * @return the folded 16-bit one's-complement sum, not complemented
+ *
+ * Allows checksumming data split over several buffers. If a buffer starts
+ * at an odd offset of the checksummed data, its sum must be byte-swapped
+ * before being added. */
+uint32_t click_in_cksum_add(uint32_t csum, const unsigned char *x, int len);
 uint16_t click_in_cksum_pseudohdr_hard(uint32_t csum, const struct click_ip *iph, int packet_len);
 void click_update_zero_in_cksum_hard(uint16_t *csum, const unsigned char *addr, int len);
 
@@ -182,6 +192,22 @@ click_update_in_cksum(uint16_t *csum, uint16_t old_hw, uint16_t new_hw)
     *csum = ~(sum + (sum >> 16));
 }
 
+/** @brief Incrementally adjust an Internet checksum for a 32-bit field.
+ * @param[in, out] csum points to checksum
+ * @param old_w old word, in network byte order
+ * @param new_w new word, in network byte order
+ *
+ * Same as two calls to click_update_in_cksum(), one per halfword. */
+static inline void
+click_update_in_cksum32(uint16_t *csum, uint32_t old_w, uint32_t new_w)
+{
+    /* RFC1624: new_sum = ~(~old_sum + ~old_word + new_word), in halfwords */
+    uint32_t sum = (~*csum & 0xFFFF) + (~old_w & 0xFFFF) + (~old_w >> 16)
+	+ (new_w & 0xFFFF) + (new_w >> 16);
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    *csum = ~(sum + (sum >> 16));
+}
+
 /** @brief Potentially fix a zero-valued Internet checksum.
  * @param[in, out] csum points to checksum
  * @param x data to checksum
@@ -246,9 +246,15 @@ TCP_DST(Packet *p)
 // "If an MSS option is not received at connection setup, TCP MUST
 //  assume a default send MSS of 536 (576-40)."
 #define TCP_SND_MSS_MIN       536
-#define TCP_SND_MSS_MAX      1460
 #define TCP_RCV_MSS_DEFAULT  1460
 
+// IP MTU, from which the MSS is derived (see TCPInfo)
+#define TCP_MTU_DEFAULT      1500
+#define TCP_MTU_JUMBO        9000
+
+// Largest MSS, that of a jumbo frame
+#define TCP_SND_MSS_MAX      (TCP_MTU_JUMBO - 40)
+
 // TCP read(rx)/write(tx) memory size
 #define TCP_RMEM_SHIFT_DEFAULT   20  //   1 MB
 #define TCP_WMEM_SHIFT_DEFAULT   20  //   1 MB
@@ -67,6 +67,8 @@ const char Element::PROCESSING_A_AH[] = "a/ah";
 const char Element::COMPLETE_FLOW[] = "x/x";
 
 int Element::nelements_allocated = 0;
+void (*Element::push_hook)(const Port &, Packet *) = 0;
+Packet *(*Element::pull_hook)(const Port &) = 0;
 
 /** @mainpage Click
  *  @section  Introduction
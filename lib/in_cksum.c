@@ -16,38 +16,95 @@
 # include <string.h>
 #endif
 
-#if !CLICK_LINUXMODULE
-uint16_t
-click_in_cksum(const unsigned char *addr, int len)
+#if !CLICK_LINUXMODULE && defined(__GNUC__) && (defined(__SSE2__) || defined(__ARM_NEON))
+# if defined(__AVX2__)
+#  define CKSUM_VEC_BYTES 32
+# else
+#  define CKSUM_VEC_BYTES 16
+# endif
+typedef uint32_t cksum_vec __attribute__((vector_size(CKSUM_VEC_BYTES)));
+#endif
+
+/*
+ * Add the 16-bit words in [addr, addr+len) to a 64-bit accumulator, without
+ * folding. An odd trailing byte is added as if followed by a zero byte.
+ *
+ * The one's-complement sum does not depend on the word size as long as the
+ * carries are folded back in the end (RFC 1071), so the data is added in
+ * vectors of 32-bit words split into their 16-bit halves, and then 32 bits
+ * at a time into the 64-bit accumulator.
+ */
+static uint64_t
+cksum_add(uint64_t sum, const unsigned char *addr, int len)
 {
-    int nleft = len;
-    const uint16_t *w = (const uint16_t *)addr;
-    uint32_t sum = 0;
-    uint16_t answer = 0;
-
-    /*
-     * Our algorithm is simple, using a 32 bit accumulator (sum), we add
-     * sequential 16 bit words to it, and at the end, fold back all the
-     * carry bits from the top 16 bits into the lower 16 bits.
-     */
-    while (nleft > 1)  {
-	sum += *w++;
-	nleft -= 2;
+#ifdef CKSUM_VEC_BYTES
+    while (len >= 4 * CKSUM_VEC_BYTES) {
+	cksum_vec acc = { 0 };
+	cksum_vec v[4];
+	unsigned i;
+	int n;
+
+	/* each round adds at most 8 * 0xFFFF per lane, fold before overflow */
+	for (n = 0; n < 4096 && len >= 4 * CKSUM_VEC_BYTES; n++) {
+	    memcpy(v, addr, sizeof(v));
+	    acc += (v[0] & 0xFFFF) + (v[0] >> 16) + (v[1] & 0xFFFF) + (v[1] >> 16)
+		+ (v[2] & 0xFFFF) + (v[2] >> 16) + (v[3] & 0xFFFF) + (v[3] >> 16);
+	    addr += sizeof(v);
+	    len -= sizeof(v);
+	}
+
+	for (i = 0; i < CKSUM_VEC_BYTES / 4; i++)
+	    sum += acc[i];
+    }
+#endif
+
+    while (len >= 8) {
+	uint64_t w;
+	memcpy(&w, addr, 8);
+	sum += (w & 0xFFFFFFFF) + (w >> 32);
+	addr += 8;
+	len -= 8;
+    }
+
+    while (len > 1) {
+	uint16_t w;
+	memcpy(&w, addr, 2);
+	sum += w;
+	addr += 2;
+	len -= 2;
     }
 
     /* mop up an odd byte, if necessary */
-    if (nleft == 1) {
-	*(unsigned char *)(&answer) = *(const unsigned char *)w ;
-	sum += answer;
+    if (len == 1) {
+	uint16_t w = 0;
+	*(unsigned char *)(&w) = *addr;
+	sum += w;
     }
 
-    /* add back carry outs from top 16 bits to low 16 bits */
-    sum = (sum & 0xffff) + (sum >> 16);
-    sum += (sum >> 16);
-    /* guaranteed now that the lower 16 bits of sum are correct */
+    return sum;
+}
+
+static inline uint32_t
+cksum_fold(uint64_t sum)
+{
+    sum = (sum & 0xFFFFFFFF) + (sum >> 32);
+    sum = (sum & 0xFFFFFFFF) + (sum >> 32);
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    return sum;
+}
+
+uint32_t
+click_in_cksum_add(uint32_t csum, const unsigned char *addr, int len)
+{
+    return cksum_fold(cksum_add(csum, addr, len));
+}
 
-    answer = ~sum;              /* truncate to 16 bits */
-    return answer;
+#if !CLICK_LINUXMODULE
+uint16_t
+click_in_cksum(const unsigned char *addr, int len)
+{
+    return ~cksum_fold(cksum_add(0, addr, len)) & 0xFFFF;
 }
 
 uint16_t
@@ -1328,6 +1328,42 @@ Packet::shift_data(int offset, bool free_on_failure)
 #endif /* HAVE_DPDK_PACKET */
 }
 
+/** @brief Return the partial Internet checksum of a data range.
+ * @param offset offset of the range from data()
+ * @param len length of the range
+ *
+ * Returns the folded, non-complemented 16-bit one's-complement sum of @a len
+ * bytes starting at @a offset, which may span several segments of a chain.
+ * @sa click_in_cksum_add */
+uint32_t
+Packet::seg_cksum(uint32_t offset, uint32_t len) const
+{
+    const Packet *p = this;
+    while (p && offset >= p->seg_len()) {
+	offset -= p->seg_len();
+	p = p->seg_next();
+    }
+
+    uint32_t sum = 0;
+    bool odd = false;
+    for (; p && len > 0; p = p->seg_next(), offset = 0) {
+	uint32_t n = p->seg_len() - offset;
+	if (n > len)
+	    n = len;
+
+	uint32_t s = click_in_cksum_add(0, p->data() + offset, n);
+	if (odd)
+	    s = ((s & 0xFF) << 8) | (s >> 8);
+	sum += s;
+	sum = (sum & 0xFFFF) + (sum >> 16);
+
+	odd ^= (n & 1);
+	len -= n;
+    }
+
+    return sum;
+}
+
 
 #if HAVE_CLICK_PACKET_POOL
 static void
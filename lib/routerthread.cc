@@ -25,6 +25,7 @@
 #include <click/router.hh>
 #include <click/routerthread.hh>
 #include <click/master.hh>
+#include "elements/tcp/tcpclock.hh"
 #if CLICK_LINUXMODULE
 # include <click/cxxprotect.h>
 CLICK_CXX_PROTECT
@@ -604,6 +605,10 @@ RouterThread::driver()
         if (_pending_head.x)
             process_pending();
 
+        // refresh the cached TCP clock once per iteration
+        if (TCPClock::enabled())
+            TCPClock::refresh();
+
         // run tasks
         do {
 #if HAVE_ADAPTIVE_SCHEDULER
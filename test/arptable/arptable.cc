@@ -0,0 +1,215 @@
+/*
+ * arptable.cc -- ARPTable lookup throughput, locked table versus snapshot
+ *
+ * Fills an ARPTable with known entries and has several threads look up
+ * random addresses in it, either through the read-locked hash table (the
+ * former ARPTable::lookup) or through the lock-free snapshot. Reports lookups
+ * per second for 1, 2, 4, ... up to the given number of threads. Optionally,
+ * a writer thread changes a mapping every given number of microseconds, which
+ * publishes a new snapshot each time, as an ARP reply with a new address would.
+ *
+ * Usage: arptable [-m locked|snapshot|all] [-t max_threads] [-n entries]
+ *                 [-d seconds] [-u update_usec]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <inttypes.h>
+#include <click/config.h>
+#include <click/glue.hh>
+#include <click/timestamp.hh>
+#include "elements/ethernet/arptable.hh"
+
+// Defined by the click driver, which is not linked in
+int click_nthreads = 1;
+
+enum { MODE_LOCKED, MODE_SNAPSHOT };
+static const char *mode_name[] = { "locked", "snapshot" };
+
+static ARPTable *table;
+static uint32_t entries = 64;
+static double duration = 2.0;
+static int update_usec = 0;
+static volatile bool stop;
+
+struct ThreadArg {
+	int id;
+	int mode;
+	uint64_t lookups;
+	uint64_t misses;
+} CLICK_ALIGNED(CLICK_CACHE_LINE_SIZE);
+
+static double
+now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static IPAddress
+entry_ip(uint32_t i)
+{
+	return IPAddress(htonl(0x0A000000 | (i + 1)));
+}
+
+static EtherAddress
+entry_eth(uint32_t i, uint32_t v)
+{
+	unsigned char a[6] = { 0x02, 0x00, (unsigned char)v,
+	                       (unsigned char)(i >> 16), (unsigned char)(i >> 8),
+	                       (unsigned char)i };
+	return EtherAddress(a);
+}
+
+static void *
+reader(void *a)
+{
+	ThreadArg *t = (ThreadArg *)a;
+	click_current_thread_id = t->id;
+
+	uint32_t x = 2463534242U + t->id;
+	EtherAddress eth;
+	uint64_t lookups = 0, misses = 0;
+
+	while (!stop) {
+		for (int k = 0; k < 256; k++) {
+			x ^= x << 13;
+			x ^= x >> 17;
+			x ^= x << 5;
+			IPAddress ip = entry_ip(x % entries);
+
+			int r;
+			if (t->mode == MODE_LOCKED)
+				r = table->lookup_locked(ip, &eth, 0);
+			else
+				r = table->lookup(ip, &eth, 0);
+			if (r < 0)
+				misses++;
+		}
+		lookups += 256;
+	}
+
+	t->lookups = lookups;
+	t->misses = misses;
+	return NULL;
+}
+
+static void *
+writer(void *a)
+{
+	ThreadArg *t = (ThreadArg *)a;
+	click_current_thread_id = t->id;
+
+	for (uint32_t v = 1; !stop; v++) {
+		uint32_t i = v % entries;
+		table->insert(entry_ip(i), entry_eth(i, v & 0xFF));
+		t->lookups++;
+		usleep(update_usec);
+	}
+
+	return NULL;
+}
+
+static void
+run(int mode, int threads)
+{
+	pthread_t tid[threads + 1];
+	ThreadArg arg[threads + 1];
+
+	stop = false;
+	double start = now();
+	for (int i = 0; i <= threads; i++) {
+		memset(&arg[i], 0, sizeof(arg[i]));
+		arg[i].id = i;
+		arg[i].mode = mode;
+		if (i < threads)
+			pthread_create(&tid[i], NULL, reader, &arg[i]);
+		else if (update_usec > 0)
+			pthread_create(&tid[i], NULL, writer, &arg[i]);
+	}
+
+	usleep((useconds_t)(duration * 1e6));
+	stop = true;
+
+	uint64_t lookups = 0, misses = 0;
+	for (int i = 0; i < threads; i++) {
+		pthread_join(tid[i], NULL);
+		lookups += arg[i].lookups;
+		misses += arg[i].misses;
+	}
+	if (update_usec > 0)
+		pthread_join(tid[threads], NULL);
+	double elapsed = now() - start;
+
+	printf("mode=%s threads=%d entries=%u lookups=%" PRIu64 " misses=%" PRIu64
+	       " updates=%" PRIu64 " seconds=%.3f mlookups_per_sec=%.2f\n",
+	       mode_name[mode], threads, entries, lookups, misses,
+	       arg[threads].lookups, elapsed, lookups / elapsed / 1e6);
+	fflush(stdout);
+}
+
+int
+main(int argc, char **argv)
+{
+	int max_threads = 32;
+	int first = MODE_LOCKED, last = MODE_SNAPSHOT;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "m:t:n:d:u:")) != -1) {
+		switch (opt) {
+		case 'm':
+			if (!strcmp(optarg, "all"))
+				break;
+			for (first = MODE_LOCKED; first <= MODE_SNAPSHOT; first++)
+				if (!strcmp(optarg, mode_name[first]))
+					break;
+			if (first > MODE_SNAPSHOT) {
+				fprintf(stderr, "unknown mode %s\n", optarg);
+				return 1;
+			}
+			last = first;
+			break;
+		case 't':
+			max_threads = atoi(optarg);
+			break;
+		case 'n':
+			entries = atoi(optarg);
+			break;
+		case 'd':
+			duration = atof(optarg);
+			break;
+		case 'u':
+			update_usec = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-m locked|snapshot|all] [-t max_threads] "
+			        "[-n entries] [-d seconds] [-u update_usec]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	if (max_threads < 1)
+		max_threads = 1;
+	if (entries < 1)
+		entries = 1;
+
+	// One reader slot per thread, plus the writer
+	click_nthreads = max_threads + 1;
+
+	table = new ARPTable;
+	table->set_timeout(Timestamp());
+	for (uint32_t i = 0; i < entries; i++)
+		table->insert(entry_ip(i), entry_eth(i, 0));
+
+	for (int mode = first; mode <= last; mode++)
+		for (int threads = 1; threads <= max_threads; threads *= 2)
+			run(mode, threads);
+
+	table->clear();
+	delete table;
+	return 0;
+}
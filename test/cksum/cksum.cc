@@ -0,0 +1,174 @@
+/*
+ * cksum.cc -- Internet checksum throughput and incremental updates
+ *
+ * Checks click_in_cksum() and click_in_cksum_add() against a plain 16-bit
+ * reference loop (the former click_in_cksum) for every length and alignment
+ * up to 2 KB, then reports the throughput of both for lengths from 64 B to
+ * 9 KB. Finally, compares rewriting the sequence number and timestamps of a
+ * TCP segment with an incremental checksum update (RFC 1624) against
+ * recomputing the checksum over the whole segment.
+ *
+ * Usage: cksum [-n iterations]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <inttypes.h>
+#include <netinet/in.h>
+#include <click/config.h>
+#include <clicknet/ip.h>
+
+static double
+now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// The former scalar click_in_cksum()
+static uint16_t
+reference(const unsigned char *addr, int len)
+{
+	const uint16_t *w = (const uint16_t *)addr;
+	uint32_t sum = 0;
+	uint16_t answer = 0;
+
+	while (len > 1) {
+		sum += *w++;
+		len -= 2;
+	}
+	if (len == 1) {
+		*(unsigned char *)(&answer) = *(const unsigned char *)w;
+		sum += answer;
+	}
+	sum = (sum & 0xffff) + (sum >> 16);
+	sum += (sum >> 16);
+	return ~sum;
+}
+
+static int
+check(const unsigned char *buf)
+{
+	int errors = 0;
+	for (int off = 0; off < 8; off += 2)
+		for (int len = 0; len <= 2048; len++) {
+			uint16_t r = reference(buf + off, len);
+			if (click_in_cksum(buf + off, len) != r) {
+				fprintf(stderr, "click_in_cksum mismatch, off %d len %d\n", off, len);
+				errors++;
+			}
+
+			// Same sum in two pieces split at an even offset
+			int half = (len / 2) & ~1;
+			uint32_t s = click_in_cksum_add(0, buf + off, half);
+			s = click_in_cksum_add(s, buf + off + half, len - half);
+			if ((uint16_t)~s != r && !(s == 0xFFFF && r == 0xFFFF)) {
+				fprintf(stderr, "click_in_cksum_add mismatch, off %d len %d\n", off, len);
+				errors++;
+			}
+		}
+	return errors;
+}
+
+static void
+bench(const unsigned char *buf, int len, long n)
+{
+	volatile uint16_t sink = 0;
+
+	double t0 = now();
+	for (long i = 0; i < n; i++)
+		sink += reference(buf, len);
+	double t1 = now();
+	for (long i = 0; i < n; i++)
+		sink += click_in_cksum(buf, len);
+	double t2 = now();
+
+	double ref = (t1 - t0) * 1e9 / n;
+	double cur = (t2 - t1) * 1e9 / n;
+	printf("len=%d ref_ns=%.1f ns=%.1f ref_gbps=%.2f gbps=%.2f speedup=%.2f\n",
+	       len, ref, cur, len * 8 / ref, len * 8 / cur, ref / cur);
+	fflush(stdout);
+}
+
+// Rewrite sequence number and TCP timestamps of a 1500-byte IP packet
+static void
+bench_update(unsigned char *buf, long n)
+{
+	const int len = 1480;         // TCP header, options, and data
+	uint32_t *seq = (uint32_t *)(buf + 4);
+	uint32_t *ts = (uint32_t *)(buf + 24);
+	uint16_t *sum = (uint16_t *)(buf + 16);
+	int errors = 0;
+
+	*sum = 0;
+	*sum = click_in_cksum(buf, len);
+
+	double t0 = now();
+	for (long i = 0; i < n; i++) {
+		*sum = 0;
+		*seq = htonl(ntohl(*seq) - 1);
+		ts[0] = htonl(i);
+		ts[1] = htonl(i + 1);
+		*sum = click_in_cksum(buf, len);
+	}
+	double t1 = now();
+	for (long i = 0; i < n; i++) {
+		uint32_t s = htonl(ntohl(*seq) - 1);
+		click_update_in_cksum32(sum, *seq, s);
+		*seq = s;
+		click_update_in_cksum32(sum, ts[0], htonl(i));
+		ts[0] = htonl(i);
+		click_update_in_cksum32(sum, ts[1], htonl(i + 1));
+		ts[1] = htonl(i + 1);
+	}
+	double t2 = now();
+
+	if (click_in_cksum(buf, len) != 0) {
+		fprintf(stderr, "incremental update mismatch\n");
+		errors++;
+	}
+
+	double full = (t1 - t0) * 1e9 / n;
+	double inc = (t2 - t1) * 1e9 / n;
+	printf("update len=%d recompute_ns=%.1f incremental_ns=%.1f errors=%d\n",
+	       len, full, inc, errors);
+	fflush(stdout);
+}
+
+int
+main(int argc, char **argv)
+{
+	long iterations = 1000000;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:")) != -1) {
+		switch (opt) {
+		case 'n':
+			iterations = atol(optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-n iterations]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	static unsigned char buf[16384] __attribute__((aligned(64)));
+	srandom(1);
+	for (unsigned i = 0; i < sizeof(buf); i++)
+		buf[i] = random();
+
+	int errors = check(buf);
+	printf("check errors=%d\n", errors);
+
+	static const int sizes[] = { 64, 128, 256, 512, 1024, 1500, 2048, 4096, 9000 };
+	for (unsigned i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		long n = iterations * 64 / sizes[i] + 1000;
+		bench(buf, sizes[i], n);
+	}
+
+	bench_update(buf, iterations);
+	return (errors ? 1 : 0);
+}
@@ -0,0 +1,59 @@
+#!/bin/sh
+#
+# run.sh -- run the NIC-free loopback benchmarks and print CSV
+# Rafael Laufer, Massimo Gallo
+#
+# Copyright (c) 2019 Nokia
+#
+# Usage: run.sh [-c click] [-j threads] [-r runs] [bench ...]
+#
+# Each benchmark is a conf/loopback-<bench>.click configuration whose
+# DriverManager prints one "bench=<name> key=value ..." line at the end,
+# which is turned into one CSV row per key.
+# With several threads, the client on core c talks to the server on core
+# c+1 (mod threads), so every packet crosses cores as it would through RSS.
+#
+
+CLICK=../../userlevel/click
+CONF=../../conf
+THREADS=2
+RUNS=1
+
+while getopts "c:j:r:" opt; do
+	case $opt in
+	c) CLICK=$OPTARG ;;
+	j) THREADS=$OPTARG ;;
+	r) RUNS=$OPTARG ;;
+	*) echo "usage: $0 [-c click] [-j threads] [-r runs] [bench ...]" >&2
+	   exit 1 ;;
+	esac
+done
+shift $((OPTIND - 1))
+
+BENCHES=${*:-"bulk bulk-wan echo echo-epollzc rpc socks ssl"}
+
+# Client core c sends to server core c+1
+PEER=""
+c=0
+while [ $c -lt $THREADS ]; do
+	PEER="$PEER $(( (c + 1) % THREADS ))"
+	c=$((c + 1))
+done
+
+echo "bench,threads,run,metric,value"
+for b in $BENCHES; do
+	r=0
+	while [ $r -lt $RUNS ]; do
+		LINE=$(cd $CONF && $CLICK -j $THREADS loopback-$b.click \
+		         PEER="$PEER" THREADS=$THREADS 2>/dev/null | grep "^bench=")
+		if [ -z "$LINE" ]; then
+			echo "$b: no result" >&2
+		fi
+
+		# One row per key=value pair
+		for kv in ${LINE#bench=* }; do
+			echo "$b,$THREADS,$r,${kv%%=*},${kv#*=}"
+		done
+		r=$((r + 1))
+	done
+done
@@ -0,0 +1,459 @@
+/*
+ * sslhandshake.cc -- TLS handshake rate with and without session resumption
+ *
+ * Runs in-memory client/server handshakes with the same SSL_CTX options as
+ * SSLServer, including its SSLSessionCache and SSLTicketKeys, and reports
+ * handshakes per second for a full handshake, resumption through the session
+ * cache, and resumption through session tickets. With several threads, all of
+ * them share the server context, so a session created by one thread is resumed
+ * by another, as when a client reconnects through a different core.
+ *
+ * Before the benchmark, checks that sessions are resumed from the local and
+ * remote core caches and that evicted ones are not, and that tickets survive a
+ * key rotation, are renewed with the newest key, and are rejected once their
+ * key has been rotated out. Exits with 1 if a check fails.
+ *
+ * Usage: sslhandshake [-m full|cache|ticket|all] [-t threads] [-d seconds]
+ *                     [-b rsa_bits] [-v 1.2|1.3] [-c cache_size] [-k]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <inttypes.h>
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+#include <click/config.h>
+#include <click/glue.hh>
+#include <click/string.hh>
+#include "elements/app/sslsessioncache.hh"
+#include "elements/app/sslticketkeys.hh"
+
+// Defined by the click driver, which is not linked in
+int click_nthreads = 1;
+
+enum { MODE_FULL, MODE_CACHE, MODE_TICKET };
+static const char *mode_name[] = { "full", "cache", "ticket" };
+
+static SSL_CTX *server_ctx;
+static SSL_CTX *client_ctx;
+static SSLSessionCache *cache;
+static SSLTicketKeys *tickets;
+static double duration = 5.0;
+static volatile bool stop;
+
+struct ThreadArg {
+	int id;
+	int mode;
+	uint64_t handshakes;
+	uint64_t resumed;
+	uint64_t errors;
+};
+
+static double
+now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static EVP_PKEY *
+make_key(int bits)
+{
+	EVP_PKEY *pkey = NULL;
+	EVP_PKEY_CTX *pctx = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, NULL);
+	if (!pctx || EVP_PKEY_keygen_init(pctx) <= 0 ||
+	    EVP_PKEY_CTX_set_rsa_keygen_bits(pctx, bits) <= 0 ||
+	    EVP_PKEY_keygen(pctx, &pkey) <= 0)
+		pkey = NULL;
+	EVP_PKEY_CTX_free(pctx);
+	return pkey;
+}
+
+static X509 *
+make_cert(EVP_PKEY *pkey)
+{
+	X509 *x509 = X509_new();
+	X509_set_version(x509, 2);
+	ASN1_INTEGER_set(X509_get_serialNumber(x509), 1);
+	X509_gmtime_adj(X509_get_notBefore(x509), 0);
+	X509_gmtime_adj(X509_get_notAfter(x509), 60*60*24);
+	X509_set_pubkey(x509, pkey);
+	X509_NAME *name = X509_get_subject_name(x509);
+	X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+	                           (const unsigned char *)"clicknf", -1, -1, 0);
+	X509_set_issuer_name(x509, name);
+	X509_sign(x509, pkey, EVP_sha256());
+	return x509;
+}
+
+static int
+setup(int mode, int bits, int version, int threads, uint32_t cache_size,
+      uint32_t ticket_keys)
+{
+	static EVP_PKEY *pkey = NULL;
+	static X509 *x509 = NULL;
+
+	if (!pkey) {
+		pkey = make_key(bits);
+		if (!pkey)
+			return -1;
+		x509 = make_cert(pkey);
+	}
+
+	SSL_CTX_free(server_ctx);
+	SSL_CTX_free(client_ctx);
+	delete cache;
+	delete tickets;
+	cache = new SSLSessionCache;
+	tickets = new SSLTicketKeys;
+
+	server_ctx = SSL_CTX_new(TLS_server_method());
+	client_ctx = SSL_CTX_new(TLS_client_method());
+	if (!server_ctx || !client_ctx)
+		return -1;
+
+	SSL_CTX_use_PrivateKey(server_ctx, pkey);
+	SSL_CTX_use_certificate(server_ctx, x509);
+	SSL_CTX_set_session_id_context(server_ctx, (const unsigned char *)"ClickNF", 7);
+	SSL_CTX_set_timeout(server_ctx, 300);
+
+	SSL_CTX_set_min_proto_version(server_ctx, version);
+	SSL_CTX_set_max_proto_version(server_ctx, version);
+	SSL_CTX_set_min_proto_version(client_ctx, version);
+	SSL_CTX_set_max_proto_version(client_ctx, version);
+	SSL_CTX_set_verify(client_ctx, SSL_VERIFY_NONE, NULL);
+
+	// Same as SSLServer::initialize(), a cache without capacity is off
+	if (cache->configure(server_ctx, threads,
+	                     (mode == MODE_CACHE ? cache_size : 0)) < 0)
+		return -1;
+
+	if (mode == MODE_TICKET) {
+		if (tickets->configure(server_ctx, threads, ticket_keys, String()) < 0)
+			return -1;
+	}
+	else
+		SSL_CTX_set_options(server_ctx, SSL_OP_NO_TICKET);
+
+	return 0;
+}
+
+// One handshake over a BIO pair, returns the session to resume next time
+static int
+handshake(SSL_SESSION **sess, bool *resumed)
+{
+	SSL *c = SSL_new(client_ctx);
+	SSL *s = SSL_new(server_ctx);
+	BIO *cb, *sb;
+	BIO_new_bio_pair(&cb, 0, &sb, 0);
+	SSL_set_bio(c, cb, cb);
+	SSL_set_bio(s, sb, sb);
+	SSL_set_connect_state(c);
+	SSL_set_accept_state(s);
+
+	if (*sess)
+		SSL_set_session(c, *sess);
+
+	int r = -1;
+	for (int i = 0; i < 16; i++) {
+		int rc = SSL_do_handshake(c);
+		int rs = SSL_do_handshake(s);
+		if (rc == 1 && rs == 1) {
+			r = 0;
+			break;
+		}
+		if (rc <= 0 && SSL_get_error(c, rc) != SSL_ERROR_WANT_READ)
+			break;
+		if (rs <= 0 && SSL_get_error(s, rs) != SSL_ERROR_WANT_READ)
+			break;
+	}
+
+	if (r == 0) {
+		// Process any TLS 1.3 NewSessionTicket sent after the handshake
+		char buf[1];
+		SSL_read(c, buf, sizeof(buf));
+
+		*resumed = SSL_session_reused(c);
+		cache->handshake_done(s);
+		SSL_SESSION *n = SSL_get1_session(c);
+		if (n) {
+			SSL_SESSION_free(*sess);
+			*sess = n;
+		}
+	}
+
+	// Mark both ends as cleanly closed, otherwise the session is dropped
+	SSL_set_shutdown(c, SSL_SENT_SHUTDOWN | SSL_RECEIVED_SHUTDOWN);
+	SSL_set_shutdown(s, SSL_SENT_SHUTDOWN | SSL_RECEIVED_SHUTDOWN);
+	SSL_free(c);
+	SSL_free(s);
+	return r;
+}
+
+static void *
+worker(void *a)
+{
+	ThreadArg *t = (ThreadArg *)a;
+	SSL_SESSION *sess = NULL;
+	click_current_thread_id = t->id;
+
+	while (!stop) {
+		bool resumed = false;
+		if (handshake(&sess, &resumed) < 0) {
+			t->errors++;
+			ERR_clear_error();
+			SSL_SESSION_free(sess);
+			sess = NULL;
+			continue;
+		}
+
+		t->handshakes++;
+		if (resumed)
+			t->resumed++;
+
+		// Without resumption, start each connection from scratch
+		if (t->mode == MODE_FULL) {
+			SSL_SESSION_free(sess);
+			sess = NULL;
+		}
+	}
+
+	SSL_SESSION_free(sess);
+	return NULL;
+}
+
+static void
+run(int mode, int threads)
+{
+	pthread_t tid[threads];
+	ThreadArg arg[threads];
+
+	stop = false;
+	double start = now();
+	for (int i = 0; i < threads; i++) {
+		memset(&arg[i], 0, sizeof(arg[i]));
+		arg[i].id = i;
+		arg[i].mode = mode;
+		pthread_create(&tid[i], NULL, worker, &arg[i]);
+	}
+
+	usleep((useconds_t)(duration * 1e6));
+	stop = true;
+
+	uint64_t handshakes = 0, resumed = 0, errors = 0;
+	for (int i = 0; i < threads; i++) {
+		pthread_join(tid[i], NULL);
+		handshakes += arg[i].handshakes;
+		resumed += arg[i].resumed;
+		errors += arg[i].errors;
+	}
+	double elapsed = now() - start;
+
+	printf("mode=%s threads=%d handshakes=%" PRIu64 " resumed=%" PRIu64
+	       " errors=%" PRIu64 " seconds=%.3f hs_per_sec=%.1f\n",
+	       mode_name[mode], threads, handshakes, resumed, errors, elapsed,
+	       handshakes / elapsed);
+	fflush(stdout);
+}
+
+// Counter from SSLSessionCache::unparse() or SSLTicketKeys::unparse()
+static uint64_t
+stat(const String &s, const char *name)
+{
+	String key = String(name) + " ";
+	int i = 0;
+	while (i >= 0 && i < s.length()) {
+		if (s.substring(i, key.length()) == key)
+			return strtoull(s.c_str() + i + key.length(), NULL, 10);
+		i = s.find_left('\n', i);
+		if (i >= 0)
+			i++;
+	}
+	return ~0ULL;
+}
+
+static int failures;
+
+static void
+expect(bool ok, const char *what)
+{
+	printf("check %s: %s\n", what, ok ? "ok" : "FAILED");
+	fflush(stdout);
+	if (!ok)
+		failures++;
+}
+
+// One handshake from the given core, returns whether it was resumed
+static bool
+connect_from(int core, SSL_SESSION **sess)
+{
+	bool resumed = false;
+	click_current_thread_id = core;
+	if (handshake(sess, &resumed) < 0) {
+		ERR_clear_error();
+		return false;
+	}
+	return resumed;
+}
+
+static int
+check(int bits, int version)
+{
+	const uint32_t capacity = 4;
+	SSL_SESSION *a = NULL, *b = NULL;
+	String st;
+
+	// Session cache: local hit, hit in another core, eviction
+	if (setup(MODE_CACHE, bits, version, 2, capacity, 0) < 0)
+		return -1;
+
+	expect(!connect_from(0, &a), "cache first handshake is full");
+	expect(connect_from(0, &a), "cache resumed on the same core");
+	expect(connect_from(1, &a), "cache resumed on another core");
+
+	st = cache->unparse();
+	expect(stat(st, "cache_hits_local") >= 1, "cache local hit counted");
+	expect(stat(st, "cache_hits_remote") >= 1, "cache remote hit counted");
+
+	// Push the session of a out with others. It is stored on core 0 with
+	// TLS 1.2, and on core 1 with TLS 1.3, which issues one per handshake.
+	for (int c = 0; c < 2; c++)
+		for (uint32_t i = 0; i < capacity; i++) {
+			SSL_SESSION_free(b);
+			b = NULL;
+			connect_from(c, &b);
+		}
+
+	st = cache->unparse();
+	expect(stat(st, "cache_evicted") >= 1, "cache evicts when full");
+	expect(stat(st, "cache_size") <= 2 * capacity, "cache bounded");
+	uint64_t misses = stat(st, "cache_misses");
+	expect(!connect_from(0, &a), "cache evicted session not resumed");
+	expect(stat(cache->unparse(), "cache_misses") > misses, "cache miss counted");
+
+	SSL_SESSION_free(a);
+	SSL_SESSION_free(b);
+	a = b = NULL;
+
+	// Tickets: resumption, renewal after a rotation, unknown once gone
+	if (setup(MODE_TICKET, bits, version, 2, 0, 2) < 0)
+		return -1;
+
+	expect(!connect_from(0, &a), "ticket first handshake is full");
+	expect(connect_from(1, &a), "ticket resumed");
+	st = tickets->unparse();
+	expect(stat(st, "tickets_issued") >= 1, "ticket issued counted");
+	expect(stat(st, "tickets_resumed") >= 1, "ticket resumed counted");
+
+	// Keep a ticket sealed with the first key
+	if (a && SSL_SESSION_up_ref(a))
+		b = a;
+
+	if (tickets->rotate() < 0)
+		return -1;
+	expect(connect_from(0, &a), "ticket old key resumed after rotation");
+	expect(stat(tickets->unparse(), "tickets_renewed") == 1, "ticket renewed");
+
+	// The renewed ticket is sealed with the newest key
+	uint64_t resumed = stat(tickets->unparse(), "tickets_resumed");
+	expect(connect_from(1, &a), "ticket renewed resumed");
+	expect(stat(tickets->unparse(), "tickets_resumed") == resumed + 1,
+	       "ticket renewed sealed with newest key");
+
+	// With two keys, another rotation drops the first one
+	if (tickets->rotate() < 0)
+		return -1;
+	expect(!connect_from(0, &b), "ticket rotated-out key not resumed");
+	expect(stat(tickets->unparse(), "tickets_unknown") == 1, "ticket unknown counted");
+
+	SSL_SESSION_free(a);
+	SSL_SESSION_free(b);
+	click_current_thread_id = 0;
+
+	return failures ? -1 : 0;
+}
+
+int
+main(int argc, char **argv)
+{
+	int threads = 1;
+	int bits = 2048;
+	int version = TLS1_3_VERSION;
+	int first = MODE_FULL, last = MODE_TICKET;
+	uint32_t cache_size = 20000;
+	bool check_only = false;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "m:t:d:b:v:c:k")) != -1) {
+		switch (opt) {
+		case 'm':
+			if (!strcmp(optarg, "all"))
+				break;
+			for (first = MODE_FULL; first <= MODE_TICKET; first++)
+				if (!strcmp(optarg, mode_name[first]))
+					break;
+			if (first > MODE_TICKET) {
+				fprintf(stderr, "unknown mode %s\n", optarg);
+				return 1;
+			}
+			last = first;
+			break;
+		case 't':
+			threads = atoi(optarg);
+			break;
+		case 'd':
+			duration = atof(optarg);
+			break;
+		case 'b':
+			bits = atoi(optarg);
+			break;
+		case 'v':
+			version = (!strcmp(optarg, "1.2") ? TLS1_2_VERSION : TLS1_3_VERSION);
+			break;
+		case 'c':
+			cache_size = atoi(optarg);
+			break;
+		case 'k':
+			check_only = true;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-m full|cache|ticket|all] [-t threads] "
+			        "[-d seconds] [-b rsa_bits] [-v 1.2|1.3] [-c cache_size] "
+			        "[-k]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	if (threads < 1)
+		threads = 1;
+
+	// Threads index the per-core caches and counters
+	click_nthreads = (threads > 2 ? threads : 2);
+
+	if (check(bits, version) < 0) {
+		fprintf(stderr, "%d checks failed\n", failures);
+		return 1;
+	}
+	if (check_only)
+		return 0;
+
+	for (int mode = first; mode <= last; mode++) {
+		if (setup(mode, bits, version, threads, cache_size, 2) < 0) {
+			fprintf(stderr, "error setting up SSL contexts\n");
+			return 1;
+		}
+		run(mode, threads);
+	}
+
+	SSL_CTX_free(server_ctx);
+	SSL_CTX_free(client_ctx);
+	delete cache;
+	delete tickets;
+	return 0;
+}
@@ -0,0 +1,186 @@
+/*
+ * tcpclock.cc -- TCPClock monotonicity, drift and cost versus clock_gettime()
+ *
+ * Checks TCPClock::now_usec() itself: the time read through it never goes
+ * backwards, also across resyncs with the system clock, and after each
+ * refresh it is within the given bound of clock_gettime(CLOCK_MONOTONIC).
+ * Then emulates the time readings of the TCP data path, where each packet
+ * reads the clock a few times (RTX timestamp, RTT estimate, TCP timestamp
+ * option, BBR pacing and delivery rate), once calling clock_gettime() for
+ * every reading, as before TCPClock, and once refreshing TCPClock per batch
+ * and reading TCPClock::now_usec(), as the driver and DPDK do. Reports
+ * nanoseconds per packet and per call. Exits with 1 if a check fails.
+ *
+ * Usage: tcpclock [-n packets] [-r reads_per_packet] [-b batch]
+ *                 [-d check_seconds] [-m max_drift_usec]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include <inttypes.h>
+#include <click/config.h>
+#include <click/glue.hh>
+#include <click/string.hh>
+#include "elements/tcp/tcpclock.hh"
+
+// Defined by the click driver, which is not linked in
+int click_nthreads = 1;
+
+static inline uint64_t
+gettime_usec()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+static inline uint64_t
+gettime_nsec()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int failures;
+
+static void
+expect(bool ok, const char *what)
+{
+	printf("check %s: %s\n", what, ok ? "ok" : "FAILED");
+	fflush(stdout);
+	if (!ok)
+		failures++;
+}
+
+// Read the clock for the given time, refreshing it every batch readings
+static void
+check(double seconds, int batch, uint64_t max_drift)
+{
+	uint64_t last = TCPClock::now_usec();
+	uint64_t backwards = 0, refreshes = 0;
+	uint64_t drift = 0, stale = 0;
+	uint64_t end = gettime_usec() + (uint64_t)(seconds * 1e6);
+
+	for (uint64_t i = 0; ; i++) {
+		if (i % batch == 0) {
+			uint64_t g0 = gettime_usec();
+			uint64_t t = TCPClock::refresh().usecval();
+			uint64_t g1 = gettime_usec();
+			refreshes++;
+
+			// The refreshed time falls within the two system readings
+			uint64_t d = (t < g0 ? g0 - t : (t > g1 ? t - g1 : 0));
+			if (d > drift)
+				drift = d;
+
+			if (g1 >= end)
+				break;
+		}
+
+		uint64_t now = TCPClock::now_usec();
+		if (now < last)
+			backwards++;
+		last = now;
+
+		// How far the cached time lags behind, one batch at most
+		uint64_t g = gettime_usec();
+		if (g > now && g - now > stale)
+			stale = g - now;
+	}
+
+	printf("refreshes=%" PRIu64 " max_drift_usec=%" PRIu64 " max_stale_usec=%" PRIu64 "\n",
+	       refreshes, drift, stale);
+	expect(backwards == 0, "now_usec() monotonic");
+	expect(drift <= max_drift, "refresh() drift bounded");
+}
+
+int
+main(int argc, char **argv)
+{
+	uint64_t packets = 10000000;
+	int reads = 6;
+	int batch = 32;
+	double seconds = 1.0;
+	uint64_t max_drift = 1000;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:r:b:d:m:")) != -1) {
+		switch (opt) {
+		case 'n':
+			packets = strtoull(optarg, NULL, 10);
+			break;
+		case 'r':
+			reads = atoi(optarg);
+			break;
+		case 'b':
+			batch = atoi(optarg);
+			break;
+		case 'd':
+			seconds = atof(optarg);
+			break;
+		case 'm':
+			max_drift = strtoull(optarg, NULL, 10);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-n packets] [-r reads_per_packet] [-b batch] "
+			        "[-d check_seconds] [-m max_drift_usec]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	if (batch < 1)
+		batch = 1;
+
+	TCPClock::calibrate();
+	expect(TCPClock::enabled(), "TSC calibrated");
+
+	// Spans several resyncs of TCP_CLOCK_RESYNC_MS
+	check(seconds, batch, max_drift);
+
+	volatile uint64_t sink = 0;
+
+	// A clock_gettime() call for every reading
+	uint64_t start = gettime_nsec();
+	for (uint64_t i = 0; i < packets; i++)
+		for (int r = 0; r < reads; r++)
+			sink += gettime_usec();
+	uint64_t end = gettime_nsec();
+	double gettime_ns = (end - start) / (double)packets;
+
+	printf("clock=gettime packets=%" PRIu64 " reads_per_packet=%d ns_per_packet=%.2f ns_per_call=%.2f\n",
+	       packets, reads, gettime_ns, gettime_ns / reads);
+
+	// One refresh per batch, cached readings in between
+	start = gettime_nsec();
+	for (uint64_t i = 0; i < packets; i++) {
+		if (i % batch == 0)
+			TCPClock::refresh();
+		for (int r = 0; r < reads; r++)
+			sink += TCPClock::now_usec();
+	}
+	end = gettime_nsec();
+	double tcpclock_ns = (end - start) / (double)packets;
+
+	printf("clock=tcpclock packets=%" PRIu64 " reads_per_packet=%d batch=%d ns_per_packet=%.2f ns_per_call=%.2f\n",
+	       packets, reads, batch, tcpclock_ns, tcpclock_ns / reads);
+
+	// Refresh alone, as done once per driver iteration or RX batch
+	start = gettime_nsec();
+	for (uint64_t i = 0; i < packets; i++)
+		sink += TCPClock::refresh().nsecval();
+	end = gettime_nsec();
+
+	printf("clock=refresh calls=%" PRIu64 " ns_per_call=%.2f\n",
+	       packets, (end - start) / (double)packets);
+
+	String s = TCPClock::unparse();
+	fputs(s.c_str(), stdout);
+
+	if (failures) {
+		fprintf(stderr, "%d checks failed\n", failures);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,132 @@
+/*
+ * tcptrace.cc -- decode TCPTrace records into CSV
+ *
+ * Reads a trace written by TCPTrace, either through its FILENAME or its
+ * "drain" handler, and prints one CSV row per record. Records are drained
+ * core by core, so -s sorts them by timestamp to interleave the cores.
+ * The output of several drains can be concatenated into the same input.
+ *
+ * Usage: tcptrace [-s] [-e event] [-p port] [file]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <inttypes.h>
+#include <arpa/inet.h>
+#include <vector>
+#include <algorithm>
+#include "../../elements/tcp/tcptracerecord.h"
+
+static const char *event_name[TCP_TRACE_MAX] = {
+	"header", "ack", "rto", "loss", "pace", "state"
+};
+
+static const char *state_name[] = {
+	"CLOSED", "LISTEN", "SYN_SENT", "SYN_RECV", "ESTABLISHED", "FIN_WAIT1",
+	"FIN_WAIT2", "CLOSING", "TIME_WAIT", "CLOSE_WAIT", "LAST_ACK"
+};
+
+static bool
+by_time(const TCPTraceRecord &a, const TCPTraceRecord &b)
+{
+	return a.tstamp < b.tstamp;
+}
+
+static void
+print(const TCPTraceRecord &r, uint64_t t0)
+{
+	char saddr[INET_ADDRSTRLEN], daddr[INET_ADDRSTRLEN];
+	inet_ntop(AF_INET, &r.saddr, saddr, sizeof(saddr));
+	inet_ntop(AF_INET, &r.daddr, daddr, sizeof(daddr));
+
+	const char *event = (r.event < TCP_TRACE_MAX ? event_name[r.event] : "?");
+	const char *state = (r.state < sizeof(state_name)/sizeof(state_name[0]) ?
+	                     state_name[r.state] : "?");
+
+	printf("%.9f,%u,%s,%s,%s,%u,%s,%u,%u,%u,%u,%u,%u,%u,%u,%u,%" PRIu64 "\n",
+	       (r.tstamp - t0) * 1e-9, r.core, event, state,
+	       saddr, ntohs(r.sport), daddr, ntohs(r.dport),
+	       r.snd_una, r.snd_nxt, r.snd_cwnd, r.snd_ssthresh, r.snd_wnd,
+	       r.rcv_nxt, r.srtt, r.rto, r.value);
+}
+
+int
+main(int argc, char **argv)
+{
+	bool sort = false;
+	int event = 0;
+	int port = 0;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "se:p:")) != -1) {
+		switch (opt) {
+		case 's':
+			sort = true;
+			break;
+		case 'e':
+			for (event = 1; event < TCP_TRACE_MAX; event++)
+				if (!strcmp(optarg, event_name[event]))
+					break;
+			if (event == TCP_TRACE_MAX) {
+				fprintf(stderr, "unknown event %s\n", optarg);
+				return 1;
+			}
+			break;
+		case 'p':
+			port = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-s] [-e event] [-p port] [file]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	FILE *f = stdin;
+	if (optind < argc && !(f = fopen(argv[optind], "r"))) {
+		perror(argv[optind]);
+		return 1;
+	}
+
+	std::vector<TCPTraceRecord> v;
+	TCPTraceRecord r;
+	bool header = false;
+	while (fread(&r, sizeof(r), 1, f) == 1) {
+		// Each drained chunk starts with a header record
+		if (r.event == TCP_TRACE_HEADER) {
+			if (r.value != TCP_TRACE_HEADER_VALUE) {
+				fprintf(stderr, "not a TCPTrace file, or a different version\n");
+				return 1;
+			}
+			header = true;
+			continue;
+		}
+		if (!header) {
+			fprintf(stderr, "not a TCPTrace file\n");
+			return 1;
+		}
+
+		if (event && r.event != event)
+			continue;
+		if (port && ntohs(r.sport) != port && ntohs(r.dport) != port)
+			continue;
+		v.push_back(r);
+	}
+
+	if (f != stdin)
+		fclose(f);
+
+	if (sort)
+		std::stable_sort(v.begin(), v.end(), by_time);
+
+	uint64_t t0 = UINT64_MAX;
+	for (size_t i = 0; i < v.size(); i++)
+		t0 = std::min(t0, v[i].tstamp);
+
+	printf("time,core,event,state,saddr,sport,daddr,dport,snd_una,snd_nxt,"
+	       "snd_cwnd,snd_ssthresh,snd_wnd,rcv_nxt,srtt_us,rto_ms,value\n");
+	for (size_t i = 0; i < v.size(); i++)
+		print(v[i], t0);
+
+	return 0;
+}
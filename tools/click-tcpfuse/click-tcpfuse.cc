@@ -0,0 +1,823 @@
+/*
+ * click-tcpfuse.cc -- fuse TCP element chains into specialized elements
+ * Rafael Laufer, Massimo Gallo
+ *
+ * Copyright (c) 2019 Nokia Bell Labs
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+ *    in the documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ */
+
+
+#include <click/config.h>
+#include <click/pathvars.h>
+
+#include "routert.hh"
+#include "lexert.hh"
+#include "processingt.hh"
+#include <click/error.hh>
+#include <click/confparse.hh>
+#include <click/straccum.hh>
+#include <click/clp.h>
+#include <click/driver.hh>
+#include "toolutils.hh"
+#include "elementmap.hh"
+#include <click/md5.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <unistd.h>
+
+#define HELP_OPT		300
+#define VERSION_OPT		301
+#define CLICKPATH_OPT		302
+#define ROUTER_OPT		303
+#define EXPRESSION_OPT		304
+#define OUTPUT_OPT		305
+#define KERNEL_OPT		306
+#define USERLEVEL_OPT		307
+#define SOURCE_OPT		308
+#define CONFIG_OPT		309
+#define CONGCTRL_OPT		310
+#define PRUNE_OPT		311
+#define QUIET_OPT		312
+#define VERBOSE_OPT		313
+
+static const Clp_Option options[] = {
+    { "clickpath", 'C', CLICKPATH_OPT, Clp_ValString, 0 },
+    { "config", 'c', CONFIG_OPT, 0, Clp_Negate },
+    { "congctrl", 'g', CONGCTRL_OPT, Clp_ValString, 0 },
+    { "expression", 'e', EXPRESSION_OPT, Clp_ValString, 0 },
+    { "file", 'f', ROUTER_OPT, Clp_ValString, 0 },
+    { "help", 0, HELP_OPT, 0, 0 },
+    { "kernel", 'k', KERNEL_OPT, 0, 0 },
+    { "output", 'o', OUTPUT_OPT, Clp_ValString, 0 },
+    { "prune", 0, PRUNE_OPT, 0, Clp_Negate },
+    { "quiet", 'q', QUIET_OPT, 0, Clp_Negate },
+    { "source", 's', SOURCE_OPT, 0, Clp_Negate },
+    { "user", 'u', USERLEVEL_OPT, 0, 0 },
+    { "verbose", 'V', VERBOSE_OPT, 0, Clp_Negate },
+    { "version", 'v', VERSION_OPT, 0, 0 }
+};
+
+static const char *program_name;
+static String click_buildtool_prog;
+static int compile_quiet;
+static bool verbose;
+
+// Congestion control names, in the order of TCPClassifier outputs
+static const char *congctrl_names[] = { "newreno", "dctcp", "bbr" };
+#define NCONGCTRL 3
+
+void
+short_usage()
+{
+    fprintf(stderr, "Usage: %s [OPTION]... [ROUTERFILE]\n\
+Try '%s --help' for more information.\n",
+	    program_name, program_name);
+}
+
+void
+usage()
+{
+    printf("\
+'Click-tcpfuse' transforms a router configuration by replacing linear chains\n\
+of TCP elements with generated elements that call each element's processing\n\
+function directly, and by removing the TCPClassifier branches of unused\n\
+congestion control algorithms. The resulting configuration has both\n\
+Click-language files and object files.\n\
+\n\
+Usage: %s [OPTION]... [ROUTERFILE]\n\
+\n\
+Options:\n\
+  -f, --file FILE               Read router configuration from FILE.\n\
+  -e, --expression EXPR         Use EXPR as router configuration.\n\
+  -o, --output FILE             Write output to FILE.\n\
+  -g, --congctrl ALG            Congestion control: newreno, dctcp, or bbr.\n\
+                                Default is the CONGCTRL of TCPInfo.\n\
+      --no-prune                Keep all TCPClassifier branches.\n\
+  -k, --kernel                  Compile into Linux kernel binary package.\n\
+  -u, --user                    Compile into user-level binary package.\n\
+  -s, --source                  Write source code only.\n\
+  -c, --config                  Write new configuration only.\n\
+  -q, --quiet                   Compile any packages quietly.\n\
+  -V, --verbose                 Print the fused chains.\n\
+  -C, --clickpath PATH          Use PATH for CLICKPATH.\n\
+      --help                    Print this message and exit.\n\
+  -v, --version                 Print version number and exit.\n", program_name);
+}
+
+
+/*
+ * congestion control
+ */
+
+static int
+parse_congctrl(const String &s)
+{
+    int cc;
+    if (cp_integer(s, &cc) && cc >= 0 && cc < NCONGCTRL)
+	return cc;
+    for (cc = 0; cc < NCONGCTRL; cc++)
+	if (s.equals(congctrl_names[cc], -1))
+	    return cc;
+    return -1;
+}
+
+// Returns the CONGCTRL keyword of the first TCPInfo, or 0
+static int
+router_congctrl(RouterT *r, ErrorHandler *errh)
+{
+    ElementClassT *t = ElementClassT::base_type("TCPInfo");
+    for (RouterT::type_iterator x = r->begin_elements(t); x; x++) {
+	Vector<String> args;
+	cp_argvec(x->configuration(), args);
+	for (int i = 0; i < args.size(); i++) {
+	    String value = args[i];
+	    if (cp_shift_spacevec(value) != "CONGCTRL")
+		continue;
+	    int cc = parse_congctrl(value);
+	    if (cc < 0)
+		errh->fatal("%s: bad CONGCTRL %<%s%>", x->name_c_str(), value.c_str());
+	    return cc;
+	}
+    }
+    return 0;
+}
+
+// Connects the inputs of each TCPClassifier to the branch of the selected
+// congestion control, then removes the elements only reachable through the
+// other branches
+static int
+prune_classifiers(RouterT *r, int cc)
+{
+    ElementClassT *t = ElementClassT::base_type("TCPClassifier");
+    Vector<int> orphans;
+    int pruned = 0;
+
+    for (RouterT::type_iterator x = r->begin_elements(t); x; x++) {
+	Vector<PortT> from, branch;
+	r->find_connections_to(PortT(x.get(), 0), from);
+	r->find_connections_from(PortT(x.get(), cc), branch);
+	if (branch.size() != 1)
+	    continue;
+
+	for (int i = 0; i < from.size(); i++)
+	    r->add_connection(from[i], branch[0], x->landmarkt());
+
+	for (RouterT::conn_iterator it = r->find_connections_from(x.get()); it; ++it)
+	    if (it->to() != branch[0])
+		orphans.push_back(it->to().eindex());
+
+	x->kill();
+	pruned++;
+    }
+
+    // Remove elements left without inputs, and whatever they fed
+    while (orphans.size()) {
+	ElementT *e = r->element(orphans.back());
+	orphans.pop_back();
+	if (e->dead())
+	    continue;
+
+	bool fed = false;
+	for (RouterT::conn_iterator it = r->find_connections_to(e); it && !fed; ++it)
+	    fed = it->from_element()->live();
+	if (fed)
+	    continue;
+
+	for (RouterT::conn_iterator it = r->find_connections_from(e); it; ++it)
+	    orphans.push_back(it->to().eindex());
+	e->kill();
+    }
+
+    r->remove_dead_elements();
+    return pruned;
+}
+
+
+/*
+ * chains
+ */
+
+// Next C++ token in [s, end), skipping whitespace, comments, literals and
+// preprocessor lines; empty at the end
+static String
+next_token(const char *&s, const char *end)
+{
+    while (s != end) {
+	if (isspace((unsigned char) *s))
+	    s++;
+	else if (*s == '#' || (*s == '/' && s + 1 != end && s[1] == '/')) {
+	    while (s != end && *s != '\n')
+		s++;
+	} else if (*s == '/' && s + 1 != end && s[1] == '*') {
+	    for (s += 2; s != end && !(*s == '*' && s + 1 != end && s[1] == '/'); s++)
+		/* nada */;
+	    s = (s == end ? end : s + 2);
+	} else if (*s == '"' || *s == '\'') {
+	    char q = *s;
+	    for (s++; s != end && *s != q; s++)
+		if (*s == '\\' && s + 1 != end)
+		    s++;
+	    if (s != end)
+		s++;
+	} else
+	    break;
+    }
+    if (s == end)
+	return String();
+
+    const char *t = s;
+    if (isalpha((unsigned char) *s) || *s == '_') {
+	while (s != end && (isalnum((unsigned char) *s) || *s == '_'))
+	    s++;
+    } else if (*s == ':' && s + 1 != end && s[1] == ':')
+	s += 2;
+    else
+	s++;
+    return String(t, s - t);
+}
+
+// True iff the definition of class @a cxx in header @a text declares exactly
+// one Packet *smaction(Packet *...), and it is public. Anything unexpected,
+// e.g., no definition, overloads or an inherited smaction(), returns false.
+static bool
+smaction_public(const String &text, const String &cxx)
+{
+    const char *s = text.begin(), *end = text.end();
+    String tok, last, prev;
+
+    // Find the class definition, not a forward declaration
+    bool is_struct = false;
+    while (1) {
+	while ((tok = next_token(s, end)) && tok != "class" && tok != "struct")
+	    /* nada */;
+	if (!tok)
+	    return false;
+	is_struct = (tok == "struct");
+	if (next_token(s, end) != cxx)
+	    continue;
+	while ((tok = next_token(s, end)) && tok != "{" && tok != ";")
+	    /* nada */;
+	if (!tok)
+	    return false;
+	if (tok == "{")
+	    break;
+    }
+
+    // Walk its body, tracking the access level at the class scope
+    bool is_public = is_struct, found = false, ok = false;
+    int depth = 1;
+    while (depth > 0 && (tok = next_token(s, end))) {
+	if (tok == "{")
+	    depth++;
+	else if (tok == "}")
+	    depth--;
+	else if (depth == 1 && (tok == "public" || tok == "private" || tok == "protected")) {
+	    const char *t = s;
+	    if (next_token(t, end) == ":") {
+		is_public = (tok == "public");
+		s = t;
+	    }
+	} else if (depth == 1 && tok == "smaction") {
+	    const char *t = s;
+	    if (next_token(t, end) != "(")
+		continue;
+	    bool sig = (prev == "Packet" && last == "*"
+			&& next_token(t, end) == "Packet" && next_token(t, end) == "*");
+	    if (found || !sig)
+		return false;
+	    found = true;
+	    ok = is_public;
+	}
+	prev = last;
+	last = tok;
+    }
+
+    return found && ok;
+}
+
+// An element is fusable if its push() only wraps a public smaction()
+static bool
+fusable_class(ElementMap &emap, const String &name, HashTable<String, int> &cache)
+{
+    int &known = cache[name];
+    if (known)
+	return known > 0;
+    known = -1;
+
+    if (!emap.has_traits(name))
+	return false;
+    const ElementTraits &t = emap.traits(name);
+    if (!t.header_file || !t.cxx)
+	return false;
+
+    // Only TCP elements, whose push() does nothing but call smaction()
+    // and forward the result on output 0
+    if (t.header_file.find_left("elements/tcp/") < 0 || !t.source_file)
+	return false;
+
+    String hfn = clickpath_find_file(t.header_file, 0, emap.source_directory(t));
+    String cfn = clickpath_find_file(t.source_file, 0, emap.source_directory(t));
+    if (!hfn || !cfn)
+	return false;
+
+    // The generated element calls smaction() from outside the class
+    String text = file_string(hfn);
+    if (!smaction_public(text, t.cxx))
+	return false;
+
+    text = file_string(cfn);
+    int pos = text.find_left(t.cxx + "::push(int");
+    int end = (pos >= 0 ? text.find_left("\n}", pos) : -1);
+    if (end < 0)
+	return false;
+
+    StringAccum sa;
+    for (const char *s = text.begin() + pos; s != text.begin() + end + 2; s++)
+	if (!isspace((unsigned char) *s))
+	    sa << *s;
+    String body = sa.take_string();
+    String args = t.cxx + "::push(int,Packet*p){";
+    if (body == args + "if(Packet*q=smaction(p))output(0).push(q);}"
+	|| body == args + "p=smaction(p);if(likely(p))output(0).push(p);}")
+	known = 1;
+    return known > 0;
+}
+
+static String
+header_path(ElementMap &emap, const String &name)
+{
+    const ElementTraits &t = emap.traits(name);
+    return clickpath_find_file(t.header_file, 0, emap.source_directory(t));
+}
+
+// The single element that @a e pushes to on output 0, if the chain can
+// continue through it
+static ElementT *
+chain_next(RouterT *r, ProcessingT &proc, ElementT *e, const Vector<int> &fusable)
+{
+    Vector<PortT> out;
+    r->find_connections_from(PortT(e, 0), out);
+    if (out.size() != 1 || out[0].port != 0 || !proc.output_is_push(e->eindex(), 0))
+	return 0;
+
+    ElementT *f = out[0].element;
+    if (f == e || !fusable[f->eindex()])
+	return 0;
+
+    int nin = 0;
+    for (RouterT::conn_iterator it = r->find_connections_to(f); it; ++it)
+	nin++;
+    if (nin != 1)
+	return 0;
+
+    return f;
+}
+
+static void
+find_chains(RouterT *r, ProcessingT &proc, ElementMap &emap,
+	    Vector<Vector<int> > &chains)
+{
+    HashTable<String, int> cache(0);
+    Vector<int> fusable(r->nelements(), 0);
+    Vector<int> has_prev(r->nelements(), 0);
+
+    for (int i = 0; i < r->nelements(); i++) {
+	ElementT *e = r->element(i);
+	fusable[i] = e->live() && fusable_class(emap, e->type_name(), cache);
+    }
+
+    for (int i = 0; i < r->nelements(); i++)
+	if (fusable[i])
+	    if (ElementT *f = chain_next(r, proc, r->element(i), fusable))
+		has_prev[f->eindex()] = 1;
+
+    for (int i = 0; i < r->nelements(); i++) {
+	if (!fusable[i] || has_prev[i])
+	    continue;
+
+	Vector<int> chain;
+	ElementT *e = r->element(i);
+	do {
+	    chain.push_back(e->eindex());
+	    e = chain_next(r, proc, e, fusable);
+	} while (e && chain.size() < r->nelements());
+
+	if (chain.size() > 1)
+	    chains.push_back(chain);
+    }
+}
+
+
+/*
+ * code generation
+ */
+
+static String
+translate_class_name(const String &s)
+{
+    StringAccum sa;
+    for (int i = 0; i < s.length(); i++)
+	if (s[i] == '_')
+	    sa << "_u";
+	else if (s[i] == '@')
+	    sa << "_a";
+	else if (s[i] == '/')
+	    sa << "_s";
+	else
+	    sa << s[i];
+    return sa.take_string();
+}
+
+static void
+output_fused_class(const String &eclass, const String &cxx,
+		   const Vector<String> &types, ElementMap &emap,
+		   StringAccum &header, StringAccum &source)
+{
+    header << "class " << cxx << " final : public Element { public:\n\
+  " << cxx << "() { }\n\
+  const char *class_name() const { return \"" << eclass << "\"; }\n\
+  const char *port_count() const { return PORTS_1_1; }\n\
+  const char *processing() const { return PUSH; }\n\
+  int configure(Vector<String> &, ErrorHandler *);\n\
+  void push(int, Packet *) final;\n\
+ private:\n";
+    for (int i = 0; i < types.size(); i++)
+	header << "  " << emap.traits(types[i]).cxx << " *_e" << i << ";\n";
+    header << "};\n";
+
+    source << "int\n" << cxx << "::configure(Vector<String> &conf, ErrorHandler *errh)\n{\n\
+  return Args(conf, this, errh)\n";
+    for (int i = 0; i < types.size(); i++)
+	source << "    .read_mp(\"E" << i << "\", ElementCastArg(\"" << types[i]
+	       << "\"), _e" << i << ")\n";
+    source << "    .complete();\n}\n";
+
+    // Each smaction() either returns the packet or has consumed it
+    source << "void\n" << cxx << "::push(int, Packet *p)\n{\n";
+    for (int i = 0; i < types.size(); i++)
+	source << "  if (!(p = _e" << i << "->smaction(p)))\n    return;\n";
+    source << "  output(0).push(p);\n}\n";
+}
+
+static void
+fuse_chains(RouterT *r, ElementMap &emap, const Vector<Vector<int> > &chains,
+	    const String &package_name, int compile_drivers, ErrorHandler *errh)
+{
+    StringAccum header, source, source_body;
+    header << "#ifndef CLICK_" << package_name << "_HH\n"
+	   << "#define CLICK_" << package_name << "_HH\n"
+	   << "#include <click/package.hh>\n#include <click/element.hh>\n";
+
+    // One class per distinct sequence of element classes
+    HashTable<String, int> class_map(-1);
+    HashTable<String, int> included(0);
+    Vector<String> eclass_names, cxxclass_names;
+    Vector<int> chain_class;
+
+    for (int c = 0; c < chains.size(); c++) {
+	Vector<String> types;
+	StringAccum sa;
+	for (int i = 0; i < chains[c].size(); i++) {
+	    types.push_back(r->element(chains[c][i])->type_name());
+	    sa << types.back() << ' ';
+	}
+	String key = sa.take_string();
+
+	int k = class_map.get(key);
+	if (k < 0) {
+	    k = eclass_names.size();
+	    class_map.set(key, k);
+	    eclass_names.push_back("TCPFused@@" + String(k));
+	    cxxclass_names.push_back(translate_class_name("TCPFused@@" + package_name + "@" + String(k)));
+
+	    for (int i = 0; i < types.size(); i++)
+		if (!included[types[i]]++)
+		    header << "#include \"" << header_path(emap, types[i]) << "\"\n";
+	    output_fused_class(eclass_names[k], cxxclass_names[k], types, emap,
+			       header, source_body);
+	}
+	chain_class.push_back(k);
+    }
+    header << "#endif\n";
+
+    // Rewire: the fused element takes over the inputs of the first element
+    // and the output of the last one. The chain stays in place, hooked to an
+    // Idle element, for its other outputs and handlers.
+    ElementT *idle = r->get_element("tcpfuse@idle", ElementClassT::base_type("Idle"),
+				    String(), LandmarkT("<click-tcpfuse>"));
+    for (int c = 0; c < chains.size(); c++) {
+	ElementT *first = r->element(chains[c][0]);
+	ElementT *last = r->element(chains[c].back());
+
+	Vector<String> names;
+	for (int i = 0; i < chains[c].size(); i++)
+	    names.push_back(r->element(chains[c][i])->name());
+
+	ElementClassT *t = ElementClassT::base_type(eclass_names[chain_class[c]]);
+	ElementT *fused = r->get_element(first->name() + "@fused", t,
+					 cp_unargvec(names), first->landmarkt());
+
+	Vector<PortT> in, out;
+	r->find_connections_to(PortT(first, 0), in);
+	r->find_connections_from(PortT(last, 0), out);
+	for (RouterT::conn_iterator it = r->find_connections_to(PortT(first, 0)); it; )
+	    it = r->erase(it);
+	for (RouterT::conn_iterator it = r->find_connections_from(PortT(last, 0)); it; )
+	    it = r->erase(it);
+
+	for (int i = 0; i < in.size(); i++)
+	    r->add_connection(in[i], PortT(fused, 0));
+	for (int i = 0; i < out.size(); i++)
+	    r->add_connection(PortT(fused, 0), out[i]);
+	r->add_connection(PortT(idle, c), PortT(first, 0));
+	r->add_connection(PortT(last, 0), PortT(idle, c));
+
+	if (verbose) {
+	    StringAccum sa;
+	    for (int i = 0; i < names.size(); i++)
+		sa << (i ? " -> " : "") << names[i];
+	    errh->message("%s: %s", fused->name_c_str(), sa.c_str());
+	}
+    }
+
+    r->add_requirement("package", package_name);
+
+    source << "/** click-compile: -w */\n";
+    {
+	StringAccum elem2package, cmd_sa;
+	for (int i = 0; i < eclass_names.size(); i++)
+	    elem2package << "-\t\"" << package_name << ".hh\"\t" << cxxclass_names[i] << '-' << eclass_names[i] << '\n';
+	cmd_sa << click_buildtool_prog << " elem2package " << package_name;
+	source << shell_command_output_string(cmd_sa.take_string(), elem2package.take_string(), errh);
+    }
+    source << "#include <click/args.hh>\nCLICK_DECLS\n" << source_body << "CLICK_ENDDECLS\n";
+
+    // add source files to archive
+    {
+	ArchiveElement ae = init_archive_element(package_name + ".cc", 0600);
+	ae.data = source.take_string();
+	r->add_archive(ae);
+
+	ae.name = package_name + ".hh";
+	ae.data = header.take_string();
+	r->add_archive(ae);
+    }
+
+    // add compiled versions to archive
+    if (compile_drivers) {
+	int source_ae = r->archive_index(package_name + ".cc");
+	BailErrorHandler berrh(errh);
+	bool tmpdir_populated = false;
+
+	if (compile_drivers & (1 << Driver::LINUXMODULE))
+	    if (String fn = click_compile_archive_file(r->archive(), &r->archive()[source_ae], package_name, "linuxmodule", compile_quiet, tmpdir_populated, &berrh)) {
+		ArchiveElement ae = init_archive_element(package_name + ".ko", 0600);
+		ae.data = file_string(fn, errh);
+		r->add_archive(ae);
+	    }
+
+	if (compile_drivers & (1 << Driver::USERLEVEL))
+	    if (String fn = click_compile_archive_file(r->archive(), &r->archive()[source_ae], package_name, "userlevel", compile_quiet, tmpdir_populated, &berrh)) {
+		ArchiveElement ae = init_archive_element(package_name + ".uo", 0600);
+		ae.data = file_string(fn, errh);
+		r->add_archive(ae);
+	    }
+    }
+
+    // add elementmap to archive
+    {
+	String emap_package = "elementmap-" + package_name + ".xml";
+	if (r->archive_index(emap_package) < 0)
+	    r->add_archive(init_archive_element(emap_package, 0600));
+	ArchiveElement &ae = r->archive(emap_package);
+	ElementMap em(ae.data);
+	ElementTraits t;
+	t.header_file = package_name + ".hh";
+	t.source_file = package_name + ".cc";
+	t.port_count_code = "1/1";
+	t.processing_code = "h/h";
+	t.flow_code = "x/x";
+	for (int i = 0; i < eclass_names.size(); i++) {
+	    t.name = eclass_names[i];
+	    t.cxx = cxxclass_names[i];
+	    em.add(t);
+	}
+	ae.data = em.unparse("tcpfuse");
+    }
+}
+
+int
+main(int argc, char **argv)
+{
+    click_static_initialize();
+    CLICK_DEFAULT_PROVIDES;
+    ErrorHandler *errh = new PrefixErrorHandler(ErrorHandler::default_handler(), "click-tcpfuse: ");
+
+    // read command line arguments
+    Clp_Parser *clp =
+	Clp_NewParser(argc, argv, sizeof(options) / sizeof(options[0]), options);
+    Clp_SetOptionChar(clp, '+', Clp_ShortNegated);
+    program_name = Clp_ProgramName(clp);
+
+    const char *router_file = 0;
+    const char *output_file = 0;
+    int compile_drivers = 0;
+    int congctrl = -1;
+    bool prune = true;
+    bool source_only = false;
+    bool config_only = false;
+    bool file_is_expr = false;
+
+    while (1) {
+	int opt = Clp_Next(clp);
+	switch (opt) {
+
+	case HELP_OPT:
+	    usage();
+	    exit(0);
+	    break;
+
+	case VERSION_OPT:
+	    printf("click-tcpfuse (Click) %s\n", CLICK_VERSION);
+	    printf("Copyright (c) 2019 Nokia Bell Labs\n\
+This is free software; see the source for copying conditions.\n\
+There is NO warranty, not even for merchantability or fitness for a\n\
+particular purpose.\n");
+	    exit(0);
+	    break;
+
+	case CLICKPATH_OPT:
+	    set_clickpath(clp->vstr);
+	    break;
+
+	case ROUTER_OPT:
+	case EXPRESSION_OPT:
+	router_file:
+	    if (router_file) {
+		errh->error("router configuration specified twice");
+		goto bad_option;
+	    }
+	    router_file = clp->vstr;
+	    file_is_expr = (opt == EXPRESSION_OPT);
+	    break;
+
+	case Clp_NotOption:
+	    if (!click_maybe_define(clp->vstr, errh))
+		goto router_file;
+	    break;
+
+	case OUTPUT_OPT:
+	    if (output_file) {
+		errh->error("output file specified twice");
+		goto bad_option;
+	    }
+	    output_file = clp->vstr;
+	    break;
+
+	case CONGCTRL_OPT:
+	    congctrl = parse_congctrl(clp->vstr);
+	    if (congctrl < 0) {
+		errh->error("unknown congestion control %<%s%>", clp->vstr);
+		goto bad_option;
+	    }
+	    break;
+
+	case PRUNE_OPT:
+	    prune = !clp->negated;
+	    break;
+
+	case SOURCE_OPT:
+	    source_only = !clp->negated;
+	    break;
+
+	case CONFIG_OPT:
+	    config_only = !clp->negated;
+	    break;
+
+	case KERNEL_OPT:
+	    compile_drivers |= 1 << Driver::LINUXMODULE;
+	    break;
+
+	case USERLEVEL_OPT:
+	    compile_drivers |= 1 << Driver::USERLEVEL;
+	    break;
+
+	case QUIET_OPT:
+	    if (!clp->negated)
+		compile_quiet = 1;
+	    else if (compile_quiet == 1)
+		compile_quiet = 0;
+	    break;
+
+	case VERBOSE_OPT:
+	    verbose = !clp->negated;
+	    if (!clp->negated)
+		compile_quiet = -1;
+	    else if (compile_quiet == -1)
+		compile_quiet = 0;
+	    break;
+
+	bad_option:
+	case Clp_BadOption:
+	    short_usage();
+	    exit(1);
+	    break;
+
+	case Clp_Done:
+	    goto done;
+
+	}
+    }
+
+ done:
+    RouterT *r = read_router(router_file, file_is_expr, errh);
+    if (r)
+	r->flatten(errh);
+    if (!r || errh->nerrors() > 0)
+	exit(1);
+    if (source_only || config_only)
+	compile_drivers = 0;
+
+    // open output file
+    FILE *outf = stdout;
+    if (output_file && strcmp(output_file, "-") != 0) {
+	outf = fopen(output_file, "w");
+	if (!outf)
+	    errh->fatal("%s: %s", output_file, strerror(errno));
+    }
+
+    // find and parse elementmap
+    ElementMap emap;
+    emap.parse_all_files(r, CLICK_DATADIR, errh);
+    click_buildtool_prog = clickpath_find_file("click-buildtool", "bin", CLICK_BINDIR, errh);
+
+    // drop the branches of unused congestion control algorithms
+    if (congctrl < 0)
+	congctrl = router_congctrl(r, errh);
+    if (prune) {
+	int n = prune_classifiers(r, congctrl);
+	if (verbose)
+	    errh->message("%s: pruned %d TCPClassifiers", congctrl_names[congctrl], n);
+    }
+
+    // find chains
+    Vector<Vector<int> > chains;
+    {
+	ProcessingT proc(r, &emap, errh);
+	find_chains(r, proc, emap, chains);
+    }
+
+    // figure out package name
+    String package_name;
+    {
+	md5_state_t pms;
+	char buf[MD5_TEXT_DIGEST_MAX_SIZE];
+	String s = r->configuration_string();
+	md5_init(&pms);
+	md5_append(&pms, (const md5_byte_t *) s.data(), s.length());
+	int buflen = md5_finish_text(&pms, buf, 0);
+	md5_free(&pms);
+	package_name = "clicktf_" + String(buf, buflen);
+    }
+
+    if (chains.size())
+	fuse_chains(r, emap, chains, package_name, compile_drivers, errh);
+    else if (source_only)
+	errh->message("no TCP element chains in router");
+
+    // write output
+    if (source_only) {
+	if (r->archive_index(package_name + ".hh") < 0)
+	    exit(chains.size() ? 1 : 0);
+	const ArchiveElement &aeh = r->archive(package_name + ".hh");
+	const ArchiveElement &aec = r->archive(package_name + ".cc");
+	ignore_result(fwrite(aeh.data.data(), 1, aeh.data.length(), outf));
+	ignore_result(fwrite(aec.data.data(), 1, aec.data.length(), outf));
+    } else if (config_only) {
+	String config = r->configuration_string();
+	ignore_result(fwrite(config.data(), 1, config.length(), outf));
+    } else
+	write_router_file(r, outf, errh);
+
+    exit(0);
+}